@@ -144,6 +144,10 @@ define(`SHMEM_BIND_C_COLL_CMPLX', dnl args: macro_name, op_name, op_const
 `$1(complexf, float _Complex, `SHM_INTERNAL_FLOAT_COMPLEX', `$2', `$3')
 $1(complexd, double _Complex,`SHM_INTERNAL_DOUBLE_COMPLEX',`$2', `$3')')dnl
 dnl
+define(`SHMEMX_BIND_C_COLL_HALF', dnl args: macro_name, op_name, op_const
+`$1(float16,  shmemx_float16_t,  `SHM_INTERNAL_FLOAT16',  `$2', `$3')
+$1(bfloat16, shmemx_bfloat16_t, `SHM_INTERNAL_BFLOAT16', `$2', `$3')')dnl
+dnl
 define(`SHMEM_DECLARE_FOR_RMA', `SHMEM_BIND_C_RMA(`$1',`;');')dnl
 define(`SHMEM_DECLARE_FOR_AMO', `SHMEM_BIND_C_AMO(`$1',`;');')dnl
 define(`SHMEM_DECLARE_FOR_SIZES', `SHMEM_BIND_C_SIZES(`$1',`;');')dnl
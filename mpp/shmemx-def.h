@@ -10,6 +10,43 @@ extern "C" {
 
 #define HAVE_SHMEMX_WTIME
 
+/* Color passed to shmemx_team_split_color by PEs that join no team */
+#define SHMEMX_TEAM_COLOR_UNDEFINED (-1)
+
+/* Doorbell bitmap for shmemx_TYPENAME_wait_until_any_doorbell.  The vars
+ * array is divided into SHMEMX_DOORBELL_LINE byte lines, counted from its
+ * first element, and each line is covered by one bit of the doorbell.  After
+ * updating an element, writers fence and then set its bit with
+ * shmem_uint64_atomic_or(&doorbell[SHMEMX_DOORBELL_WORD(idx, size)],
+ * SHMEMX_DOORBELL_BIT(idx, size), pe), where size is the element size. */
+#define SHMEMX_DOORBELL_LINE 64
+#define SHMEMX_DOORBELL_NWORDS(nelems, size)                                   \
+    ((((nelems) * (size) + SHMEMX_DOORBELL_LINE - 1) / SHMEMX_DOORBELL_LINE + 63) / 64)
+#define SHMEMX_DOORBELL_WORD(idx, size)                                        \
+    ((idx) * (size) / SHMEMX_DOORBELL_LINE / 64)
+#define SHMEMX_DOORBELL_BIT(idx, size)                                         \
+    ((uint64_t) 1 << ((idx) * (size) / SHMEMX_DOORBELL_LINE % 64))
+
+/* Element types of the half-precision team reductions: IEEE 754 binary16
+ * and bfloat16 (the upper 16 bits of a binary32).  They are the compiler's
+ * native types when it provides them, and otherwise hold the bit pattern. */
+#if defined(__FLT16_MAX__)
+typedef _Float16 shmemx_float16_t;
+#else
+typedef uint16_t shmemx_float16_t;
+#endif
+
+#if defined(__BFLT16_MAX__)
+typedef __bf16 shmemx_bfloat16_t;
+#else
+typedef uint16_t shmemx_bfloat16_t;
+#endif
+
+/* User-defined reduction operation for shmemx_team_reduce_user.  It combines
+ * nelems elements, inout[i] = in[i] op inout[i], where in holds the result
+ * for lower-numbered PEs when the operation is not commutative. */
+typedef void (*shmemx_reduce_fn_t)(const void *in, void *inout, size_t nelems);
+
 /* Counting puts */
 typedef char * shmemx_ct_t;
 
@@ -22,6 +59,38 @@ typedef struct {
     uint64_t target;
 } shmemx_pcntr_t;
 
+/* Symmetric heap partition usage statistics */
+typedef struct {
+    size_t   size;
+    size_t   in_use;
+    size_t   peak_in_use;
+    uint64_t num_allocs;
+    uint64_t num_frees;
+    uint64_t num_fallbacks;
+} shmemx_heap_stats_t;
+
+/* Description of peers whose memory is directly mapped, used by the inline
+ * fast paths enabled by defining SHMEMX_INLINE_FASTPATH before including
+ * shmem.h.  Filled in by shmem_init and read-only for applications. */
+typedef struct {
+    int    enabled;
+    int    atomics;             /* AMOs to mapped peers use CPU atomics */
+    int    heap_sync_pending;   /* Symmetric allocations not yet synchronized */
+    int    num_pes;
+    char  *heap_base;
+    size_t heap_length;
+    char  *data_base;
+    size_t data_length;
+    char **peer_heap;           /* Indexed by PE, NULL if not mapped */
+    char **peer_data;
+} shmemx_fastpath_info_t;
+
+#if defined(SHMEM_HAVE_ATTRIBUTE_VISIBILITY) && SHMEM_HAVE_ATTRIBUTE_VISIBILITY == 1
+    __attribute__((visibility("default"))) extern shmemx_fastpath_info_t shmemx_fastpath_info;
+#else
+    extern shmemx_fastpath_info_t shmemx_fastpath_info;
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -21,6 +21,7 @@
 #include "shmem_internal.h"
 #include "shmem_collectives.h"
 #include "shmem_internal_op.h"
+#include "shmem_remote_pointer.h"
 
 coll_type_t shmem_internal_barrier_type = AUTO;
 coll_type_t shmem_internal_bcast_type = AUTO;
@@ -29,13 +30,19 @@ coll_type_t shmem_internal_collect_type = AUTO;
 coll_type_t shmem_internal_fcollect_type = AUTO;
 long *shmem_internal_barrier_all_psync;
 long *shmem_internal_sync_all_psync;
+long shmem_internal_barrier_all_epoch = 0;
+long shmem_internal_sync_all_epoch = 0;
+shmem_internal_shr_barrier_t *shmem_internal_barrier_all_shr = NULL;
 
 char *coll_type_str[] = { "AUTO",
                           "LINEAR",
                           "TREE",
                           "DISSEM",
                           "RING",
-                          "RECDBL" };
+                          "RECDBL",
+                          "SHR",
+                          "BRUCK",
+                          "NEIGHBOR" };
 
 static int *full_tree_children;
 static int full_tree_num_children;
@@ -115,22 +122,29 @@ shmem_internal_collectives_init(void)
     int my_root = 0;
     char *type;
 
+    /* A tuning table may set the radix, so it is loaded first */
+    if (!shmem_internal_params.COLL_TUNE &&
+        shmem_internal_params.COLL_TUNING_FILE_provided &&
+        shmem_internal_params.COLL_TUNING_FILE[0] != '\0')
+        shmem_internal_coll_tune_load(shmem_internal_params.COLL_TUNING_FILE);
+
     tree_radix = shmem_internal_params.COLL_RADIX;
 
-    /* initialize barrier_all psync array */
+    /* initialize barrier_all psync array.  The epoch barriers keep one
+       counter per dissemination round, so size it for that. */
     shmem_internal_barrier_all_psync =
-        shmem_internal_shmalloc(sizeof(long) * SHMEM_BARRIER_SYNC_SIZE);
+        shmem_internal_shmalloc(sizeof(long) * SHMEM_INTERNAL_EPOCH_SYNC_SIZE);
     if (NULL == shmem_internal_barrier_all_psync) return -1;
 
-    for (i = 0; i < SHMEM_BARRIER_SYNC_SIZE; i++)
+    for (i = 0; i < SHMEM_INTERNAL_EPOCH_SYNC_SIZE; i++)
         shmem_internal_barrier_all_psync[i] = SHMEM_SYNC_VALUE;
 
     /* initialize sync_all psync array */
     shmem_internal_sync_all_psync =
-        shmem_internal_shmalloc(sizeof(long) * SHMEM_BARRIER_SYNC_SIZE);
+        shmem_internal_shmalloc(sizeof(long) * SHMEM_INTERNAL_EPOCH_SYNC_SIZE);
     if (NULL == shmem_internal_sync_all_psync) return -1;
 
-    for (i = 0; i < SHMEM_BARRIER_SYNC_SIZE; i++)
+    for (i = 0; i < SHMEM_INTERNAL_EPOCH_SYNC_SIZE; i++)
         shmem_internal_sync_all_psync[i] = SHMEM_SYNC_VALUE;
 
     /* initialize the binomial tree for collective operations over
@@ -175,6 +189,8 @@ shmem_internal_collectives_init(void)
             shmem_internal_barrier_type = TREE;
         } else if (0 == strcmp(type, "dissem")) {
             shmem_internal_barrier_type = DISSEM;
+        } else if (0 == strcmp(type, "shr")) {
+            shmem_internal_barrier_type = SHR;
         } else {
             RAISE_WARN_MSG("Ignoring bad barrier algorithm '%s'\n", type);
         }
@@ -203,6 +219,8 @@ shmem_internal_collectives_init(void)
             shmem_internal_reduce_type = TREE;
         } else if (0 == strcmp(type, "recdbl")) {
             shmem_internal_reduce_type = RECDBL;
+        } else if (0 == strcmp(type, "shr")) {
+            shmem_internal_reduce_type = SHR;
         } else {
             RAISE_WARN_MSG("Ignoring bad reduction algorithm '%s'\n", type);
         }
@@ -213,6 +231,10 @@ shmem_internal_collectives_init(void)
             shmem_internal_collect_type = AUTO;
         } else if (0 == strcmp(type, "linear")) {
             shmem_internal_collect_type = LINEAR;
+        } else if (0 == strcmp(type, "ring")) {
+            shmem_internal_collect_type = RING;
+        } else if (0 == strcmp(type, "recdbl")) {
+            shmem_internal_collect_type = RECDBL;
         } else {
             RAISE_WARN_MSG("Ignoring bad collect algorithm '%s'\n", type);
         }
@@ -229,11 +251,22 @@ shmem_internal_collectives_init(void)
             shmem_internal_fcollect_type = RING;
         } else if (0 == strcmp(type, "recdbl")) {
             shmem_internal_fcollect_type = RECDBL;
+        } else if (0 == strcmp(type, "bruck")) {
+            shmem_internal_fcollect_type = BRUCK;
+        } else if (0 == strcmp(type, "neighbor")) {
+            shmem_internal_fcollect_type = NEIGHBOR;
         } else {
             RAISE_WARN_MSG("Ignoring bad fcollect algorithm '%s'\n", type);
         }
     }
 
+    if (shmem_internal_params.COLL_TUNE &&
+        0 == shmem_internal_coll_tune_measure() &&
+        shmem_internal_my_pe == 0 &&
+        shmem_internal_params.COLL_TUNING_FILE_provided &&
+        shmem_internal_params.COLL_TUNING_FILE[0] != '\0')
+        shmem_internal_coll_tune_write(shmem_internal_params.COLL_TUNING_FILE);
+
     return 0;
 }
 
@@ -407,6 +440,232 @@ shmem_internal_sync_dissem(int PE_start, int PE_stride, int PE_size, long *pSync
 }
 
 
+/* Epoch barriers.  These operate on internal pSync arrays whose counters
+ * only ever increase: the caller passes the number of this barrier on the
+ * pSync (starting at 1), and every PE waits for its counters to reach a
+ * multiple of that epoch instead of an exact value.  A fast PE that enters
+ * the next barrier early only pushes a counter past the current target, so
+ * the pSync never has to be cleared and no reset traffic is generated.  The
+ * counters must start at zero and the same pSync must not be used with the
+ * reset-based algorithms above. */
+void
+shmem_internal_sync_epoch_linear(int PE_start, int PE_stride, int PE_size, long *pSync,
+                                 long epoch)
+{
+    long one = 1;
+
+    if (PE_start == shmem_internal_my_pe) {
+        int pe, i;
+
+        /* wait for N - 1 callins for this epoch */
+        SHMEM_WAIT_UNTIL(pSync, SHMEM_CMP_GE, epoch * (PE_size - 1));
+
+        /* Release everyone by publishing the epoch */
+        for (pe = PE_start + PE_stride, i = 1 ;
+             i < PE_size ;
+             i++, pe += PE_stride) {
+            shmem_internal_put_scalar(SHMEM_CTX_DEFAULT, pSync, &epoch, sizeof(epoch), pe);
+        }
+
+    } else {
+        /* send message to root */
+        shmem_internal_atomic(SHMEM_CTX_DEFAULT, pSync, &one, sizeof(one), PE_start,
+                              SHM_INTERNAL_SUM, SHM_INTERNAL_LONG);
+
+        /* wait for the root to publish this epoch */
+        SHMEM_WAIT_UNTIL(pSync, SHMEM_CMP_GE, epoch);
+    }
+}
+
+
+void
+shmem_internal_sync_epoch_tree(int PE_start, int PE_stride, int PE_size, long *pSync,
+                               long epoch)
+{
+    long one = 1;
+    int parent, num_children, *children, i;
+
+    /* pSync[0] counts arrivals from children, pSync[1] holds the last epoch
+     * released by the parent */
+    if (PE_size == shmem_internal_num_pes) {
+        /* we're the full tree, use the binomial tree */
+        parent = full_tree_parent;
+        num_children = full_tree_num_children;
+        children = full_tree_children;
+    } else {
+        children = alloca(sizeof(int) * tree_radix);
+        shmem_internal_build_kary_tree(tree_radix, PE_start, PE_stride, PE_size,
+                                       0, &parent, &num_children, children);
+    }
+
+    /* wait for num_children callins up the tree */
+    if (num_children != 0)
+        SHMEM_WAIT_UNTIL(&pSync[0], SHMEM_CMP_GE, epoch * num_children);
+
+    if (parent != shmem_internal_my_pe) {
+        /* send message up psync tree and wait for the release */
+        shmem_internal_atomic(SHMEM_CTX_DEFAULT, &pSync[0], &one, sizeof(one), parent,
+                              SHM_INTERNAL_SUM, SHM_INTERNAL_LONG);
+        SHMEM_WAIT_UNTIL(&pSync[1], SHMEM_CMP_GE, epoch);
+    }
+
+    /* Send release down to children */
+    for (i = 0 ; i < num_children ; ++i) {
+        shmem_internal_put_scalar(SHMEM_CTX_DEFAULT, &pSync[1], &epoch, sizeof(epoch),
+                                  children[i]);
+    }
+}
+
+
+void
+shmem_internal_sync_epoch_dissem(int PE_start, int PE_stride, int PE_size, long *pSync,
+                                 long epoch)
+{
+    long one = 1;
+    int distance, to, i;
+    int coll_rank = (shmem_internal_my_pe - PE_start) / PE_stride;
+
+    /* need log2(num_procs) long slots, which is always less than
+       sizeof(int) * 8 */
+    for (i = 0, distance = 1 ; distance < PE_size ; ++i, distance <<= 1) {
+        to = ((coll_rank + distance) % PE_size);
+        to = PE_start + (to * PE_stride);
+
+        shmem_internal_atomic(SHMEM_CTX_DEFAULT, &pSync[i], &one, sizeof(one),
+                              to, SHM_INTERNAL_SUM, SHM_INTERNAL_LONG);
+
+        /* Exactly one peer signals this round per epoch.  It can run at
+           most one epoch ahead, which leaves the counter above target. */
+        SHMEM_WAIT_UNTIL(&pSync[i], SHMEM_CMP_GE, epoch);
+    }
+}
+
+
+/* Dissemination epoch barrier over an explicit list of PEs, used by teams
+ * whose members do not have a constant stride */
+void
+shmem_internal_sync_epoch_table(const int *pes, int my_idx, int size, long *pSync,
+                                long epoch)
+{
+    long one = 1;
+    int distance, i;
+
+    if (shmem_internal_params.BARRIERS_FLUSH) {
+        fflush(stdout);
+        fflush(stderr);
+    }
+
+    for (i = 0, distance = 1 ; distance < size ; ++i, distance <<= 1) {
+        shmem_internal_atomic(SHMEM_CTX_DEFAULT, &pSync[i], &one, sizeof(one),
+                              pes[(my_idx + distance) % size],
+                              SHM_INTERNAL_SUM, SHM_INTERNAL_LONG);
+
+        SHMEM_WAIT_UNTIL(&pSync[i], SHMEM_CMP_GE, epoch);
+    }
+
+    /* Ensure remote updates are visible in memory */
+    shmem_internal_membar_acq_rel();
+    shmem_transport_syncmem();
+}
+
+
+/* Shared memory barrier for active sets whose members are all reachable
+ * through load/store.  The barrier state occupies two cache lines in a
+ * symmetric slot: the arrival counter in the first line (only the copy on
+ * PE_start is used) and the release flag in the second.  Each PE atomically
+ * increments the counter on PE_start and then polls its own release flag.
+ * The last PE to arrive resets the counter and writes the new sense into
+ * every member's flag. */
+shmem_internal_shr_barrier_t *
+shmem_internal_shr_barrier_create(long *slot, int PE_start, int PE_stride, int PE_size)
+{
+    shmem_internal_shr_barrier_t *bar;
+    int i, pe;
+
+    if (shmem_internal_barrier_type != AUTO && shmem_internal_barrier_type != SHR)
+        return NULL;
+
+    if (PE_size < 2)
+        return NULL;
+
+    for (i = 0, pe = PE_start; i < PE_size; i++, pe += PE_stride) {
+        if (NULL == shmem_internal_ptr(slot, pe))
+            return NULL;
+    }
+
+    bar = malloc(sizeof(shmem_internal_shr_barrier_t));
+    if (NULL == bar)
+        return NULL;
+
+    bar->peer_flags = malloc(PE_size * sizeof(long *));
+    if (NULL == bar->peer_flags) {
+        free(bar);
+        return NULL;
+    }
+
+    for (i = 0, pe = PE_start; i < PE_size; i++, pe += PE_stride) {
+        bar->peer_flags[i] = (long *) ((char *) shmem_internal_ptr(slot, pe) +
+                                       SHMEM_INTERNAL_CACHELINE_SIZE);
+    }
+
+    bar->counter = shmem_internal_ptr(slot, PE_start);
+    bar->flag    = (long *) ((char *) slot + SHMEM_INTERNAL_CACHELINE_SIZE);
+    bar->size    = PE_size;
+
+    /* The caller clears the slot on every member and synchronizes before
+     * the first barrier, so all members start from sense 0. */
+    bar->sense   = 0;
+
+    DEBUG_MSG("Using shared memory barrier for <%d, %d, %d>\n",
+              PE_start, PE_stride, PE_size);
+
+    return bar;
+}
+
+
+void
+shmem_internal_shr_barrier_destroy(shmem_internal_shr_barrier_t *bar)
+{
+    if (NULL == bar) return;
+
+    free(bar->peer_flags);
+    free(bar);
+}
+
+
+void
+shmem_internal_sync_shr(shmem_internal_shr_barrier_t *bar)
+{
+    long sense = !bar->sense;
+
+    if (shmem_internal_params.BARRIERS_FLUSH) {
+        fflush(stdout);
+        fflush(stderr);
+    }
+
+    bar->sense = sense;
+
+    if (__atomic_fetch_add(bar->counter, 1, __ATOMIC_ACQ_REL) == bar->size - 1) {
+        int i;
+
+        /* The release stores below order the reset before any PE can
+         * arrive at the next barrier */
+        __atomic_store_n(bar->counter, 0, __ATOMIC_RELAXED);
+
+        for (i = 0; i < bar->size; i++)
+            __atomic_store_n(bar->peer_flags[i], sense, __ATOMIC_RELEASE);
+    } else {
+        while (__atomic_load_n(bar->flag, __ATOMIC_ACQUIRE) != sense) {
+            shmem_transport_probe();
+            SPINLOCK_BODY();
+        }
+    }
+
+    shmem_internal_membar_acq_rel();
+    shmem_transport_syncmem();
+}
+
+
 /*****************************************
  *
  * BROADCAST
@@ -631,11 +890,25 @@ shmem_internal_op_to_all_linear(void *target, const void *source, size_t count,
 #define chunk_count(id_, count_, npes_) \
     (count_)/(npes_) + ((id_) < (count_) % (_npes))
 
-void
-shmem_internal_op_to_all_ring(void *target, const void *source, size_t count, size_t type_size,
-                              int PE_start, int PE_stride, int PE_size,
-                              void *pWrk, long *pSync,
-                              shm_internal_op_t op, shm_internal_datatype_t datatype)
+/* Combine count elements of in into inout, with either the built-in
+ * operation or a user-defined reduction function */
+static inline void
+reduce_combine(shm_internal_op_t op, shm_internal_datatype_t datatype,
+               shmem_internal_reduce_fn_t fn, size_t count, const void *in, void *inout)
+{
+    if (fn != NULL)
+        fn(in, inout, count);
+    else
+        shmem_internal_reduce_local(op, datatype, count, (void *) in, inout);
+}
+
+
+/* The ring combines chunks in a rotated PE order, so fn must be commutative */
+static void
+op_to_all_ring(void *target, const void *source, size_t count, size_t type_size,
+               int PE_start, int PE_stride, int PE_size, long *pSync,
+               shm_internal_op_t op, shm_internal_datatype_t datatype,
+               shmem_internal_reduce_fn_t fn)
 {
     int group_rank = (shmem_internal_my_pe - PE_start) / PE_stride;
     long zero = 0, one = 1;
@@ -708,9 +981,9 @@ shmem_internal_op_to_all_ring(void *target, const void *source, size_t count, si
         /* Wait for chunk */
         SHMEM_WAIT_UNTIL(pSync, SHMEM_CMP_GE, i+1);
 
-        shmem_internal_reduce_local(op, datatype, chunk_in_count,
-                                    ((uint8_t *) source) + chunk_in_disp,
-                                    ((uint8_t *) target) + chunk_in_disp);
+        reduce_combine(op, datatype, fn, chunk_in_count,
+                       ((uint8_t *) source) + chunk_in_disp,
+                       ((uint8_t *) target) + chunk_in_disp);
     }
 
     /* Reset reduce-scatter pSync */
@@ -751,6 +1024,17 @@ shmem_internal_op_to_all_ring(void *target, const void *source, size_t count, si
 }
 
 
+void
+shmem_internal_op_to_all_ring(void *target, const void *source, size_t count, size_t type_size,
+                              int PE_start, int PE_stride, int PE_size,
+                              void *pWrk, long *pSync,
+                              shm_internal_op_t op, shm_internal_datatype_t datatype)
+{
+    op_to_all_ring(target, source, count, type_size, PE_start, PE_stride, PE_size, pSync,
+                   op, datatype, NULL);
+}
+
+
 void
 shmem_internal_op_to_all_tree(void *target, const void *source, size_t count, size_t type_size,
                               int PE_start, int PE_stride, int PE_size,
@@ -834,11 +1118,15 @@ shmem_internal_op_to_all_tree(void *target, const void *source, size_t count, si
 }
 
 
-void
-shmem_internal_op_to_all_recdbl_sw(void *target, const void *source, size_t count, size_t type_size,
-                                   int PE_start, int PE_stride, int PE_size,
-                                   void *pWrk, long *pSync,
-                                   shm_internal_op_t op, shm_internal_datatype_t datatype)
+/* When fn is not commutative, each step combines the lower block of PEs on
+ * the left, at the cost of a copy when the peer's block is the upper one.
+ * The extra PEs of a non-power-of-two set are folded in out of order, so
+ * non-commutative reductions require a power-of-two set. */
+static void
+op_to_all_recdbl_sw(void *target, const void *source, size_t count, size_t type_size,
+                    int PE_start, int PE_stride, int PE_size, long *pSync,
+                    shm_internal_op_t op, shm_internal_datatype_t datatype,
+                    shmem_internal_reduce_fn_t fn, int commutative)
 {
     int my_id = ((shmem_internal_my_pe - PE_start) / PE_stride);
     int log2_proc = 1, pow2_proc = 2;
@@ -909,7 +1197,7 @@ shmem_internal_op_to_all_recdbl_sw(void *target, const void *source, size_t coun
             shmem_internal_put_scalar(SHMEM_CTX_DEFAULT, pSync_extra_peer, &ps_target_ready, sizeof(long), peer);
 
             SHMEM_WAIT_UNTIL(pSync_extra_peer, SHMEM_CMP_EQ, ps_data_ready);
-            shmem_internal_reduce_local(op, datatype, count, target, current_target);
+            reduce_combine(op, datatype, fn, count, target, current_target);
         }
 
         /* Pairwise exchange: (only for PE's that are within the power of 2
@@ -945,8 +1233,12 @@ shmem_internal_op_to_all_recdbl_sw(void *target, const void *source, size_t coun
                 SHMEM_WAIT_UNTIL(step_psync, SHMEM_CMP_EQ, ps_data_ready);
             }
 
-            shmem_internal_reduce_local(op, datatype, count,
-                                        target, current_target);
+            if (commutative || peer < shmem_internal_my_pe) {
+                reduce_combine(op, datatype, fn, count, target, current_target);
+            } else {
+                reduce_combine(op, datatype, fn, count, current_target, target);
+                memcpy(current_target, target, wrk_size);
+            }
         }
 
         /* update extra peer with the final result from the pairwise exchange */
@@ -971,6 +1263,363 @@ shmem_internal_op_to_all_recdbl_sw(void *target, const void *source, size_t coun
 }
 
 
+void
+shmem_internal_op_to_all_recdbl_sw(void *target, const void *source, size_t count, size_t type_size,
+                                   int PE_start, int PE_stride, int PE_size,
+                                   void *pWrk, long *pSync,
+                                   shm_internal_op_t op, shm_internal_datatype_t datatype)
+{
+    op_to_all_recdbl_sw(target, source, count, type_size, PE_start, PE_stride, PE_size,
+                        pSync, op, datatype, NULL, 1);
+}
+
+
+/* Software binomial tree reduction for user-defined operations.  The subtree
+ * of rank r covers the consecutive ranks [r, r + lowbit(r)), and children are
+ * combined in increasing rank order, so the result preserves the PE order
+ * even when fn is not commutative.  Children send one at a time into their
+ * parent's target buffer, which is then combined into a private accumulator.
+ * The result is broadcast from rank 0.
+ */
+static void
+reduce_user_tree(void *target, const void *source, size_t count, size_t type_size,
+                 int PE_start, int PE_stride, int PE_size, long *pSync,
+                 shmem_internal_reduce_fn_t fn, int commutative)
+{
+    const int my_id = (shmem_internal_my_pe - PE_start) / PE_stride;
+    const size_t len = count * type_size;
+    long zero = 0, one = 1;
+    long completion = 0;
+    int mask, parent = -1;
+    void *acc = NULL;
+
+    /* need 2 slots, plus bcast */
+    shmem_internal_assert(SHMEM_REDUCE_SYNC_SIZE >= 2 + SHMEM_BCAST_SYNC_SIZE);
+
+    for (mask = 1; mask < PE_size; mask <<= 1) {
+        int child;
+
+        if (my_id & mask) {
+            parent = PE_start + (my_id - mask) * PE_stride;
+            break;
+        }
+
+        child = my_id + mask;
+        if (child >= PE_size) continue;
+
+        if (acc == NULL) {
+            acc = malloc(len);
+            if (acc == NULL)
+                RAISE_ERROR_MSG("Unable to allocate %zub accumulation buffer\n", len);
+            memcpy(acc, source, len);
+        }
+
+        /* Let the child send its subtree's result into our target */
+        shmem_internal_put_scalar(SHMEM_CTX_DEFAULT, pSync + 1, &one, sizeof(one),
+                                  PE_start + child * PE_stride);
+        SHMEM_WAIT_UNTIL(pSync, SHMEM_CMP_EQ, 1);
+
+        shmem_internal_put_scalar(SHMEM_CTX_DEFAULT, pSync, &zero, sizeof(zero),
+                                  shmem_internal_my_pe);
+        SHMEM_WAIT_UNTIL(pSync, SHMEM_CMP_EQ, 0);
+
+        if (commutative) {
+            fn(target, acc, count);
+        } else {
+            fn(acc, target, count);
+            memcpy(acc, target, len);
+        }
+    }
+
+    if (parent >= 0) {
+        /* wait for clear to send */
+        SHMEM_WAIT(pSync + 1, 0);
+
+        shmem_internal_put_scalar(SHMEM_CTX_DEFAULT, pSync + 1, &zero, sizeof(zero),
+                                  shmem_internal_my_pe);
+        SHMEM_WAIT_UNTIL(pSync + 1, SHMEM_CMP_EQ, 0);
+
+        shmem_internal_put_nb(SHMEM_CTX_DEFAULT, target, acc ? acc : source, len, parent,
+                              &completion);
+        shmem_internal_put_wait(SHMEM_CTX_DEFAULT, &completion);
+        shmem_internal_fence(SHMEM_CTX_DEFAULT);
+
+        shmem_internal_put_scalar(SHMEM_CTX_DEFAULT, pSync, &one, sizeof(one), parent);
+    } else {
+        memcpy(target, acc ? acc : source, len);
+    }
+
+    free(acc);
+
+    /* broadcast out */
+    shmem_internal_bcast(target, target, len, 0, PE_start, PE_stride, PE_size, pSync + 2, 0);
+}
+
+
+/* Reduction with a user-defined operation fn, which combines elements of
+ * type_size bytes.  Commutative operations use the configured algorithm,
+ * with ring for large and recursive doubling for small messages under auto
+ * selection.  Non-commutative operations use recursive doubling on
+ * power-of-two sets and the binomial tree otherwise.  Operations without
+ * NIC support cannot use the linear and tree algorithms, which rely on
+ * atomicv, so those select the software tree. */
+void
+shmem_internal_reduce_user(void *target, const void *source, size_t count, size_t type_size,
+                           int PE_start, int PE_stride, int PE_size, long *pSync,
+                           shmem_internal_reduce_fn_t fn, int commutative)
+{
+    const size_t len = count * type_size;
+    coll_type_t type;
+    uint64_t prof;
+
+    if (count == 0) return;
+
+    if (PE_size == 1) {
+        if (target != source)
+            memcpy(target, source, len);
+        return;
+    }
+
+    prof = shmem_internal_prof_begin();
+
+    type = shmem_internal_coll_select(shmem_internal_reduce_type, SHMEM_INTERNAL_COLL_REDUCE,
+                                      PE_size, len);
+
+    if (!commutative) {
+        type = (0 == (PE_size & (PE_size - 1))) ? RECDBL : TREE;
+    } else if (type == AUTO || type == SHR) {
+        type = (len < shmem_internal_params.COLL_SIZE_CROSSOVER) ? RECDBL : RING;
+    }
+
+    switch (type) {
+        /* The built-in op and datatype are unused when fn is given */
+        case RING:
+            op_to_all_ring(target, source, count, type_size, PE_start, PE_stride, PE_size,
+                           pSync, 0, 0, fn);
+            break;
+        case RECDBL:
+            op_to_all_recdbl_sw(target, source, count, type_size, PE_start, PE_stride,
+                                PE_size, pSync, 0, 0, fn, commutative);
+            break;
+        default:
+            reduce_user_tree(target, source, count, type_size, PE_start, PE_stride, PE_size,
+                             pSync, fn, commutative);
+            break;
+    }
+
+    shmem_internal_prof_end(SHMEM_INTERNAL_PROF_REDUCE, prof, len);
+}
+
+
+/* Whether all PEs of an active set can be reached through load/store does
+ * not change after initialization, so the answer is cached in a small
+ * direct-mapped table.  Each entry packs the active set and the answer into
+ * one word, so that it can be read and written atomically by any thread. */
+#define SHR_PEERS_CACHE_SIZE 16
+#define SHR_PEERS_FIELD_BITS 21
+
+static uint64_t shr_peers_cache[SHR_PEERS_CACHE_SIZE];
+
+static int
+op_to_all_shr_peers(int PE_start, int PE_stride, int PE_size)
+{
+    const uint64_t field_max = (1ULL << SHR_PEERS_FIELD_BITS) - 1;
+    uint64_t key, entry;
+    size_t slot;
+    int i, pe, reachable = 1;
+
+    if ((uint64_t) PE_start > field_max || (uint64_t) PE_stride > field_max ||
+        (uint64_t) PE_size > field_max) {
+        key = 0;
+        slot = 0;
+    } else {
+        /* Bit 0 holds the answer, and a valid entry is never zero */
+        key = ((((uint64_t) PE_start << SHR_PEERS_FIELD_BITS | (uint64_t) PE_stride)
+                << SHR_PEERS_FIELD_BITS | (uint64_t) PE_size) << 1);
+        slot = (size_t) ((key >> 1) * 0x9E3779B97F4A7C15ULL >> 60) % SHR_PEERS_CACHE_SIZE;
+
+        entry = __atomic_load_n(&shr_peers_cache[slot], __ATOMIC_RELAXED);
+        if ((entry & ~1ULL) == key)
+            return (int) (entry & 1);
+    }
+
+    for (i = 0, pe = PE_start; i < PE_size; i++, pe += PE_stride) {
+        if (NULL == shmem_internal_ptr(shmem_internal_heap_base, pe)) {
+            reachable = 0;
+            break;
+        }
+    }
+
+    if (key != 0)
+        __atomic_store_n(&shr_peers_cache[slot], key | (uint64_t) reachable, __ATOMIC_RELAXED);
+
+    return reachable;
+}
+
+
+/* Returns nonzero when every PE in the active set can be reached through load
+ * and store instructions for both target and source, and both buffers are
+ * aligned to the element size.  On-node mappability is symmetric, so all PEs
+ * in the active set reach the same decision. */
+int
+shmem_internal_op_to_all_shr_eligible(void *target, const void *source, size_t type_size,
+                                      int PE_start, int PE_stride, int PE_size)
+{
+    int peer;
+
+    if (((uintptr_t) target | (uintptr_t) source) % type_size != 0)
+        return 0;
+
+    if (PE_size < 2)
+        return 1;
+
+    if (!op_to_all_shr_peers(PE_start, PE_stride, PE_size))
+        return 0;
+
+    /* The peers share one mapping of each symmetric segment, so checking one
+     * of them tells whether the buffers are in a mapped segment */
+    peer = (PE_start == shmem_internal_my_pe) ? PE_start + PE_stride : PE_start;
+
+    return NULL != shmem_internal_ptr(target, peer) &&
+           NULL != shmem_internal_ptr(source, peer);
+}
+
+
+/* Number of half-precision elements accumulated per block by the shared
+ * memory reduction */
+#define SHR_HALF_BLOCK 256
+
+/* Reduce one slice of float16 or bfloat16 values from all peers, accumulating
+ * in single precision so that the result is rounded only once.  The slice
+ * starts at byte offset 'offset' of the source and target buffers. */
+static void
+op_to_all_shr_half(void *target, const void *source, size_t offset, size_t nelems,
+                   int PE_start, int PE_stride, int PE_size,
+                   shm_internal_op_t op, shm_internal_datatype_t datatype)
+{
+    float acc[SHR_HALF_BLOCK], tmp[SHR_HALF_BLOCK];
+    size_t done, n;
+    int i, pe;
+
+    for (done = 0; done < nelems; done += n) {
+        size_t block_offset = offset + done * sizeof(uint16_t);
+
+        n = nelems - done;
+        if (n > SHR_HALF_BLOCK) n = SHR_HALF_BLOCK;
+
+        shmem_internal_half_to_float(datatype, (const char *) source + block_offset, acc, n);
+
+        for (i = 0, pe = PE_start; i < PE_size; i++, pe += PE_stride) {
+            if (pe == shmem_internal_my_pe) continue;
+
+            shmem_internal_half_to_float(datatype,
+                                         (char *) shmem_internal_ptr(source, pe) + block_offset,
+                                         tmp, n);
+            shmem_internal_reduce_local(op, SHM_INTERNAL_FLOAT, n, tmp, acc);
+        }
+
+        shmem_internal_float_to_half(datatype, acc, (char *) target + block_offset, n);
+    }
+}
+
+
+/* Intra-node reduction through direct load/store mappings of the peers'
+ * symmetric buffers.
+ *
+ * The reduction is split into PE_size slices, which are rounded to whole
+ * cache lines so that no two PEs write the same line.  Each PE reduces its
+ * slice by reading the source buffers of every peer in place, accumulating
+ * into its own target, and then stores the result into the same slice of
+ * every peer's target.  Slices are disjoint, so in-place reductions need no
+ * temporary copy of the source.  A barrier on entry guarantees that all
+ * source buffers are ready and one on exit that all slices have landed.  This
+ * routine can also be used as the intra-node phase of a hierarchical
+ * reduction, with each node's active set passed in by the caller.
+ */
+void
+shmem_internal_op_to_all_shr(void *target, const void *source, size_t count, size_t type_size,
+                             int PE_start, int PE_stride, int PE_size,
+                             void *pWrk, long *pSync,
+                             shm_internal_op_t op, shm_internal_datatype_t datatype)
+{
+    int group_rank = (shmem_internal_my_pe - PE_start) / PE_stride;
+    size_t line_count, head, slice_count, slice_start, slice_end, slice_len;
+    int i, pe;
+
+    shmem_internal_assert(SHMEM_REDUCE_SYNC_SIZE >= SHMEM_BARRIER_SYNC_SIZE);
+
+    if (count == 0) return;
+
+    if (PE_size == 1) {
+        if (target != source)
+            memcpy(target, source, count*type_size);
+        return;
+    }
+
+    /* Slices are counted from the start of the cache line holding target,
+     * so that their boundaries fall on cache lines even when target is not
+     * aligned to one */
+    line_count = SHMEM_INTERNAL_CACHELINE_SIZE / type_size;
+    if (line_count == 0 || SHMEM_INTERNAL_CACHELINE_SIZE % type_size != 0) {
+        line_count = 1;
+        head = 0;
+    } else {
+        head = ((uintptr_t) target % SHMEM_INTERNAL_CACHELINE_SIZE) / type_size;
+    }
+
+    slice_count = (count + head + PE_size - 1) / PE_size;
+    slice_count = ((slice_count + line_count - 1) / line_count) * line_count;
+    slice_start = slice_count * group_rank;
+    slice_end   = slice_start + slice_count;
+    slice_start = (slice_start > head) ? slice_start - head : 0;
+    slice_end   = (slice_end > head) ? slice_end - head : 0;
+    if (slice_start > count) slice_start = count;
+    if (slice_end > count) slice_end = count;
+    slice_len   = (slice_end - slice_start) * type_size;
+    slice_start *= type_size;
+
+    /* Wait until all source buffers are ready */
+    shmem_internal_sync(PE_start, PE_stride, PE_size, pSync);
+
+    if (slice_len > 0) {
+        char *slice = (char *) target + slice_start;
+
+        if (SHMEM_INTERNAL_DTYPE_IS_HALF(datatype)) {
+            op_to_all_shr_half(target, source, slice_start, slice_len / type_size,
+                               PE_start, PE_stride, PE_size, op, datatype);
+        } else {
+            if (target != source)
+                memcpy(slice, (char *) source + slice_start, slice_len);
+
+            for (i = 0, pe = PE_start; i < PE_size; i++, pe += PE_stride) {
+                char *peer_source;
+
+                if (pe == shmem_internal_my_pe) continue;
+
+                peer_source = shmem_internal_ptr(source, pe);
+                shmem_internal_reduce_local(op, datatype, slice_len / type_size,
+                                            peer_source + slice_start, slice);
+            }
+        }
+
+        for (i = 0, pe = PE_start; i < PE_size; i++, pe += PE_stride) {
+            char *peer_target;
+
+            if (pe == shmem_internal_my_pe) continue;
+
+            peer_target = shmem_internal_ptr(target, pe);
+            memcpy(peer_target + slice_start, slice, slice_len);
+        }
+
+        shmem_internal_membar_release();
+    }
+
+    /* Wait until all slices have been written */
+    shmem_internal_sync(PE_start, PE_stride, PE_size, pSync);
+    shmem_internal_membar_acquire();
+}
+
+
 /*****************************************
  *
  * COLLECT (variable size)
@@ -1040,6 +1689,257 @@ shmem_internal_collect_linear(void *target, const void *source, size_t len,
 }
 
 
+/* pSync layout of the scan-based collect algorithms.  The scan uses one
+ * slot per recursive doubling step, so the number of steps, and hence the
+ * PE set size, is bounded by the size of the collect pSync. */
+#define COLLECT_PSYNC_COUNT  0  /* ring: bytes received so far */
+#define COLLECT_PSYNC_NEXT   1  /* ring: length of the next PE, plus one */
+#define COLLECT_PSYNC_TOTAL  2  /* total length, for non power of two sets */
+#define COLLECT_PSYNC_BCAST  3  /* broadcast of the total length */
+#define COLLECT_PSYNC_SCAN   (COLLECT_PSYNC_BCAST + SHMEM_BCAST_SYNC_SIZE)
+#define COLLECT_SCAN_MAX_STEPS (SHMEM_COLLECT_SYNC_SIZE - COLLECT_PSYNC_SCAN)
+
+/* Number of long slots taken by the per-step recdbl completion flags */
+#define COLLECT_RECDBL_FLAG_SLOTS(steps) \
+    (((steps) * sizeof(int) + sizeof(long) - 1) / sizeof(long))
+
+
+/* Recursive doubling exclusive prefix sum of the contribution lengths.
+ * Power of two PE sets exchange the length of the group of PEs each side
+ * has accumulated, which also gives the total and the length of the peer
+ * group at every step (used by the recdbl data phase).  Other set sizes
+ * use the Hillis-Steele formulation, sending the running prefix to the PE
+ * at distance 2^k, and broadcast the total from the last PE.
+ *
+ *   log(p) alpha
+ */
+static size_t
+collect_scan(size_t len, int my_id, int PE_start, int PE_stride, int PE_size,
+             long *pSync, size_t *total, size_t *peer_len)
+{
+    long *pSync_scan = &pSync[COLLECT_PSYNC_SCAN];
+    size_t offset = 0, sum = len;
+    long val;
+    int i, distance;
+
+    if (0 == (PE_size & (PE_size - 1))) {
+        for (i = 0, distance = 0x1 ; distance < PE_size ; i++, distance <<= 1) {
+            int peer = my_id ^ distance;
+
+            val = (long) sum + 1; /* Nonzero flag, even for empty groups */
+            shmem_internal_put_scalar(SHMEM_CTX_DEFAULT, &pSync_scan[i], &val, sizeof(long),
+                                      PE_start + peer * PE_stride);
+            SHMEM_WAIT(&pSync_scan[i], SHMEM_SYNC_VALUE);
+
+            peer_len[i] = (size_t) (pSync_scan[i] - 1);
+            if (peer < my_id) offset += peer_len[i];
+            sum += peer_len[i];
+        }
+
+        *total = sum;
+        return offset;
+    }
+
+    for (i = 0, distance = 0x1 ; distance < PE_size ; i++, distance <<= 1) {
+        /* Send the prefix from the previous step before adding this one */
+        if (my_id + distance < PE_size) {
+            val = (long) sum + 1;
+            shmem_internal_put_scalar(SHMEM_CTX_DEFAULT, &pSync_scan[i], &val, sizeof(long),
+                                      PE_start + (my_id + distance) * PE_stride);
+        }
+        if (my_id >= distance) {
+            SHMEM_WAIT(&pSync_scan[i], SHMEM_SYNC_VALUE);
+            sum += (size_t) (pSync_scan[i] - 1);
+        }
+    }
+
+    if (my_id == PE_size - 1)
+        pSync[COLLECT_PSYNC_TOTAL] = (long) sum;
+
+    shmem_internal_bcast(&pSync[COLLECT_PSYNC_TOTAL], &pSync[COLLECT_PSYNC_TOTAL],
+                         sizeof(long), PE_size - 1, PE_start, PE_stride, PE_size,
+                         &pSync[COLLECT_PSYNC_BCAST], 0);
+
+    *total = (size_t) pSync[COLLECT_PSYNC_TOTAL];
+    return sum - len;
+}
+
+
+/* Put the bytes [s0, s1) of the stream that runs downward from top, modulo
+ * total, to pe. */
+static void
+collect_ring_put(void *target, size_t top, size_t total, size_t s0, size_t s1,
+                 int pe, long *completion)
+{
+    if (s1 <= top) {
+        shmem_internal_put_nb(SHMEM_CTX_DEFAULT, (char*) target + top - s1,
+                              (char*) target + top - s1, s1 - s0, pe, completion);
+    } else if (s0 >= top) {
+        shmem_internal_put_nb(SHMEM_CTX_DEFAULT, (char*) target + total - (s1 - top),
+                              (char*) target + total - (s1 - top), s1 - s0, pe, completion);
+    } else {
+        shmem_internal_put_nb(SHMEM_CTX_DEFAULT, target, target, top - s0, pe, completion);
+        shmem_internal_put_nb(SHMEM_CTX_DEFAULT, (char*) target + total - (s1 - top),
+                              (char*) target + total - (s1 - top), s1 - top, pe, completion);
+    }
+}
+
+
+/* Ring allgatherv.  As in fcollect_ring, every PE only sends to its next
+ * highest neighbor, forwarding what it received.  Blocks have different
+ * lengths, so rather than a message per block, the data is treated as a
+ * stream of bytes running downward (modulo the total) from the end of the
+ * sender's block: first its own block, then everything received from the
+ * previous PE, which arrives in the same order.  A rolling byte counter is
+ * therefore enough to tell the receiver which part of its target is valid,
+ * and each PE stops before the next PE's own block.
+ *
+ *   (p - 1) alpha + ((p - 1)/p)n beta
+ */
+static void
+collect_ring(void *target, size_t offset, size_t len, size_t total, int my_id,
+             int PE_start, int PE_stride, int PE_size, long *pSync)
+{
+    int next_proc = PE_start + ((my_id + 1) % PE_size) * PE_stride;
+    int prev_proc = PE_start + ((my_id - 1 + PE_size) % PE_size) * PE_stride;
+    size_t top = offset + len;
+    size_t recv_len = total - len, send_len;
+    size_t sent = 0, recvd = 0;
+    long completion = 0;
+    long zero = 0, val = (long) len + 1;
+
+    /* The previous PE stops forwarding before my block */
+    shmem_internal_put_scalar(SHMEM_CTX_DEFAULT, &pSync[COLLECT_PSYNC_NEXT], &val,
+                              sizeof(long), prev_proc);
+    SHMEM_WAIT(&pSync[COLLECT_PSYNC_NEXT], SHMEM_SYNC_VALUE);
+    send_len = total - (size_t) (pSync[COLLECT_PSYNC_NEXT] - 1);
+
+    for (;;) {
+        size_t avail = len + recvd;
+
+        if (avail > send_len) avail = send_len;
+
+        if (avail > sent) {
+            collect_ring_put(target, top, total, sent, avail, next_proc, &completion);
+            shmem_internal_put_wait(SHMEM_CTX_DEFAULT, &completion);
+            shmem_internal_fence(SHMEM_CTX_DEFAULT);
+
+            /* Only next_proc is sent to and there is a fence after each
+             * put, so the rolling counter covers a contiguous range. */
+            val = (long) (avail - sent);
+            shmem_internal_atomic(SHMEM_CTX_DEFAULT, &pSync[COLLECT_PSYNC_COUNT], &val,
+                                  sizeof(long), next_proc, SHM_INTERNAL_SUM,
+                                  SHM_INTERNAL_LONG);
+            sent = avail;
+        }
+
+        if (recvd == recv_len) break;
+
+        SHMEM_WAIT_UNTIL(&pSync[COLLECT_PSYNC_COUNT], SHMEM_CMP_GT, (long) recvd);
+        recvd = (size_t) pSync[COLLECT_PSYNC_COUNT];
+    }
+
+    pSync[COLLECT_PSYNC_NEXT] = SHMEM_SYNC_VALUE;
+
+    shmem_internal_put_scalar(SHMEM_CTX_DEFAULT, &pSync[COLLECT_PSYNC_COUNT], &zero,
+                              sizeof(long), shmem_internal_my_pe);
+    SHMEM_WAIT_UNTIL(&pSync[COLLECT_PSYNC_COUNT], SHMEM_CMP_EQ, 0);
+}
+
+
+/* Recursive doubling allgatherv for power of two PE sets.  As in
+ * fcollect_recdbl, pairs exchange the range accumulated so far; the length
+ * of the peer's range comes from the scan.
+ *
+ *   log(p) alpha + (p-1)/p n beta
+ */
+static void
+collect_recdbl(void *target, size_t offset, size_t len, const size_t *peer_len,
+               int my_id, int PE_start, int PE_stride, int PE_size, long *pSync, int steps)
+{
+    int *pSync_ints = (int*) &pSync[COLLECT_PSYNC_SCAN + steps];
+    int one = 1, neg_one = -1;
+    long completion = 0;
+    int i, distance;
+
+    for (i = 0, distance = 0x1 ; distance < PE_size ; i++, distance <<= 1) {
+        int peer = my_id ^ distance;
+        int real_peer = PE_start + (peer * PE_stride);
+
+        if (len > 0) {
+            shmem_internal_put_nb(SHMEM_CTX_DEFAULT, (char*) target + offset,
+                                  (char*) target + offset, len, real_peer, &completion);
+            shmem_internal_put_wait(SHMEM_CTX_DEFAULT, &completion);
+            shmem_internal_fence(SHMEM_CTX_DEFAULT);
+        }
+
+        shmem_internal_atomic(SHMEM_CTX_DEFAULT, &pSync_ints[i], &one, sizeof(int),
+                              real_peer, SHM_INTERNAL_SUM, SHM_INTERNAL_INT);
+
+        SHMEM_WAIT_UNTIL(&pSync_ints[i], SHMEM_CMP_NE, 0);
+
+        shmem_internal_atomic(SHMEM_CTX_DEFAULT, &pSync_ints[i], &neg_one, sizeof(int),
+                              shmem_internal_my_pe, SHM_INTERNAL_SUM, SHM_INTERNAL_INT);
+
+        if (peer < my_id) offset -= peer_len[i];
+        len += peer_len[i];
+    }
+
+    shmem_internal_quiet(SHMEM_CTX_DEFAULT);
+}
+
+
+/* Collect that computes the offsets with a recursive doubling scan and
+ * moves the data with the ring or recursive doubling allgatherv.  With
+ * type AUTO, recdbl is used below SHMEM_COLL_SIZE_CROSSOVER total bytes,
+ * recdbl falls back to ring for PE sets that are not a power of two, and
+ * sets too large for the pSync use the linear algorithm. */
+void
+shmem_internal_collect_scan(void *target, const void *source, size_t len,
+                            int PE_start, int PE_stride, int PE_size, long *pSync,
+                            coll_type_t type)
+{
+    int my_id = ((shmem_internal_my_pe - PE_start) / PE_stride);
+    size_t peer_len[sizeof(int) * 8];
+    size_t offset, total;
+    int i, steps = 0, pow2;
+
+    DEBUG_MSG("target=%p, source=%p, len=%zd, PE_Start=%d, PE_stride=%d, PE_size=%d, pSync=%p\n",
+              target, source, len, PE_start, PE_stride, PE_size, (void*) pSync);
+
+    while ((1 << steps) < PE_size) steps++;
+
+    if (PE_size == 1 || steps > COLLECT_SCAN_MAX_STEPS) {
+        shmem_internal_collect_linear(target, source, len, PE_start, PE_stride,
+                                      PE_size, pSync);
+        return;
+    }
+
+    pow2 = (0 == (PE_size & (PE_size - 1)));
+    offset = collect_scan(len, my_id, PE_start, PE_stride, PE_size, pSync, &total,
+                          peer_len);
+
+    if (len > 0 && (char*) target + offset != source)
+        memcpy((char*) target + offset, source, len);
+
+    if (total > 0) {
+        if (pow2 && (type == RECDBL ||
+                     (type == AUTO && total < shmem_internal_params.COLL_SIZE_CROSSOVER)) &&
+            steps + COLLECT_RECDBL_FLAG_SLOTS(steps) <= COLLECT_SCAN_MAX_STEPS) {
+            collect_recdbl(target, offset, len, peer_len, my_id, PE_start, PE_stride,
+                           PE_size, pSync, steps);
+        } else {
+            collect_ring(target, offset, len, total, my_id, PE_start, PE_stride,
+                         PE_size, pSync);
+        }
+    }
+
+    for (i = 0; i < steps; i++)
+        pSync[COLLECT_PSYNC_SCAN + i] = SHMEM_SYNC_VALUE;
+    pSync[COLLECT_PSYNC_TOTAL] = SHMEM_SYNC_VALUE;
+}
+
+
 /*****************************************
  *
  * COLLECT (same size)
@@ -1210,6 +2110,155 @@ shmem_internal_fcollect_recdbl(void *target, const void *source, size_t len,
 }
 
 
+/* Bruck algorithm.  At step k, every process sends the blocks it has
+ * gathered so far to the process 2^k below it, so the gathered range
+ * doubles each step for any process count.  Blocks are gathered starting
+ * with our own, and rotated into place at the end.
+ *
+ *   ceil(log(p)) alpha + (p-1)/p n beta
+ */
+void
+shmem_internal_fcollect_bruck(void *target, const void *source, size_t len,
+                              int PE_start, int PE_stride, int PE_size, long *pSync)
+{
+    int my_id = ((shmem_internal_my_pe - PE_start) / PE_stride);
+    int i;
+    long completion = 0;
+    int *pSync_ints = (int*) pSync;
+    int one = 1, neg_one = -1;
+    int distance;
+
+    /* need log2(num_procs) int slots, see fcollect_recdbl */
+    shmem_internal_assert(SHMEM_COLLECT_SYNC_SIZE >= (sizeof(int) * 8) / (sizeof(long) / sizeof(int)));
+
+    if (len == 0) return;
+
+    memcpy(target, source, len);
+
+    for (i = 0, distance = 0x1 ; distance < PE_size ; i++, distance <<= 1) {
+        int real_peer = PE_start + ((my_id - distance + PE_size) % PE_size) * PE_stride;
+        int nblocks = (distance < PE_size - distance) ? distance : PE_size - distance;
+
+        /* send data to peer */
+        shmem_internal_put_nb(SHMEM_CTX_DEFAULT, (char*) target + distance * len, target,
+                              nblocks * len, real_peer, &completion);
+        shmem_internal_put_wait(SHMEM_CTX_DEFAULT, &completion);
+        shmem_internal_fence(SHMEM_CTX_DEFAULT);
+
+        /* mark completion for this round */
+        shmem_internal_atomic(SHMEM_CTX_DEFAULT, &pSync_ints[i], &one, sizeof(int),
+                              real_peer, SHM_INTERNAL_SUM, SHM_INTERNAL_INT);
+
+        SHMEM_WAIT_UNTIL(&pSync_ints[i], SHMEM_CMP_NE, 0);
+
+        /* this slot is no longer used, so subtract off results now */
+        shmem_internal_atomic(SHMEM_CTX_DEFAULT, &pSync_ints[i], &neg_one, sizeof(int),
+                              shmem_internal_my_pe, SHM_INTERNAL_SUM, SHM_INTERNAL_INT);
+    }
+
+    shmem_internal_quiet(SHMEM_CTX_DEFAULT);
+
+    /* Target holds blocks my_id ... PE_size - 1, 0 ... my_id - 1.  Move the
+     * last my_id blocks to the front. */
+    if (my_id > 0) {
+        size_t wrap_len = my_id * len;
+        void *tmp = malloc(wrap_len);
+
+        if (NULL == tmp)
+            RAISE_ERROR_MSG("Unable to allocate %zub temporary buffer\n", wrap_len);
+
+        memcpy(tmp, (char*) target + (PE_size - my_id) * len, wrap_len);
+        memmove((char*) target + wrap_len, target, (PE_size - my_id) * len);
+        memcpy(target, tmp, wrap_len);
+        free(tmp);
+    }
+}
+
+
+/* Neighbor exchange algorithm.  Only supports an even number of
+ * processes.  Processes alternate between exchanging with their two
+ * neighbors, first a single block and then the two blocks received in the
+ * previous step, so each step after the first adds two blocks.
+ *
+ *   (p/2) alpha + ((p - 1)/p)n beta
+ */
+void
+shmem_internal_fcollect_neighbor(void *target, const void *source, size_t len,
+                                 int PE_start, int PE_stride, int PE_size, long *pSync)
+{
+    int my_id = ((shmem_internal_my_pe - PE_start) / PE_stride);
+    int neighbor[2], recv_from[2], step_offset[2];
+    int i, send_from;
+    long completion = 0;
+    long zero = 0, one = 1;
+
+    /* need 2 slots */
+    shmem_internal_assert(SHMEM_COLLECT_SYNC_SIZE >= 2);
+    shmem_internal_assert(0 == PE_size % 2);
+
+    if (len == 0) return;
+
+    if (0 == my_id % 2) {
+        neighbor[0] = my_id + 1;
+        neighbor[1] = (my_id - 1 + PE_size) % PE_size;
+        recv_from[0] = recv_from[1] = my_id;
+        step_offset[0] = 2;
+        step_offset[1] = -2;
+    } else {
+        neighbor[0] = my_id - 1;
+        neighbor[1] = (my_id + 1) % PE_size;
+        recv_from[0] = recv_from[1] = my_id - 1;
+        step_offset[0] = -2;
+        step_offset[1] = 2;
+    }
+
+    /* copy my portion to the right place */
+    memcpy((char*) target + my_id * len, source, len);
+
+    /* exchange my block with neighbor 0 */
+    shmem_internal_put_nb(SHMEM_CTX_DEFAULT, (char*) target + my_id * len,
+                          (char*) target + my_id * len, len,
+                          PE_start + neighbor[0] * PE_stride, &completion);
+    shmem_internal_put_wait(SHMEM_CTX_DEFAULT, &completion);
+    shmem_internal_fence(SHMEM_CTX_DEFAULT);
+    shmem_internal_atomic(SHMEM_CTX_DEFAULT, &pSync[0], &one, sizeof(long),
+                          PE_start + neighbor[0] * PE_stride, SHM_INTERNAL_SUM,
+                          SHM_INTERNAL_LONG);
+    SHMEM_WAIT_UNTIL(&pSync[0], SHMEM_CMP_GE, 1);
+
+    /* then forward the pair of blocks received in the previous step */
+    send_from = my_id & ~1;
+    for (i = 1 ; i < PE_size / 2 ; ++i) {
+        int parity = i % 2;
+        int real_peer = PE_start + neighbor[parity] * PE_stride;
+
+        recv_from[parity] = (recv_from[parity] + step_offset[parity] + PE_size) % PE_size;
+
+        shmem_internal_put_nb(SHMEM_CTX_DEFAULT, (char*) target + send_from * len,
+                              (char*) target + send_from * len, 2 * len, real_peer,
+                              &completion);
+        shmem_internal_put_wait(SHMEM_CTX_DEFAULT, &completion);
+        shmem_internal_fence(SHMEM_CTX_DEFAULT);
+
+        /* Each neighbor is sent to every other step, with a fence between
+           the puts, so a rolling counter per neighbor is safe here. */
+        shmem_internal_atomic(SHMEM_CTX_DEFAULT, &pSync[parity], &one, sizeof(long),
+                              real_peer, SHM_INTERNAL_SUM, SHM_INTERNAL_LONG);
+
+        SHMEM_WAIT_UNTIL(&pSync[parity], SHMEM_CMP_GE, i / 2 + 1);
+
+        send_from = recv_from[parity];
+    }
+
+    /* zero out psync */
+    for (i = 0 ; i < 2 ; i++) {
+        shmem_internal_put_scalar(SHMEM_CTX_DEFAULT, &pSync[i], &zero, sizeof(long),
+                                  shmem_internal_my_pe);
+        SHMEM_WAIT_UNTIL(&pSync[i], SHMEM_CMP_EQ, 0);
+    }
+}
+
+
 void
 shmem_internal_alltoall(void *dest, const void *source, size_t len,
                         int PE_start, int PE_stride, int PE_size, long *pSync)
@@ -1217,12 +2266,15 @@ shmem_internal_alltoall(void *dest, const void *source, size_t len,
     const int my_as_rank = (shmem_internal_my_pe - PE_start) / PE_stride;
     const void *dest_ptr = (uint8_t *) dest + my_as_rank * len;
     int peer, start_pe, i;
+    uint64_t prof;
 
     shmem_internal_assert(SHMEM_ALLTOALL_SYNC_SIZE >= SHMEM_BARRIER_SYNC_SIZE);
 
     if (0 == len)
         return;
 
+    prof = shmem_internal_prof_begin();
+
     /* Send data round-robin, ending with my PE */
     start_pe = shmem_internal_circular_iter_next(shmem_internal_my_pe,
                                                  PE_start, PE_stride,
@@ -1241,6 +2293,8 @@ shmem_internal_alltoall(void *dest, const void *source, size_t len,
 
     for (i = 0; i < SHMEM_BARRIER_SYNC_SIZE; i++)
         pSync[i] = SHMEM_SYNC_VALUE;
+
+    shmem_internal_prof_end(SHMEM_INTERNAL_PROF_ALLTOALL, prof, len);
 }
 
 
@@ -1252,12 +2306,15 @@ shmem_internal_alltoalls(void *dest, const void *source, ptrdiff_t dst,
     const int my_as_rank = (shmem_internal_my_pe - PE_start) / PE_stride;
     const void *dest_base = (uint8_t *) dest + my_as_rank * nelems * dst * elem_size;
     int peer, start_pe, i;
+    uint64_t prof;
 
     shmem_internal_assert(SHMEM_ALLTOALLS_SYNC_SIZE >= SHMEM_BARRIER_SYNC_SIZE);
 
     if (0 == nelems)
         return;
 
+    prof = shmem_internal_prof_begin();
+
     /* Implementation note: Neither OFI nor Portals presently has support for
      * noncontiguous data at the target of a one-sided operation.  I'm not sure
      * of the best communication schedule for the resulting doubly-nested
@@ -1292,4 +2349,6 @@ shmem_internal_alltoalls(void *dest, const void *source, ptrdiff_t dst,
 
     for (i = 0; i < SHMEM_BARRIER_SYNC_SIZE; i++)
         pSync[i] = SHMEM_SYNC_VALUE;
+
+    shmem_internal_prof_end(SHMEM_INTERNAL_PROF_ALLTOALLS, prof, nelems * elem_size);
 }
@@ -0,0 +1,462 @@
+/* -*- C -*-
+ *
+ * Copyright (c) 2018 Intel Corporation. All rights reserved.
+ * This software is available to you under the BSD license.
+ *
+ * This file is part of the Sandia OpenSHMEM software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+ *
+ */
+
+/* Collective algorithm tuning table.  The table holds, for each tunable
+ * collective, rules of the form (minimum team size, minimum message size) ->
+ * algorithm.  The most specific matching rule, i.e. the one with the largest
+ * team size and then the largest message size, selects the algorithm; when
+ * no rule matches, the built-in auto-selection is used.  The table is either
+ * loaded from SHMEM_COLL_TUNING_FILE or measured over the world team at
+ * startup (SHMEM_COLL_TUNE). */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SHMEM_INTERNAL_INCLUDE
+#include "shmem.h"
+#include "shmem_internal.h"
+#include "shmem_collectives.h"
+
+#define COLL_TUNE_MAX_RULES 32
+#define COLL_TUNE_WARMUP    2
+#define COLL_TUNE_ITERS     10
+
+/* Largest buffer used by a startup measurement, which bounds the message
+ * sizes measured for fcollect on large jobs */
+#define COLL_TUNE_MAX_BYTES (4 * 1024 * 1024)
+
+struct coll_rule_t {
+    int         min_npes;
+    size_t      min_bytes;
+    coll_type_t type;
+};
+typedef struct coll_rule_t coll_rule_t;
+
+int shmem_internal_coll_tuned = 0;
+
+static coll_rule_t coll_rules[SHMEM_INTERNAL_COLL_NUM][COLL_TUNE_MAX_RULES];
+static int coll_nrules[SHMEM_INTERNAL_COLL_NUM];
+
+static const char *coll_names[SHMEM_INTERNAL_COLL_NUM] = {
+    "barrier", "bcast", "reduce", "fcollect"
+};
+
+static const struct {
+    const char  *name;
+    coll_type_t  type;
+} coll_algs[] = {
+    { "linear",   LINEAR },
+    { "tree",     TREE },
+    { "dissem",   DISSEM },
+    { "ring",     RING },
+    { "recdbl",   RECDBL },
+    { "bruck",    BRUCK },
+    { "neighbor", NEIGHBOR }
+};
+
+#define COLL_NUM_ALGS ((int) (sizeof(coll_algs) / sizeof(coll_algs[0])))
+
+/* Algorithms that can be selected for each collective */
+static int
+coll_alg_valid(int coll, coll_type_t type)
+{
+    switch (coll) {
+        case SHMEM_INTERNAL_COLL_BARRIER:
+            return type == LINEAR || type == TREE || type == DISSEM;
+        case SHMEM_INTERNAL_COLL_BCAST:
+            return type == LINEAR || type == TREE;
+        case SHMEM_INTERNAL_COLL_REDUCE:
+            return type == LINEAR || type == TREE || type == RING || type == RECDBL;
+        case SHMEM_INTERNAL_COLL_FCOLLECT:
+            return type == LINEAR || type == RING || type == RECDBL || type == BRUCK ||
+                   type == NEIGHBOR;
+        default:
+            return 0;
+    }
+}
+
+
+static const char *
+coll_alg_name(coll_type_t type)
+{
+    int i;
+
+    for (i = 0; i < COLL_NUM_ALGS; i++)
+        if (coll_algs[i].type == type)
+            return coll_algs[i].name;
+
+    return "auto";
+}
+
+
+/* Insert a rule, keeping the rules ordered from most to least specific.  A
+ * rule with the same key replaces the existing one. */
+static int
+coll_rule_add(int coll, int min_npes, size_t min_bytes, coll_type_t type)
+{
+    coll_rule_t *rules = coll_rules[coll];
+    int i, n = coll_nrules[coll];
+
+    for (i = 0; i < n; i++) {
+        if (rules[i].min_npes == min_npes && rules[i].min_bytes == min_bytes) {
+            rules[i].type = type;
+            return 0;
+        }
+        if (rules[i].min_npes < min_npes ||
+            (rules[i].min_npes == min_npes && rules[i].min_bytes < min_bytes))
+            break;
+    }
+
+    if (n == COLL_TUNE_MAX_RULES)
+        return -1;
+
+    memmove(&rules[i + 1], &rules[i], (n - i) * sizeof(coll_rule_t));
+    rules[i].min_npes  = min_npes;
+    rules[i].min_bytes = min_bytes;
+    rules[i].type      = type;
+    coll_nrules[coll]++;
+
+    shmem_internal_coll_tuned = 1;
+
+    return 0;
+}
+
+
+coll_type_t
+shmem_internal_coll_tune_lookup(int coll, int PE_size, size_t bytes)
+{
+    const coll_rule_t *rules = coll_rules[coll];
+    int i;
+
+    for (i = 0; i < coll_nrules[coll]; i++)
+        if (PE_size >= rules[i].min_npes && bytes >= rules[i].min_bytes)
+            return rules[i].type;
+
+    return AUTO;
+}
+
+
+/* Table file format, one entry per line, '#' starts a comment:
+ *
+ *   radix <n>                  tree radix (SHMEM_COLL_RADIX)
+ *   crossover <n>              SHMEM_COLL_CROSSOVER
+ *   size_crossover <n>         SHMEM_COLL_SIZE_CROSSOVER
+ *   <collective> <min PEs> <min bytes> <algorithm>
+ *
+ * Settings given explicitly in the environment take precedence over the
+ * table. */
+int
+shmem_internal_coll_tune_load(const char *path)
+{
+    char line[256];
+    int lineno = 0, ret = 0;
+    FILE *f;
+
+    f = fopen(path, "r");
+    if (f == NULL) {
+        RAISE_WARN_MSG("Unable to open collective tuning file '%s'\n", path);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char name[32], alg[32];
+        char *comment = strchr(line, '#');
+        long min_npes;
+        unsigned long long min_bytes;
+        int n, coll, i;
+
+        lineno++;
+        if (comment) *comment = '\0';
+
+        n = sscanf(line, "%31s %ld %llu %31s", name, &min_npes, &min_bytes, alg);
+        if (n <= 0) continue;
+
+        if (n == 2 && 0 == strcmp(name, "radix")) {
+            if (min_npes < 2) goto bad_line;
+            if (!shmem_internal_params.COLL_RADIX_provided)
+                shmem_internal_params.COLL_RADIX = min_npes;
+            continue;
+        } else if (n == 2 && 0 == strcmp(name, "crossover")) {
+            if (min_npes < 1) goto bad_line;
+            if (!shmem_internal_params.COLL_CROSSOVER_provided)
+                shmem_internal_params.COLL_CROSSOVER = min_npes;
+            continue;
+        } else if (n == 2 && 0 == strcmp(name, "size_crossover")) {
+            if (min_npes < 0) goto bad_line;
+            if (!shmem_internal_params.COLL_SIZE_CROSSOVER_provided)
+                shmem_internal_params.COLL_SIZE_CROSSOVER = min_npes;
+            continue;
+        } else if (n != 4) {
+            goto bad_line;
+        }
+
+        for (coll = 0; coll < SHMEM_INTERNAL_COLL_NUM; coll++)
+            if (0 == strcmp(name, coll_names[coll])) break;
+
+        for (i = 0; i < COLL_NUM_ALGS; i++)
+            if (0 == strcmp(alg, coll_algs[i].name)) break;
+
+        if (coll == SHMEM_INTERNAL_COLL_NUM || i == COLL_NUM_ALGS || min_npes < 1 ||
+            !coll_alg_valid(coll, coll_algs[i].type))
+            goto bad_line;
+
+        if (coll_rule_add(coll, (int) min_npes, (size_t) min_bytes, coll_algs[i].type)) {
+            RAISE_WARN_MSG("%s:%d: too many %s rules, ignoring the rest\n", path, lineno,
+                           coll_names[coll]);
+            ret = -1;
+        }
+        continue;
+
+    bad_line:
+        RAISE_WARN_MSG("%s:%d: ignoring invalid collective tuning entry\n", path, lineno);
+        ret = -1;
+    }
+
+    fclose(f);
+
+    return ret;
+}
+
+
+int
+shmem_internal_coll_tune_write(const char *path)
+{
+    FILE *f;
+    int coll, i;
+
+    f = fopen(path, "w");
+    if (f == NULL) {
+        RAISE_WARN_MSG("Unable to write collective tuning file '%s'\n", path);
+        return -1;
+    }
+
+    fprintf(f, "# Collective tuning table measured at startup on %d PEs\n",
+            shmem_internal_num_pes);
+    fprintf(f, "# <collective> <min PEs> <min bytes> <algorithm>\n");
+    fprintf(f, "radix %ld\n", shmem_internal_params.COLL_RADIX);
+
+    for (coll = 0; coll < SHMEM_INTERNAL_COLL_NUM; coll++)
+        for (i = coll_nrules[coll] - 1; i >= 0; i--)
+            fprintf(f, "%s %d %zu %s\n", coll_names[coll], coll_rules[coll][i].min_npes,
+                    coll_rules[coll][i].min_bytes, coll_alg_name(coll_rules[coll][i].type));
+
+    fclose(f);
+
+    return 0;
+}
+
+
+struct coll_measurement_t {
+    int         coll;
+    size_t      bytes;
+    coll_type_t type;
+};
+typedef struct coll_measurement_t coll_measurement_t;
+
+static const size_t coll_tune_sizes[] = { 8, 1024, 16384, 262144 };
+
+#define COLL_TUNE_NUM_SIZES ((int) (sizeof(coll_tune_sizes) / sizeof(coll_tune_sizes[0])))
+
+/* Barrier, plus each algorithm of the other collectives at each size */
+#define COLL_TUNE_MAX_MEASUREMENTS (3 + (2 + 4 + 5) * COLL_TUNE_NUM_SIZES)
+
+
+static void
+coll_tune_run(const coll_measurement_t *m, void *dst, const void *src, long *pSync)
+{
+    const int npes = shmem_internal_num_pes;
+
+    switch (m->coll) {
+        case SHMEM_INTERNAL_COLL_BARRIER:
+            if (m->type == LINEAR)
+                shmem_internal_sync_linear(0, 1, npes, pSync);
+            else if (m->type == TREE)
+                shmem_internal_sync_tree(0, 1, npes, pSync);
+            else
+                shmem_internal_sync_dissem(0, 1, npes, pSync);
+            break;
+        case SHMEM_INTERNAL_COLL_BCAST:
+            if (m->type == LINEAR)
+                shmem_internal_bcast_linear(dst, src, m->bytes, 0, 0, 1, npes, pSync, 1);
+            else
+                shmem_internal_bcast_tree(dst, src, m->bytes, 0, 0, 1, npes, pSync, 1);
+            break;
+        case SHMEM_INTERNAL_COLL_REDUCE:
+            if (m->type == LINEAR)
+                shmem_internal_op_to_all_linear(dst, src, m->bytes / sizeof(long), sizeof(long),
+                                                0, 1, npes, NULL, pSync, SHM_INTERNAL_SUM,
+                                                SHM_INTERNAL_LONG);
+            else if (m->type == TREE)
+                shmem_internal_op_to_all_tree(dst, src, m->bytes / sizeof(long), sizeof(long),
+                                              0, 1, npes, NULL, pSync, SHM_INTERNAL_SUM,
+                                              SHM_INTERNAL_LONG);
+            else if (m->type == RING)
+                shmem_internal_op_to_all_ring(dst, src, m->bytes / sizeof(long), sizeof(long),
+                                              0, 1, npes, NULL, pSync, SHM_INTERNAL_SUM,
+                                              SHM_INTERNAL_LONG);
+            else
+                shmem_internal_op_to_all_recdbl_sw(dst, src, m->bytes / sizeof(long),
+                                                   sizeof(long), 0, 1, npes, NULL, pSync,
+                                                   SHM_INTERNAL_SUM, SHM_INTERNAL_LONG);
+            break;
+        case SHMEM_INTERNAL_COLL_FCOLLECT:
+            if (m->type == LINEAR)
+                shmem_internal_fcollect_linear(dst, src, m->bytes, 0, 1, npes, pSync);
+            else if (m->type == RING)
+                shmem_internal_fcollect_ring(dst, src, m->bytes, 0, 1, npes, pSync);
+            else if (m->type == BRUCK)
+                shmem_internal_fcollect_bruck(dst, src, m->bytes, 0, 1, npes, pSync);
+            else if (m->type == NEIGHBOR)
+                shmem_internal_fcollect_neighbor(dst, src, m->bytes, 0, 1, npes, pSync);
+            else
+                shmem_internal_fcollect_recdbl(dst, src, m->bytes, 0, 1, npes, pSync);
+            break;
+    }
+}
+
+
+/* Time each candidate algorithm over the world team and keep the fastest per
+ * message size.  The times are max-reduced over all PEs before they are
+ * compared, so every PE arrives at the same table. */
+int
+shmem_internal_coll_tune_measure(void)
+{
+    const int npes = shmem_internal_num_pes;
+    coll_measurement_t m[COLL_TUNE_MAX_MEASUREMENTS];
+    int nm = 0, i, it, s, coll;
+    size_t max_src = 0, max_dst = 0, psync_len;
+    double *times, *max_times;
+    long *pSync;
+    void *src, *dst;
+
+    /* Nothing to choose between on a single PE */
+    if (npes == 1) return 0;
+
+    /* Build the list of measurements */
+    m[nm++] = (coll_measurement_t) { SHMEM_INTERNAL_COLL_BARRIER, 0, LINEAR };
+    m[nm++] = (coll_measurement_t) { SHMEM_INTERNAL_COLL_BARRIER, 0, TREE };
+    m[nm++] = (coll_measurement_t) { SHMEM_INTERNAL_COLL_BARRIER, 0, DISSEM };
+
+    for (s = 0; s < COLL_TUNE_NUM_SIZES; s++) {
+        const size_t bytes = coll_tune_sizes[s];
+
+        m[nm++] = (coll_measurement_t) { SHMEM_INTERNAL_COLL_BCAST, bytes, LINEAR };
+        m[nm++] = (coll_measurement_t) { SHMEM_INTERNAL_COLL_BCAST, bytes, TREE };
+
+        if (shmem_transport_atomic_supported(SHM_INTERNAL_SUM, SHM_INTERNAL_LONG)) {
+            m[nm++] = (coll_measurement_t) { SHMEM_INTERNAL_COLL_REDUCE, bytes, LINEAR };
+            m[nm++] = (coll_measurement_t) { SHMEM_INTERNAL_COLL_REDUCE, bytes, TREE };
+        }
+        m[nm++] = (coll_measurement_t) { SHMEM_INTERNAL_COLL_REDUCE, bytes, RING };
+        m[nm++] = (coll_measurement_t) { SHMEM_INTERNAL_COLL_REDUCE, bytes, RECDBL };
+
+        if (bytes * npes <= COLL_TUNE_MAX_BYTES) {
+            m[nm++] = (coll_measurement_t) { SHMEM_INTERNAL_COLL_FCOLLECT, bytes, LINEAR };
+            m[nm++] = (coll_measurement_t) { SHMEM_INTERNAL_COLL_FCOLLECT, bytes, RING };
+            m[nm++] = (coll_measurement_t) { SHMEM_INTERNAL_COLL_FCOLLECT, bytes, BRUCK };
+            if (0 == (npes & (npes - 1)))
+                m[nm++] = (coll_measurement_t) { SHMEM_INTERNAL_COLL_FCOLLECT, bytes, RECDBL };
+            if (0 == npes % 2)
+                m[nm++] = (coll_measurement_t) { SHMEM_INTERNAL_COLL_FCOLLECT, bytes, NEIGHBOR };
+            max_dst = MAX(max_dst, bytes * npes);
+        }
+
+        max_src = MAX(max_src, bytes);
+        max_dst = MAX(max_dst, bytes);
+    }
+
+    shmem_internal_assert(nm <= COLL_TUNE_MAX_MEASUREMENTS);
+
+    psync_len = MAX(MAX(SHMEM_BARRIER_SYNC_SIZE, SHMEM_BCAST_SYNC_SIZE),
+                    MAX(SHMEM_REDUCE_SYNC_SIZE, SHMEM_COLLECT_SYNC_SIZE));
+
+    src = shmem_internal_shmalloc(max_src);
+    dst = shmem_internal_shmalloc(max_dst);
+    times = shmem_internal_shmalloc(2 * nm * sizeof(double));
+    pSync = shmem_internal_shmalloc(2 * psync_len * sizeof(long));
+
+    if (src == NULL || dst == NULL || times == NULL || pSync == NULL) {
+        RAISE_WARN_STR("Out of symmetric memory measuring collectives, tuning skipped");
+        if (src) shmem_internal_free(src);
+        if (dst) shmem_internal_free(dst);
+        if (times) shmem_internal_free(times);
+        if (pSync) shmem_internal_free(pSync);
+        return -1;
+    }
+
+    max_times = times + nm;
+    memset(src, 0, max_src);
+    for (i = 0; i < 2 * (int) psync_len; i++)
+        pSync[i] = SHMEM_SYNC_VALUE;
+
+    for (i = 0; i < nm; i++) {
+        times[i] = 0.0;
+
+        for (it = 0; it < COLL_TUNE_WARMUP + COLL_TUNE_ITERS; it++) {
+            double start;
+
+            shmem_internal_barrier_all();
+
+            start = shmem_internal_wtime();
+            coll_tune_run(&m[i], dst, src, pSync);
+            if (it >= COLL_TUNE_WARMUP)
+                times[i] += shmem_internal_wtime() - start;
+        }
+    }
+
+    shmem_internal_barrier_all();
+
+    /* The second half of pSync is reserved for the reduction of the results */
+    shmem_internal_op_to_all(max_times, times, nm, sizeof(double), 0, 1, npes, NULL,
+                             pSync + psync_len, SHM_INTERNAL_MAX, SHM_INTERNAL_DOUBLE);
+
+    /* Fastest algorithm per collective and size.  Consecutive sizes with the
+     * same winner are merged into one rule. */
+    for (coll = 0; coll < SHMEM_INTERNAL_COLL_NUM; coll++) {
+        for (s = 0; s < COLL_TUNE_NUM_SIZES; s++) {
+            const size_t bytes = (coll == SHMEM_INTERNAL_COLL_BARRIER) ? 0 : coll_tune_sizes[s];
+            coll_type_t best = AUTO;
+            double best_time = 0.0;
+
+            for (i = 0; i < nm; i++) {
+                if (m[i].coll != coll || m[i].bytes != bytes) continue;
+                if (best == AUTO || max_times[i] < best_time) {
+                    best = m[i].type;
+                    best_time = max_times[i];
+                }
+            }
+
+            if (best != AUTO) {
+                DEBUG_MSG("Tuned %s at %zu bytes: %s (%.2f us)\n", coll_names[coll], bytes,
+                          coll_alg_name(best), best_time / COLL_TUNE_ITERS * 1.0e6);
+
+                if (coll_nrules[coll] == 0)
+                    coll_rule_add(coll, npes, 0, best);
+                else if (coll_rules[coll][0].type != best)
+                    coll_rule_add(coll, npes, bytes, best);
+            }
+
+            if (coll == SHMEM_INTERNAL_COLL_BARRIER) break;
+        }
+    }
+
+    shmem_internal_barrier_all();
+
+    shmem_internal_free(pSync);
+    shmem_internal_free(times);
+    shmem_internal_free(dst);
+    shmem_internal_free(src);
+
+    return 0;
+}
@@ -37,6 +37,8 @@
 #include "runtime.h"
 #include "build_info.h"
 #include "shmem_team.h"
+#include "shmem_remote_pointer.h"
+#include "shmem_prof.h"
 
 #if defined(ENABLE_REMOTE_VIRTUAL_ADDRESSING) && defined(__linux__)
 #include <sys/personality.h>
@@ -71,31 +73,106 @@ unsigned int shmem_internal_rand_seed;
 
 #ifdef ENABLE_THREADS
 shmem_internal_mutex_t shmem_internal_mutex_alloc;
-shmem_internal_mutex_t shmem_internal_mutex_rand_r;
 #endif
 
 static char *shmem_internal_thread_level_str[4] = { "SINGLE", "FUNNELED",
                                                     "SERIALIZED", "MULTIPLE" };
 
+/* Initialization phases reported with SHMEM_INIT_TIMING.  Each phase is
+ * timed from the end of the previous one. */
+enum init_phase_t {
+    INIT_PHASE_ENV = 0,
+    INIT_PHASE_RUNTIME,
+    INIT_PHASE_HEAP,
+    INIT_PHASE_TRANSPORT_INIT,
+    INIT_PHASE_EXCHANGE,
+    INIT_PHASE_TRANSPORT_STARTUP,
+    INIT_PHASE_FASTPATH,
+    INIT_PHASE_COLLECTIVES,
+    INIT_PHASE_TEAMS,
+    INIT_PHASE_BARRIER,
+    INIT_NUM_PHASES
+};
+
+static const char *init_phase_names[INIT_NUM_PHASES] = {
+    "env", "runtime init", "symmetric heap", "transport init",
+    "runtime exchange", "transport startup", "fast path", "collectives",
+    "teams", "final barrier"
+};
+
+static double init_phase_time[INIT_NUM_PHASES];
+static double init_phase_mark;
+
+#define INIT_PHASE_END(phase)                                           \
+    do {                                                                \
+        double now_ = shmem_internal_wtime();                           \
+        init_phase_time[phase] = now_ - init_phase_mark;                \
+        init_phase_mark = now_;                                         \
+    } while (0)
+
+
+/* Reduce the phase times over all PEs and print them on PE 0.  Phases that
+ * end in a collective step (exchange, barrier) include the time spent waiting
+ * for the slowest PE, so a large min/max spread in an earlier phase points to
+ * the phase where PEs fall behind. */
 static void
-shmem_internal_randr_init(void)
+shmem_internal_init_timing_report(void)
 {
-    shmem_internal_rand_seed = shmem_internal_my_pe;
+    const int n = INIT_NUM_PHASES + 1;  /* Phases plus the total */
+    shmem_internal_team_t *team = &shmem_internal_team_world;
+    double *src, *dst;
+    long *psync;
+    int i;
+
+    /* Source and result of a max reduction over {t, -t}, which yields the
+     * max and min, followed by those of a sum reduction over t */
+    src = shmem_internal_shmalloc(sizeof(double) * 6 * n);
+    if (src == NULL) {
+        RAISE_WARN_STR("Out of symmetric memory reporting initialization times");
+        return;
+    }
+    dst = src + 3 * n;
 
-#ifdef ENABLE_THREADS
-    SHMEM_MUTEX_INIT(shmem_internal_mutex_rand_r);
-#endif
+    src[INIT_NUM_PHASES] = 0.0;
+    for (i = 0; i < INIT_NUM_PHASES; i++) {
+        src[i] = init_phase_time[i];
+        src[INIT_NUM_PHASES] += init_phase_time[i];
+    }
+    for (i = 0; i < n; i++) {
+        src[n + i] = -src[i];
+        src[2 * n + i] = src[i];
+    }
 
-    return;
+    psync = shmem_internal_team_choose_psync(team, REDUCE);
+    shmem_internal_op_to_all(dst, src, 2 * n, sizeof(double), team->start, team->stride,
+                             team->size, NULL, psync, SHM_INTERNAL_MAX, SHM_INTERNAL_DOUBLE);
+    shmem_internal_team_release_psyncs(team, REDUCE);
+
+    psync = shmem_internal_team_choose_psync(team, REDUCE);
+    shmem_internal_op_to_all(dst + 2 * n, src + 2 * n, n, sizeof(double), team->start,
+                             team->stride, team->size, NULL, psync, SHM_INTERNAL_SUM,
+                             SHM_INTERNAL_DOUBLE);
+    shmem_internal_team_release_psyncs(team, REDUCE);
+
+    if (shmem_internal_my_pe == 0) {
+        printf("Initialization phase times (seconds) over %d PEs:\n", shmem_internal_num_pes);
+        printf("  %-20s %12s %12s %12s\n", "phase", "min", "avg", "max");
+        for (i = 0; i < n; i++)
+            printf("  %-20s %12.6f %12.6f %12.6f\n",
+                   i < INIT_NUM_PHASES ? init_phase_names[i] : "total",
+                   -dst[n + i], dst[2 * n + i] / shmem_internal_num_pes, dst[i]);
+        printf("\n");
+        fflush(NULL);
+    }
+
+    shmem_internal_barrier_all();
+    shmem_internal_free(src);
 }
 
 static void
-shmem_internal_randr_fini(void)
+shmem_internal_randr_init(void)
 {
-
-#ifdef ENABLE_THREADS
-    SHMEM_MUTEX_DESTROY(shmem_internal_mutex_rand_r);
-#endif
+    shmem_internal_rand_seed = shmem_internal_my_pe;
 
     return;
 }
@@ -111,18 +188,20 @@ shmem_internal_shutdown(void)
 
     shmem_internal_barrier_all();
 
+    shmem_internal_prof_fini();
+
     shmem_internal_finalized = 1;
 
     shmem_internal_team_fini();
 
     shmem_transport_fini();
 
+    shmem_internal_fastpath_fini();
+
     shmem_shr_transport_fini();
 
     SHMEM_MUTEX_DESTROY(shmem_internal_mutex_alloc);
 
-    shmem_internal_randr_fini();
-
     shmem_internal_symmetric_fini();
     shmem_runtime_fini();
 }
@@ -161,13 +240,15 @@ shmem_internal_init(int tl_requested, int *tl_provided)
     int runtime_initialized   = 0;
     int transport_initialized = 0;
     int shr_initialized       = 0;
-    int randr_initialized     = 0;
     int teams_initialized     = 0;
     int enable_node_ranks     = 0;
 
+    init_phase_mark = shmem_internal_wtime();
+
     /* Parse environment variables into shmem_internal_params */
     ret = shmem_internal_parse_env();
     if (ret) return ret;
+    INIT_PHASE_END(INIT_PHASE_ENV);
 
     /* set up threading */
     SHMEM_MUTEX_INIT(shmem_internal_mutex_alloc);
@@ -194,6 +275,7 @@ shmem_internal_init(int tl_requested, int *tl_provided)
         goto cleanup;
     }
     runtime_initialized = 1;
+    INIT_PHASE_END(INIT_PHASE_RUNTIME);
     shmem_internal_my_pe = shmem_runtime_get_rank();
     shmem_internal_num_pes = shmem_runtime_get_size();
 
@@ -314,6 +396,7 @@ shmem_internal_init(int tl_requested, int *tl_provided)
         RETURN_ERROR_MSG("Symmetric heap initialization failed (%d)\n", ret);
         goto cleanup;
     }
+    INIT_PHASE_END(INIT_PHASE_HEAP);
 
     DEBUG_MSG("Thread level=%s, Num. PEs=%d\n"
               RAISE_PE_PREFIX
@@ -374,6 +457,7 @@ shmem_internal_init(int tl_requested, int *tl_provided)
         RETURN_ERROR_MSG("Shared memory transport init failed (%d)\n", ret);
         goto cleanup;
     }
+    INIT_PHASE_END(INIT_PHASE_TRANSPORT_INIT);
 
     /* exchange information */
     ret = shmem_runtime_exchange();
@@ -381,6 +465,7 @@ shmem_internal_init(int tl_requested, int *tl_provided)
         RETURN_ERROR_MSG("Runtime exchange failed (%d)\n", ret);
         goto cleanup;
     }
+    INIT_PHASE_END(INIT_PHASE_EXCHANGE);
 
     DEBUG_MSG("Local rank=%d, Num. local=%d, Shr. rank=%d, Num. shr=%d\n",
               enable_node_ranks ? shmem_runtime_get_node_rank(shmem_internal_my_pe) : 0,
@@ -402,12 +487,21 @@ shmem_internal_init(int tl_requested, int *tl_provided)
         goto cleanup;
     }
     shr_initialized = 1;
+    INIT_PHASE_END(INIT_PHASE_TRANSPORT_STARTUP);
+
+    ret = shmem_internal_fastpath_init();
+    if (0 != ret) {
+        RETURN_ERROR_MSG("Fast path initialization failed (%d)\n", ret);
+        goto cleanup;
+    }
+    INIT_PHASE_END(INIT_PHASE_FASTPATH);
 
     ret = shmem_internal_collectives_init();
     if (ret != 0) {
         RETURN_ERROR_MSG("Initialization of collectives failed (%d)\n", ret);
         goto cleanup;
     }
+    INIT_PHASE_END(INIT_PHASE_COLLECTIVES);
 
     ret = shmem_internal_team_init();
     if (ret != 0) {
@@ -415,9 +509,11 @@ shmem_internal_init(int tl_requested, int *tl_provided)
         goto cleanup;
     }
     teams_initialized = 1;
+    INIT_PHASE_END(INIT_PHASE_TEAMS);
 
     shmem_internal_randr_init();
-    randr_initialized = 1;
+
+    shmem_internal_prof_init();
 
     atexit(shmem_internal_shutdown_atexit);
     shmem_internal_initialized = 1;
@@ -426,6 +522,11 @@ shmem_internal_init(int tl_requested, int *tl_provided)
 #ifndef USE_PMIX
     shmem_runtime_barrier();
 #endif
+    INIT_PHASE_END(INIT_PHASE_BARRIER);
+
+    if (shmem_internal_params.INIT_TIMING)
+        shmem_internal_init_timing_report();
+
     return 0;
 
  cleanup:
@@ -434,13 +535,10 @@ shmem_internal_init(int tl_requested, int *tl_provided)
     }
 
     if (shr_initialized) {
+        shmem_internal_fastpath_fini();
         shmem_shr_transport_fini();
     }
 
-    if (randr_initialized) {
-        shmem_internal_randr_fini();
-    }
-
     if (teams_initialized) {
         shmem_internal_team_fini();
     }
@@ -559,6 +559,8 @@ MAX_RELEASE_CHECK_RATE   default: 4095 unless not HAVE_MMAP
 
 /* Mutexes are handled at the SOS level */
 #define USE_LOCKS 0
+/* Hint-driven symmetric heap partitions are managed as mspaces */
+#define MSPACES 1
 /* END SHMEM CHANGES */
 
 /* Version identifier to allow people to support multiple versions */
@@ -17,6 +17,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define SHMEM_INTERNAL_INCLUDE
 #include "shmem.h"
@@ -40,5 +41,71 @@ shmem_ptr(const void *target, int pe)
     SHMEM_ERR_CHECK_PE(pe);
     SHMEM_ERR_CHECK_SYMMETRIC(target, 1);
 
+    SHMEM_INTERNAL_HEAP_SYNC_PE(target, pe);
+
     return shmem_internal_ptr(target, pe);
 }
+
+
+shmemx_fastpath_info_t shmemx_fastpath_info;
+
+
+/* Publish the peers that shmem_ptr can reach for the inline fast paths in
+ * shmem.h.  Only peers whose put and get are performed with loads and stores
+ * are included, so that fast path accesses are ordered with library calls. */
+int
+shmem_internal_fastpath_init(void)
+{
+#if USE_XPMEM || USE_MEMCPY
+    shmemx_fastpath_info_t *fp = &shmemx_fastpath_info;
+    int pe;
+
+    fp->peer_heap = calloc(shmem_internal_num_pes, sizeof(char *));
+    fp->peer_data = calloc(shmem_internal_num_pes, sizeof(char *));
+    if (NULL == fp->peer_heap || NULL == fp->peer_data) {
+        shmem_internal_fastpath_fini();
+        RETURN_ERROR_STR("Out of memory allocating fast path table");
+        return -1;
+    }
+
+    for (pe = 0; pe < shmem_internal_num_pes; pe++) {
+        int noderank = shmem_internal_get_shr_rank(pe);
+
+        if (-1 == noderank) continue;
+
+#if USE_XPMEM
+        fp->peer_heap[pe] = shmem_transport_xpmem_peers[noderank].heap_ptr;
+        fp->peer_data[pe] = shmem_transport_xpmem_peers[noderank].data_ptr;
+#else
+        fp->peer_heap[pe] = shmem_internal_heap_base;
+        fp->peer_data[pe] = shmem_internal_data_base;
+#endif
+    }
+
+    fp->heap_base   = shmem_internal_heap_base;
+    fp->heap_length = shmem_internal_heap_length;
+    fp->data_base   = shmem_internal_data_base;
+    fp->data_length = shmem_internal_data_length;
+    fp->num_pes     = shmem_internal_num_pes;
+#if USE_SHR_ATOMICS
+    fp->atomics     = 1;
+#endif
+
+    shmem_internal_membar_release();
+    fp->enabled = 1;
+#endif
+
+    return 0;
+}
+
+
+void
+shmem_internal_fastpath_fini(void)
+{
+    shmemx_fastpath_info.enabled = 0;
+
+    free(shmemx_fastpath_info.peer_heap);
+    free(shmemx_fastpath_info.peer_data);
+
+    memset(&shmemx_fastpath_info, 0, sizeof(shmemx_fastpath_info_t));
+}
@@ -30,5 +30,7 @@ FC_SHMEM_PTR(void **target, fortran_integer_t *pe)
     SHMEM_ERR_CHECK_PE(*pe);
     SHMEM_ERR_CHECK_SYMMETRIC(target, 1);
 
+    SHMEM_INTERNAL_HEAP_SYNC_PE(*target, *pe);
+
     return shmem_internal_ptr(*target, *pe);
 }
@@ -17,6 +17,7 @@
 #define SHMEM_COLLECTIVES_H
 
 #include "shmem_synchronization.h"
+#include "shmem_prof.h"
 
 
 enum coll_type_t {
@@ -25,7 +26,10 @@ enum coll_type_t {
     TREE,
     DISSEM,
     RING,
-    RECDBL
+    RECDBL,
+    SHR,
+    BRUCK,
+    NEIGHBOR
 };
 typedef enum coll_type_t coll_type_t;
 
@@ -33,6 +37,26 @@ extern char *coll_type_str[];
 
 extern long *shmem_internal_barrier_all_psync;
 extern long *shmem_internal_sync_all_psync;
+extern long shmem_internal_barrier_all_epoch;
+extern long shmem_internal_sync_all_epoch;
+
+/* Number of longs needed by the epoch barriers (one counter per
+ * dissemination round) */
+#define SHMEM_INTERNAL_EPOCH_SYNC_SIZE (sizeof(int) * 8)
+
+/* Number of longs in a shared memory barrier slot (two cache lines) */
+#define SHMEM_INTERNAL_SHR_BARRIER_SLOT_LEN (2 * SHMEM_INTERNAL_CACHELINE_SIZE / sizeof(long))
+
+struct shmem_internal_shr_barrier_t {
+    long  *counter;     /* Arrival counter on the first PE of the set */
+    long  *flag;        /* Local release flag */
+    long **peer_flags;  /* Release flags of all members */
+    long   sense;
+    int    size;
+};
+typedef struct shmem_internal_shr_barrier_t shmem_internal_shr_barrier_t;
+
+extern shmem_internal_shr_barrier_t *shmem_internal_barrier_all_shr;
 
 extern coll_type_t shmem_internal_barrier_type;
 extern coll_type_t shmem_internal_bcast_type;
@@ -40,14 +64,58 @@ extern coll_type_t shmem_internal_reduce_type;
 extern coll_type_t shmem_internal_collect_type;
 extern coll_type_t shmem_internal_fcollect_type;
 
+/* Collectives whose algorithm can be selected by a tuning table
+ * (SHMEM_COLL_TUNING_FILE or SHMEM_COLL_TUNE) */
+enum shmem_internal_coll_t {
+    SHMEM_INTERNAL_COLL_BARRIER = 0,
+    SHMEM_INTERNAL_COLL_BCAST,
+    SHMEM_INTERNAL_COLL_REDUCE,
+    SHMEM_INTERNAL_COLL_FCOLLECT,
+    SHMEM_INTERNAL_COLL_NUM
+};
+
+extern int shmem_internal_coll_tuned;
+
+int shmem_internal_coll_tune_load(const char *path);
+int shmem_internal_coll_tune_measure(void);
+int shmem_internal_coll_tune_write(const char *path);
+coll_type_t shmem_internal_coll_tune_lookup(int coll, int PE_size, size_t bytes);
+
+/* Algorithm for a collective whose configured type is 'type'.  The tuning
+ * table is only consulted when the algorithm was left to auto-selection and
+ * returns AUTO when no rule matches. */
+static inline coll_type_t
+shmem_internal_coll_select(coll_type_t type, int coll, int PE_size, size_t bytes)
+{
+    if (type == AUTO && shmem_internal_coll_tuned)
+        return shmem_internal_coll_tune_lookup(coll, PE_size, bytes);
+
+    return type;
+}
+
 void shmem_internal_sync_linear(int PE_start, int PE_stride, int PE_size, long *pSync);
 void shmem_internal_sync_tree(int PE_start, int PE_stride, int PE_size, long *pSync);
 void shmem_internal_sync_dissem(int PE_start, int PE_stride, int PE_size, long *pSync);
+void shmem_internal_sync_epoch_linear(int PE_start, int PE_stride, int PE_size, long *pSync,
+                                      long epoch);
+void shmem_internal_sync_epoch_tree(int PE_start, int PE_stride, int PE_size, long *pSync,
+                                    long epoch);
+void shmem_internal_sync_epoch_dissem(int PE_start, int PE_stride, int PE_size, long *pSync,
+                                      long epoch);
+void shmem_internal_sync_epoch_table(const int *pes, int my_idx, int size, long *pSync,
+                                     long epoch);
+
+shmem_internal_shr_barrier_t *shmem_internal_shr_barrier_create(long *slot, int PE_start,
+                                                                int PE_stride, int PE_size);
+void shmem_internal_shr_barrier_destroy(shmem_internal_shr_barrier_t *bar);
+void shmem_internal_sync_shr(shmem_internal_shr_barrier_t *bar);
 
 static inline
 void
 shmem_internal_sync(int PE_start, int PE_stride, int PE_size, long *pSync)
 {
+    uint64_t prof;
+
     if (shmem_internal_params.BARRIERS_FLUSH) {
         fflush(stdout);
         fflush(stderr);
@@ -55,8 +123,12 @@ shmem_internal_sync(int PE_start, int PE_stride, int PE_size, long *pSync)
 
     if (PE_size == 1) return;
 
-    switch (shmem_internal_barrier_type) {
+    prof = shmem_internal_prof_begin();
+
+    switch (shmem_internal_coll_select(shmem_internal_barrier_type,
+                                       SHMEM_INTERNAL_COLL_BARRIER, PE_size, 0)) {
     case AUTO:
+    case SHR:
         if (PE_size < shmem_internal_params.COLL_CROSSOVER) {
             shmem_internal_sync_linear(PE_start, PE_stride, PE_size, pSync);
         } else {
@@ -80,6 +152,52 @@ shmem_internal_sync(int PE_start, int PE_stride, int PE_size, long *pSync)
     /* Ensure remote updates are visible in memory */
     shmem_internal_membar_acq_rel();
     shmem_transport_syncmem();
+
+    shmem_internal_prof_end(SHMEM_INTERNAL_PROF_BARRIER, prof, 0);
+}
+
+
+/* Synchronize using an internal pSync whose counters are never reset.  The
+ * caller increments 'epoch' once per call on the same pSync. */
+static inline
+void
+shmem_internal_sync_epoch(int PE_start, int PE_stride, int PE_size, long *pSync,
+                          long epoch)
+{
+    if (shmem_internal_params.BARRIERS_FLUSH) {
+        fflush(stdout);
+        fflush(stderr);
+    }
+
+    if (PE_size == 1) return;
+
+    switch (shmem_internal_coll_select(shmem_internal_barrier_type,
+                                       SHMEM_INTERNAL_COLL_BARRIER, PE_size, 0)) {
+    case AUTO:
+    case SHR:
+        if (PE_size < shmem_internal_params.COLL_CROSSOVER) {
+            shmem_internal_sync_epoch_linear(PE_start, PE_stride, PE_size, pSync, epoch);
+        } else {
+            shmem_internal_sync_epoch_tree(PE_start, PE_stride, PE_size, pSync, epoch);
+        }
+        break;
+    case LINEAR:
+        shmem_internal_sync_epoch_linear(PE_start, PE_stride, PE_size, pSync, epoch);
+        break;
+    case TREE:
+        shmem_internal_sync_epoch_tree(PE_start, PE_stride, PE_size, pSync, epoch);
+        break;
+    case DISSEM:
+        shmem_internal_sync_epoch_dissem(PE_start, PE_stride, PE_size, pSync, epoch);
+        break;
+    default:
+        RAISE_ERROR_MSG("Illegal barrier/sync type (%d)\n",
+                        shmem_internal_barrier_type);
+    }
+
+    /* Ensure remote updates are visible in memory */
+    shmem_internal_membar_acq_rel();
+    shmem_transport_syncmem();
 }
 
 
@@ -87,7 +205,15 @@ static inline
 void
 shmem_internal_sync_all(void)
 {
-    shmem_internal_sync(0, 1, shmem_internal_num_pes, shmem_internal_sync_all_psync);
+    uint64_t prof = shmem_internal_prof_begin();
+
+    if (shmem_internal_barrier_all_shr)
+        shmem_internal_sync_shr(shmem_internal_barrier_all_shr);
+    else
+        shmem_internal_sync_epoch(0, 1, shmem_internal_num_pes, shmem_internal_sync_all_psync,
+                                  ++shmem_internal_sync_all_epoch);
+
+    shmem_internal_prof_end(SHMEM_INTERNAL_PROF_BARRIER, prof, 0);
 }
 
 
@@ -95,8 +221,12 @@ static inline
 void
 shmem_internal_barrier(int PE_start, int PE_stride, int PE_size, long *pSync)
 {
+    uint64_t prof = shmem_internal_prof_begin();
+
     shmem_internal_quiet(SHMEM_CTX_DEFAULT);
     shmem_internal_sync(PE_start, PE_stride, PE_size, pSync);
+
+    shmem_internal_prof_end(SHMEM_INTERNAL_PROF_BARRIER, prof, 0);
 }
 
 
@@ -104,8 +234,17 @@ static inline
 void
 shmem_internal_barrier_all(void)
 {
+    uint64_t prof = shmem_internal_prof_begin();
+
     shmem_internal_quiet(SHMEM_CTX_DEFAULT);
-    shmem_internal_sync(0, 1, shmem_internal_num_pes, shmem_internal_barrier_all_psync);
+
+    if (shmem_internal_barrier_all_shr)
+        shmem_internal_sync_shr(shmem_internal_barrier_all_shr);
+    else
+        shmem_internal_sync_epoch(0, 1, shmem_internal_num_pes, shmem_internal_barrier_all_psync,
+                                  ++shmem_internal_barrier_all_epoch);
+
+    shmem_internal_prof_end(SHMEM_INTERNAL_PROF_BARRIER, prof, 0);
 }
 
 
@@ -122,7 +261,10 @@ shmem_internal_bcast(void *target, const void *source, size_t len,
                      int PE_root, int PE_start, int PE_stride, int PE_size,
                      long *pSync, int complete)
 {
-    switch (shmem_internal_bcast_type) {
+    uint64_t prof = shmem_internal_prof_begin();
+
+    switch (shmem_internal_coll_select(shmem_internal_bcast_type,
+                                       SHMEM_INTERNAL_COLL_BCAST, PE_size, len)) {
     case AUTO:
         if (PE_size < shmem_internal_params.COLL_CROSSOVER) {
             shmem_internal_bcast_linear(target, source, len, PE_root, PE_start,
@@ -144,6 +286,8 @@ shmem_internal_bcast(void *target, const void *source, size_t len,
         RAISE_ERROR_MSG("Illegal broadcast type (%d)\n",
                         shmem_internal_bcast_type);
     }
+
+    shmem_internal_prof_end(SHMEM_INTERNAL_PROF_BCAST, prof, len);
 }
 
 
@@ -165,6 +309,20 @@ void shmem_internal_op_to_all_recdbl_sw(void *target, const void *source, size_t
                                    void *pWrk, long *pSync,
                                    shm_internal_op_t op, shm_internal_datatype_t datatype);
 
+/* User-defined reduction operation: combines nelems elements of in into inout */
+typedef void (*shmem_internal_reduce_fn_t)(const void *in, void *inout, size_t nelems);
+
+void shmem_internal_reduce_user(void *target, const void *source, size_t count, size_t type_size,
+                                int PE_start, int PE_stride, int PE_size, long *pSync,
+                                shmem_internal_reduce_fn_t fn, int commutative);
+
+void shmem_internal_op_to_all_shr(void *target, const void *source, size_t count, size_t type_size,
+                                  int PE_start, int PE_stride, int PE_size,
+                                  void *pWrk, long *pSync,
+                                  shm_internal_op_t op, shm_internal_datatype_t datatype);
+int shmem_internal_op_to_all_shr_eligible(void *target, const void *source, size_t type_size,
+                                          int PE_start, int PE_stride, int PE_size);
+
 static inline
 void
 shmem_internal_op_to_all(void *target, const void *source, size_t count,
@@ -173,11 +331,20 @@ shmem_internal_op_to_all(void *target, const void *source, size_t count,
                          shm_internal_op_t op,
                          shm_internal_datatype_t datatype)
 {
+    uint64_t prof = shmem_internal_prof_begin();
+
     shmem_internal_assert(type_size > 0);
 
-    switch (shmem_internal_reduce_type) {
+    switch (shmem_internal_coll_select(shmem_internal_reduce_type, SHMEM_INTERNAL_COLL_REDUCE,
+                                       PE_size, count * type_size)) {
         case AUTO:
-            if (shmem_transport_atomic_supported(op, datatype)) {
+            if (PE_size > 1 &&
+                shmem_internal_op_to_all_shr_eligible(target, source, type_size,
+                                                      PE_start, PE_stride, PE_size)) {
+                shmem_internal_op_to_all_shr(target, source, count, type_size,
+                                             PE_start, PE_stride, PE_size,
+                                             pWrk, pSync, op, datatype);
+            } else if (shmem_transport_atomic_supported(op, datatype)) {
                 if (PE_size < shmem_internal_params.COLL_CROSSOVER) {
                     shmem_internal_op_to_all_linear(target, source, count, type_size,
                                                     PE_start, PE_stride, PE_size,
@@ -231,34 +398,65 @@ shmem_internal_op_to_all(void *target, const void *source, size_t count,
                                                PE_start, PE_stride, PE_size,
                                                pWrk, pSync, op, datatype);
             break;
+        case SHR:
+            if (shmem_internal_op_to_all_shr_eligible(target, source, type_size,
+                                                      PE_start, PE_stride, PE_size)) {
+                shmem_internal_op_to_all_shr(target, source, count, type_size,
+                                             PE_start, PE_stride, PE_size,
+                                             pWrk, pSync, op, datatype);
+            } else {
+                shmem_internal_op_to_all_ring(target, source, count, type_size,
+                                              PE_start, PE_stride, PE_size,
+                                              pWrk, pSync, op, datatype);
+            }
+            break;
         default:
             RAISE_ERROR_MSG("Illegal reduction type (%d)\n",
                             shmem_internal_reduce_type);
     }
+
+    shmem_internal_prof_end(SHMEM_INTERNAL_PROF_REDUCE, prof, count * type_size);
 }
 
 
 void shmem_internal_collect_linear(void *target, const void *source, size_t len,
                                    int PE_start, int PE_stride, int PE_size, long *pSync);
+void shmem_internal_collect_scan(void *target, const void *source, size_t len,
+                                 int PE_start, int PE_stride, int PE_size, long *pSync,
+                                 coll_type_t type);
 
 static inline
 void
 shmem_internal_collect(void *target, const void *source, size_t len,
                   int PE_start, int PE_stride, int PE_size, long *pSync)
 {
+    uint64_t prof = shmem_internal_prof_begin();
+
     switch (shmem_internal_collect_type) {
     case AUTO:
-        shmem_internal_collect_linear(target, source, len, PE_start, PE_stride,
-                                      PE_size, pSync);
+        if (PE_size < shmem_internal_params.COLL_CROSSOVER) {
+            shmem_internal_collect_linear(target, source, len, PE_start, PE_stride,
+                                          PE_size, pSync);
+        } else {
+            shmem_internal_collect_scan(target, source, len, PE_start, PE_stride,
+                                        PE_size, pSync, AUTO);
+        }
         break;
     case LINEAR:
         shmem_internal_collect_linear(target, source, len, PE_start, PE_stride,
                                       PE_size, pSync);
         break;
+    case RING:
+    case RECDBL:
+        shmem_internal_collect_scan(target, source, len, PE_start, PE_stride,
+                                    PE_size, pSync, shmem_internal_collect_type);
+        break;
     default:
         RAISE_ERROR_MSG("Illegal collect type (%d)\n",
                         shmem_internal_collect_type);
     }
+
+    shmem_internal_prof_end(SHMEM_INTERNAL_PROF_COLLECT, prof, len);
 }
 
 
@@ -268,16 +466,38 @@ void shmem_internal_fcollect_ring(void *target, const void *source, size_t len,
                                   int PE_start, int PE_stride, int PE_size, long *pSync);
 void shmem_internal_fcollect_recdbl(void *target, const void *source, size_t len,
                                     int PE_start, int PE_stride, int PE_size, long *pSync);
+void shmem_internal_fcollect_bruck(void *target, const void *source, size_t len,
+                                   int PE_start, int PE_stride, int PE_size, long *pSync);
+void shmem_internal_fcollect_neighbor(void *target, const void *source, size_t len,
+                                      int PE_start, int PE_stride, int PE_size, long *pSync);
 
 static inline
 void
 shmem_internal_fcollect(void *target, const void *source, size_t len,
                    int PE_start, int PE_stride, int PE_size, long *pSync)
 {
-    switch (shmem_internal_fcollect_type) {
+    uint64_t prof = shmem_internal_prof_begin();
+
+    switch (shmem_internal_coll_select(shmem_internal_fcollect_type,
+                                       SHMEM_INTERNAL_COLL_FCOLLECT, PE_size, len)) {
     case AUTO:
-        shmem_internal_fcollect_ring(target, source, len, PE_start, PE_stride,
-                                     PE_size, pSync);
+        /* Fewest steps for small totals, then neighbor exchange for even
+         * PE sets and ring otherwise */
+        if (len * PE_size < shmem_internal_params.COLL_SIZE_CROSSOVER) {
+            if (0 == (PE_size & (PE_size - 1))) {
+                shmem_internal_fcollect_recdbl(target, source, len, PE_start, PE_stride,
+                                               PE_size, pSync);
+            } else {
+                shmem_internal_fcollect_bruck(target, source, len, PE_start, PE_stride,
+                                              PE_size, pSync);
+            }
+        } else if (0 == PE_size % 2) {
+            shmem_internal_fcollect_neighbor(target, source, len, PE_start, PE_stride,
+                                             PE_size, pSync);
+        } else {
+            shmem_internal_fcollect_ring(target, source, len, PE_start, PE_stride,
+                                         PE_size, pSync);
+        }
         break;
     case LINEAR:
         shmem_internal_fcollect_linear(target, source, len, PE_start, PE_stride,
@@ -296,10 +516,25 @@ shmem_internal_fcollect(void *target, const void *source, size_t len,
                                          PE_size, pSync);
         }
         break;
+    case BRUCK:
+        shmem_internal_fcollect_bruck(target, source, len, PE_start, PE_stride,
+                                      PE_size, pSync);
+        break;
+    case NEIGHBOR:
+        if (0 == PE_size % 2) {
+            shmem_internal_fcollect_neighbor(target, source, len, PE_start, PE_stride,
+                                             PE_size, pSync);
+        } else {
+            shmem_internal_fcollect_ring(target, source, len, PE_start, PE_stride,
+                                         PE_size, pSync);
+        }
+        break;
     default:
         RAISE_ERROR_MSG("Illegal fcollect type (%d)\n",
                         shmem_internal_fcollect_type);
     }
+
+    shmem_internal_prof_end(SHMEM_INTERNAL_PROF_FCOLLECT, prof, len);
 }
 
 
@@ -309,4 +544,22 @@ void shmem_internal_alltoall(void *dest, const void *source, size_t len,
 void shmem_internal_alltoalls(void *dest, const void *source, ptrdiff_t dst,
                               ptrdiff_t sst, size_t elem_size, size_t nelems,
                               int PE_start, int PE_stride, int PE_size, long *pSync);
+
+/* Collectives on teams with a member table, whose PEs cannot be addressed as
+ * <start, stride, size> (shmem_team.c) */
+struct shmem_internal_team_t;
+
+void shmem_internal_team_bcast_table(struct shmem_internal_team_t *team, void *target,
+                                     const void *source, size_t len, int PE_root);
+void shmem_internal_team_reduce_table(struct shmem_internal_team_t *team, void *target,
+                                      const void *source, size_t count, size_t type_size,
+                                      shm_internal_op_t op, shm_internal_datatype_t datatype,
+                                      shmem_internal_reduce_fn_t fn);
+void shmem_internal_team_collect_table(struct shmem_internal_team_t *team, void *target,
+                                       const void *source, size_t len, long *pSync);
+void shmem_internal_team_fcollect_table(struct shmem_internal_team_t *team, void *target,
+                                        const void *source, size_t len);
+void shmem_internal_team_alltoalls_table(struct shmem_internal_team_t *team, void *dest,
+                                         const void *source, ptrdiff_t dst, ptrdiff_t sst,
+                                         size_t elem_size, size_t nelems);
 #endif
@@ -26,6 +26,7 @@
 #include "shmemx.h"
 
 #include "shmem_atomic.h"
+#include "shmem_prof.h"
 
 #include "transport.h"
 #include "shr_transport.h"
@@ -36,6 +37,9 @@ shmem_internal_put_scalar(shmem_ctx_t ctx, void *target, const void *source, siz
 {
     shmem_internal_assert(len > 0);
 
+    SHMEM_INTERNAL_HEAP_SYNC_PE(target, pe);
+    SHMEM_INTERNAL_PROF_OP(SHMEM_INTERNAL_PROF_PUT, pe, len);
+
     if (shmem_shr_transport_use_write(ctx, target, source, len, pe)) {
         shmem_shr_transport_put_scalar(ctx, target, source, len, pe);
     } else {
@@ -52,6 +56,9 @@ shmem_internal_put_nb(shmem_ctx_t ctx, void *target, const void *source, size_t
     if (len == 0)
         return;
 
+    SHMEM_INTERNAL_HEAP_SYNC_PE(target, pe);
+    SHMEM_INTERNAL_PROF_OP(SHMEM_INTERNAL_PROF_PUT, pe, len);
+
     if (shmem_shr_transport_use_write(ctx, target, source, len, pe)) {
         shmem_shr_transport_put(ctx, target, source, len, pe);
     } else {
@@ -64,6 +71,10 @@ void
 shmem_internal_put_signal_nbi(shmem_ctx_t ctx, void *target, const void *source, size_t len,
                               uint64_t *sig_addr, uint64_t signal, int sig_op, int pe)
 {
+    SHMEM_INTERNAL_HEAP_SYNC_PE(target, pe);
+    SHMEM_INTERNAL_HEAP_SYNC_PE(sig_addr, pe);
+    SHMEM_INTERNAL_PROF_OP(SHMEM_INTERNAL_PROF_AMO, pe, sizeof(uint64_t));
+
     if (len == 0) {
         if (sig_op == SHMEM_SIGNAL_ADD)
             shmem_transport_atomic((shmem_transport_ctx_t *) ctx, sig_addr, &signal, sizeof(uint64_t),
@@ -74,6 +85,8 @@ shmem_internal_put_signal_nbi(shmem_ctx_t ctx, void *target, const void *source,
         return;
     }
 
+    SHMEM_INTERNAL_PROF_OP(SHMEM_INTERNAL_PROF_PUT, pe, len);
+
     if (shmem_shr_transport_use_write(ctx, target, source, len, pe)) {
         shmem_shr_transport_put_signal(ctx, target, source, len, sig_addr, signal, sig_op, pe);
     } else {
@@ -87,6 +100,9 @@ shmem_internal_put_nbi(shmem_ctx_t ctx, void *target, const void *source, size_t
 {
     if (len == 0) return;
 
+    SHMEM_INTERNAL_HEAP_SYNC_PE(target, pe);
+    SHMEM_INTERNAL_PROF_OP(SHMEM_INTERNAL_PROF_PUT, pe, len);
+
     if (shmem_shr_transport_use_write(ctx, target, source, len, pe)) {
         shmem_shr_transport_put(ctx, target, source, len, pe);
     } else {
@@ -100,6 +116,9 @@ void
 shmem_internal_put_ct_nb(shmemx_ct_t ct, void *target, const void *source, size_t len, int pe,
                       long *completion)
 {
+    SHMEM_INTERNAL_HEAP_SYNC_PE(target, pe);
+    SHMEM_INTERNAL_PROF_OP(SHMEM_INTERNAL_PROF_PUT, pe, len);
+
     /* TODO: add shortcut for on-node-comms */
     shmem_transport_put_ct_nb((shmem_transport_ct_t *)
                               ct, target, source, len, pe, completion);
@@ -121,6 +140,9 @@ shmem_internal_get(shmem_ctx_t ctx, void *target, const void *source, size_t len
 {
     if (len == 0) return;
 
+    SHMEM_INTERNAL_HEAP_SYNC_PE(source, pe);
+    SHMEM_INTERNAL_PROF_OP(SHMEM_INTERNAL_PROF_GET, pe, len);
+
     if (shmem_shr_transport_use_read(ctx, target, source, len, pe)) {
         shmem_shr_transport_get(ctx, target, source, len, pe);
     } else {
@@ -133,6 +155,9 @@ static inline
 void
 shmem_internal_get_ct(shmemx_ct_t ct, void *target, const void *source, size_t len, int pe)
 {
+    SHMEM_INTERNAL_HEAP_SYNC_PE(source, pe);
+    SHMEM_INTERNAL_PROF_OP(SHMEM_INTERNAL_PROF_GET, pe, len);
+
     /* TODO: add shortcut for on-node-comms */
     shmem_transport_get_ct((shmem_transport_ct_t *) ct,
                            target, source, len, pe);
@@ -154,6 +179,9 @@ shmem_internal_swap(shmem_ctx_t ctx, void *target, void *source, void *dest, siz
 {
     shmem_internal_assert(len > 0);
 
+    SHMEM_INTERNAL_HEAP_SYNC_PE(target, pe);
+    SHMEM_INTERNAL_PROF_OP(SHMEM_INTERNAL_PROF_FETCH_AMO, pe, len);
+
     if (shmem_shr_transport_use_atomic(ctx, target, len, pe, datatype)) {
         shmem_shr_transport_swap(ctx, target, source, dest, len, pe, datatype);
     } else {
@@ -170,6 +198,9 @@ shmem_internal_swap_nbi(shmem_ctx_t ctx, void *target, void *source,
 {
     shmem_internal_assert(len > 0);
 
+    SHMEM_INTERNAL_HEAP_SYNC_PE(target, pe);
+    SHMEM_INTERNAL_PROF_OP(SHMEM_INTERNAL_PROF_FETCH_AMO, pe, len);
+
     if (shmem_shr_transport_use_atomic(ctx, target, len, pe, datatype)) {
         shmem_shr_transport_swap(ctx, target, source, dest, len, pe, datatype);
     } else {
@@ -186,6 +217,9 @@ shmem_internal_cswap(shmem_ctx_t ctx, void *target, void *source, void *dest, vo
 {
     shmem_internal_assert(len > 0);
 
+    SHMEM_INTERNAL_HEAP_SYNC_PE(target, pe);
+    SHMEM_INTERNAL_PROF_OP(SHMEM_INTERNAL_PROF_FETCH_AMO, pe, len);
+
     if (shmem_shr_transport_use_atomic(ctx, target, len, pe, datatype)) {
         shmem_shr_transport_cswap(ctx, target, source, dest, operand, len, pe, datatype);
     } else {
@@ -203,6 +237,9 @@ shmem_internal_cswap_nbi(shmem_ctx_t ctx, void *target, void *source,
 {
     shmem_internal_assert(len > 0);
 
+    SHMEM_INTERNAL_HEAP_SYNC_PE(target, pe);
+    SHMEM_INTERNAL_PROF_OP(SHMEM_INTERNAL_PROF_FETCH_AMO, pe, len);
+
     if (shmem_shr_transport_use_atomic(ctx, target, len, pe, datatype)) {
         shmem_shr_transport_cswap(ctx, target, source, dest, operand, len, pe, datatype);
     } else {
@@ -219,6 +256,9 @@ shmem_internal_mswap(shmem_ctx_t ctx, void *target, void *source, void *dest, vo
 {
     shmem_internal_assert(len > 0);
 
+    SHMEM_INTERNAL_HEAP_SYNC_PE(target, pe);
+    SHMEM_INTERNAL_PROF_OP(SHMEM_INTERNAL_PROF_FETCH_AMO, pe, len);
+
     if (shmem_shr_transport_use_atomic(ctx, target, len, pe, datatype)) {
         shmem_shr_transport_mswap(ctx, target, source, dest, mask, len, pe, datatype);
     } else {
@@ -235,6 +275,9 @@ shmem_internal_atomic(shmem_ctx_t ctx, void *target, const void *source, size_t
 {
     shmem_internal_assert(len > 0);
 
+    SHMEM_INTERNAL_HEAP_SYNC_PE(target, pe);
+    SHMEM_INTERNAL_PROF_OP(SHMEM_INTERNAL_PROF_AMO, pe, len);
+
     if (shmem_shr_transport_use_atomic(ctx, target, len, pe, datatype)) {
         shmem_shr_transport_atomic(ctx, target, source, len, pe, op, datatype);
     } else {
@@ -251,6 +294,9 @@ shmem_internal_atomic_fetch(shmem_ctx_t ctx, void *target, const void *source, s
 {
     shmem_internal_assert(len > 0);
 
+    SHMEM_INTERNAL_HEAP_SYNC_PE(source, pe);
+    SHMEM_INTERNAL_PROF_OP(SHMEM_INTERNAL_PROF_FETCH_AMO, pe, len);
+
     if (shmem_shr_transport_use_atomic(ctx, target, len, pe, datatype)) {
         shmem_shr_transport_atomic_fetch(ctx, target, source, len, pe, datatype);
     } else {
@@ -267,6 +313,9 @@ shmem_internal_atomic_set(shmem_ctx_t ctx, void *target, const void *source, siz
 {
     shmem_internal_assert(len > 0);
 
+    SHMEM_INTERNAL_HEAP_SYNC_PE(target, pe);
+    SHMEM_INTERNAL_PROF_OP(SHMEM_INTERNAL_PROF_AMO, pe, len);
+
     if (shmem_shr_transport_use_atomic(ctx, target, len, pe, datatype)) {
         shmem_shr_transport_atomic_set(ctx, target, source, len, pe, datatype);
     } else {
@@ -284,6 +333,9 @@ shmem_internal_atomicv(shmem_ctx_t ctx, void *target, const void *source,
 {
     shmem_internal_assert(len > 0);
 
+    SHMEM_INTERNAL_HEAP_SYNC_PE(target, pe);
+    SHMEM_INTERNAL_PROF_OP(SHMEM_INTERNAL_PROF_AMO, pe, len);
+
     if (shmem_shr_transport_use_atomic(ctx, target, len, pe, datatype)) {
         shmem_shr_transport_atomicv(ctx, target, source, len, pe, op, datatype);
     } else {
@@ -302,6 +354,9 @@ shmem_internal_fetch_atomic(shmem_ctx_t ctx, void *target, void *source, void *d
 {
     shmem_internal_assert(len > 0);
 
+    SHMEM_INTERNAL_HEAP_SYNC_PE(target, pe);
+    SHMEM_INTERNAL_PROF_OP(SHMEM_INTERNAL_PROF_FETCH_AMO, pe, len);
+
     if (shmem_shr_transport_use_atomic(ctx, target, len, pe, datatype)) {
         shmem_shr_transport_fetch_atomic(ctx, target, source, dest, len, pe,
                                          op, datatype);
@@ -320,6 +375,9 @@ shmem_internal_fetch_atomic_nbi(shmem_ctx_t ctx, void *target, void *source,
 {
     shmem_internal_assert(len > 0);
 
+    SHMEM_INTERNAL_HEAP_SYNC_PE(target, pe);
+    SHMEM_INTERNAL_PROF_OP(SHMEM_INTERNAL_PROF_FETCH_AMO, pe, len);
+
     if (shmem_shr_transport_use_atomic(ctx, target, len, pe, datatype)) {
         shmem_shr_transport_fetch_atomic(ctx, target, source, dest, len, pe,
                                          op, datatype);
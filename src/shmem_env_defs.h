@@ -44,6 +44,14 @@ SHMEM_INTERNAL_ENV_DEF(DISABLE_ASLR_CHECK, bool, false, SHMEM_INTERNAL_ENV_CAT_O
 
 SHMEM_INTERNAL_ENV_DEF(SYMMETRIC_HEAP_USE_MALLOC, bool, false, SHMEM_INTERNAL_ENV_CAT_OTHER,
                         "Allocate the symmetric heap using malloc")
+SHMEM_INTERNAL_ENV_DEF(SYMMETRIC_HEAP_ATOMICS_SIZE, size, 2*1024*1024, SHMEM_INTERNAL_ENV_CAT_OTHER,
+                       "Size of the symmetric heap partition for atomics and signals (0 to disable)")
+SHMEM_INTERNAL_ENV_DEF(SYMMETRIC_HEAP_BULK_SIZE, size, 0, SHMEM_INTERNAL_ENV_CAT_OTHER,
+                       "Size of the symmetric heap partition for bulk data (0 to disable)")
+SHMEM_INTERNAL_ENV_DEF(SYMMETRIC_HEAP_DEFER_SYNC, bool, false, SHMEM_INTERNAL_ENV_CAT_OTHER,
+                       "Defer the barrier in symmetric heap allocation routines")
+SHMEM_INTERNAL_ENV_DEF(SYMMETRIC_HEAP_CHECK, bool, false, SHMEM_INTERNAL_ENV_CAT_OTHER,
+                       "Verify that symmetric heap allocations match on all PEs")
 SHMEM_INTERNAL_ENV_DEF(BOUNCE_SIZE, size, DEFAULT_BOUNCE_SIZE, SHMEM_INTERNAL_ENV_CAT_OTHER,
                        "Maximum message size to bounce buffer")
 SHMEM_INTERNAL_ENV_DEF(MAX_BOUNCE_BUFFERS, long, 128, SHMEM_INTERNAL_ENV_CAT_OTHER,
@@ -58,15 +66,19 @@ SHMEM_INTERNAL_ENV_DEF(COLL_SIZE_CROSSOVER, size, 16384, SHMEM_INTERNAL_ENV_CAT_
 SHMEM_INTERNAL_ENV_DEF(COLL_RADIX, long, 4, SHMEM_INTERNAL_ENV_CAT_COLLECTIVES,
                        "Radix for tree-based collectives")
 SHMEM_INTERNAL_ENV_DEF(BARRIER_ALGORITHM, string, "auto", SHMEM_INTERNAL_ENV_CAT_COLLECTIVES,
-                       "Algorithm for barrier.  Options are auto, linear, tree, dissem")
+                       "Algorithm for barrier.  Options are auto, linear, tree, dissem, shr")
 SHMEM_INTERNAL_ENV_DEF(BCAST_ALGORITHM, string, "auto", SHMEM_INTERNAL_ENV_CAT_COLLECTIVES,
                        "Algorithm for broadcast.  Options are auto, linear, tree")
 SHMEM_INTERNAL_ENV_DEF(REDUCE_ALGORITHM, string, "auto", SHMEM_INTERNAL_ENV_CAT_COLLECTIVES,
-                       "Algorithm for reductions.  Options are auto, linear, tree, recdbl")
+                       "Algorithm for reductions.  Options are auto, linear, tree, recdbl, ring, shr")
 SHMEM_INTERNAL_ENV_DEF(COLLECT_ALGORITHM, string, "auto", SHMEM_INTERNAL_ENV_CAT_COLLECTIVES,
-                       "Algorithm for collect.  Options are auto, linear")
+                       "Algorithm for collect.  Options are auto, linear, ring, recdbl")
 SHMEM_INTERNAL_ENV_DEF(FCOLLECT_ALGORITHM, string, "auto", SHMEM_INTERNAL_ENV_CAT_COLLECTIVES,
-                       "Algorithm for fcollect.  Options are auto, linear, ring, recdbl")
+                       "Algorithm for fcollect.  Options are auto, linear, ring, recdbl, bruck, neighbor")
+SHMEM_INTERNAL_ENV_DEF(COLL_TUNING_FILE, string, "", SHMEM_INTERNAL_ENV_CAT_COLLECTIVES,
+                       "Collective algorithm tuning table to load, or to write when COLL_TUNE is set")
+SHMEM_INTERNAL_ENV_DEF(COLL_TUNE, bool, false, SHMEM_INTERNAL_ENV_CAT_COLLECTIVES,
+                       "Measure the collective algorithms at startup and select the fastest per message size")
 SHMEM_INTERNAL_ENV_DEF(BARRIERS_FLUSH, bool, false, SHMEM_INTERNAL_ENV_CAT_COLLECTIVES,
                         "Flush stdout and stderr on barrier")
 
@@ -74,6 +86,8 @@ SHMEM_INTERNAL_ENV_DEF(TEAMS_MAX, long, DEFAULT_TEAMS_MAX, SHMEM_INTERNAL_ENV_CA
                        "Maximum number of teams per PE")
 SHMEM_INTERNAL_ENV_DEF(TEAM_SHARED_ONLY_SELF, bool, false, SHMEM_INTERNAL_ENV_CAT_OTHER,
                        "Include only the self PE in SHMEM_TEAM_SHARED")
+SHMEM_INTERNAL_ENV_DEF(TEAM_COLLECTIVE_SLOTS, long, 4, SHMEM_INTERNAL_ENV_CAT_OTHER,
+                       "Number of back-to-back collectives per team before the team is resynchronized")
 
 #ifdef USE_CMA
 SHMEM_INTERNAL_ENV_DEF(CMA_PUT_MAX, size, 8*1024, SHMEM_INTERNAL_ENV_CAT_INTRANODE,
@@ -107,11 +121,27 @@ SHMEM_INTERNAL_ENV_DEF(OFI_STX_ALLOCATOR, string, "round-robin", SHMEM_INTERNAL_
                        "Algorithm for allocating STX resources to contexts")
 SHMEM_INTERNAL_ENV_DEF(OFI_STX_DISABLE_PRIVATE, bool, false, SHMEM_INTERNAL_ENV_CAT_TRANSPORT,
                        "Disallow private contexts from having exclusive STX access")
+SHMEM_INTERNAL_ENV_DEF(OFI_ATOMICS_MR, bool, false, SHMEM_INTERNAL_ENV_CAT_TRANSPORT,
+                       "Register the symmetric heap atomics partition as a separate memory region")
+SHMEM_INTERNAL_ENV_DEF(OFI_PROGRESS_INTERVAL, long, 0, SHMEM_INTERNAL_ENV_CAT_TRANSPORT,
+                       "Maximum polling interval for the OFI progress thread in microseconds (0 to disable)")
+SHMEM_INTERNAL_ENV_DEF(OFI_PROGRESS_CPU, long, -1, SHMEM_INTERNAL_ENV_CAT_TRANSPORT,
+                       "CPU to bind the OFI progress thread to (-1 to leave unbound)")
+SHMEM_INTERNAL_ENV_DEF(OFI_MR_CACHE_SIZE, long, 0, SHMEM_INTERNAL_ENV_CAT_TRANSPORT,
+                       "Maximum number of cached registrations of private buffers (0 to disable)")
+SHMEM_INTERNAL_ENV_DEF(OFI_MR_CACHE_THRESHOLD, size, 256*1024, SHMEM_INTERNAL_ENV_CAT_TRANSPORT,
+                       "Minimum size of a transfer from or to a private buffer that uses the MR cache")
+SHMEM_INTERNAL_ENV_DEF(OFI_RAILS, long, 1, SHMEM_INTERNAL_ENV_CAT_TRANSPORT,
+                       "Number of OFI domains (rails) over which transfers are distributed")
+SHMEM_INTERNAL_ENV_DEF(OFI_RAIL_STRIPE_SIZE, size, 256*1024, SHMEM_INTERNAL_ENV_CAT_TRANSPORT,
+                       "Minimum size of the part of a transfer that is striped onto one rail")
 #endif
 
 #ifdef USE_UCX
 SHMEM_INTERNAL_ENV_DEF(PROGRESS_INTERVAL, long, 1000, SHMEM_INTERNAL_ENV_CAT_TRANSPORT,
                        "Polling interval for progress thread in microseconds (0 to disable)")
+SHMEM_INTERNAL_ENV_DEF(UCX_CTX_WORKERS, bool, true, SHMEM_INTERNAL_ENV_CAT_TRANSPORT,
+                       "Create a separate UCX worker for each private context")
 #endif
 
 #ifdef ENABLE_PMI_MPI
@@ -122,3 +152,11 @@ SHMEM_INTERNAL_ENV_DEF(MPI_THREAD_LEVEL, string, "MPI_THREAD_SINGLE", SHMEM_INTE
 SHMEM_INTERNAL_ENV_DEF(BACKTRACE, string, "", SHMEM_INTERNAL_ENV_CAT_OTHER,
                        "Specify the mechanism to use for backtracing on failure")
 
+SHMEM_INTERNAL_ENV_DEF(PROFILE, bool, false, SHMEM_INTERNAL_ENV_CAT_OTHER,
+                       "Record per-peer communication and synchronization statistics and report them at finalize")
+SHMEM_INTERNAL_ENV_DEF(PROFILE_TRACE, string, "", SHMEM_INTERNAL_ENV_CAT_OTHER,
+                       "File name prefix for a per-PE Chrome trace of profiled events")
+SHMEM_INTERNAL_ENV_DEF(PROFILE_TRACE_EVENTS, long, 65536, SHMEM_INTERNAL_ENV_CAT_OTHER,
+                       "Maximum number of trace events recorded per thread")
+SHMEM_INTERNAL_ENV_DEF(INIT_TIMING, bool, false, SHMEM_INTERNAL_ENV_CAT_OTHER,
+                       "Report the min/avg/max time across PEs spent in each initialization phase")
@@ -42,9 +42,15 @@ extern long shmem_internal_heap_length;
 extern void *shmem_internal_data_base;
 extern long shmem_internal_data_length;
 
+/* Partition of the symmetric heap used for objects allocated with the
+ * SHMEM_MALLOC_ATOMICS_REMOTE or SHMEM_MALLOC_SIGNAL_REMOTE hints */
+extern void *shmem_internal_heap_atomics_base;
+extern size_t shmem_internal_heap_atomics_length;
+
 extern unsigned int shmem_internal_rand_seed;
 
 #define SHMEM_INTERNAL_HEAP_OVERHEAD (1024*1024)
+#define SHMEM_INTERNAL_CACHELINE_SIZE 64
 #define SHMEM_INTERNAL_DIAG_STRLEN 1024
 #define SHMEM_INTERNAL_DIAG_WRAPLEN 72
 
@@ -432,7 +438,6 @@ typedef shmem_spinlock_t shmem_internal_mutex_t;
 #   endif /* ENABLE_PTHREAD_MUTEX */
 
 extern shmem_internal_mutex_t shmem_internal_mutex_alloc;
-extern shmem_internal_mutex_t shmem_internal_mutex_rand_r;
 
 #else
 #   define SHMEM_MUTEX_INIT(_mutex)
@@ -454,19 +459,36 @@ int shmem_internal_collectives_init(void);
 void *shmem_internal_shmalloc(size_t size);
 void* shmem_internal_get_next(intptr_t incr);
 
-void dlfree(void*);
+/* Release a symmetric heap object, the caller must hold
+ * shmem_internal_mutex_alloc */
+void shmem_internal_heap_free(void *ptr);
 
 static inline void shmem_internal_free(void *ptr)
 {
-    /* It's fine to call dlfree with NULL, but better to avoid unnecessarily
-     * taking the mutex in the threaded case. */
+    /* It's fine to free NULL, but better to avoid unnecessarily taking the
+     * mutex in the threaded case. */
     if (ptr != NULL) {
         SHMEM_MUTEX_LOCK(shmem_internal_mutex_alloc);
-        dlfree(ptr);
+        shmem_internal_heap_free(ptr);
         SHMEM_MUTEX_UNLOCK(shmem_internal_mutex_alloc);
     }
 }
 
+/* Nonzero while some symmetric allocation has skipped its barrier, which
+ * only happens inside an allocation epoch or with
+ * SHMEM_SYMMETRIC_HEAP_DEFER_SYNC.  Cleared when all PEs synchronize. */
+extern int shmem_internal_heap_sync_pending;
+
+void shmem_internal_heap_sync_pe(const void *addr, int pe);
+
+/* Before accessing addr at the target PE, wait for the target to complete
+ * the allocation of addr if its barrier was deferred */
+#define SHMEM_INTERNAL_HEAP_SYNC_PE(addr, pe)                                      \
+    do {                                                                           \
+        if (__atomic_load_n(&shmem_internal_heap_sync_pending, __ATOMIC_RELAXED))  \
+            shmem_internal_heap_sync_pe(addr, pe);                                 \
+    } while (0)
+
 /* Query PEs reachable using shared memory */
 static inline int shmem_internal_get_shr_rank(int pe)
 {
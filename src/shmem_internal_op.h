@@ -18,8 +18,13 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 #include "transport.h"
 
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+
 #define FUNC_OP_CREATE(type_name, c_type, op_name, calc)                    \
     static inline void shmem_op_##type_name##_##op_name##_func(c_type *in,  \
                                                     c_type *out, int count) \
@@ -147,6 +152,170 @@ FUNC_OP_CREATE(double_complex, double _Complex, prod, shmem_internal_prod_op)
 FUNC_OP_CREATE(float_complex, float _Complex, sum, shmem_internal_sum_op)
 FUNC_OP_CREATE(float_complex, float _Complex, prod, shmem_internal_prod_op)
 
+
+/* Half-precision types are stored as 16-bit patterns: IEEE 754 binary16
+ * (float16) and the upper half of a binary32 (bfloat16).  Operands are
+ * widened to float, combined in single precision, and rounded to nearest
+ * even once per combine. */
+static inline float shmem_internal_float16_to_float(uint16_t h)
+{
+    uint32_t sign = (uint32_t) (h & 0x8000) << 16;
+    uint32_t exp  = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+    uint32_t x;
+    float f;
+
+    if (exp == 0x1f) {
+        x = sign | 0x7f800000 | (mant << 13);
+    } else if (exp != 0) {
+        x = sign | ((exp + 112) << 23) | (mant << 13);
+    } else {
+        /* Zero or subnormal, mant * 2^-24 is exact in single precision */
+        f = (float) mant * 5.9604644775390625e-8f;
+        memcpy(&x, &f, sizeof(x));
+        x |= sign;
+    }
+
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+static inline uint16_t shmem_internal_float_to_float16(float f)
+{
+    uint32_t x, sign, absx;
+
+    memcpy(&x, &f, sizeof(x));
+    sign = (x >> 16) & 0x8000;
+    absx = x & 0x7fffffff;
+
+    if (absx >= 0x7f800000) {
+        /* Inf stays Inf, NaN stays a quiet NaN */
+        return sign | 0x7c00 | (absx > 0x7f800000 ? 0x200 | ((absx >> 13) & 0x3ff) : 0);
+    } else if (absx >= 0x477ff000) {
+        /* Rounds above the largest float16 (65504) */
+        return sign | 0x7c00;
+    } else if (absx < 0x38800000) {
+        /* Subnormal result: adding 0.5 aligns the float16 subnormal ulp
+         * (2^-24) with the float ulp, so the FPU rounds for us */
+        float a;
+        uint32_t y;
+
+        memcpy(&a, &absx, sizeof(a));
+        a += 0.5f;
+        memcpy(&y, &a, sizeof(y));
+        return sign | (y - 0x3f000000);
+    } else {
+        /* Rebias the exponent and round the dropped 13 bits to nearest even */
+        absx += 0xc8000fff + ((absx >> 13) & 1);
+        return sign | (absx >> 13);
+    }
+}
+
+static inline float shmem_internal_bfloat16_to_float(uint16_t b)
+{
+    uint32_t x = (uint32_t) b << 16;
+    float f;
+
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+static inline uint16_t shmem_internal_float_to_bfloat16(float f)
+{
+    uint32_t x;
+
+    memcpy(&x, &f, sizeof(x));
+
+    if ((x & 0x7fffffff) > 0x7f800000)
+        return (x >> 16) | 0x40;        /* Quiet NaN */
+
+    x += 0x7fff + ((x >> 16) & 1);
+    return x >> 16;
+}
+
+#define FUNC_OP_CREATE_HALF(type_name, op_name, calc)                       \
+    static inline void shmem_op_##type_name##_##op_name##_func(uint16_t *in,\
+                                                  uint16_t *out, int count) \
+    {                                                                       \
+        int i;                                                              \
+        for (i = 0; i < count; ++i) {                                       \
+            out[i] = shmem_internal_float_to_##type_name(                   \
+                         calc(shmem_internal_##type_name##_to_float(out[i]),\
+                              shmem_internal_##type_name##_to_float(in[i])));\
+        }                                                                   \
+    }
+
+/* With F16C, float16 operands are converted eight at a time */
+#ifdef __F16C__
+#define FUNC_OP_CREATE_FLOAT16(op_name, calc, vcalc)                        \
+    static inline void shmem_op_float16_##op_name##_func(uint16_t *in,     \
+                                                  uint16_t *out, int count) \
+    {                                                                       \
+        int i;                                                              \
+        for (i = 0; i + 8 <= count; i += 8) {                               \
+            __m256 a = _mm256_cvtph_ps(_mm_loadu_si128((__m128i *) &out[i]));\
+            __m256 b = _mm256_cvtph_ps(_mm_loadu_si128((__m128i *) &in[i])); \
+            _mm_storeu_si128((__m128i *) &out[i],                           \
+                             _mm256_cvtps_ph(vcalc(a, b),                   \
+                                             _MM_FROUND_TO_NEAREST_INT));   \
+        }                                                                   \
+        for (; i < count; ++i) {                                            \
+            out[i] = shmem_internal_float_to_float16(                       \
+                         calc(shmem_internal_float16_to_float(out[i]),      \
+                              shmem_internal_float16_to_float(in[i])));     \
+        }                                                                   \
+    }
+#else
+#define FUNC_OP_CREATE_FLOAT16(op_name, calc, vcalc)                        \
+    FUNC_OP_CREATE_HALF(float16, op_name, calc)
+#endif
+
+FUNC_OP_CREATE_FLOAT16(max, shmem_internal_max_op, _mm256_max_ps)
+FUNC_OP_CREATE_FLOAT16(min, shmem_internal_min_op, _mm256_min_ps)
+FUNC_OP_CREATE_FLOAT16(sum, shmem_internal_sum_op, _mm256_add_ps)
+
+FUNC_OP_CREATE_HALF(bfloat16, max, shmem_internal_max_op)
+FUNC_OP_CREATE_HALF(bfloat16, min, shmem_internal_min_op)
+FUNC_OP_CREATE_HALF(bfloat16, sum, shmem_internal_sum_op)
+
+#undef FUNC_OP_CREATE_FLOAT16
+#undef FUNC_OP_CREATE_HALF
+
+#define SHMEM_INTERNAL_DTYPE_IS_HALF(dtype) \
+    ((dtype) == SHM_INTERNAL_FLOAT16 || (dtype) == SHM_INTERNAL_BFLOAT16)
+
+/* Widen count half-precision values to float */
+static inline void shmem_internal_half_to_float(shm_internal_datatype_t datatype,
+                                                const void *in, float *out, size_t count)
+{
+    const uint16_t *h = (const uint16_t *) in;
+    size_t i;
+
+    if (datatype == SHM_INTERNAL_FLOAT16) {
+        for (i = 0; i < count; i++)
+            out[i] = shmem_internal_float16_to_float(h[i]);
+    } else {
+        for (i = 0; i < count; i++)
+            out[i] = shmem_internal_bfloat16_to_float(h[i]);
+    }
+}
+
+/* Round count float values to half precision */
+static inline void shmem_internal_float_to_half(shm_internal_datatype_t datatype,
+                                                const float *in, void *out, size_t count)
+{
+    uint16_t *h = (uint16_t *) out;
+    size_t i;
+
+    if (datatype == SHM_INTERNAL_FLOAT16) {
+        for (i = 0; i < count; i++)
+            h[i] = shmem_internal_float_to_float16(in[i]);
+    } else {
+        for (i = 0; i < count; i++)
+            h[i] = shmem_internal_float_to_bfloat16(in[i]);
+    }
+}
+
 #define REDUCE_LOCAL_DTYPE_CASE_FP(dtype, dtype_name, c_type)                             \
     case dtype:                                                                           \
         switch(op) {                                                                      \
@@ -181,6 +350,23 @@ FUNC_OP_CREATE(float_complex, float _Complex, prod, shmem_internal_prod_op)
         }                                                                                 \
         break;
 
+#define REDUCE_LOCAL_DTYPE_CASE_HALF(dtype, dtype_name)                                   \
+    case dtype:                                                                           \
+        switch(op) {                                                                      \
+            case SHM_INTERNAL_MIN:                                                        \
+                shmem_op_##dtype_name##_min_func((uint16_t *) in, (uint16_t *) inout, count); \
+                break;                                                                    \
+            case SHM_INTERNAL_MAX:                                                        \
+                shmem_op_##dtype_name##_max_func((uint16_t *) in, (uint16_t *) inout, count); \
+                break;                                                                    \
+            case SHM_INTERNAL_SUM:                                                        \
+                shmem_op_##dtype_name##_sum_func((uint16_t *) in, (uint16_t *) inout, count); \
+                break;                                                                    \
+            default:                                                                      \
+                RAISE_ERROR_STR("unsupported reduction on " # dtype_name);                \
+        }                                                                                 \
+        break;
+
 #define REDUCE_LOCAL_DTYPE_CASE_INT(dtype, dtype_name, c_type)                            \
     case dtype:                                                                           \
         switch(op) {                                                                      \
@@ -247,6 +433,8 @@ static inline void shmem_internal_reduce_local(shm_internal_op_t op,
         REDUCE_LOCAL_DTYPE_CASE_FP(SHM_INTERNAL_LONG_DOUBLE, long_double, long double);
         REDUCE_LOCAL_DTYPE_CASE_CPLX(SHM_INTERNAL_FLOAT_COMPLEX, float_complex, float _Complex);
         REDUCE_LOCAL_DTYPE_CASE_CPLX(SHM_INTERNAL_DOUBLE_COMPLEX, double_complex, double _Complex);
+        REDUCE_LOCAL_DTYPE_CASE_HALF(SHM_INTERNAL_FLOAT16, float16);
+        REDUCE_LOCAL_DTYPE_CASE_HALF(SHM_INTERNAL_BFLOAT16, bfloat16);
 
         default:
             RAISE_ERROR_MSG("invalid data type (%d)", (int) datatype);
@@ -255,4 +443,5 @@ static inline void shmem_internal_reduce_local(shm_internal_op_t op,
 
 #undef REDUCE_LOCAL_DTYPE_CASE_FP
 #undef REDUCE_LOCAL_DTYPE_CASE_CPLX
+#undef REDUCE_LOCAL_DTYPE_CASE_HALF
 #undef REDUCE_LOCAL_DTYPE_CASE_INT
@@ -0,0 +1,418 @@
+/* -*- C -*-
+ *
+ * Copyright (c) 2018 Intel Corporation. All rights reserved.
+ * This software is available to you under the BSD license.
+ *
+ * This file is part of the Sandia OpenSHMEM software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+ *
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+
+#define SHMEM_INTERNAL_INCLUDE
+#include "shmem.h"
+#include "shmem_internal.h"
+#include "shmem_prof.h"
+
+/* Number of peers listed in the summary, by bytes transferred */
+#define PROF_TOP_PEERS 8
+
+/* Size histogram bucket b > 0 counts lengths in [2^(b-1), 2^b) */
+#define PROF_HIST_BUCKETS 65
+
+struct prof_event_t {
+    uint64_t start;             /* Monotonic time (ns) */
+    uint64_t dur;               /* 0 for RMA and atomic operations */
+    uint64_t len;
+    int32_t  kind;              /* Region, or NUM_REGIONS + op */
+    int32_t  pe;
+};
+typedef struct prof_event_t prof_event_t;
+
+struct prof_thread_t {
+    int                   id;
+    int                   depth;
+    uint64_t             *op_cnt;       /* Indexed by op * num_pes + pe */
+    uint64_t             *op_bytes;
+    uint64_t              hist[SHMEM_INTERNAL_PROF_NUM_OPS][PROF_HIST_BUCKETS];
+    uint64_t              region_cnt[SHMEM_INTERNAL_PROF_NUM_REGIONS];
+    uint64_t              region_ns[SHMEM_INTERNAL_PROF_NUM_REGIONS];
+    prof_event_t         *events;
+    size_t                nevents;
+    size_t                ndropped;
+    struct prof_thread_t *next;
+};
+typedef struct prof_thread_t prof_thread_t;
+
+int shmem_internal_prof_enabled = 0;
+
+static int prof_trace = 0;
+static size_t prof_max_events;
+static uint64_t prof_mono_base, prof_real_base;
+
+static __thread prof_thread_t *prof_self = NULL;
+static prof_thread_t *prof_threads = NULL;
+static int prof_nthreads = 0;
+#ifdef ENABLE_THREADS
+static shmem_internal_mutex_t prof_mutex;
+#endif
+
+static const char *prof_op_names[SHMEM_INTERNAL_PROF_NUM_OPS] = {
+    "put", "get", "amo", "fetch-amo"
+};
+
+static const char *prof_region_names[SHMEM_INTERNAL_PROF_NUM_REGIONS] = {
+    "quiet", "fence", "wait", "barrier", "bcast", "reduce", "collect",
+    "fcollect", "alltoall", "alltoalls"
+};
+
+
+static inline uint64_t
+prof_clock(clockid_t clk)
+{
+    struct timespec ts;
+
+    clock_gettime(clk, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+static prof_thread_t *
+prof_get_thread(void)
+{
+    prof_thread_t *t = prof_self;
+
+    if (t != NULL)
+        return t;
+
+    t = calloc(1, sizeof(prof_thread_t));
+    if (t == NULL)
+        RAISE_ERROR_STR("Out of memory allocating profiler state");
+
+    t->op_cnt = calloc(SHMEM_INTERNAL_PROF_NUM_OPS * shmem_internal_num_pes, sizeof(uint64_t));
+    t->op_bytes = calloc(SHMEM_INTERNAL_PROF_NUM_OPS * shmem_internal_num_pes, sizeof(uint64_t));
+    if (t->op_cnt == NULL || t->op_bytes == NULL)
+        RAISE_ERROR_STR("Out of memory allocating profiler peer tables");
+
+    if (prof_trace) {
+        t->events = malloc(prof_max_events * sizeof(prof_event_t));
+        if (t->events == NULL)
+            RAISE_ERROR_STR("Out of memory allocating profiler trace buffer");
+    }
+
+    SHMEM_MUTEX_LOCK(prof_mutex);
+    t->id = prof_nthreads++;
+    t->next = prof_threads;
+    prof_threads = t;
+    SHMEM_MUTEX_UNLOCK(prof_mutex);
+
+    prof_self = t;
+
+    return t;
+}
+
+
+static inline void
+prof_add_event(prof_thread_t *t, int kind, uint64_t start, uint64_t dur, size_t len, int pe)
+{
+    prof_event_t *e;
+
+    if (t->nevents == prof_max_events) {
+        t->ndropped++;
+        return;
+    }
+
+    e = &t->events[t->nevents++];
+    e->start = start;
+    e->dur   = dur;
+    e->len   = len;
+    e->kind  = kind;
+    e->pe    = pe;
+}
+
+
+void
+shmem_internal_prof_record_op(int op, int pe, size_t len)
+{
+    prof_thread_t *t = prof_get_thread();
+    size_t idx = (size_t) op * shmem_internal_num_pes + pe;
+    int bucket = len ? 64 - __builtin_clzll((unsigned long long) len) : 0;
+
+    t->op_cnt[idx]++;
+    t->op_bytes[idx] += len;
+    t->hist[op][bucket]++;
+
+    if (prof_trace)
+        prof_add_event(t, SHMEM_INTERNAL_PROF_NUM_REGIONS + op,
+                       prof_clock(CLOCK_MONOTONIC), 0, len, pe);
+}
+
+
+uint64_t
+shmem_internal_prof_region_begin(void)
+{
+    prof_thread_t *t = prof_get_thread();
+
+    /* Nested regions are tracked for the depth only */
+    if (t->depth++ > 0)
+        return 1;
+
+    return prof_clock(CLOCK_MONOTONIC);
+}
+
+
+void
+shmem_internal_prof_region_end(int region, uint64_t start, size_t len)
+{
+    prof_thread_t *t;
+    uint64_t dur;
+
+    /* The profiler was shut down while the region was open */
+    if (!shmem_internal_prof_enabled)
+        return;
+
+    t = prof_get_thread();
+    t->depth--;
+    if (start == 1)
+        return;
+
+    dur = prof_clock(CLOCK_MONOTONIC) - start;
+    t->region_cnt[region]++;
+    t->region_ns[region] += dur;
+
+    if (prof_trace)
+        prof_add_event(t, region, start, dur, len, -1);
+}
+
+
+void
+shmem_internal_prof_init(void)
+{
+    if (!shmem_internal_params.PROFILE &&
+        !(shmem_internal_params.PROFILE_TRACE_provided &&
+          shmem_internal_params.PROFILE_TRACE[0] != '\0'))
+        return;
+
+    prof_trace = shmem_internal_params.PROFILE_TRACE_provided &&
+                 shmem_internal_params.PROFILE_TRACE[0] != '\0';
+    prof_max_events = shmem_internal_params.PROFILE_TRACE_EVENTS > 0 ?
+                      (size_t) shmem_internal_params.PROFILE_TRACE_EVENTS : 0;
+
+    prof_mono_base = prof_clock(CLOCK_MONOTONIC);
+    prof_real_base = prof_clock(CLOCK_REALTIME);
+
+    SHMEM_MUTEX_INIT(prof_mutex);
+
+    shmem_internal_prof_enabled = 1;
+}
+
+
+/* Trace timestamps are wall clock based so that the traces of different PEs
+ * can be loaded together */
+static void
+prof_print_ts(FILE *f, uint64_t mono)
+{
+    uint64_t ns = prof_real_base + (mono - prof_mono_base);
+
+    fprintf(f, "%" PRIu64 ".%03" PRIu64, ns / 1000, ns % 1000);
+}
+
+
+static void
+prof_write_trace(void)
+{
+    char path[1024];
+    prof_thread_t *t;
+    FILE *f;
+    size_t i;
+
+    snprintf(path, sizeof(path), "%s.%d.json", shmem_internal_params.PROFILE_TRACE,
+             shmem_internal_my_pe);
+
+    f = fopen(path, "w");
+    if (f == NULL) {
+        RAISE_WARN_MSG("Unable to open profile trace file '%s'\n", path);
+        return;
+    }
+
+    fprintf(f, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+    fprintf(f, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, "
+            "\"args\": {\"name\": \"PE %d\"}}", shmem_internal_my_pe, shmem_internal_my_pe);
+
+    for (t = prof_threads; t != NULL; t = t->next) {
+        for (i = 0; i < t->nevents; i++) {
+            prof_event_t *e = &t->events[i];
+
+            if (e->kind < SHMEM_INTERNAL_PROF_NUM_REGIONS) {
+                fprintf(f, ",\n{\"name\": \"%s\", \"cat\": \"sync\", \"ph\": \"X\", "
+                        "\"pid\": %d, \"tid\": %d, \"ts\": ", prof_region_names[e->kind],
+                        shmem_internal_my_pe, t->id);
+                prof_print_ts(f, e->start);
+                fprintf(f, ", \"dur\": %" PRIu64 ".%03" PRIu64 ", \"args\": {\"bytes\": %" PRIu64 "}}",
+                        e->dur / 1000, e->dur % 1000, e->len);
+            } else {
+                fprintf(f, ",\n{\"name\": \"%s\", \"cat\": \"rma\", \"ph\": \"i\", \"s\": \"t\", "
+                        "\"pid\": %d, \"tid\": %d, \"ts\": ",
+                        prof_op_names[e->kind - SHMEM_INTERNAL_PROF_NUM_REGIONS],
+                        shmem_internal_my_pe, t->id);
+                prof_print_ts(f, e->start);
+                fprintf(f, ", \"args\": {\"pe\": %d, \"bytes\": %" PRIu64 "}}", e->pe, e->len);
+            }
+        }
+    }
+
+    fprintf(f, "\n]}\n");
+    fclose(f);
+}
+
+
+#define PROF_PRINT(...)                                                 \
+    do {                                                                \
+        char prof_str_[SHMEM_INTERNAL_DIAG_STRLEN];                     \
+        snprintf(prof_str_, sizeof(prof_str_), __VA_ARGS__);            \
+        fprintf(stderr, "[%04d] PROFILE: %s\n", shmem_internal_my_pe, prof_str_); \
+    } while (0)
+
+static void
+prof_print_summary(void)
+{
+    const int npes = shmem_internal_num_pes;
+    uint64_t *cnt, *bytes, *peer_bytes;
+    uint64_t hist[SHMEM_INTERNAL_PROF_NUM_OPS][PROF_HIST_BUCKETS] = { { 0 } };
+    uint64_t region_cnt[SHMEM_INTERNAL_PROF_NUM_REGIONS] = { 0 };
+    uint64_t region_ns[SHMEM_INTERNAL_PROF_NUM_REGIONS] = { 0 };
+    size_t ndropped = 0;
+    prof_thread_t *t;
+    int op, pe, b, r, i;
+
+    cnt = calloc(SHMEM_INTERNAL_PROF_NUM_OPS * npes, sizeof(uint64_t));
+    bytes = calloc(SHMEM_INTERNAL_PROF_NUM_OPS * npes, sizeof(uint64_t));
+    peer_bytes = calloc(npes, sizeof(uint64_t));
+    if (cnt == NULL || bytes == NULL || peer_bytes == NULL) {
+        RAISE_WARN_STR("Out of memory printing profile");
+        goto out;
+    }
+
+    for (t = prof_threads; t != NULL; t = t->next) {
+        for (i = 0; i < SHMEM_INTERNAL_PROF_NUM_OPS * npes; i++) {
+            cnt[i] += t->op_cnt[i];
+            bytes[i] += t->op_bytes[i];
+        }
+        for (op = 0; op < SHMEM_INTERNAL_PROF_NUM_OPS; op++)
+            for (b = 0; b < PROF_HIST_BUCKETS; b++)
+                hist[op][b] += t->hist[op][b];
+        for (r = 0; r < SHMEM_INTERNAL_PROF_NUM_REGIONS; r++) {
+            region_cnt[r] += t->region_cnt[r];
+            region_ns[r] += t->region_ns[r];
+        }
+        ndropped += t->ndropped;
+    }
+
+    PROF_PRINT("%-10s %14s %16s", "operation", "count", "bytes");
+    for (op = 0; op < SHMEM_INTERNAL_PROF_NUM_OPS; op++) {
+        uint64_t op_cnt = 0, op_bytes = 0;
+        char hist_str[SHMEM_INTERNAL_DIAG_STRLEN];
+        size_t off = 0;
+
+        for (pe = 0; pe < npes; pe++) {
+            op_cnt += cnt[op * npes + pe];
+            op_bytes += bytes[op * npes + pe];
+            peer_bytes[pe] += bytes[op * npes + pe];
+        }
+
+        if (op_cnt == 0) continue;
+
+        PROF_PRINT("%-10s %14" PRIu64 " %16" PRIu64, prof_op_names[op], op_cnt, op_bytes);
+
+        /* Histogram buckets are labeled by their lower bound */
+        hist_str[0] = '\0';
+        for (b = 0; b < PROF_HIST_BUCKETS && off < sizeof(hist_str); b++) {
+            if (hist[op][b] == 0) continue;
+            off += snprintf(hist_str + off, sizeof(hist_str) - off, " %llu:%" PRIu64,
+                            b == 0 ? 0ULL : 1ULL << (b - 1), hist[op][b]);
+        }
+        PROF_PRINT("  %s sizes (B:count):%s", prof_op_names[op], hist_str);
+    }
+
+    /* Peers with the most traffic */
+    for (i = 0; i < PROF_TOP_PEERS; i++) {
+        int top = -1;
+
+        for (pe = 0; pe < npes; pe++)
+            if (peer_bytes[pe] > 0 && (top < 0 || peer_bytes[pe] > peer_bytes[top]))
+                top = pe;
+
+        if (top < 0) break;
+
+        if (i == 0)
+            PROF_PRINT("%-10s %14s %16s %14s %16s %12s %12s", "peer", "puts", "put bytes",
+                       "gets", "get bytes", "amos", "fetch-amos");
+
+        PROF_PRINT("%-10d %14" PRIu64 " %16" PRIu64 " %14" PRIu64 " %16" PRIu64
+                   " %12" PRIu64 " %12" PRIu64, top,
+                   cnt[SHMEM_INTERNAL_PROF_PUT * npes + top],
+                   bytes[SHMEM_INTERNAL_PROF_PUT * npes + top],
+                   cnt[SHMEM_INTERNAL_PROF_GET * npes + top],
+                   bytes[SHMEM_INTERNAL_PROF_GET * npes + top],
+                   cnt[SHMEM_INTERNAL_PROF_AMO * npes + top],
+                   cnt[SHMEM_INTERNAL_PROF_FETCH_AMO * npes + top]);
+
+        peer_bytes[top] = 0;
+    }
+
+    PROF_PRINT("%-10s %14s %16s %14s", "routine", "calls", "total (ms)", "avg (us)");
+    for (r = 0; r < SHMEM_INTERNAL_PROF_NUM_REGIONS; r++) {
+        if (region_cnt[r] == 0) continue;
+
+        PROF_PRINT("%-10s %14" PRIu64 " %16.3f %14.3f", prof_region_names[r], region_cnt[r],
+                   region_ns[r] / 1.0e6, region_ns[r] / 1.0e3 / region_cnt[r]);
+    }
+
+    if (ndropped)
+        PROF_PRINT("%zu trace events dropped, increase SHMEM_PROFILE_TRACE_EVENTS", ndropped);
+
+out:
+    free(cnt);
+    free(bytes);
+    free(peer_bytes);
+}
+
+
+void
+shmem_internal_prof_fini(void)
+{
+    prof_thread_t *t;
+
+    if (!shmem_internal_prof_enabled)
+        return;
+
+    shmem_internal_prof_enabled = 0;
+
+    prof_print_summary();
+
+    if (prof_trace)
+        prof_write_trace();
+
+    while (prof_threads != NULL) {
+        t = prof_threads;
+        prof_threads = t->next;
+        free(t->op_cnt);
+        free(t->op_bytes);
+        free(t->events);
+        free(t);
+    }
+
+    /* Thread-local pointers of other threads are stale from here on, but the
+     * profiler cannot be re-enabled */
+    prof_self = NULL;
+
+    SHMEM_MUTEX_DESTROY(prof_mutex);
+}
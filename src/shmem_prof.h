@@ -0,0 +1,77 @@
+/* -*- C -*-
+ *
+ * Copyright (c) 2018 Intel Corporation. All rights reserved.
+ * This software is available to you under the BSD license.
+ *
+ * This file is part of the Sandia OpenSHMEM software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+ *
+ */
+
+#ifndef SHMEM_PROF_H
+#define SHMEM_PROF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Communication profiler, enabled with SHMEM_PROFILE.  RMA and atomic
+ * operations are counted per destination PE and by log2 message size, and
+ * the time spent in synchronization and collective routines is accumulated.
+ * Statistics are kept in thread-local buffers and reported at finalize. */
+
+enum shmem_internal_prof_op_t {
+    SHMEM_INTERNAL_PROF_PUT = 0,
+    SHMEM_INTERNAL_PROF_GET,
+    SHMEM_INTERNAL_PROF_AMO,            /* Non-fetching atomics and signals */
+    SHMEM_INTERNAL_PROF_FETCH_AMO,
+    SHMEM_INTERNAL_PROF_NUM_OPS
+};
+
+enum shmem_internal_prof_region_t {
+    SHMEM_INTERNAL_PROF_QUIET = 0,
+    SHMEM_INTERNAL_PROF_FENCE,
+    SHMEM_INTERNAL_PROF_WAIT,
+    SHMEM_INTERNAL_PROF_BARRIER,
+    SHMEM_INTERNAL_PROF_BCAST,
+    SHMEM_INTERNAL_PROF_REDUCE,
+    SHMEM_INTERNAL_PROF_COLLECT,
+    SHMEM_INTERNAL_PROF_FCOLLECT,
+    SHMEM_INTERNAL_PROF_ALLTOALL,
+    SHMEM_INTERNAL_PROF_ALLTOALLS,
+    SHMEM_INTERNAL_PROF_NUM_REGIONS
+};
+
+extern int shmem_internal_prof_enabled;
+
+void shmem_internal_prof_init(void);
+void shmem_internal_prof_fini(void);
+void shmem_internal_prof_record_op(int op, int pe, size_t len);
+uint64_t shmem_internal_prof_region_begin(void);
+void shmem_internal_prof_region_end(int region, uint64_t start, size_t len);
+
+#define SHMEM_INTERNAL_PROF_OP(op, pe, len)                             \
+    do {                                                                \
+        if (__builtin_expect(shmem_internal_prof_enabled, 0))          \
+            shmem_internal_prof_record_op(op, pe, len);                 \
+    } while (0)
+
+/* Timed regions are bracketed by begin and end.  Only the outermost region
+ * on a thread is recorded, e.g. a quiet inside a barrier is attributed to the
+ * barrier.  A begin token of 0 means the region is not tracked. */
+static inline uint64_t
+shmem_internal_prof_begin(void)
+{
+    if (__builtin_expect(shmem_internal_prof_enabled, 0))
+        return shmem_internal_prof_region_begin();
+    return 0;
+}
+
+static inline void
+shmem_internal_prof_end(int region, uint64_t start, size_t len)
+{
+    if (__builtin_expect(start != 0, 0))
+        shmem_internal_prof_region_end(region, start, len);
+}
+
+#endif
@@ -42,5 +42,7 @@ shmem_internal_ptr(const void *target, int pe)
     }
 }
 
+int shmem_internal_fastpath_init(void);
+void shmem_internal_fastpath_fini(void);
 
 #endif /* #ifndef SHMEM_REMOTE_POINTER_H */
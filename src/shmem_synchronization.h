@@ -19,16 +19,20 @@
 #include "shmem_atomic.h"
 #include "shmem_comm.h"
 #include "transport.h"
+#include "shmem_prof.h"
 
 static inline void
 shmem_internal_quiet(shmem_ctx_t ctx)
 {
     int ret;
+    uint64_t prof;
 
     if (ctx == SHMEM_CTX_INVALID)
         return;
 
+    prof = shmem_internal_prof_begin();
     ret = shmem_transport_quiet((shmem_transport_ctx_t *)ctx);
+    shmem_internal_prof_end(SHMEM_INTERNAL_PROF_QUIET, prof, 0);
     if (0 != ret) { RAISE_ERROR(ret); }
 
     shmem_internal_membar();
@@ -41,15 +45,39 @@ shmem_internal_quiet(shmem_ctx_t ctx)
 }
 
 
+/* Complete the operations issued on ctx to the given PE.  The transport may
+ * complete other operations as well. */
+static inline void
+shmem_internal_quiet_pe(shmem_ctx_t ctx, int pe)
+{
+    int ret;
+    uint64_t prof;
+
+    if (ctx == SHMEM_CTX_INVALID)
+        return;
+
+    prof = shmem_internal_prof_begin();
+    ret = shmem_transport_quiet_pe((shmem_transport_ctx_t *)ctx, pe);
+    shmem_internal_prof_end(SHMEM_INTERNAL_PROF_QUIET, prof, 0);
+    if (0 != ret) { RAISE_ERROR(ret); }
+
+    shmem_internal_membar();
+    shmem_transport_syncmem();
+}
+
+
 static inline void
 shmem_internal_fence(shmem_ctx_t ctx)
 {
     int ret;
+    uint64_t prof;
 
     if (ctx == SHMEM_CTX_INVALID)
         return;
 
+    prof = shmem_internal_prof_begin();
     ret = shmem_transport_fence((shmem_transport_ctx_t *)ctx);
+    shmem_internal_prof_end(SHMEM_INTERNAL_PROF_FENCE, prof, 0);
     if (0 != ret) { RAISE_ERROR(ret); }
 
     shmem_internal_membar_release();
@@ -112,54 +140,69 @@ shmem_internal_fence(shmem_ctx_t ctx)
         }                                                \
     } while(0)
 
-#define SHMEM_WAIT_BLOCK(var, value)                                    \
-    do {                                                                \
-        uint64_t target_cntr;                                           \
-                                                                        \
-        while (SYNC_LOAD(var) == value) {                               \
-            target_cntr = shmem_transport_received_cntr_get();          \
-            COMPILER_FENCE();                                           \
-            if (SYNC_LOAD(var) != value) break;                         \
-            shmem_transport_received_cntr_wait(target_cntr + 1);        \
-        }                                                               \
-    } while(0)
+/* Load the len byte variable at var, used to detect changes to variables of
+ * any width */
+static inline uint64_t
+shmem_internal_wait_word(const void *var, size_t len)
+{
+    switch (len) {
+        case 1:
+            return *(volatile const uint8_t *) var;
+        case 2:
+            return *(volatile const uint16_t *) var;
+        case 4:
+            return *(volatile const uint32_t *) var;
+        case 8:
+            return *(volatile const uint64_t *) var;
+        default:
+            RAISE_ERROR_STR("Unsupported wait variable size");
+    }
+    return 0;
+}
+
+/* Sleep until the variable at var no longer holds old.  May return early. */
+void shmem_internal_wait_change(const void *var, size_t len, uint64_t old);
 
+/* The snapshot is taken before the condition is tested, so an update that
+ * lands between the two makes the wait return at once instead of being
+ * missed. */
 #define SHMEM_WAIT_UNTIL_BLOCK(var, cond, value)                        \
     do {                                                                \
-        uint64_t target_cntr;                                           \
+        uint64_t snapshot;                                              \
         int cmpret;                                                     \
                                                                         \
+        snapshot = shmem_internal_wait_word(var, sizeof(*(var)));       \
         COMP(cond, SYNC_LOAD(var), value, cmpret);                      \
         while (!cmpret) {                                               \
-            target_cntr = shmem_transport_received_cntr_get();          \
-            COMPILER_FENCE();                                           \
-            COMP(cond, SYNC_LOAD(var), value, cmpret);                  \
-            if (cmpret) break;                                          \
-            shmem_transport_received_cntr_wait(target_cntr + 1);        \
+            shmem_internal_wait_change(var, sizeof(*(var)), snapshot);  \
+            snapshot = shmem_internal_wait_word(var, sizeof(*(var)));   \
             COMP(cond, SYNC_LOAD(var), value, cmpret);                  \
         }                                                               \
     } while(0)
 
+#define SHMEM_WAIT_BLOCK(var, value)                                    \
+    SHMEM_WAIT_UNTIL_BLOCK(var, SHMEM_CMP_NE, value)
+
 #if defined(ENABLE_HARD_POLLING)
 #define SHMEM_INTERNAL_WAIT_UNTIL(var, cond, value)                     \
     SHMEM_WAIT_UNTIL_POLL(var, cond, value)
 #else
 #define SHMEM_INTERNAL_WAIT_UNTIL(var, cond, value)                     \
-    if (shmem_internal_thread_level == SHMEM_THREAD_SINGLE) {           \
-        SHMEM_WAIT_UNTIL_BLOCK(var, cond, value);                       \
-    } else {                                                            \
-        SHMEM_WAIT_UNTIL_POLL(var, cond, value);                        \
-    }
+    SHMEM_WAIT_UNTIL_BLOCK(var, cond, value)
 #endif
 
 #define SHMEM_WAIT(var, value) do {                                     \
+        uint64_t prof_ = shmem_internal_prof_begin();                   \
         SHMEM_INTERNAL_WAIT_UNTIL(var, SHMEM_CMP_NE, value);            \
+        shmem_internal_prof_end(SHMEM_INTERNAL_PROF_WAIT, prof_, 0);    \
         shmem_internal_membar_acq_rel();                                \
         shmem_transport_syncmem();                                      \
     } while (0)
 
 #define SHMEM_WAIT_UNTIL(var, cond, value) do {                         \
+        uint64_t prof_ = shmem_internal_prof_begin();                   \
         SHMEM_INTERNAL_WAIT_UNTIL(var, cond, value);                    \
+        shmem_internal_prof_end(SHMEM_INTERNAL_PROF_WAIT, prof_, 0);    \
         shmem_internal_membar_acq_rel();                                \
         shmem_transport_syncmem();                                      \
     } while (0)
@@ -15,6 +15,7 @@
 #include "shmem_team.h"
 #include "shmem_collectives.h"
 #include "shmem_remote_pointer.h"
+#include "shmem_internal_op.h"
 
 #include <math.h>
 
@@ -23,7 +24,8 @@
 #define SHMEM_TEAMS_MIN          2
 
 #define N_PSYNC_BYTES             8
-#define PSYNC_CHUNK_SIZE          (N_PSYNCS_PER_TEAM * SHMEM_SYNC_SIZE)
+#define N_PSYNC_SLOTS_MAX         64
+#define PSYNC_CHUNK_SIZE          (shmem_internal_params.TEAM_COLLECTIVE_SLOTS * SHMEM_SYNC_SIZE)
 
 
 shmem_internal_team_t shmem_internal_team_world;
@@ -35,11 +37,21 @@ shmem_team_t SHMEM_TEAM_SHARED = (shmem_team_t) &shmem_internal_team_shared;
 shmem_internal_team_t **shmem_internal_team_pool;
 long *shmem_internal_psync_pool;
 long *shmem_internal_psync_barrier_pool;
-static unsigned char *psync_pool_avail;
-static unsigned char *psync_pool_avail_reduced;
-
-static int *team_ret_val;
-static int *team_ret_val_reduced;
+static long *shr_barrier_pool;
+static void *shr_barrier_pool_base;
+static unsigned char psync_pool_avail[N_PSYNC_BYTES];
+
+/* Per-PE record exchanged by the team split routines */
+struct team_split_rec_t {
+    unsigned char psync_avail[N_PSYNC_BYTES];
+    int           color;
+    int           key;
+};
+typedef struct team_split_rec_t team_split_rec_t;
+
+/* Gather buffer for the split routines, one record per PE in the parent
+ * team.  Each PE only writes its own copy; peers read it with gets. */
+static team_split_rec_t *team_split_buf;
 
 /* Checks whether a PE has a consistent stride given (start, stride, size).
  * This function is useful within a loop across PE IDs, and sets 'start',
@@ -78,9 +90,9 @@ int shmem_internal_team_init(void)
     shmem_internal_team_world.my_pe          = shmem_internal_my_pe;
     shmem_internal_team_world.config_mask    = 0;
     shmem_internal_team_world.contexts_len   = 0;
+    shmem_internal_team_world.psync_next     = 0;
+    shmem_internal_team_world.sync_epoch     = 0;
     memset(&shmem_internal_team_world.config, 0, sizeof(shmem_team_config_t));
-    for (size_t i = 0; i < N_PSYNCS_PER_TEAM; i++)
-        shmem_internal_team_world.psync_avail[i] = 1;
     SHMEM_TEAM_WORLD = (shmem_team_t) &shmem_internal_team_world;
 
     /* Initialize SHMEM_TEAM_SHARED */
@@ -88,9 +100,9 @@ int shmem_internal_team_init(void)
     shmem_internal_team_shared.my_pe         = shmem_internal_my_pe;
     shmem_internal_team_shared.config_mask   = 0;
     shmem_internal_team_shared.contexts_len  = 0;
+    shmem_internal_team_shared.psync_next    = 0;
+    shmem_internal_team_shared.sync_epoch    = 0;
     memset(&shmem_internal_team_shared.config, 0, sizeof(shmem_team_config_t));
-    for (size_t i = 0; i < N_PSYNCS_PER_TEAM; i++)
-        shmem_internal_team_shared.psync_avail[i] = 1;
     SHMEM_TEAM_SHARED = (shmem_team_t) &shmem_internal_team_shared;
 
     if (shmem_internal_params.TEAM_SHARED_ONLY_SELF) {
@@ -132,6 +144,13 @@ int shmem_internal_team_init(void)
     if (shmem_internal_params.TEAMS_MAX < SHMEM_TEAMS_MIN)
         shmem_internal_params.TEAMS_MAX = SHMEM_TEAMS_MIN;
 
+    if (shmem_internal_params.TEAM_COLLECTIVE_SLOTS < 1 ||
+        shmem_internal_params.TEAM_COLLECTIVE_SLOTS > N_PSYNC_SLOTS_MAX) {
+        RETURN_ERROR_MSG("Requested %ld collective slots per team, but 1 to %d are supported\n",
+                         shmem_internal_params.TEAM_COLLECTIVE_SLOTS, N_PSYNC_SLOTS_MAX);
+        goto cleanup;
+    }
+
     shmem_internal_team_pool = malloc(shmem_internal_params.TEAMS_MAX *
                                       sizeof(shmem_internal_team_t*));
 
@@ -142,13 +161,19 @@ int shmem_internal_team_init(void)
     shmem_internal_team_pool[SHMEM_TEAM_SHARED_INDEX] = &shmem_internal_team_shared;
 
     /* Allocate pSync pool, each with the maximum possible size requirement */
-    /* Create two pSyncs per team for back-to-back collectives and one for barriers.
+    /* Create SHMEM_TEAM_COLLECTIVE_SLOTS pSyncs per team for back-to-back
+     * collectives and one for barriers.  The barrier pSyncs are used with the
+     * epoch barriers and are never reset.  The collective pSyncs are still
+     * reset by each broadcast, reduction, and collect before it returns, so
+     * a slot can be reused once all PEs have left the collective.
      * Array organization:
      *
      * [ (world) (shared) (team 1) (team 2) ...  (world) (shared) (team 1) (team 2) ... ]
      *  <----------- groups 1 & 2-------------->|<------------- group 3 ---------------->
      *  <--- (bcast, collect, reduce, etc.) --->|<------ (barriers and syncs) ---------->
      * */
+    shmem_internal_assert(SHMEM_SYNC_SIZE >= SHMEM_INTERNAL_EPOCH_SYNC_SIZE);
+
     long psync_len = shmem_internal_params.TEAMS_MAX * (PSYNC_CHUNK_SIZE + SHMEM_SYNC_SIZE);
     shmem_internal_psync_pool = shmem_internal_shmalloc(sizeof(long) * psync_len);
     if (NULL == shmem_internal_psync_pool) goto cleanup;
@@ -161,12 +186,8 @@ int shmem_internal_team_init(void)
     shmem_internal_psync_barrier_pool = &shmem_internal_psync_pool[PSYNC_CHUNK_SIZE *
                                                          shmem_internal_params.TEAMS_MAX];
 
-    psync_pool_avail = shmem_internal_shmalloc(2 * N_PSYNC_BYTES);
-    if (NULL == psync_pool_avail) goto cleanup;
-    psync_pool_avail_reduced = &psync_pool_avail[N_PSYNC_BYTES];
-
     /* Initialize the psync bits to 1, making all slots available: */
-    memset(psync_pool_avail, 0, 2 * N_PSYNC_BYTES);
+    memset(psync_pool_avail, 0, N_PSYNC_BYTES);
     for (size_t i = 0; i < (size_t) shmem_internal_params.TEAMS_MAX; i++) {
         shmem_internal_bit_set(psync_pool_avail, N_PSYNC_BYTES, i);
     }
@@ -175,10 +196,37 @@ int shmem_internal_team_init(void)
     shmem_internal_bit_clear(psync_pool_avail, N_PSYNC_BYTES, SHMEM_TEAM_WORLD_INDEX);
     shmem_internal_bit_clear(psync_pool_avail, N_PSYNC_BYTES, SHMEM_TEAM_SHARED_INDEX);
 
-    /* Initialize an integer used to agree on an equal return value across PEs in team creation: */
-    team_ret_val = shmem_internal_shmalloc(sizeof(int) * 2);
-    if (NULL == team_ret_val) goto cleanup;
-    team_ret_val_reduced = &team_ret_val[1];
+    /* Allocate the shared memory barrier slots, one per team, cache line aligned */
+    shr_barrier_pool_base = shmem_internal_shmalloc(sizeof(long) * shmem_internal_params.TEAMS_MAX *
+                                                    SHMEM_INTERNAL_SHR_BARRIER_SLOT_LEN +
+                                                    SHMEM_INTERNAL_CACHELINE_SIZE);
+    if (NULL == shr_barrier_pool_base) goto cleanup;
+
+    shr_barrier_pool = (long *) (((uintptr_t) shr_barrier_pool_base + SHMEM_INTERNAL_CACHELINE_SIZE - 1) &
+                                 ~((uintptr_t) SHMEM_INTERNAL_CACHELINE_SIZE - 1));
+    memset(shr_barrier_pool, 0, sizeof(long) * shmem_internal_params.TEAMS_MAX *
+                                SHMEM_INTERNAL_SHR_BARRIER_SLOT_LEN);
+
+    /* Peers update the counter in our slots, so it must be cleared everywhere
+     * before any shared memory barrier is used. */
+    shmem_internal_barrier_all();
+
+    shmem_internal_team_world.shr_barrier =
+        shmem_internal_shr_barrier_create(&shr_barrier_pool[SHMEM_TEAM_WORLD_INDEX *
+                                                            SHMEM_INTERNAL_SHR_BARRIER_SLOT_LEN],
+                                          shmem_internal_team_world.start,
+                                          shmem_internal_team_world.stride,
+                                          shmem_internal_team_world.size);
+    shmem_internal_team_shared.shr_barrier =
+        shmem_internal_shr_barrier_create(&shr_barrier_pool[SHMEM_TEAM_SHARED_INDEX *
+                                                            SHMEM_INTERNAL_SHR_BARRIER_SLOT_LEN],
+                                          shmem_internal_team_shared.start,
+                                          shmem_internal_team_shared.stride,
+                                          shmem_internal_team_shared.size);
+    shmem_internal_barrier_all_shr = shmem_internal_team_world.shr_barrier;
+
+    team_split_buf = shmem_internal_shmalloc(sizeof(team_split_rec_t) * shmem_internal_num_pes);
+    if (NULL == team_split_buf) goto cleanup;
 
     return 0;
 
@@ -191,13 +239,19 @@ cleanup:
         shmem_internal_free(shmem_internal_psync_pool);
         shmem_internal_psync_pool = NULL;
     }
-    if (psync_pool_avail) {
-        shmem_internal_free(psync_pool_avail);
-        psync_pool_avail = NULL;
+    shmem_internal_barrier_all_shr = NULL;
+    shmem_internal_shr_barrier_destroy(shmem_internal_team_world.shr_barrier);
+    shmem_internal_team_world.shr_barrier = NULL;
+    shmem_internal_shr_barrier_destroy(shmem_internal_team_shared.shr_barrier);
+    shmem_internal_team_shared.shr_barrier = NULL;
+    if (shr_barrier_pool_base) {
+        shmem_internal_free(shr_barrier_pool_base);
+        shr_barrier_pool_base = NULL;
+        shr_barrier_pool = NULL;
     }
-    if (team_ret_val) {
-        shmem_internal_free(team_ret_val);
-        team_ret_val = NULL;
+    if (team_split_buf) {
+        shmem_internal_free(team_split_buf);
+        team_split_buf = NULL;
     }
 
     return -1;
@@ -205,6 +259,8 @@ cleanup:
 
 void shmem_internal_team_fini(void)
 {
+    shmem_internal_barrier_all_shr = NULL;
+
     /* Destroy all undestroyed teams */
     for (long i = 0; i < shmem_internal_params.TEAMS_MAX; i++) {
         if (shmem_internal_team_pool[i] != NULL)
@@ -213,152 +269,389 @@ void shmem_internal_team_fini(void)
 
     free(shmem_internal_team_pool);
     shmem_internal_free(shmem_internal_psync_pool);
-    shmem_internal_free(psync_pool_avail);
-    shmem_internal_free(team_ret_val);
+    shmem_internal_free(shr_barrier_pool_base);
+    shmem_internal_free(team_split_buf);
 
     return;
 }
 
+static int team_member_cmp(const void *a, const void *b)
+{
+    const shmem_internal_team_member_t *x = a, *y = b;
+    return (x->pe > y->pe) - (x->pe < y->pe);
+}
+
+int shmem_internal_team_pe_index(shmem_internal_team_t *team, int global_pe)
+{
+    shmem_internal_team_member_t key, *found;
+
+    if (team->members == NULL)
+        return shmem_internal_pe_in_active_set(global_pe, team->start, team->stride,
+                                               team->size);
+
+    key.pe = global_pe;
+    found = bsearch(&key, team->member_index, team->size,
+                    sizeof(shmem_internal_team_member_t), team_member_cmp);
+
+    return found ? found->team_pe : -1;
+}
+
 int shmem_internal_team_translate_pe(shmem_internal_team_t *src_team, int src_pe,
                                      shmem_internal_team_t *dest_team)
 {
-    int src_pe_world, dest_pe = -1;
+    int src_pe_world;
 
     if (src_team == SHMEM_TEAM_INVALID || dest_team == SHMEM_TEAM_INVALID)
         return -1;
 
-    if (src_pe > src_team->size)
+    if (src_pe < 0 || src_pe >= src_team->size)
         return -1;
 
-    src_pe_world = src_team->start + src_pe * src_team->stride;
+    src_pe_world = shmem_internal_team_pe(src_team, src_pe);
 
-    shmem_internal_assert(src_pe_world >= src_team->start && src_pe_world < shmem_internal_num_pes);
+    shmem_internal_assert(src_pe_world >= 0 && src_pe_world < shmem_internal_num_pes);
 
-    dest_pe = shmem_internal_pe_in_active_set(src_pe_world, dest_team->start, dest_team->stride,
-                                              dest_team->size);
+    return shmem_internal_team_pe_index(dest_team, src_pe_world);
+}
+
+/* Returns the next collective pSync slot of the team, resynchronizing the
+ * team to recycle the slots once they are all in use. */
+static long *team_coll_psync(shmem_internal_team_t *team)
+{
+    if (team->psync_next == shmem_internal_params.TEAM_COLLECTIVE_SLOTS) {
+        /* No psync is available, so we must quiesce communication across all psyncs on this team. */
+        /* Currently, all collectives on all teams are done on the default context. */
+        shmem_internal_quiet(SHMEM_CTX_DEFAULT);
+        shmem_internal_team_sync(team);
+    }
 
-    return dest_pe;
+    return &shmem_internal_psync_pool[team->psync_idx * PSYNC_CHUNK_SIZE +
+                                      team->psync_next++ * SHMEM_SYNC_SIZE];
 }
 
-int shmem_internal_team_split_strided(shmem_internal_team_t *parent_team, int PE_start, int PE_stride,
-                                      int PE_size, const shmem_team_config_t *config, long config_mask,
-                                      shmem_internal_team_t **new_team)
+/* Gather one record from every PE in the parent team into 'recs', indexed by
+ * parent team PE.  This is a Bruck allgather: in round k each PE fetches the
+ * 2^k records accumulated by the PE 2^k ranks above it, after that PE signals
+ * that they are complete.  Records are pulled with gets so that each PE only
+ * writes its own gather buffer, which a slower PE from an earlier split may
+ * still be reading. */
+static void team_split_allgather(shmem_internal_team_t *parent, const team_split_rec_t *mine,
+                                 team_split_rec_t *recs, long *psync)
 {
+    const int size = parent->size, me = parent->my_pe;
+    long one = 1, zero = 0;
+    int i, round, dist;
 
-    *new_team = SHMEM_TEAM_INVALID;
+    team_split_buf[0] = *mine;
 
-    if (parent_team == SHMEM_TEAM_INVALID) {
-        return 1;
+    for (round = 0, dist = 1; dist < size; round++, dist <<= 1) {
+        int cnt = (dist < size - dist) ? dist : size - dist;
+        int to = shmem_internal_team_pe(parent, (me - dist + size) % size);
+        int from = shmem_internal_team_pe(parent, (me + dist) % size);
+
+        /* The first 'dist' records in our buffer are now final */
+        shmem_internal_atomic(SHMEM_CTX_DEFAULT, &psync[round], &one, sizeof(long),
+                              to, SHM_INTERNAL_SUM, SHM_INTERNAL_LONG);
+
+        SHMEM_WAIT_UNTIL(&psync[round], SHMEM_CMP_GE, 1);
+
+        shmem_internal_get(SHMEM_CTX_DEFAULT, &team_split_buf[dist], team_split_buf,
+                           cnt * sizeof(team_split_rec_t), from);
+        shmem_internal_get_wait(SHMEM_CTX_DEFAULT);
     }
 
-    int global_PE_start = shmem_internal_team_pe(parent_team, PE_start);
-    int global_PE_end   = global_PE_start + PE_stride * (PE_size -1);
+    /* Record i in the buffer came from parent PE (me + i) % size */
+    for (i = 0; i < size; i++)
+        recs[(me + i) % size] = team_split_buf[i];
 
-    if (PE_start < 0 || PE_start >= parent_team->size ||
-        PE_size <= 0 || PE_size > parent_team->size   ||
-        PE_stride < 1) {
-        RAISE_WARN_MSG("Invalid <start, stride, size>: child <%d, %d, %d>, parent <%d, %d, %d>\n",
-                       PE_start, PE_stride, PE_size,
-                       parent_team->start, parent_team->stride, parent_team->size);
-        return -1;
+    /* Each round was signaled exactly once, clear the counters */
+    for (i = 0; i < round; i++) {
+        shmem_internal_put_scalar(SHMEM_CTX_DEFAULT, &psync[i], &zero, sizeof(zero),
+                                  shmem_internal_my_pe);
+        SHMEM_WAIT_UNTIL(&psync[i], SHMEM_CMP_EQ, 0);
     }
+}
 
-    if (global_PE_start >= shmem_internal_num_pes ||
-        global_PE_end >= shmem_internal_num_pes) {
-        RAISE_WARN_MSG("Starting PE (%d) or ending PE (%d) is invalid\n",
-                       global_PE_start, global_PE_end);
-        return -1;
+/* Sort order for building child teams: by color, then key, then parent PE */
+struct team_split_ent_t {
+    int color, key, pe;
+};
+typedef struct team_split_ent_t team_split_ent_t;
+
+static int team_split_ent_cmp(const void *a, const void *b)
+{
+    const team_split_ent_t *x = a, *y = b;
+
+    if (x->color != y->color) return (x->color > y->color) - (x->color < y->color);
+    if (x->key != y->key) return (x->key > y->key) - (x->key < y->key);
+    return (x->pe > y->pe) - (x->pe < y->pe);
+}
+
+/* Allocate a team object for the given members (world PEs in team order).
+ * Member sets with a constant positive stride are stored as a triplet, all
+ * others keep an explicit member table. */
+static shmem_internal_team_t *team_alloc(const int *members, int size, int my_pe,
+                                         const shmem_team_config_t *config, long config_mask)
+{
+    shmem_internal_team_t *team = calloc(1, sizeof(shmem_internal_team_t));
+    int stride = (size > 1) ? members[1] - members[0] : 1;
+    int strided = stride > 0;
+
+    if (team == NULL) RAISE_ERROR_STR("Out of memory allocating team");
+
+    for (int i = 2; strided && i < size; i++)
+        strided = (members[i] - members[i-1] == stride);
+
+    team->my_pe  = my_pe;
+    team->start  = members[0];
+    team->stride = strided ? stride : 1;
+    team->size   = size;
+    if (config) {
+        team->config      = *config;
+        team->config_mask = config_mask;
+    }
+    team->psync_idx = -1;
+
+    if (!strided) {
+        team->members      = malloc(sizeof(int) * size);
+        team->member_index = malloc(sizeof(shmem_internal_team_member_t) * size);
+        if (team->members == NULL || team->member_index == NULL)
+            RAISE_ERROR_STR("Out of memory allocating team member table");
+
+        for (int i = 0; i < size; i++) {
+            team->members[i] = members[i];
+            team->member_index[i].pe = members[i];
+            team->member_index[i].team_pe = i;
+        }
+        qsort(team->member_index, size, sizeof(shmem_internal_team_member_t), team_member_cmp);
     }
 
-    int my_pe = shmem_internal_pe_in_active_set(shmem_internal_my_pe,
-                                                global_PE_start, PE_stride, PE_size);
+    return team;
+}
+
+/* Create the child teams of one or more splits of the parent team in a
+ * single collective round.  When every PE can compute the layout locally,
+ * color_fn gives the color of each parent PE in each split, and children are
+ * ordered by parent PE.  Otherwise (a single color split) each PE passes its
+ * own color and key, which are exchanged.  PEs with a negative color are not
+ * part of any child team in that split.  Each PE gathers the available pSync
+ * slots of every parent PE, then replays the slot allocation for every child
+ * team in the same order, so all PEs agree on the result without further
+ * communication. */
+static int team_split_batch(shmem_internal_team_t *parent, int nsplits,
+                            int (*color_fn)(int parent_pe, int split, void *arg), void *arg,
+                            int color, int key,
+                            const shmem_team_config_t **configs, const long *config_masks,
+                            shmem_internal_team_t **new_teams)
+{
+    const int size = parent->size;
+    team_split_rec_t *recs = malloc(sizeof(team_split_rec_t) * size);
+    unsigned char (*avail)[N_PSYNC_BYTES] = malloc(N_PSYNC_BYTES * size);
+    team_split_ent_t *ents = malloc(sizeof(team_split_ent_t) * size);
+    int *members = malloc(sizeof(int) * size);
+    int ret = 0;
+
+    if (recs == NULL || avail == NULL || ents == NULL || members == NULL)
+        RAISE_ERROR_STR("Out of memory in team split");
+
+    for (int j = 0; j < nsplits; j++)
+        new_teams[j] = SHMEM_TEAM_INVALID;
 
-    long *psync = shmem_internal_team_choose_psync(parent_team, REDUCE);
-    shmem_internal_team_t *myteam = NULL;
-    *team_ret_val = 0;
-    *team_ret_val_reduced = 0;
+    shmem_internal_assert(color_fn != NULL || nsplits == 1);
 
-    if (my_pe != -1) {
-        char bit_str[SHMEM_INTERNAL_DIAG_STRLEN];
+    /* Exchange the pSync availability, plus color and key for color splits */
+    {
+        team_split_rec_t mine;
 
-        myteam = calloc(1, sizeof(shmem_internal_team_t));
+        memcpy(mine.psync_avail, psync_pool_avail, N_PSYNC_BYTES);
+        mine.color = color;
+        mine.key   = key;
 
-        myteam->my_pe       = my_pe;
-        myteam->start       = global_PE_start;
-        myteam->stride      = PE_stride;
-        myteam->size        = PE_size;
-        if (config) {
-            myteam->config      = *config;
-            myteam->config_mask = config_mask;
+        team_split_allgather(parent, &mine, recs, team_coll_psync(parent));
+    }
+
+    for (int i = 0; i < size; i++)
+        memcpy(avail[i], recs[i].psync_avail, N_PSYNC_BYTES);
+
+    for (int j = 0; j < nsplits && ret == 0; j++) {
+        int n = 0;
+
+        for (int i = 0; i < size; i++) {
+            int c = color_fn ? color_fn(i, j, arg) : recs[i].color;
+            if (c < 0) continue;
+            ents[n].color = c;
+            ents[n].key   = color_fn ? i : recs[i].key;
+            ents[n].pe    = i;
+            n++;
         }
-        myteam->contexts_len = 0;
-        myteam->psync_idx = -1;
 
-        shmem_internal_op_to_all(psync_pool_avail_reduced,
-                                 psync_pool_avail, N_PSYNC_BYTES, 1,
-                                 myteam->start, PE_stride, PE_size, NULL,
-                                 psync, SHM_INTERNAL_BAND, SHM_INTERNAL_UCHAR);
+        qsort(ents, n, sizeof(team_split_ent_t), team_split_ent_cmp);
 
-        /* We cannot release the psync here, because this reduction may not
-         * have been performed on the entire parent team. */
+        /* Assign a pSync slot to each child team in color order */
+        for (int first = 0, last; first < n && ret == 0; first = last) {
+            unsigned char reduced[N_PSYNC_BYTES];
+            int idx, my_idx = -1;
 
-        shmem_internal_bit_to_string(bit_str, SHMEM_INTERNAL_DIAG_STRLEN,
-                                     psync_pool_avail_reduced, N_PSYNC_BYTES);
-        DEBUG_MSG("My pSyncs  [ %s ]\n", bit_str);
+            for (last = first; last < n && ents[last].color == ents[first].color; last++)
+                ;
 
-        /* Select the least signficant nonzero bit, which corresponds to an available pSync. */
-        myteam->psync_idx = shmem_internal_bit_1st_nonzero(psync_pool_avail_reduced, N_PSYNC_BYTES);
+            memset(reduced, 0xff, N_PSYNC_BYTES);
+            for (int i = first; i < last; i++) {
+                for (int b = 0; b < N_PSYNC_BYTES; b++)
+                    reduced[b] &= avail[ents[i].pe][b];
+                if (ents[i].pe == parent->my_pe)
+                    my_idx = i - first;
+            }
 
-        shmem_internal_bit_to_string(bit_str, SHMEM_INTERNAL_DIAG_STRLEN,
-                                     psync_pool_avail_reduced, N_PSYNC_BYTES);
-        DEBUG_MSG("All pSyncs [ %s ], allocated %d\n", bit_str,
-                  myteam->psync_idx);
+            idx = (int) shmem_internal_bit_1st_nonzero(reduced, N_PSYNC_BYTES);
 
-        if (myteam->psync_idx == -1 || myteam->psync_idx >= shmem_internal_params.TEAMS_MAX) {
-            RAISE_WARN_MSG("No more teams available (max = %ld), try increasing SHMEM_TEAMS_MAX\n",
-                            shmem_internal_params.TEAMS_MAX);
-            /* No psync was available, but must call barrier across parent team before returning. */
-            myteam->psync_idx = -1;
-            *team_ret_val = 1;
-        } else {
-            /* Set the selected psync bit to 0, reserving that slot */
-            shmem_internal_bit_clear(psync_pool_avail, N_PSYNC_BYTES, myteam->psync_idx);
+            if (idx < 0 || idx >= shmem_internal_params.TEAMS_MAX) {
+                RAISE_WARN_MSG("No more teams available (max = %ld), try increasing SHMEM_TEAMS_MAX\n",
+                               shmem_internal_params.TEAMS_MAX);
+                ret = 1;
+                break;
+            }
 
-            for (size_t i = 0; i < N_PSYNCS_PER_TEAM; i++)
-                myteam->psync_avail[i] = 1;
+            for (int i = first; i < last; i++)
+                shmem_internal_bit_clear(avail[ents[i].pe], N_PSYNC_BYTES, idx);
 
-            *new_team = myteam;
+            if (my_idx < 0) continue;
 
-            shmem_internal_team_pool[myteam->psync_idx] = *new_team;
+            for (int i = first; i < last; i++)
+                members[i - first] = shmem_internal_team_pe(parent, ents[i].pe);
+
+            new_teams[j] = team_alloc(members, last - first, my_idx,
+                                      configs ? configs[j] : NULL,
+                                      config_masks ? config_masks[j] : 0);
+            new_teams[j]->psync_idx = idx;
+
+            DEBUG_MSG("Split %d: created team %d of size %d (%s), my_pe %d\n", j, idx,
+                      last - first, new_teams[j]->members ? "member table" : "strided",
+                      my_idx);
         }
     }
 
-    shmem_internal_team_release_psyncs(parent_team, REDUCE);
+    /* All PEs replayed the same allocation, so either every team was
+     * created or none of them are kept. */
+    for (int j = 0; j < nsplits; j++) {
+        shmem_internal_team_t *team = new_teams[j];
+        long zero = 0;
+        long *barrier_psync;
+
+        if (team == SHMEM_TEAM_INVALID) continue;
+
+        if (ret) {
+            free(team->members);
+            free(team->member_index);
+            free(team);
+            new_teams[j] = SHMEM_TEAM_INVALID;
+            continue;
+        }
+
+        /* Set the selected psync bit to 0, reserving that slot */
+        shmem_internal_bit_clear(psync_pool_avail, N_PSYNC_BYTES, team->psync_idx);
+
+        barrier_psync = &shmem_internal_psync_barrier_pool[team->psync_idx * SHMEM_SYNC_SIZE];
+
+        /* The barrier pSync may hold epoch counters from a destroyed
+         * team.  All of their updates have landed, since every member
+         * completed its last sync before destroying the team.  Clear them
+         * before the parent sync below so the new team starts at epoch 0. */
+        for (size_t i = 0; i < SHMEM_SYNC_SIZE; i++)
+            shmem_internal_put_scalar(SHMEM_CTX_DEFAULT, &barrier_psync[i], &zero,
+                                      sizeof(zero), shmem_internal_my_pe);
+
+        /* Likewise, the shared memory barrier slot may hold the counter and
+         * release flag of a destroyed team with different members.  Clear
+         * our copy so every member of the new team starts from sense 0. */
+        memset(&shr_barrier_pool[team->psync_idx * SHMEM_INTERNAL_SHR_BARRIER_SLOT_LEN], 0,
+               sizeof(long) * SHMEM_INTERNAL_SHR_BARRIER_SLOT_LEN);
+
+        if (team->members == NULL)
+            team->shr_barrier =
+                shmem_internal_shr_barrier_create(&shr_barrier_pool[team->psync_idx *
+                                                                    SHMEM_INTERNAL_SHR_BARRIER_SLOT_LEN],
+                                                  team->start, team->stride, team->size);
+
+        shmem_internal_team_pool[team->psync_idx] = team;
+    }
 
     /* This barrier on the parent team eliminates problematic race conditions
-     * during psync allocation between back-to-back team creations. */
-    psync = shmem_internal_team_choose_psync(parent_team, SYNC);
+     * during psync allocation between back-to-back team creations, and keeps
+     * the gather buffer alive until every PE has read it. */
+    shmem_internal_quiet(SHMEM_CTX_DEFAULT);
+    shmem_internal_team_sync(parent);
 
-    shmem_internal_barrier(parent_team->start, parent_team->stride, parent_team->size, psync);
+    free(members);
+    free(ents);
+    free(avail);
+    free(recs);
 
-    shmem_internal_team_release_psyncs(parent_team, SYNC);
+    return ret;
+}
+
+struct team_split_strided_arg_t {
+    int start, stride, size;
+};
 
-    /* This OR reduction assures all PEs return the same value.  */
-    psync = shmem_internal_team_choose_psync(parent_team, REDUCE);
+static int team_split_strided_color(int parent_pe, int split, void *arg)
+{
+    struct team_split_strided_arg_t *a = arg;
 
-    shmem_internal_op_to_all(team_ret_val_reduced, team_ret_val, 1, sizeof(int),
-                             parent_team->start, parent_team->stride, parent_team->size, NULL,
-                             psync, SHM_INTERNAL_MAX, SHM_INTERNAL_INT);
+    if (parent_pe < a->start || (parent_pe - a->start) % a->stride ||
+        (parent_pe - a->start) / a->stride >= a->size)
+        return -1;
 
-    shmem_internal_team_release_psyncs(parent_team, REDUCE);
+    return 0;
+}
 
-    /* If no team was available, print some team triplet info and return nonzero. */
-    if (my_pe >= 0 && myteam != NULL && myteam->psync_idx == -1) {
+int shmem_internal_team_split_strided(shmem_internal_team_t *parent_team, int PE_start, int PE_stride,
+                                      int PE_size, const shmem_team_config_t *config, long config_mask,
+                                      shmem_internal_team_t **new_team)
+{
+    struct team_split_strided_arg_t arg = { PE_start, PE_stride, PE_size };
+    int ret;
+
+    *new_team = SHMEM_TEAM_INVALID;
+
+    if (parent_team == SHMEM_TEAM_INVALID) {
+        return 1;
+    }
+
+    if (PE_start < 0 || PE_start >= parent_team->size ||
+        PE_size <= 0 || PE_size > parent_team->size   ||
+        PE_stride < 1) {
+        RAISE_WARN_MSG("Invalid <start, stride, size>: child <%d, %d, %d>, parent <%d, %d, %d>\n",
+                       PE_start, PE_stride, PE_size,
+                       parent_team->start, parent_team->stride, parent_team->size);
+        return -1;
+    }
+
+    if (PE_start + (long) PE_stride * (PE_size - 1) >= parent_team->size) {
+        RAISE_WARN_MSG("Ending PE (%ld) is invalid in a parent team of size %d\n",
+                       PE_start + (long) PE_stride * (PE_size - 1), parent_team->size);
+        return -1;
+    }
+
+    ret = team_split_batch(parent_team, 1, team_split_strided_color, &arg, 0, 0,
+                           &config, &config_mask, new_team);
+
+    if (ret) {
         RAISE_WARN_MSG("Team split strided failed: child <%d, %d, %d>, parent <%d, %d, %d>\n",
-                        global_PE_start, PE_stride, PE_size,
+                        PE_start, PE_stride, PE_size,
                         parent_team->start, parent_team->stride, parent_team->size);
     }
-    return *team_ret_val_reduced;
+
+    return ret;
+}
+
+/* Split 0 is the x-axis (contiguous ranges of xrange parent PEs), split 1 is
+ * the y-axis (parent PEs that are equal modulo xrange). */
+static int team_split_2d_color(int parent_pe, int split, void *arg)
+{
+    int xrange = *(int *) arg;
+
+    return (split == 0) ? parent_pe / xrange : parent_pe % xrange;
 }
 
 int shmem_internal_team_split_2d(shmem_internal_team_t *parent_team, int xrange,
@@ -366,6 +659,11 @@ int shmem_internal_team_split_2d(shmem_internal_team_t *parent_team, int xrange,
                                  shmem_internal_team_t **xaxis_team, const shmem_team_config_t *yaxis_config,
                                  long yaxis_mask, shmem_internal_team_t **yaxis_team)
 {
+    const shmem_team_config_t *configs[2] = { xaxis_config, yaxis_config };
+    long masks[2] = { xaxis_mask, yaxis_mask };
+    shmem_internal_team_t *teams[2];
+    int ret;
+
     *xaxis_team = SHMEM_TEAM_INVALID;
     *yaxis_team = SHMEM_TEAM_INVALID;
 
@@ -373,64 +671,42 @@ int shmem_internal_team_split_2d(shmem_internal_team_t *parent_team, int xrange,
         return 1;
     }
 
+    if (xrange < 1) {
+        RAISE_WARN_MSG("Invalid xrange (%d) for 2D team split\n", xrange);
+        return -1;
+    }
+
     if (xrange > parent_team->size) {
         xrange = parent_team->size;
     }
 
-    const int parent_start = parent_team->start;
-    const int parent_stride = parent_team->stride;
-    const int parent_size = parent_team->size;
-    const int num_xteams = ceil( parent_size / (float)xrange );
-    const int num_yteams = xrange;
-
-    int start = 0;
-    int ret = 0;
-
-    for (int i = 0; i < num_xteams; i++) {
-        shmem_internal_team_t *my_xteam;
-        int xsize = (i == num_xteams - 1 && parent_size % xrange) ? parent_size % xrange : xrange;
-
-        ret = shmem_internal_team_split_strided(parent_team, start, parent_stride,
-                                                xsize, xaxis_config, xaxis_mask, &my_xteam);
-        if (ret) {
-            RAISE_ERROR_MSG("Creation of x-axis team %d of %d failed\n", i+1, num_xteams);
-        }
-        start += xrange;
+    ret = team_split_batch(parent_team, 2, team_split_2d_color, &xrange, 0, 0,
+                           configs, masks, teams);
 
-        if (my_xteam != SHMEM_TEAM_INVALID) {
-            shmem_internal_assert(*xaxis_team == SHMEM_TEAM_INVALID);
-            *xaxis_team = my_xteam;
-        }
+    if (ret) {
+        RAISE_WARN_MSG("Team split 2D failed: xrange %d, parent <%d, %d, %d>\n", xrange,
+                       parent_team->start, parent_team->stride, parent_team->size);
+        return ret;
     }
 
-    start = 0;
+    *xaxis_team = teams[0];
+    *yaxis_team = teams[1];
 
-    for (int i = 0; i < num_yteams; i++) {
-        shmem_internal_team_t *my_yteam;
-        int remainder = parent_size % xrange;
-        int yrange = parent_size / xrange;
-        int ysize = (remainder && i < remainder) ? yrange + 1 : yrange;
+    return 0;
+}
 
-        ret = shmem_internal_team_split_strided(parent_team, start, xrange*parent_stride,
-                                        ysize, yaxis_config, yaxis_mask, &my_yteam);
-        if (ret) {
-            RAISE_ERROR_MSG("Creation of y-axis team %d of %d failed\n", i+1, num_yteams);
-        }
-        start += 1;
+int shmem_internal_team_split_color(shmem_internal_team_t *parent_team, int color, int key,
+                                    const shmem_team_config_t *config, long config_mask,
+                                    shmem_internal_team_t **new_team)
+{
+    *new_team = SHMEM_TEAM_INVALID;
 
-        if (my_yteam != SHMEM_TEAM_INVALID) {
-            shmem_internal_assert(*yaxis_team == SHMEM_TEAM_INVALID);
-            *yaxis_team = my_yteam;
-        }
+    if (parent_team == SHMEM_TEAM_INVALID) {
+        return 1;
     }
 
-    long *psync = shmem_internal_team_choose_psync(parent_team, SYNC);
-
-    shmem_internal_barrier(parent_start, parent_stride, parent_size, psync);
-
-    shmem_internal_team_release_psyncs(parent_team, SYNC);
-
-    return 0;
+    return team_split_batch(parent_team, 1, NULL, NULL, color, key,
+                            &config, &config_mask, new_team);
 }
 
 int shmem_internal_team_destroy(shmem_internal_team_t *team)
@@ -456,6 +732,14 @@ int shmem_internal_team_destroy(shmem_internal_team_t *team)
     shmem_internal_team_pool[team->psync_idx] = NULL;
     free(team->contexts);
 
+    shmem_internal_shr_barrier_destroy(team->shr_barrier);
+    team->shr_barrier = NULL;
+
+    free(team->members);
+    free(team->member_index);
+    team->members = NULL;
+    team->member_index = NULL;
+
     if (team != &shmem_internal_team_world && team != &shmem_internal_team_shared) {
         free(team);
     }
@@ -473,27 +757,7 @@ long * shmem_internal_team_choose_psync(shmem_internal_team_t *team, shmem_inter
             return &shmem_internal_psync_barrier_pool[team->psync_idx * SHMEM_SYNC_SIZE];
 
         default:
-            for (int i = 0; i < N_PSYNCS_PER_TEAM; i++) {
-                if (team->psync_avail[i]) {
-                    team->psync_avail[i] = 0;
-                    return &shmem_internal_psync_pool[(team->psync_idx + i) * PSYNC_CHUNK_SIZE];
-                }
-            }
-
-            /* No psync is available, so we must quiesce communication across all psyncs on this team. */
-            /* Currently, all collectives on all teams are done on the default context. */
-            shmem_internal_quiet(SHMEM_CTX_DEFAULT);
-
-            size_t psync = team->psync_idx * SHMEM_SYNC_SIZE;
-            shmem_internal_sync(team->start, team->stride, team->size,
-                                &shmem_internal_psync_barrier_pool[psync]);
-
-            for (int i = 0; i < N_PSYNCS_PER_TEAM; i++) {
-                team->psync_avail[i] = 1;
-            }
-            team->psync_avail[0] = 0;
-
-            return &shmem_internal_psync_pool[psync];
+            return team_coll_psync(team);
     }
 }
 
@@ -501,9 +765,7 @@ void shmem_internal_team_release_psyncs(shmem_internal_team_t *team, shmem_inter
 {
     switch (op) {
         case SYNC:
-            for (size_t i = 0; i < N_PSYNCS_PER_TEAM; i++) {
-                team->psync_avail[i] = 1;
-            }
+            team->psync_next = 0;
             break;
         default:
             break;
@@ -511,3 +773,198 @@ void shmem_internal_team_release_psyncs(shmem_internal_team_t *team, shmem_inter
 
     return;
 }
+
+/* Synchronize the team, using the shared memory barrier when all members are
+ * reachable through load/store and the epoch barrier otherwise.  Either way,
+ * every collective pSync of the team is free again afterwards. */
+void shmem_internal_team_sync(shmem_internal_team_t *team)
+{
+    if (team->shr_barrier) {
+        shmem_internal_sync_shr(team->shr_barrier);
+    } else if (team->members) {
+        long *psync = shmem_internal_team_choose_psync(team, SYNC);
+        shmem_internal_sync_epoch_table(team->members, team->my_pe, team->size, psync,
+                                        ++team->sync_epoch);
+    } else {
+        long *psync = shmem_internal_team_choose_psync(team, SYNC);
+        shmem_internal_sync_epoch(team->start, team->stride, team->size, psync,
+                                  ++team->sync_epoch);
+    }
+    shmem_internal_team_release_psyncs(team, SYNC);
+}
+
+
+/* Collectives on teams with a member table.  The collective algorithms
+ * address PEs as <start, stride, size>, so these teams use linear algorithms
+ * over the member table, separated by team syncs.  Broadcast, fcollect, and
+ * alltoall push data into the members' buffers before one sync, as the
+ * linear algorithms do; collect and reduce pull data from every member
+ * between two syncs.  Each PE sends or fetches O(size) messages. */
+
+void shmem_internal_team_bcast_table(shmem_internal_team_t *team, void *target,
+                                     const void *source, size_t len, int PE_root)
+{
+    uint64_t prof = shmem_internal_prof_begin();
+    int i;
+
+    if (team->my_pe == PE_root) {
+        for (i = 0; i < team->size; i++) {
+            if (i == PE_root) continue;
+            shmem_internal_put_nbi(SHMEM_CTX_DEFAULT, target, source, len, team->members[i]);
+        }
+        shmem_internal_quiet(SHMEM_CTX_DEFAULT);
+    }
+
+    shmem_internal_team_sync(team);
+
+    shmem_internal_prof_end(SHMEM_INTERNAL_PROF_BCAST, prof, len);
+}
+
+
+/* Reduce with the built-in op and datatype, or with fn when it is given.
+ * Every PE combines the members' sources in the same order, from the last
+ * member down to the first, so all PEs compute the same result and fn need
+ * not be commutative.  The result is built in a private buffer, since a
+ * member's target may alias its source while others are still reading it. */
+void shmem_internal_team_reduce_table(shmem_internal_team_t *team, void *target,
+                                      const void *source, size_t count, size_t type_size,
+                                      shm_internal_op_t op, shm_internal_datatype_t datatype,
+                                      shmem_internal_reduce_fn_t fn)
+{
+    const size_t len = count * type_size;
+    uint64_t prof;
+    void *acc, *tmp;
+    int i;
+
+    if (count == 0) return;
+
+    prof = shmem_internal_prof_begin();
+
+    acc = malloc(len);
+    tmp = malloc(len);
+    if (acc == NULL || tmp == NULL)
+        RAISE_ERROR_MSG("Unable to allocate %zub reduction buffers\n", len);
+
+    shmem_internal_team_sync(team);
+
+    shmem_internal_get(SHMEM_CTX_DEFAULT, acc, source, len, team->members[team->size - 1]);
+    shmem_internal_get_wait(SHMEM_CTX_DEFAULT);
+
+    for (i = team->size - 2; i >= 0; i--) {
+        shmem_internal_get(SHMEM_CTX_DEFAULT, tmp, source, len, team->members[i]);
+        shmem_internal_get_wait(SHMEM_CTX_DEFAULT);
+
+        if (fn)
+            fn(tmp, acc, count);
+        else
+            shmem_internal_reduce_local(op, datatype, count, tmp, acc);
+    }
+
+    shmem_internal_team_sync(team);
+
+    memcpy(target, acc, len);
+
+    free(acc);
+    free(tmp);
+
+    shmem_internal_prof_end(SHMEM_INTERNAL_PROF_REDUCE, prof, len);
+}
+
+
+/* Each PE publishes its contribution length in pSync[0], and every PE then
+ * fetches all lengths followed by all contributions */
+void shmem_internal_team_collect_table(shmem_internal_team_t *team, void *target,
+                                       const void *source, size_t len, long *pSync)
+{
+    uint64_t prof = shmem_internal_prof_begin();
+    long *lens = malloc(sizeof(long) * team->size);
+    size_t offset = 0;
+    int i;
+
+    if (lens == NULL)
+        RAISE_ERROR_STR("Out of memory allocating collect lengths");
+
+    pSync[0] = (long) len;
+
+    shmem_internal_team_sync(team);
+
+    for (i = 0; i < team->size; i++)
+        shmem_internal_get(SHMEM_CTX_DEFAULT, &lens[i], pSync, sizeof(long), team->members[i]);
+    shmem_internal_get_wait(SHMEM_CTX_DEFAULT);
+
+    for (i = 0; i < team->size; i++) {
+        shmem_internal_get(SHMEM_CTX_DEFAULT, (char *) target + offset, source, lens[i],
+                           team->members[i]);
+        offset += lens[i];
+    }
+    shmem_internal_get_wait(SHMEM_CTX_DEFAULT);
+
+    shmem_internal_team_sync(team);
+
+    pSync[0] = SHMEM_SYNC_VALUE;
+    free(lens);
+
+    shmem_internal_prof_end(SHMEM_INTERNAL_PROF_COLLECT, prof, len);
+}
+
+
+void shmem_internal_team_fcollect_table(shmem_internal_team_t *team, void *target,
+                                        const void *source, size_t len)
+{
+    uint64_t prof = shmem_internal_prof_begin();
+    void *dest = (char *) target + team->my_pe * len;
+    int i;
+
+    /* Send data round-robin, ending with my PE */
+    for (i = 1; i <= team->size; i++)
+        shmem_internal_put_nbi(SHMEM_CTX_DEFAULT, dest, source, len,
+                               team->members[(team->my_pe + i) % team->size]);
+
+    shmem_internal_quiet(SHMEM_CTX_DEFAULT);
+    shmem_internal_team_sync(team);
+
+    shmem_internal_prof_end(SHMEM_INTERNAL_PROF_FCOLLECT, prof, len);
+}
+
+
+/* Member i receives nelems elements of elem_size bytes, starting at element
+ * i * nelems * sst of the source with stride sst, at element
+ * my_pe * nelems * dst of its dest with stride dst.  The contiguous alltoall
+ * is the case of one element of len bytes. */
+void shmem_internal_team_alltoalls_table(shmem_internal_team_t *team, void *dest,
+                                         const void *source, ptrdiff_t dst, ptrdiff_t sst,
+                                         size_t elem_size, size_t nelems)
+{
+    uint64_t prof;
+    int i;
+
+    if (nelems == 0) return;
+
+    prof = shmem_internal_prof_begin();
+
+    /* Send data round-robin, ending with my PE */
+    for (i = 1; i <= team->size; i++) {
+        int peer = (team->my_pe + i) % team->size;
+        uint8_t *dest_ptr = (uint8_t *) dest + team->my_pe * nelems * dst * elem_size;
+        uint8_t *source_ptr = (uint8_t *) source + peer * nelems * sst * elem_size;
+        size_t j;
+
+        if (dst == 1 && sst == 1) {
+            shmem_internal_put_nbi(SHMEM_CTX_DEFAULT, dest_ptr, source_ptr, nelems * elem_size,
+                                   team->members[peer]);
+            continue;
+        }
+
+        for (j = 0; j < nelems; j++) {
+            shmem_internal_put_scalar(SHMEM_CTX_DEFAULT, dest_ptr, source_ptr, elem_size,
+                                      team->members[peer]);
+            source_ptr += sst * elem_size;
+            dest_ptr   += dst * elem_size;
+        }
+    }
+
+    shmem_internal_quiet(SHMEM_CTX_DEFAULT);
+    shmem_internal_team_sync(team);
+
+    shmem_internal_prof_end(SHMEM_INTERNAL_PROF_ALLTOALLS, prof, nelems * elem_size);
+}
@@ -15,17 +15,27 @@
 #include "transport.h"
 #include "uthash.h"
 
-#define N_PSYNCS_PER_TEAM   2
+struct shmem_internal_team_member_t {
+    int pe;         /* PE number in SHMEM_TEAM_WORLD */
+    int team_pe;    /* PE number in the team */
+};
+typedef struct shmem_internal_team_member_t shmem_internal_team_member_t;
 
 struct shmem_internal_team_t {
     int                            my_pe;
     int                            start, stride, size;
     int                            psync_idx;
-    int                            psync_avail[N_PSYNCS_PER_TEAM];
+    int                            psync_next;  /* Next unused collective pSync slot */
+    long                           sync_epoch;  /* Number of syncs issued on the team */
     shmem_team_config_t           config;
     long                           config_mask;
     size_t                         contexts_len;
     struct shmem_transport_ctx_t **contexts;
+    struct shmem_internal_shr_barrier_t *shr_barrier;
+    /* Teams whose members do not have a constant stride keep explicit member
+     * tables; start and stride are then not meaningful. */
+    int                           *members;      /* World PE of each team PE */
+    shmem_internal_team_member_t  *member_index; /* Members sorted by world PE */
 };
 typedef struct shmem_internal_team_t shmem_internal_team_t;
 
@@ -63,6 +73,10 @@ int shmem_internal_team_split_2d(shmem_internal_team_t *parent_team, int xrange,
                                  const shmem_team_config_t *xaxis_config, long xaxis_mask, shmem_internal_team_t **xaxis_team,
                                  const shmem_team_config_t *yaxis_config, long yaxis_mask, shmem_internal_team_t **yaxis_team);
 
+int shmem_internal_team_split_color(shmem_internal_team_t *parent_team, int color, int key,
+                                    const shmem_team_config_t *config, long config_mask,
+                                    shmem_internal_team_t **new_team);
+
 int shmem_internal_team_destroy(shmem_internal_team_t *team);
 
 int shmem_internal_team_create_ctx(shmem_internal_team_t *team, long options, shmem_ctx_t *ctx);
@@ -73,9 +87,18 @@ long * shmem_internal_team_choose_psync(shmem_internal_team_t *team, shmem_inter
 
 void shmem_internal_team_release_psyncs(shmem_internal_team_t *team, shmem_internal_team_op_t op);
 
+void shmem_internal_team_sync(shmem_internal_team_t *team);
+
+/* Returns the team PE number of the given world PE, or -1 if it is not a
+ * member of the team */
+int shmem_internal_team_pe_index(shmem_internal_team_t *team, int global_pe);
+
 static inline
 int shmem_internal_team_pe(shmem_internal_team_t *team, int pe)
 {
+    if (team->members)
+        return team->members[pe];
+
     return team->start + team->stride * pe;
 }
 
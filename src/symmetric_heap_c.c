@@ -67,16 +67,108 @@
 #pragma weak shmem_malloc_with_hints = pshmem_malloc_with_hints
 #define shmem_malloc_with_hints pshmem_malloc_with_hints
 
+#pragma weak shmemx_heap_stats = pshmemx_heap_stats
+#define shmemx_heap_stats pshmemx_heap_stats
+
+#pragma weak shmemx_malloc_epoch_begin = pshmemx_malloc_epoch_begin
+#define shmemx_malloc_epoch_begin pshmemx_malloc_epoch_begin
+
+#pragma weak shmemx_malloc_epoch_end = pshmemx_malloc_epoch_end
+#define shmemx_malloc_epoch_end pshmemx_malloc_epoch_end
+
 #endif /* ENABLE_PROFILING */
 
 static char *shmem_internal_heap_curr = NULL;
 
+/* Length of the region managed by the default dlmalloc space.  Partitions
+ * selected through allocation hints are placed above this region. */
+static long shmem_internal_heap_dl_length = 0;
+
+void *shmem_internal_heap_atomics_base = NULL;
+size_t shmem_internal_heap_atomics_length = 0;
+
 void* dlmalloc(size_t);
 void* dlcalloc(size_t, size_t);
 void  dlfree(void*);
 void* dlrealloc(void*, size_t);
 void* dlmemalign(size_t, size_t);
 
+typedef void* mspace;
+mspace create_mspace_with_base(void*, size_t, int);
+size_t mspace_set_footprint_limit(mspace, size_t);
+void* mspace_memalign(mspace, size_t, size_t);
+void* mspace_realloc_in_place(mspace, void*, size_t);
+void  mspace_free(mspace, void*);
+size_t mspace_usable_size(const void*);
+
+struct shmem_internal_heap_arena_t {
+    mspace              msp;
+    char               *base;
+    size_t              length;
+    size_t              align;      /* Alignment of each object */
+    int                 pad;        /* Pad objects to a multiple of align */
+    shmemx_heap_stats_t stats;
+};
+
+typedef struct shmem_internal_heap_arena_t shmem_internal_heap_arena_t;
+
+#define SHMEM_INTERNAL_HEAP_NUM_ARENAS 2
+
+/* Indexed by SHMEMX_HEAP_ATOMICS and SHMEMX_HEAP_BULK.  Accesses are
+ * protected by shmem_internal_mutex_alloc. */
+static shmem_internal_heap_arena_t shmem_internal_heap_arenas[SHMEM_INTERNAL_HEAP_NUM_ARENAS];
+
+/* Every PE performs the same sequence of symmetric allocations.  Each PE
+ * counts its allocations and publishes the count in the symmetric heap.
+ * When the allocation barrier is deferred, the object is recorded with its
+ * count, and before accessing the object at a remote PE, the initiator
+ * waits for the target to reach that count.  A running hash of the most
+ * recent allocations is kept for SHMEM_SYMMETRIC_HEAP_CHECK.
+ */
+#define SHMEM_INTERNAL_HEAP_HASH_HIST 64
+
+struct shmem_internal_heap_sync_t {
+    long     gen;
+    uint64_t hash[SHMEM_INTERNAL_HEAP_HASH_HIST];   /* Indexed by gen */
+};
+
+typedef struct shmem_internal_heap_sync_t shmem_internal_heap_sync_t;
+
+/* An allocation whose barrier was deferred, covering [start, end) and
+ * completed at a PE once its count reaches gen */
+struct shmem_internal_heap_deferred_t {
+    uintptr_t start, end;
+    long      gen;
+};
+
+typedef struct shmem_internal_heap_deferred_t shmem_internal_heap_deferred_t;
+
+int shmem_internal_heap_sync_pending = 0;
+
+static long shmem_internal_heap_gen = 0;
+
+static shmem_internal_heap_sync_t *shmem_internal_heap_sync = NULL;
+
+/* Highest allocation count observed at each PE, updated atomically since
+ * any thread may observe a new count */
+static long *shmem_internal_heap_pe_gen = NULL;
+
+/* Allocations since the last synchronization of all PEs whose barrier was
+ * deferred, in allocation order.  Protected by shmem_internal_mutex_alloc. */
+static shmem_internal_heap_deferred_t *shmem_internal_heap_deferred = NULL;
+static size_t shmem_internal_heap_deferred_len = 0;
+static size_t shmem_internal_heap_deferred_size = 0;
+
+/* Nesting depth of shmemx_malloc_epoch_begin/end */
+static int shmem_internal_heap_epoch = 0;
+
+/* Objects freed inside an allocation epoch.  They are released at the next
+ * point where all PEs synchronize, so that no PE can reuse memory that
+ * another PE is still accessing. */
+static void **shmem_internal_heap_free_queue = NULL;
+static size_t shmem_internal_heap_free_queue_len = 0;
+static size_t shmem_internal_heap_free_queue_size = 0;
+
 
 /*
  * scan /proc/mounts for a huge page file system with the
@@ -137,10 +229,10 @@ shmem_internal_get_next(intptr_t incr)
         RAISE_WARN_STR("symmetric heap pointer pushed below start");
         shmem_internal_heap_curr = (char*) shmem_internal_heap_base;
     } else if (shmem_internal_heap_curr - (char*) shmem_internal_heap_base >
-               shmem_internal_heap_length) {
+               shmem_internal_heap_dl_length) {
         RAISE_WARN_MSG("Out of symmetric memory, heap size %ld, overrun %"PRIdPTR"\n"
                        RAISE_PE_PREFIX "Try increasing SHMEM_SYMMETRIC_SIZE\n",
-                       shmem_internal_heap_length, incr, shmem_internal_my_pe);
+                       shmem_internal_heap_dl_length, incr, shmem_internal_my_pe);
         shmem_internal_heap_curr = orig;
         orig = (void*) -1;
     }
@@ -227,12 +319,379 @@ static void *mmap_alloc(size_t bytes)
 }
 
 
+static int
+heap_arena_init(shmem_internal_heap_arena_t *arena, char *base, size_t length,
+                size_t align, int pad)
+{
+    memset(arena, 0, sizeof(shmem_internal_heap_arena_t));
+
+    if (length == 0) return 0;
+
+    arena->msp = create_mspace_with_base(base, length, 0);
+    if (NULL == arena->msp) {
+        RETURN_ERROR_MSG("Unable to create symmetric heap partition (%zu bytes)\n", length);
+        return -1;
+    }
+
+    /* Keep the partition from growing into the default heap via MORECORE */
+    mspace_set_footprint_limit(arena->msp, length);
+
+    arena->base = base;
+    arena->length = length;
+    arena->align = align;
+    arena->pad = pad;
+    arena->stats.size = length;
+
+    return 0;
+}
+
+
+static inline shmem_internal_heap_arena_t *
+heap_arena_lookup(const void *ptr)
+{
+    int i;
+
+    for (i = 0; i < SHMEM_INTERNAL_HEAP_NUM_ARENAS; i++) {
+        shmem_internal_heap_arena_t *arena = &shmem_internal_heap_arenas[i];
+
+        if (arena->msp != NULL && (char *) ptr >= arena->base &&
+            (char *) ptr < arena->base + arena->length)
+            return arena;
+    }
+
+    return NULL;
+}
+
+
+/* Allocate an object from the given heap partition.  Allocations that cannot
+ * be satisfied by the partition fall back to the default heap.  Because all
+ * PEs perform the same sequence of allocations, the fallback decision is
+ * symmetric.  Caller must hold shmem_internal_mutex_alloc. */
+static void *
+heap_arena_alloc(int idx, size_t size)
+{
+    shmem_internal_heap_arena_t *arena = &shmem_internal_heap_arenas[idx];
+    void *ret = NULL;
+
+    if (arena->msp != NULL) {
+        size_t len = arena->pad ? CEILING(size, arena->align) : size;
+        ret = mspace_memalign(arena->msp, arena->align, len);
+    }
+
+    if (NULL == ret) {
+        arena->stats.num_fallbacks++;
+        return dlmalloc(size);
+    }
+
+    arena->stats.num_allocs++;
+    arena->stats.in_use += mspace_usable_size(ret);
+    if (arena->stats.in_use > arena->stats.peak_in_use)
+        arena->stats.peak_in_use = arena->stats.in_use;
+
+    return ret;
+}
+
+
+/* Caller must hold shmem_internal_mutex_alloc */
+static void *
+heap_realloc(void *ptr, size_t size)
+{
+    shmem_internal_heap_arena_t *arena = heap_arena_lookup(ptr);
+    size_t old_size, len;
+    void *ret;
+
+    if (NULL == arena)
+        return dlrealloc(ptr, size);
+
+    old_size = mspace_usable_size(ptr);
+    len = arena->pad ? CEILING(size, arena->align) : size;
+
+    ret = mspace_realloc_in_place(arena->msp, ptr, len);
+    if (NULL != ret) {
+        arena->stats.in_use = arena->stats.in_use - old_size + mspace_usable_size(ret);
+        if (arena->stats.in_use > arena->stats.peak_in_use)
+            arena->stats.peak_in_use = arena->stats.in_use;
+        return ret;
+    }
+
+    /* mspace_realloc does not preserve the partition's alignment, so move
+     * the object explicitly */
+    ret = heap_arena_alloc(arena - shmem_internal_heap_arenas, size);
+    if (NULL != ret) {
+        memcpy(ret, ptr, old_size < size ? old_size : size);
+        shmem_internal_heap_free(ptr);
+    }
+
+    return ret;
+}
+
+
+void
+shmem_internal_heap_free(void *ptr)
+{
+    shmem_internal_heap_arena_t *arena = heap_arena_lookup(ptr);
+
+    if (NULL == arena) {
+        dlfree(ptr);
+    } else {
+        arena->stats.num_frees++;
+        arena->stats.in_use -= mspace_usable_size(ptr);
+        mspace_free(arena->msp, ptr);
+    }
+}
+
+
+static inline int
+heap_defer_active(void)
+{
+    return shmem_internal_params.SYMMETRIC_HEAP_DEFER_SYNC ||
+           shmem_internal_heap_epoch > 0;
+}
+
+
+/* Read allocation state from a peer.  This bypasses shmem_internal_get,
+ * which would recursively wait on the allocation sequence of the target. */
+static void
+heap_sync_read(void *dest, const void *source, size_t len, int pe)
+{
+    if (shmem_shr_transport_use_read(SHMEM_CTX_DEFAULT, dest, source, len, pe)) {
+        shmem_shr_transport_get(SHMEM_CTX_DEFAULT, dest, source, len, pe);
+    } else {
+        shmem_transport_get((shmem_transport_ctx_t *) SHMEM_CTX_DEFAULT, dest, source, len, pe);
+        shmem_transport_get_wait((shmem_transport_ctx_t *) SHMEM_CTX_DEFAULT);
+    }
+}
+
+
+/* Record a symmetric allocation.  The hash covers the offset of the object
+ * from the heap base and its size, which must match on all PEs.  When the
+ * barrier will be deferred, the object is added to the deferred list.
+ * Caller must hold shmem_internal_mutex_alloc. */
+static void
+heap_sync_record(void *ptr, size_t size)
+{
+    shmem_internal_heap_sync_t *sync = shmem_internal_heap_sync;
+    long gen = shmem_internal_heap_gen;
+    uint64_t off = (NULL == ptr) ? UINT64_MAX :
+        (uint64_t) ((char *) ptr - (char *) shmem_internal_heap_base);
+    uint64_t hash = sync->hash[gen % SHMEM_INTERNAL_HEAP_HASH_HIST];
+
+    /* FNV-1a style mixing */
+    hash = (hash ^ off) * 1099511628211ULL;
+    hash = (hash ^ (uint64_t) size) * 1099511628211ULL;
+
+    /* Publish the hash before the count, see shmem_internal_heap_sync_pe */
+    sync->hash[(gen + 1) % SHMEM_INTERNAL_HEAP_HASH_HIST] = hash;
+    shmem_internal_membar_release();
+    sync->gen = shmem_internal_heap_gen = gen + 1;
+
+    if (NULL == ptr || !heap_defer_active())
+        return;
+
+    if (shmem_internal_heap_deferred_len == shmem_internal_heap_deferred_size) {
+        size_t n = shmem_internal_heap_deferred_size ?
+                   2 * shmem_internal_heap_deferred_size : 64;
+        shmem_internal_heap_deferred_t *deferred =
+            realloc(shmem_internal_heap_deferred, n * sizeof(shmem_internal_heap_deferred_t));
+
+        if (NULL == deferred)
+            RAISE_ERROR_STR("Out of memory while deferring symmetric allocation");
+
+        shmem_internal_heap_deferred = deferred;
+        shmem_internal_heap_deferred_size = n;
+    }
+
+    shmem_internal_heap_deferred[shmem_internal_heap_deferred_len].start = (uintptr_t) ptr;
+    shmem_internal_heap_deferred[shmem_internal_heap_deferred_len].end = (uintptr_t) ptr + size;
+    shmem_internal_heap_deferred[shmem_internal_heap_deferred_len].gen = gen + 1;
+    shmem_internal_heap_deferred_len++;
+
+    __atomic_store_n(&shmem_internal_heap_sync_pending, 1, __ATOMIC_RELEASE);
+
+    /* Inline fast paths do not wait on the allocation sequence */
+    shmemx_fastpath_info.heap_sync_pending = 1;
+}
+
+
+/* Compare the allocation sequence with PE 0.  Must be called by all PEs
+ * after a barrier. */
+static void
+heap_sync_check_all(void)
+{
+    long gen = shmem_internal_heap_gen;
+    long root_gen;
+    uint64_t root_hash;
+
+    if (shmem_internal_my_pe != 0) {
+        heap_sync_read(&root_gen, &shmem_internal_heap_sync->gen, sizeof(long), 0);
+        heap_sync_read(&root_hash,
+                       &shmem_internal_heap_sync->hash[gen % SHMEM_INTERNAL_HEAP_HASH_HIST],
+                       sizeof(uint64_t), 0);
+
+        if (root_gen != gen ||
+            root_hash != shmem_internal_heap_sync->hash[gen % SHMEM_INTERNAL_HEAP_HASH_HIST]) {
+            RAISE_ERROR_MSG("Symmetric heap mismatch with PE 0 after %ld allocations "
+                            "(PE 0 performed %ld)\n", gen, root_gen);
+        }
+    }
+
+    /* PE 0 must not allocate until all PEs have read its state */
+    shmem_internal_barrier_all();
+}
+
+
+/* Synchronize all PEs on the allocation sequence and release objects whose
+ * free was deferred */
+static void
+heap_sync_all(void)
+{
+    size_t i;
+
+    shmem_internal_barrier_all();
+
+    /* Every PE has completed its allocations */
+    SHMEM_MUTEX_LOCK(shmem_internal_mutex_alloc);
+    shmem_internal_heap_deferred_len = 0;
+    __atomic_store_n(&shmem_internal_heap_sync_pending, 0, __ATOMIC_RELAXED);
+    shmemx_fastpath_info.heap_sync_pending = 0;
+    SHMEM_MUTEX_UNLOCK(shmem_internal_mutex_alloc);
+
+    if (shmem_internal_params.SYMMETRIC_HEAP_CHECK)
+        heap_sync_check_all();
+
+    if (shmem_internal_heap_free_queue_len == 0)
+        return;
+
+    SHMEM_MUTEX_LOCK(shmem_internal_mutex_alloc);
+    for (i = 0; i < shmem_internal_heap_free_queue_len; i++)
+        shmem_internal_heap_free(shmem_internal_heap_free_queue[i]);
+    shmem_internal_heap_free_queue_len = 0;
+    SHMEM_MUTEX_UNLOCK(shmem_internal_mutex_alloc);
+}
+
+
+/* Complete a symmetric allocation, the barrier is skipped when deferred */
+static inline void
+heap_alloc_sync(void)
+{
+    if (!heap_defer_active())
+        heap_sync_all();
+}
+
+
+/* Caller must hold shmem_internal_mutex_alloc */
+static void
+heap_free_deferred(void *ptr)
+{
+    if (shmem_internal_heap_free_queue_len == shmem_internal_heap_free_queue_size) {
+        size_t size = shmem_internal_heap_free_queue_size ?
+                      2 * shmem_internal_heap_free_queue_size : 64;
+        void **queue = realloc(shmem_internal_heap_free_queue, size * sizeof(void *));
+
+        if (NULL == queue)
+            RAISE_ERROR_STR("Out of memory while deferring symmetric free");
+
+        shmem_internal_heap_free_queue = queue;
+        shmem_internal_heap_free_queue_size = size;
+    }
+
+    shmem_internal_heap_free_queue[shmem_internal_heap_free_queue_len++] = ptr;
+}
+
+
+void
+shmem_internal_heap_sync_pe(const void *addr, int pe)
+{
+    long gen = 0, remote_gen, seen_gen;
+    size_t i;
+
+    if (pe == shmem_internal_my_pe)
+        return;
+
+    /* Only the allocation holding addr needs to be complete.  Addresses
+     * outside the deferred allocations were synchronized earlier or are not
+     * in the heap. */
+    SHMEM_MUTEX_LOCK(shmem_internal_mutex_alloc);
+    for (i = shmem_internal_heap_deferred_len; i > 0; i--) {
+        shmem_internal_heap_deferred_t *d = &shmem_internal_heap_deferred[i-1];
+
+        if ((uintptr_t) addr >= d->start && (uintptr_t) addr < d->end) {
+            gen = d->gen;
+            break;
+        }
+    }
+    SHMEM_MUTEX_UNLOCK(shmem_internal_mutex_alloc);
+
+    if (gen == 0 || __atomic_load_n(&shmem_internal_heap_pe_gen[pe], __ATOMIC_RELAXED) >= gen)
+        return;
+
+    for (;;) {
+        heap_sync_read(&remote_gen, &shmem_internal_heap_sync->gen, sizeof(long), pe);
+        if (remote_gen >= gen) break;
+        shmem_transport_probe();
+    }
+
+    /* The target publishes the hash for a count before the count itself.
+     * The entry for gen is valid unless the target has since started the
+     * allocation that overwrites it. */
+    if (shmem_internal_params.SYMMETRIC_HEAP_CHECK &&
+        remote_gen - gen < SHMEM_INTERNAL_HEAP_HASH_HIST - 1 &&
+        shmem_internal_heap_gen - gen < SHMEM_INTERNAL_HEAP_HASH_HIST - 1) {
+        uint64_t remote_hash;
+        long check_gen;
+
+        shmem_internal_membar_acquire();
+        heap_sync_read(&remote_hash,
+                       &shmem_internal_heap_sync->hash[gen % SHMEM_INTERNAL_HEAP_HASH_HIST],
+                       sizeof(uint64_t), pe);
+        heap_sync_read(&check_gen, &shmem_internal_heap_sync->gen, sizeof(long), pe);
+
+        if (check_gen - gen < SHMEM_INTERNAL_HEAP_HASH_HIST - 1 &&
+            remote_hash != shmem_internal_heap_sync->hash[gen % SHMEM_INTERNAL_HEAP_HASH_HIST]) {
+            RAISE_ERROR_MSG("Symmetric heap mismatch with PE %d after %ld allocations\n",
+                            pe, gen);
+        }
+    }
+
+    seen_gen = __atomic_load_n(&shmem_internal_heap_pe_gen[pe], __ATOMIC_RELAXED);
+    while (seen_gen < remote_gen &&
+           !__atomic_compare_exchange_n(&shmem_internal_heap_pe_gen[pe], &seen_gen, remote_gen,
+                                        0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+
 int
 shmem_internal_symmetric_init(void)
 {
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    size_t bulk_align = page_size;
+    size_t atomics_len, bulk_len;
+    long atomics_off, bulk_off;
+    int ret;
+
+#ifdef __linux__
+    if (shmem_internal_params.SYMMETRIC_HEAP_PAGE_SIZE > page_size)
+        bulk_align = CEILING(shmem_internal_params.SYMMETRIC_HEAP_PAGE_SIZE, page_size);
+#endif
+
     /* add library overhead such that the max can be shmalloc()'ed */
-    shmem_internal_heap_length = shmem_internal_params.SYMMETRIC_SIZE +
-                                 SHMEM_INTERNAL_HEAP_OVERHEAD;
+    shmem_internal_heap_dl_length = shmem_internal_params.SYMMETRIC_SIZE +
+                                    SHMEM_INTERNAL_HEAP_OVERHEAD;
+
+    /* Hint-driven partitions follow the default heap.  Offsets are relative
+     * to the heap base, so they are the same on all PEs. */
+    atomics_len = CEILING(shmem_internal_params.SYMMETRIC_HEAP_ATOMICS_SIZE, page_size);
+    atomics_off = CEILING(shmem_internal_heap_dl_length, page_size);
+    bulk_len    = CEILING(shmem_internal_params.SYMMETRIC_HEAP_BULK_SIZE, bulk_align);
+    bulk_off    = CEILING(atomics_off + atomics_len, bulk_align);
+
+    if (bulk_len > 0)
+        shmem_internal_heap_length = bulk_off + bulk_len;
+    else if (atomics_len > 0)
+        shmem_internal_heap_length = atomics_off + atomics_len;
+    else
+        shmem_internal_heap_length = shmem_internal_heap_dl_length;
 
     if (!shmem_internal_params.SYMMETRIC_HEAP_USE_MALLOC) {
         shmem_internal_heap_base =
@@ -244,13 +703,90 @@ shmem_internal_symmetric_init(void)
             malloc(shmem_internal_heap_length);
     }
 
-    return (NULL == shmem_internal_heap_base) ? -1 : 0;
+    if (NULL == shmem_internal_heap_base) return -1;
+
+    ret = heap_arena_init(&shmem_internal_heap_arenas[SHMEMX_HEAP_ATOMICS],
+                          (char *) shmem_internal_heap_base + atomics_off,
+                          atomics_len, SHMEM_INTERNAL_CACHELINE_SIZE, 1);
+    if (ret) return ret;
+
+    ret = heap_arena_init(&shmem_internal_heap_arenas[SHMEMX_HEAP_BULK],
+                          (char *) shmem_internal_heap_base + bulk_off,
+                          bulk_len, SHMEM_INTERNAL_CACHELINE_SIZE, 0);
+    if (ret) return ret;
+
+    if (atomics_len > 0) {
+        shmem_internal_heap_atomics_base = (char *) shmem_internal_heap_base + atomics_off;
+        shmem_internal_heap_atomics_length = atomics_len;
+    }
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    /* Request transparent huge pages for the bulk partition; the heap is
+     * already backed by huge pages when they are explicitly enabled */
+    if (bulk_len > 0 && !shmem_internal_params.SYMMETRIC_HEAP_USE_MALLOC &&
+        !shmem_internal_params.SYMMETRIC_HEAP_USE_HUGE_PAGES) {
+        if (madvise((char *) shmem_internal_heap_base + bulk_off, bulk_len, MADV_HUGEPAGE))
+            DEBUG_MSG("Unable to enable huge pages for bulk heap partition (%s)\n",
+                      strerror(errno));
+    }
+#endif
+
+    DEBUG_MSG("Sym. heap partitions: default len=%ld, atomics=%p len=%zu, bulk=%p len=%zu\n",
+              shmem_internal_heap_dl_length,
+              shmem_internal_heap_arenas[SHMEMX_HEAP_ATOMICS].base, atomics_len,
+              shmem_internal_heap_arenas[SHMEMX_HEAP_BULK].base, bulk_len);
+
+    /* Allocation state is the first object in the default heap, so it is
+     * at the same address on all PEs */
+    shmem_internal_heap_sync = dlmalloc(sizeof(shmem_internal_heap_sync_t));
+    if (NULL == shmem_internal_heap_sync) return -1;
+
+    memset(shmem_internal_heap_sync, 0, sizeof(shmem_internal_heap_sync_t));
+    shmem_internal_heap_sync->hash[0] = 14695981039346656037ULL;
+
+    shmem_internal_heap_pe_gen = calloc(shmem_internal_num_pes, sizeof(long));
+    if (NULL == shmem_internal_heap_pe_gen) return -1;
+
+    return 0;
 }
 
 
 int
 shmem_internal_symmetric_fini(void)
 {
+    static const char *arena_names[SHMEM_INTERNAL_HEAP_NUM_ARENAS] = { "atomics", "bulk" };
+    int i;
+
+    for (i = 0; i < SHMEM_INTERNAL_HEAP_NUM_ARENAS; i++) {
+        shmem_internal_heap_arena_t *arena = &shmem_internal_heap_arenas[i];
+
+        if (arena->msp != NULL) {
+            DEBUG_MSG("Sym. heap %s partition: size=%zu peak=%zu in use=%zu "
+                      "allocs=%"PRIu64" frees=%"PRIu64" fallbacks=%"PRIu64"\n",
+                      arena_names[i], arena->stats.size, arena->stats.peak_in_use,
+                      arena->stats.in_use, arena->stats.num_allocs,
+                      arena->stats.num_frees, arena->stats.num_fallbacks);
+        }
+
+        memset(arena, 0, sizeof(shmem_internal_heap_arena_t));
+    }
+
+    shmem_internal_heap_atomics_base = NULL;
+    shmem_internal_heap_atomics_length = 0;
+
+    free(shmem_internal_heap_pe_gen);
+    free(shmem_internal_heap_free_queue);
+    free(shmem_internal_heap_deferred);
+    shmem_internal_heap_pe_gen = NULL;
+    shmem_internal_heap_free_queue = NULL;
+    shmem_internal_heap_free_queue_len = shmem_internal_heap_free_queue_size = 0;
+    shmem_internal_heap_deferred = NULL;
+    shmem_internal_heap_deferred_len = shmem_internal_heap_deferred_size = 0;
+    shmem_internal_heap_sync_pending = 0;
+    shmem_internal_heap_sync = NULL;
+    shmem_internal_heap_gen = 0;
+    shmem_internal_heap_epoch = 0;
+
     if (NULL != shmem_internal_heap_base) {
         if (!shmem_internal_params.SYMMETRIC_HEAP_USE_MALLOC) {
             munmap( (void*)shmem_internal_heap_base, (size_t)shmem_internal_heap_length );
@@ -258,6 +794,7 @@ shmem_internal_symmetric_fini(void)
             free(shmem_internal_heap_base);
         }
         shmem_internal_heap_length = 0;
+        shmem_internal_heap_dl_length = 0;
         shmem_internal_heap_base = shmem_internal_heap_curr = NULL;
     }
 
@@ -289,9 +826,10 @@ shmem_malloc(size_t size)
 
     SHMEM_MUTEX_LOCK(shmem_internal_mutex_alloc);
     ret = dlmalloc(size);
+    heap_sync_record(ret, size);
     SHMEM_MUTEX_UNLOCK(shmem_internal_mutex_alloc);
 
-    shmem_internal_barrier_all();
+    heap_alloc_sync();
 
     return ret;
 }
@@ -307,9 +845,10 @@ shmem_calloc(size_t count, size_t size)
 
     SHMEM_MUTEX_LOCK(shmem_internal_mutex_alloc);
     ret = dlcalloc(count, size);
+    heap_sync_record(ret, count * size);
     SHMEM_MUTEX_UNLOCK(shmem_internal_mutex_alloc);
 
-    shmem_internal_barrier_all();
+    heap_alloc_sync();
 
     return ret;
 }
@@ -322,7 +861,19 @@ shmem_free(void *ptr)
       SHMEM_ERR_CHECK_SYMMETRIC_HEAP(ptr);
     }
 
-    shmem_internal_barrier_all();
+    /* Frees are only deferred inside an explicit epoch, whose end drains
+     * the queue.  With SHMEM_SYMMETRIC_HEAP_DEFER_SYNC alone there may be
+     * no later synchronization point, so the free keeps its barrier. */
+    if (shmem_internal_heap_epoch > 0) {
+        if (ptr != NULL) {
+            SHMEM_MUTEX_LOCK(shmem_internal_mutex_alloc);
+            heap_free_deferred(ptr);
+            SHMEM_MUTEX_UNLOCK(shmem_internal_mutex_alloc);
+        }
+        return;
+    }
+
+    heap_sync_all();
 
     shmem_internal_free(ptr);
 }
@@ -340,18 +891,21 @@ shmem_realloc(void *ptr, size_t size)
       SHMEM_ERR_CHECK_SYMMETRIC_HEAP(ptr);
     }
 
-    shmem_internal_barrier_all();
+    /* The contents of ptr may still be accessed remotely, so the leading
+     * barrier is not deferred */
+    heap_sync_all();
 
     SHMEM_MUTEX_LOCK(shmem_internal_mutex_alloc);
     if (size == 0 && ptr != NULL) {
-        dlfree(ptr);
+        shmem_internal_heap_free(ptr);
         ret = NULL;
     } else {
-        ret = dlrealloc(ptr, size);
+        ret = heap_realloc(ptr, size);
+        heap_sync_record(ret, size);
     }
     SHMEM_MUTEX_UNLOCK(shmem_internal_mutex_alloc);
 
-    shmem_internal_barrier_all();
+    heap_alloc_sync();
 
     return ret;
 }
@@ -370,9 +924,10 @@ shmem_align(size_t alignment, size_t size)
 
     SHMEM_MUTEX_LOCK(shmem_internal_mutex_alloc);
     ret = dlmemalign(alignment, size);
+    heap_sync_record(ret, size);
     SHMEM_MUTEX_UNLOCK(shmem_internal_mutex_alloc);
 
-    shmem_internal_barrier_all();
+    heap_alloc_sync();
 
     return ret;
 }
@@ -418,15 +973,72 @@ shmem_malloc_with_hints(size_t size, long hints)
     if (size == 0) return ret;
 
     // Check for valid hints
-    if(hints > SHMEM_MALLOC_MAX_HINTS || hints < 0) {
+    if (hints < 0 || (hints & ~(SHMEM_MALLOC_MAX_HINTS | SHMEMX_MALLOC_BULK))) {
         RAISE_WARN_MSG("Ignoring invalid hint for shmem_malloc_with_hints(%ld)\n", hints);
+        hints = 0;
     }
 
     SHMEM_MUTEX_LOCK(shmem_internal_mutex_alloc);
-    ret = dlmalloc(size);
+    if (hints & (SHMEM_MALLOC_ATOMICS_REMOTE | SHMEM_MALLOC_SIGNAL_REMOTE))
+        ret = heap_arena_alloc(SHMEMX_HEAP_ATOMICS, size);
+    else if (hints & SHMEMX_MALLOC_BULK)
+        ret = heap_arena_alloc(SHMEMX_HEAP_BULK, size);
+    else
+        ret = dlmalloc(size);
+    heap_sync_record(ret, size);
     SHMEM_MUTEX_UNLOCK(shmem_internal_mutex_alloc);
 
-    shmem_internal_barrier_all();
+    heap_alloc_sync();
 
     return ret;
 }
+
+
+int SHMEM_FUNCTION_ATTRIBUTES
+shmemx_heap_stats(int heap, shmemx_heap_stats_t *stats)
+{
+    SHMEM_ERR_CHECK_INITIALIZED();
+    SHMEM_ERR_CHECK_NULL(stats, 1);
+
+    if (heap < 0 || heap >= SHMEM_INTERNAL_HEAP_NUM_ARENAS)
+        return -1;
+
+    SHMEM_MUTEX_LOCK(shmem_internal_mutex_alloc);
+    *stats = shmem_internal_heap_arenas[heap].stats;
+    SHMEM_MUTEX_UNLOCK(shmem_internal_mutex_alloc);
+
+    return 0;
+}
+
+
+void SHMEM_FUNCTION_ATTRIBUTES
+shmemx_malloc_epoch_begin(void)
+{
+    SHMEM_ERR_CHECK_INITIALIZED();
+
+    SHMEM_MUTEX_LOCK(shmem_internal_mutex_alloc);
+    shmem_internal_heap_epoch++;
+    SHMEM_MUTEX_UNLOCK(shmem_internal_mutex_alloc);
+}
+
+
+void SHMEM_FUNCTION_ATTRIBUTES
+shmemx_malloc_epoch_end(void)
+{
+    int epoch;
+
+    SHMEM_ERR_CHECK_INITIALIZED();
+
+    SHMEM_MUTEX_LOCK(shmem_internal_mutex_alloc);
+    if (shmem_internal_heap_epoch > 0)
+        shmem_internal_heap_epoch--;
+    epoch = shmem_internal_heap_epoch;
+    SHMEM_MUTEX_UNLOCK(shmem_internal_mutex_alloc);
+
+    if (epoch > 0) return;
+
+    /* Allocation counts and deferred frees are the same on all PEs, so
+     * either all PEs or none perform the barrier */
+    if (shmem_internal_heap_sync_pending || shmem_internal_heap_free_queue_len > 0)
+        heap_sync_all();
+}
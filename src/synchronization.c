@@ -0,0 +1,174 @@
+/* -*- C -*-
+ *
+ * Copyright 2011 Sandia Corporation. Under the terms of Contract
+ * DE-AC04-94AL85000 with Sandia Corporation, the U.S.  Government
+ * retains certain rights in this software.
+ *
+ * Copyright (c) 2018 Intel Corporation. All rights reserved.
+ * This software is available to you under the BSD license.
+ *
+ * This file is part of the Sandia OpenSHMEM software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+ *
+ */
+
+#include "config.h"
+
+#define SHMEM_INTERNAL_INCLUDE
+#include "shmem.h"
+#include "shmem_internal.h"
+#include "shmem_atomic.h"
+#include "shmem_synchronization.h"
+
+#ifndef ENABLE_HARD_POLLING
+
+/* Blocking waits sleep on the transport's received messages counter, which
+ * advances on every incoming operation.  Only one thread at a time, the
+ * leader, sleeps on the counter.  After each wakeup it rechecks the variables
+ * of the other waiting threads and wakes only those whose variable changed.
+ * When the leader's own variable changes, leadership passes to the oldest
+ * remaining waiter.  Each thread therefore wakes for updates to its own
+ * variable, and the counter is never accessed concurrently.
+ *
+ * The counter does not see every update: another thread may store to the
+ * variable directly, and puts delivered by memcpy or shared memory do not
+ * advance it.  Unless the program is single threaded, the counter wait is
+ * therefore bounded so that the variable is rechecked periodically. */
+#define WAIT_RECHECK_MS 1
+
+#ifdef ENABLE_THREADS
+#include <pthread.h>
+
+enum shmem_internal_waiter_state_t {
+    WAITER_SLEEPING = 0,
+    WAITER_NOTIFIED,
+    WAITER_LEADER
+};
+
+struct shmem_internal_waiter_t {
+    const void                     *var;
+    size_t                          len;
+    uint64_t                        old;
+    int                             state;
+    pthread_cond_t                  cond;
+    struct shmem_internal_waiter_t *next;
+};
+typedef struct shmem_internal_waiter_t shmem_internal_waiter_t;
+
+static pthread_mutex_t waiters_mutex = PTHREAD_MUTEX_INITIALIZER;
+static shmem_internal_waiter_t *waiters_head = NULL;
+static shmem_internal_waiter_t *waiters_tail = NULL;
+static int waiters_have_leader = 0;
+
+
+/* Wake the waiters whose variable changed.  Called with waiters_mutex held. */
+static void
+notify_changed_waiters(void)
+{
+    shmem_internal_waiter_t **prev = &waiters_head;
+    shmem_internal_waiter_t *w;
+
+    waiters_tail = NULL;
+
+    while ((w = *prev) != NULL) {
+        if (shmem_internal_wait_word(w->var, w->len) != w->old) {
+            *prev = w->next;
+            w->state = WAITER_NOTIFIED;
+            pthread_cond_signal(&w->cond);
+        } else {
+            waiters_tail = w;
+            prev = &w->next;
+        }
+    }
+}
+
+
+static void
+wait_change_threaded(const void *var, size_t len, uint64_t old)
+{
+    shmem_internal_waiter_t self;
+
+    pthread_mutex_lock(&waiters_mutex);
+
+    if (shmem_internal_wait_word(var, len) != old) {
+        pthread_mutex_unlock(&waiters_mutex);
+        return;
+    }
+
+    if (waiters_have_leader) {
+        self.var   = var;
+        self.len   = len;
+        self.old   = old;
+        self.state = WAITER_SLEEPING;
+        self.next  = NULL;
+        pthread_cond_init(&self.cond, NULL);
+
+        if (waiters_tail)
+            waiters_tail->next = &self;
+        else
+            waiters_head = &self;
+        waiters_tail = &self;
+
+        /* The thread that changes our state also unlinks us */
+        while (self.state == WAITER_SLEEPING)
+            pthread_cond_wait(&self.cond, &waiters_mutex);
+
+        pthread_cond_destroy(&self.cond);
+
+        if (self.state == WAITER_NOTIFIED) {
+            pthread_mutex_unlock(&waiters_mutex);
+            return;
+        }
+    } else {
+        waiters_have_leader = 1;
+    }
+
+    for (;;) {
+        uint64_t target_cntr = shmem_transport_received_cntr_get();
+
+        COMPILER_FENCE();
+        notify_changed_waiters();
+        if (shmem_internal_wait_word(var, len) != old) break;
+
+        pthread_mutex_unlock(&waiters_mutex);
+        shmem_transport_received_cntr_wait(target_cntr + 1, WAIT_RECHECK_MS);
+        pthread_mutex_lock(&waiters_mutex);
+    }
+
+    if (waiters_head) {
+        shmem_internal_waiter_t *next_leader = waiters_head;
+
+        waiters_head = next_leader->next;
+        if (waiters_head == NULL) waiters_tail = NULL;
+        next_leader->state = WAITER_LEADER;
+        pthread_cond_signal(&next_leader->cond);
+    } else {
+        waiters_have_leader = 0;
+    }
+
+    pthread_mutex_unlock(&waiters_mutex);
+}
+#endif /* ENABLE_THREADS */
+
+
+void
+shmem_internal_wait_change(const void *var, size_t len, uint64_t old)
+{
+#ifdef ENABLE_THREADS
+    if (shmem_internal_thread_level == SHMEM_THREAD_MULTIPLE) {
+        wait_change_threaded(var, len, old);
+        return;
+    }
+#endif
+
+    uint64_t target_cntr = shmem_transport_received_cntr_get();
+
+    COMPILER_FENCE();
+    if (shmem_internal_wait_word(var, len) == old)
+        shmem_transport_received_cntr_wait(target_cntr + 1,
+                                           shmem_internal_thread_level == SHMEM_THREAD_SINGLE ?
+                                           -1 : WAIT_RECHECK_MS);
+}
+
+#endif /* ENABLE_HARD_POLLING */
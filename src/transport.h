@@ -43,7 +43,9 @@ enum shm_internal_datatype_t {
     SHM_INTERNAL_DOUBLE,
     SHM_INTERNAL_LONG_DOUBLE,
     SHM_INTERNAL_FLOAT_COMPLEX,
-    SHM_INTERNAL_DOUBLE_COMPLEX
+    SHM_INTERNAL_DOUBLE_COMPLEX,
+    SHM_INTERNAL_FLOAT16,
+    SHM_INTERNAL_BFLOAT16
 };
 
 typedef enum shm_internal_datatype_t shm_internal_datatype_t;
@@ -103,6 +103,13 @@ shmem_transport_quiet(shmem_transport_ctx_t* ctx)
     return 0;
 }
 
+static inline
+int
+shmem_transport_quiet_pe(shmem_transport_ctx_t* ctx, int pe)
+{
+    return 0;
+}
+
 static inline
 int
 shmem_transport_fence(shmem_transport_ctx_t* ctx)
@@ -321,9 +328,11 @@ uint64_t shmem_transport_received_cntr_get(void)
  * equal to the given value.
  *
  * @param ge_val Function returns when received messages >= ge_val
+ * @param timeout_ms Function may return after this many milliseconds,
+ *                   waits indefinitely when negative
  */
 static inline
-void shmem_transport_received_cntr_wait(uint64_t ge_val)
+void shmem_transport_received_cntr_wait(uint64_t ge_val, int timeout_ms)
 {
     RAISE_ERROR_STR("No remote peers");
 }
@@ -18,6 +18,13 @@
 #include <sys/syscall.h>
 #endif
 
+#ifdef HAVE_SCHED_GETAFFINITY
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#endif
+
+#include <sched.h>
 #include <errno.h>
 #include <stdlib.h>
 #include <sys/time.h>
@@ -68,19 +75,26 @@ struct fid_mr*                  shmem_transport_ofi_target_mrfd;
 #else  /* !ENABLE_REMOTE_VIRTUAL_ADDRESSING */
 struct fid_mr*                  shmem_transport_ofi_target_heap_mrfd;
 struct fid_mr*                  shmem_transport_ofi_target_data_mrfd;
+struct fid_mr*                  shmem_transport_ofi_target_atomics_mrfd;
 #endif
 #else  /* !ENABLE_MR_SCALABLE */
 struct fid_mr*                  shmem_transport_ofi_target_heap_mrfd;
 struct fid_mr*                  shmem_transport_ofi_target_data_mrfd;
+struct fid_mr*                  shmem_transport_ofi_target_atomics_mrfd;
 uint64_t*                       shmem_transport_ofi_target_heap_keys;
 uint64_t*                       shmem_transport_ofi_target_data_keys;
+uint64_t*                       shmem_transport_ofi_target_atomics_keys;
 #ifdef ENABLE_REMOTE_VIRTUAL_ADDRESSING
 int                             shmem_transport_ofi_use_absolute_address;
 #else
 uint8_t**                       shmem_transport_ofi_target_heap_addrs;
 uint8_t**                       shmem_transport_ofi_target_data_addrs;
+uint8_t**                       shmem_transport_ofi_target_atomics_addrs;
 #endif /* ENABLE_REMOTE_VIRTUAL_ADDRESSING */
 #endif /* ENABLE_MR_SCALABLE */
+#if !defined(ENABLE_MR_SCALABLE) || !defined(ENABLE_REMOTE_VIRTUAL_ADDRESSING)
+int                             shmem_transport_ofi_atomics_mr = 0;
+#endif
 uint64_t                        shmem_transport_ofi_max_poll;
 long                            shmem_transport_ofi_put_poll_limit;
 long                            shmem_transport_ofi_get_poll_limit;
@@ -88,6 +102,7 @@ size_t                          shmem_transport_ofi_max_buffered_send;
 size_t                          shmem_transport_ofi_max_msg_size;
 size_t                          shmem_transport_ofi_bounce_buffer_size;
 long                            shmem_transport_ofi_max_bounce_buffers;
+uint64_t                        shmem_transport_ofi_shr_pe_buckets = 0;
 size_t                          shmem_transport_ofi_addrlen;
 #ifdef ENABLE_MR_RMA_EVENT
 int                             shmem_transport_ofi_mr_rma_event;
@@ -136,7 +151,9 @@ int shmem_transport_dtype_table[] = {
     FI_DOUBLE,                /* SHM_INTERNAL_DOUBLE         */
     FI_LONG_DOUBLE,           /* SHM_INTERNAL_LONG_DOUBLE    */
     FI_FLOAT_COMPLEX,         /* SHM_INTERNAL_FLOAT_COMPLEX  */
-    FI_DOUBLE_COMPLEX         /* SHM_INTERNAL_DOUBLE_COMPLEX */
+    FI_DOUBLE_COMPLEX,        /* SHM_INTERNAL_DOUBLE_COMPLEX */
+    FI_UINT16,                /* SHM_INTERNAL_FLOAT16 (software reductions only)  */
+    FI_UINT16                 /* SHM_INTERNAL_BFLOAT16 (software reductions only) */
 };
 
 #undef SHM_INTERNAL_INT8
@@ -354,7 +371,10 @@ uint64_t shmem_transport_ofi_max_poll = (1ULL<<30);
 
 enum stx_allocator_t {
     ROUNDROBIN = 0,
-    RANDOM
+    RANDOM,
+    NUMA,
+    CORE,
+    LOAD
 };
 typedef enum stx_allocator_t stx_allocator_t;
 static stx_allocator_t shmem_transport_ofi_stx_allocator;
@@ -366,6 +386,9 @@ struct shmem_transport_ofi_stx_t {
     struct fid_stx*   stx;
     long              ref_cnt;
     int               is_private;
+    int               locality;     /* NUMA node or core of the first context */
+    uint64_t          retired_ops;  /* Operations issued by destroyed contexts */
+    shmem_transport_ctx_t *ctxs;    /* Contexts bound to the STX */
 };
 typedef struct shmem_transport_ofi_stx_t shmem_transport_ofi_stx_t;
 static shmem_transport_ofi_stx_t* shmem_transport_ofi_stx_pool = NULL;
@@ -378,23 +401,94 @@ struct shmem_transport_ofi_stx_kvs_t {
 typedef struct shmem_transport_ofi_stx_kvs_t shmem_transport_ofi_stx_kvs_t;
 static shmem_transport_ofi_stx_kvs_t* shmem_transport_ofi_stx_kvs = NULL;
 
+/* Number of operations issued by a context, used to estimate STX load */
+static inline
+uint64_t shmem_transport_ofi_ctx_ops(shmem_transport_ctx_t *ctx)
+{
+#ifdef USE_CTX_LOCK
+    return __atomic_load_n(&ctx->pending_put_cntr, __ATOMIC_RELAXED) +
+           __atomic_load_n(&ctx->pending_get_cntr, __ATOMIC_RELAXED);
+#else
+    return SHMEM_TRANSPORT_OFI_CNTR_READ(&ctx->pending_put_cntr) +
+           SHMEM_TRANSPORT_OFI_CNTR_READ(&ctx->pending_get_cntr);
+#endif
+}
+
+/* Number of operations issued by a context that have not completed.  The
+ * completion counters are read before the issue counters, as in quiet, so
+ * that the difference cannot be negative. */
+static inline
+uint64_t shmem_transport_ofi_ctx_outstanding(shmem_transport_ctx_t *ctx)
+{
+    uint64_t completed, issued;
+
+#ifdef USE_CTX_LOCK
+    /* The counters of private and serialized contexts may only be read by
+     * their owning thread, see shmem_transport_ofi_progress_ctx */
+    if (shmem_internal_thread_level == SHMEM_THREAD_MULTIPLE &&
+        (ctx->options & (SHMEM_CTX_PRIVATE | SHMEM_CTX_SERIALIZED)))
+        return 0;
+#endif
+
+    SHMEM_TRANSPORT_OFI_CTX_LOCK(ctx);
+    completed = fi_cntr_read(ctx->put_cntr) + fi_cntr_readerr(ctx->put_cntr) +
+                fi_cntr_read(ctx->get_cntr) + fi_cntr_readerr(ctx->get_cntr);
+    issued = shmem_transport_ofi_ctx_ops(ctx);
+    SHMEM_TRANSPORT_OFI_CTX_UNLOCK(ctx);
+
+    return issued > completed ? issued - completed : 0;
+}
+
+/* Operations outstanding on the contexts currently bound to an STX */
+static inline
+uint64_t shmem_transport_ofi_stx_load(int stx_idx)
+{
+    shmem_transport_ctx_t *ctx;
+    uint64_t ops = 0;
+
+    for (ctx = shmem_transport_ofi_stx_pool[stx_idx].ctxs; ctx != NULL; ctx = ctx->stx_next)
+        ops += shmem_transport_ofi_ctx_outstanding(ctx);
+
+    return ops;
+}
+
 static inline
 void shmem_transport_ofi_dump_stx(void) {
     char stx_str[256];
     int i, offset;
 
-    if (shmem_transport_ofi_stx_max == 0)
+    if (shmem_transport_ofi_stx_max == 0 || !shmem_internal_params.DEBUG)
         return;
 
-    for (i = offset = 0; i < shmem_transport_ofi_stx_max; i++)
+    /* Contexts, private/shared, locality, operations outstanding on live
+     * contexts, and operations issued by destroyed contexts */
+    for (i = offset = 0; i < shmem_transport_ofi_stx_max && offset < 256; i++)
         offset += snprintf(stx_str+offset, 256-offset,
-                           (i == shmem_transport_ofi_stx_max-1) ? "%ld%s" : "%ld%s ",
+                           (i == shmem_transport_ofi_stx_max-1) ? "%ld%s@%d:%"PRIu64"+%"PRIu64 :
+                                                                  "%ld%s@%d:%"PRIu64"+%"PRIu64" ",
                            shmem_transport_ofi_stx_pool[i].ref_cnt,
-                           shmem_transport_ofi_stx_pool[i].is_private ? "P" : "S");
+                           shmem_transport_ofi_stx_pool[i].is_private ? "P" : "S",
+                           shmem_transport_ofi_stx_pool[i].locality,
+                           shmem_transport_ofi_stx_load(i),
+                           shmem_transport_ofi_stx_pool[i].retired_ops);
 
     DEBUG_MSG("STX[%ld] = [ %s ]\n", shmem_transport_ofi_stx_max, stx_str);
 }
 
+/* NUMA node or core of the calling thread, used by the topology-aware STX
+ * allocators to group contexts created by threads close to each other */
+static inline
+int shmem_transport_ofi_stx_locality(void)
+{
+#if defined(SYS_getcpu) && !defined(__APPLE__)
+    unsigned cpu = 0, node = 0;
+
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+        return (int) (shmem_transport_ofi_stx_allocator == CORE ? cpu : node);
+#endif
+    return 0;
+}
+
 static inline
 int shmem_transport_ofi_is_private(long options) {
     if (!shmem_internal_params.OFI_STX_DISABLE_PRIVATE &&
@@ -430,11 +524,39 @@ int shmem_transport_ofi_stx_search_unused(void)
 }
 
 
+#define SHMEM_TRANSPORT_OFI_STX_SHAREABLE(i, threshold)                         \
+    (shmem_transport_ofi_stx_pool[i].ref_cnt > 0 &&                             \
+     (shmem_transport_ofi_stx_pool[i].ref_cnt <= (threshold) || (threshold) == -1) && \
+     !shmem_transport_ofi_stx_pool[i].is_private)
+
+/* Round-robin search among the shared STXs of the given locality, or of any
+ * locality when it is -1 */
+static inline
+int shmem_transport_ofi_stx_search_locality(long threshold, int locality)
+{
+    static int rr_start_idx = 0;
+    int i, count;
+
+    i = rr_start_idx;
+    for (count = 0; count < shmem_transport_ofi_stx_max; count++) {
+        if (SHMEM_TRANSPORT_OFI_STX_SHAREABLE(i, threshold) &&
+            (locality == -1 || shmem_transport_ofi_stx_pool[i].locality == locality)) {
+            rr_start_idx = (i + 1) % shmem_transport_ofi_stx_max;
+            return i;
+        }
+
+        i = (i + 1) % shmem_transport_ofi_stx_max;
+    }
+
+    return -1;
+}
+
 static inline
 int shmem_transport_ofi_stx_search_shared(long threshold)
 {
     static int rr_start_idx = 0;
     int stx_idx = -1, i, count;
+    uint64_t min_load = UINT64_MAX;
 
     switch (shmem_transport_ofi_stx_allocator) {
         case ROUNDROBIN:
@@ -477,6 +599,37 @@ int shmem_transport_ofi_stx_search_shared(long threshold)
             }
 
             break;
+
+        case NUMA:
+        case CORE:
+            /* Share only within the caller's locality while under the
+             * threshold, so that a new STX is preferred over crossing
+             * localities; once all STXs are in use, share with the same
+             * locality if possible. */
+            stx_idx = shmem_transport_ofi_stx_search_locality(threshold,
+                                                              shmem_transport_ofi_stx_locality());
+            if (stx_idx < 0 && threshold == -1)
+                stx_idx = shmem_transport_ofi_stx_search_locality(-1, -1);
+
+            break;
+
+        case LOAD:
+            /* Least loaded STX, by operations outstanding on its contexts */
+            for (i = 0; i < shmem_transport_ofi_stx_max; i++) {
+                if (SHMEM_TRANSPORT_OFI_STX_SHAREABLE(i, threshold)) {
+                    uint64_t load = shmem_transport_ofi_stx_load(i);
+
+                    if (stx_idx < 0 || load < min_load ||
+                        (load == min_load &&
+                         shmem_transport_ofi_stx_pool[i].ref_cnt < shmem_transport_ofi_stx_pool[stx_idx].ref_cnt)) {
+                        min_load = load;
+                        stx_idx = i;
+                    }
+                }
+            }
+
+            break;
+
         default:
             RAISE_ERROR_MSG("Invalid STX allocator (%d)\n",
                             shmem_transport_ofi_stx_allocator);
@@ -556,6 +709,18 @@ void shmem_transport_ofi_stx_allocate(shmem_transport_ctx_t *ctx)
         shmem_transport_ofi_stx_pool[ctx->stx_idx].ref_cnt++;
     }
 
+    if (ctx->stx_idx >= 0) {
+        shmem_transport_ofi_stx_t *stx = &shmem_transport_ofi_stx_pool[ctx->stx_idx];
+
+        if (stx->ref_cnt == 1)
+            stx->locality = (shmem_transport_ofi_stx_allocator == NUMA ||
+                             shmem_transport_ofi_stx_allocator == CORE) ?
+                            shmem_transport_ofi_stx_locality() : -1;
+
+        ctx->stx_next = stx->ctxs;
+        stx->ctxs = ctx;
+    }
+
     shmem_transport_ofi_dump_stx();
 
     return;
@@ -688,6 +853,16 @@ int allocate_recv_cntr_mr(void)
                     &shmem_transport_ofi_target_data_mrfd, NULL);
     OFI_CHECK_RETURN_STR(ret, "target memory (data) registration failed");
 
+    /* The atomics partition of the heap is optionally registered on its own,
+     * using key 2, so that atomics and signals target a dedicated region */
+    if (shmem_transport_ofi_atomics_mr) {
+        ret = fi_mr_reg(shmem_transport_ofi_domainfd, shmem_internal_heap_atomics_base,
+                        shmem_internal_heap_atomics_length,
+                        FI_REMOTE_READ | FI_REMOTE_WRITE, 0, 2ULL, flags,
+                        &shmem_transport_ofi_target_atomics_mrfd, NULL);
+        OFI_CHECK_RETURN_STR(ret, "target memory (atomics) registration failed");
+    }
+
     /* Bind counter with target memory region for incoming messages */
 #if ENABLE_TARGET_CNTR
     ret = fi_mr_bind(shmem_transport_ofi_target_heap_mrfd,
@@ -700,6 +875,13 @@ int allocate_recv_cntr_mr(void)
                      FI_REMOTE_WRITE);
     OFI_CHECK_RETURN_STR(ret, "target CNTR binding to data MR failed");
 
+    if (shmem_transport_ofi_atomics_mr) {
+        ret = fi_mr_bind(shmem_transport_ofi_target_atomics_mrfd,
+                         &shmem_transport_ofi_target_cntrfd->fid,
+                         FI_REMOTE_WRITE);
+        OFI_CHECK_RETURN_STR(ret, "target CNTR binding to atomics MR failed");
+    }
+
 #ifdef ENABLE_MR_RMA_EVENT
     if (shmem_transport_ofi_mr_rma_event) {
         ret = fi_mr_enable(shmem_transport_ofi_target_data_mrfd);
@@ -707,6 +889,11 @@ int allocate_recv_cntr_mr(void)
 
         ret = fi_mr_enable(shmem_transport_ofi_target_heap_mrfd);
         OFI_CHECK_RETURN_STR(ret, "target heap MR enable failed");
+
+        if (shmem_transport_ofi_atomics_mr) {
+            ret = fi_mr_enable(shmem_transport_ofi_target_atomics_mrfd);
+            OFI_CHECK_RETURN_STR(ret, "target atomics MR enable failed");
+        }
     }
 #endif /* ENABLE_MR_RMA_EVENT */
 #endif /* ENABLE_TARGET_CNTR */
@@ -742,6 +929,21 @@ int publish_mr_info(void)
             RAISE_WARN_STR("Put of data segment key to runtime KVS failed");
             return 1;
         }
+
+        if (shmem_transport_ofi_atomics_mr) {
+            uint64_t atomics_key;
+
+            if (shmem_transport_ofi_info.p_info->domain_attr->mr_mode & FI_MR_PROV_KEY)
+                atomics_key = fi_mr_key(shmem_transport_ofi_target_atomics_mrfd);
+            else
+                atomics_key = 2ULL;
+
+            err = shmem_runtime_put("fi_atomics_key", &atomics_key, sizeof(uint64_t));
+            if (err) {
+                RAISE_WARN_STR("Put of atomics heap key to runtime KVS failed");
+                return 1;
+            }
+        }
     }
 
 #ifdef ENABLE_REMOTE_VIRTUAL_ADDRESSING
@@ -773,6 +975,21 @@ int publish_mr_info(void)
             RAISE_WARN_STR("Put of data segment address to runtime KVS failed");
             return 1;
         }
+
+        if (shmem_transport_ofi_atomics_mr) {
+            void *atomics_base;
+
+            if (shmem_transport_ofi_info.p_info->domain_attr->mr_mode & FI_MR_VIRT_ADDR)
+                atomics_base = shmem_internal_heap_atomics_base;
+            else
+                atomics_base = (void *) 0;
+
+            err = shmem_runtime_put("fi_atomics_addr", &atomics_base, sizeof(uint8_t*));
+            if (err) {
+                RAISE_WARN_STR("Put of atomics heap address to runtime KVS failed");
+                return 1;
+            }
+        }
     }
 #endif /* ENABLE_REMOTE_VIRTUAL_ADDRESSING */
 #endif /* !ENABLE_MR_SCALABLE */
@@ -816,6 +1033,24 @@ int populate_mr_tables(void)
                 return 1;
             }
         }
+
+        if (shmem_transport_ofi_atomics_mr) {
+            shmem_transport_ofi_target_atomics_keys = malloc(sizeof(uint64_t) * shmem_internal_num_pes);
+            if (NULL == shmem_transport_ofi_target_atomics_keys) {
+                RAISE_WARN_STR("Out of memory allocating atomics keytable");
+                return 1;
+            }
+
+            for (i = 0; i < shmem_internal_num_pes; i++) {
+                err = shmem_runtime_get(i, "fi_atomics_key",
+                                        &shmem_transport_ofi_target_atomics_keys[i],
+                                        sizeof(uint64_t));
+                if (err) {
+                    RAISE_WARN_STR("Get of atomics heap key from runtime KVS failed");
+                    return 1;
+                }
+            }
+        }
     }
 
 #ifndef ENABLE_REMOTE_VIRTUAL_ADDRESSING
@@ -851,6 +1086,24 @@ int populate_mr_tables(void)
                 return 1;
             }
         }
+
+        if (shmem_transport_ofi_atomics_mr) {
+            shmem_transport_ofi_target_atomics_addrs = malloc(sizeof(uint8_t*) * shmem_internal_num_pes);
+            if (NULL == shmem_transport_ofi_target_atomics_addrs) {
+                RAISE_WARN_STR("Out of memory allocating atomics addrtable");
+                return 1;
+            }
+
+            for (i = 0; i < shmem_internal_num_pes; i++) {
+                err = shmem_runtime_get(i, "fi_atomics_addr",
+                                        &shmem_transport_ofi_target_atomics_addrs[i],
+                                        sizeof(uint8_t*));
+                if (err) {
+                    RAISE_WARN_STR("Get of atomics heap address from runtime KVS failed");
+                    return 1;
+                }
+            }
+        }
     }
 #endif /* ENABLE_REMOTE_VIRTUAL_ADDRESSING */
 #endif /* !ENABLE_MR_SCALABLE */
@@ -1176,6 +1429,10 @@ int query_for_fabric(struct fabric_info *info)
 #else
         domain_attr.threading = FI_THREAD_SAFE;
 #endif /* USE_THREAD_COMPLETION */
+    } else if (shmem_internal_params.OFI_PROGRESS_INTERVAL > 0) {
+        /* Library locks are disabled below SHMEM_THREAD_MULTIPLE, so the
+         * provider must serialize the progress thread's accesses */
+        domain_attr.threading = FI_THREAD_SAFE;
     } else
         domain_attr.threading = FI_THREAD_DOMAIN;
 #else
@@ -1316,6 +1573,150 @@ static int shmem_transport_ofi_target_ep_init(void)
     return 0;
 }
 
+#ifdef ENABLE_THREADS
+/* The progress thread walks a list of all contexts with the list lock held,
+ * so a context cannot be closed while it is being polled. */
+static pthread_t shmem_transport_ofi_progress_thread;
+static int shmem_transport_ofi_progress_thread_enabled = 0;
+static shmem_transport_ctx_t *shmem_transport_ofi_progress_ctxs = NULL;
+static pthread_mutex_t shmem_transport_ofi_progress_ctxs_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void shmem_transport_ofi_progress_register(shmem_transport_ctx_t *ctx)
+{
+    if (shmem_internal_params.OFI_PROGRESS_INTERVAL <= 0) return;
+
+    pthread_mutex_lock(&shmem_transport_ofi_progress_ctxs_lock);
+    ctx->progress_next = shmem_transport_ofi_progress_ctxs;
+    shmem_transport_ofi_progress_ctxs = ctx;
+    pthread_mutex_unlock(&shmem_transport_ofi_progress_ctxs_lock);
+}
+
+static void shmem_transport_ofi_progress_unregister(shmem_transport_ctx_t *ctx)
+{
+    shmem_transport_ctx_t **p;
+
+    if (shmem_internal_params.OFI_PROGRESS_INTERVAL <= 0) return;
+
+    pthread_mutex_lock(&shmem_transport_ofi_progress_ctxs_lock);
+    for (p = &shmem_transport_ofi_progress_ctxs; *p != NULL; p = &(*p)->progress_next) {
+        if (*p == ctx) {
+            *p = ctx->progress_next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&shmem_transport_ofi_progress_ctxs_lock);
+}
+
+/* Poll the target endpoint.  Returns nonzero if new incoming operations were
+ * observed. */
+static int shmem_transport_ofi_progress_target(uint64_t *last_cnt)
+{
+    struct fi_cq_entry buf;
+    int active = 0;
+
+#ifdef USE_THREAD_COMPLETION
+    pthread_mutex_lock(&shmem_transport_ofi_progress_lock);
+#endif
+    if (fi_cq_read(shmem_transport_ofi_target_cq, &buf, 1) == 1)
+        RAISE_WARN_STR("Unexpected event");
+    if (shmem_transport_ofi_nrails > 1)
+        shmem_transport_ofi_rail_probe();
+
+#if ENABLE_TARGET_CNTR
+#ifdef USE_THREAD_COMPLETION
+    /* Blocking waits access the target counter without the progress lock */
+    if (shmem_internal_thread_level != SHMEM_THREAD_MULTIPLE)
+#endif
+    {
+        uint64_t cnt = fi_cntr_read(shmem_transport_ofi_target_cntrfd);
+        active = (cnt != *last_cnt);
+        *last_cnt = cnt;
+    }
+#endif
+#ifdef USE_THREAD_COMPLETION
+    pthread_mutex_unlock(&shmem_transport_ofi_progress_lock);
+#endif
+
+    return active;
+}
+
+/* Read the completion counters of a context, which drives progress on its
+ * endpoint.  The CQ is left to the owner, since draining it releases bounce
+ * buffers.  Returns nonzero if any operations completed since the last poll. */
+static int shmem_transport_ofi_progress_ctx(shmem_transport_ctx_t *ctx)
+{
+    uint64_t cnt;
+
+#ifdef USE_CTX_LOCK
+    /* With FI_THREAD_COMPLETION, a context's endpoint and counters must only
+     * be accessed under the context lock, which private and serialized
+     * contexts do not take.  Their STX may also be reserved for the owning
+     * thread by shmem_transport_ofi_stx_allocate. */
+    if (shmem_internal_thread_level == SHMEM_THREAD_MULTIPLE &&
+        (ctx->options & (SHMEM_CTX_PRIVATE | SHMEM_CTX_SERIALIZED)))
+        return 0;
+#endif
+
+    SHMEM_TRANSPORT_OFI_CTX_LOCK(ctx);
+    cnt = fi_cntr_read(ctx->put_cntr) + fi_cntr_read(ctx->get_cntr);
+    SHMEM_TRANSPORT_OFI_CTX_UNLOCK(ctx);
+
+    if (cnt == ctx->progress_cnt) return 0;
+
+    ctx->progress_cnt = cnt;
+    return 1;
+}
+
+static void * shmem_transport_ofi_progress_thread_func(void *arg)
+{
+    const long max_interval = shmem_internal_params.OFI_PROGRESS_INTERVAL;
+    long interval = 0;
+    uint64_t target_cnt = 0;
+
+#ifdef HAVE_SCHED_GETAFFINITY
+    if (shmem_internal_params.OFI_PROGRESS_CPU >= 0) {
+        cpu_set_t set;
+
+        CPU_ZERO(&set);
+        CPU_SET(shmem_internal_params.OFI_PROGRESS_CPU, &set);
+
+        if (sched_setaffinity(0, sizeof(set), &set))
+            RAISE_WARN_MSG("Unable to bind progress thread to CPU %ld (%s)\n",
+                           shmem_internal_params.OFI_PROGRESS_CPU, strerror(errno));
+    }
+#endif
+
+    while (__atomic_load_n(&shmem_transport_ofi_progress_thread_enabled, __ATOMIC_ACQUIRE)) {
+        shmem_transport_ctx_t *ctx;
+        int active;
+
+        active = shmem_transport_ofi_progress_target(&target_cnt);
+
+        pthread_mutex_lock(&shmem_transport_ofi_progress_ctxs_lock);
+        for (ctx = shmem_transport_ofi_progress_ctxs; ctx != NULL; ctx = ctx->progress_next)
+            active |= shmem_transport_ofi_progress_ctx(ctx);
+        pthread_mutex_unlock(&shmem_transport_ofi_progress_ctxs_lock);
+
+        /* Poll again immediately while there is traffic, otherwise back off
+         * exponentially up to the configured interval */
+        if (active)
+            interval = 0;
+        else
+            interval = MIN(interval > 0 ? 2 * interval : 1, max_interval);
+
+        if (interval > 0)
+            usleep(interval);
+        else
+            sched_yield();
+    }
+
+    return NULL;
+}
+#else
+#define shmem_transport_ofi_progress_register(ctx)
+#define shmem_transport_ofi_progress_unregister(ctx)
+#endif /* ENABLE_THREADS */
+
 static int shmem_transport_ofi_ctx_init(shmem_transport_ctx_t *ctx, int id)
 {
     int ret = 0;
@@ -1401,6 +1802,11 @@ static int shmem_transport_ofi_ctx_init(shmem_transport_ctx_t *ctx, int id)
         ctx->bounce_buffers = NULL;
     }
 
+    ret = shmem_transport_ofi_rail_ctx_init(ctx);
+    if (ret != 0) return ret;
+
+    shmem_transport_ofi_progress_register(ctx);
+
     return 0;
 }
 
@@ -1449,6 +1855,17 @@ int shmem_transport_init(void)
     }
     shmem_transport_ofi_stx_threshold = shmem_internal_params.OFI_STX_THRESHOLD;
 
+    if (shmem_internal_params.OFI_ATOMICS_MR) {
+#if defined(ENABLE_MR_SCALABLE) && defined(ENABLE_REMOTE_VIRTUAL_ADDRESSING)
+        RAISE_WARN_STR("Ignoring OFI_ATOMICS_MR, the symmetric heap is not registered separately");
+#else
+        if (shmem_internal_heap_atomics_length == 0)
+            RAISE_WARN_STR("Ignoring OFI_ATOMICS_MR, the atomics heap partition is disabled");
+        else
+            shmem_transport_ofi_atomics_mr = 1;
+#endif
+    }
+
     ret = query_for_fabric(&shmem_transport_ofi_info);
     if (ret != 0) return ret;
 
@@ -1462,6 +1879,12 @@ int shmem_transport_init(void)
     } else if (0 == strcmp(type, "random")) {
         shmem_transport_ofi_stx_allocator = RANDOM;
         shmem_transport_ofi_stx_rand_init();
+    } else if (0 == strcmp(type, "numa")) {
+        shmem_transport_ofi_stx_allocator = NUMA;
+    } else if (0 == strcmp(type, "core")) {
+        shmem_transport_ofi_stx_allocator = CORE;
+    } else if (0 == strcmp(type, "load")) {
+        shmem_transport_ofi_stx_allocator = LOAD;
     } else {
         RAISE_WARN_MSG("Ignoring bad STX share algorithm '%s', using 'round-robin'\n", type);
         shmem_transport_ofi_stx_allocator = ROUNDROBIN;
@@ -1507,6 +1930,10 @@ int shmem_transport_init(void)
     ret = publish_av_info(&shmem_transport_ofi_info);
     if (ret != 0) return ret;
 
+    ret = shmem_transport_ofi_rails_init(shmem_transport_ofi_info.fabrics,
+                                         shmem_transport_ofi_info.p_info);
+    if (ret != 0) return ret;
+
     return 0;
 }
 
@@ -1572,8 +1999,19 @@ int shmem_transport_startup(void)
         OFI_CHECK_RETURN_MSG(ret, "STX context creation failed (%s)\n", fi_strerror(ret));
         shmem_transport_ofi_stx_pool[i].ref_cnt = 0;
         shmem_transport_ofi_stx_pool[i].is_private = 0;
+        shmem_transport_ofi_stx_pool[i].locality = -1;
+        shmem_transport_ofi_stx_pool[i].retired_ops = 0;
+        shmem_transport_ofi_stx_pool[i].ctxs = NULL;
+    }
+
+    for (i = 0; i < shmem_internal_num_pes; i++) {
+        if (-1 != shmem_internal_get_shr_rank(i))
+            shmem_transport_ofi_shr_pe_buckets |= SHMEM_TRANSPORT_OFI_PE_BUCKET(i);
     }
 
+    ret = shmem_transport_ofi_rails_startup();
+    if (ret != 0) return ret;
+
     shmem_transport_ctx_default.team = &shmem_internal_team_world;
 
     ret = shmem_transport_ofi_ctx_init(&shmem_transport_ctx_default, SHMEM_TRANSPORT_CTX_DEFAULT_ID);
@@ -1588,6 +2026,23 @@ int shmem_transport_startup(void)
     ret = populate_av();
     if (ret != 0) return ret;
 
+    ret = shmem_transport_ofi_mr_cache_init();
+    if (ret != 0) return ret;
+
+    if (shmem_internal_params.OFI_PROGRESS_INTERVAL > 0) {
+#ifdef ENABLE_THREADS
+        __atomic_store_n(&shmem_transport_ofi_progress_thread_enabled, 1, __ATOMIC_RELEASE);
+        ret = pthread_create(&shmem_transport_ofi_progress_thread, NULL,
+                             &shmem_transport_ofi_progress_thread_func, NULL);
+        if (ret) {
+            RAISE_WARN_MSG("Progress thread creation failed (%d)\n", ret);
+            __atomic_store_n(&shmem_transport_ofi_progress_thread_enabled, 0, __ATOMIC_RELEASE);
+        }
+#else
+        RAISE_WARN_STR("Ignoring SHMEM_OFI_PROGRESS_INTERVAL, threading support is disabled");
+#endif
+    }
+
     return 0;
 }
 
@@ -1660,6 +2115,8 @@ void shmem_transport_ctx_destroy(shmem_transport_ctx_t *ctx)
     if (ctx == NULL)
         return;
 
+    shmem_transport_ofi_progress_unregister(ctx);
+
     if(shmem_internal_params.DEBUG) {
         SHMEM_TRANSPORT_OFI_CTX_LOCK(ctx);
         if (ctx->bounce_buffers) SHMEM_TRANSPORT_OFI_CTX_BB_LOCK(ctx);
@@ -1690,8 +2147,27 @@ void shmem_transport_ctx_destroy(shmem_transport_ctx_t *ctx)
         shmem_free_list_destroy(ctx->bounce_buffers);
     }
 
+    shmem_transport_ofi_rail_ctx_fini(ctx);
+
+    /* The endpoint is closed, release any MR cache entries still held */
+    shmem_transport_ofi_mr_cache_release(ctx, 0, UINT64_MAX);
+    shmem_transport_ofi_mr_cache_release(ctx, 1, UINT64_MAX);
+
     if (ctx->stx_idx >= 0) {
+        shmem_transport_ctx_t **prev;
+
         SHMEM_MUTEX_LOCK(shmem_transport_ofi_lock);
+
+        /* Unlink the context from its STX and retire its operation count */
+        for (prev = &shmem_transport_ofi_stx_pool[ctx->stx_idx].ctxs; *prev != NULL;
+             prev = &(*prev)->stx_next) {
+            if (*prev == ctx) {
+                *prev = ctx->stx_next;
+                break;
+            }
+        }
+        shmem_transport_ofi_stx_pool[ctx->stx_idx].retired_ops += shmem_transport_ofi_ctx_ops(ctx);
+
         if (shmem_transport_ofi_is_private(ctx->options)) {
             shmem_transport_ofi_stx_kvs_t *e;
             HASH_FIND(hh, shmem_transport_ofi_stx_kvs, &ctx->tid,
@@ -1754,11 +2230,21 @@ int shmem_transport_fini(void)
     shmem_transport_ofi_stx_kvs_t* e;
     int stx_len = 0;
 
+#ifdef ENABLE_THREADS
+    if (__atomic_load_n(&shmem_transport_ofi_progress_thread_enabled, __ATOMIC_ACQUIRE)) {
+        __atomic_store_n(&shmem_transport_ofi_progress_thread_enabled, 0, __ATOMIC_RELEASE);
+        pthread_join(shmem_transport_ofi_progress_thread, NULL);
+    }
+#endif
+
     /* The default context is not inserted into the list of contexts on
      * SHMEM_TEAM_WORLD, so it must be destroyed here */
     shmem_transport_quiet(&shmem_transport_ctx_default);
     shmem_transport_ctx_destroy(&shmem_transport_ctx_default);
 
+    shmem_transport_ofi_mr_cache_fini();
+    shmem_transport_ofi_rails_fini();
+
     for (e = shmem_transport_ofi_stx_kvs; e != NULL; ) {
         shmem_transport_ofi_stx_kvs_t *last = e;
         stx_len++;
@@ -1795,6 +2281,11 @@ int shmem_transport_fini(void)
 
     ret = fi_close(&shmem_transport_ofi_target_data_mrfd->fid);
     OFI_CHECK_ERROR_MSG(ret, "Target data MR close failed (%s)\n", fi_strerror(errno));
+
+    if (shmem_transport_ofi_atomics_mr) {
+        ret = fi_close(&shmem_transport_ofi_target_atomics_mrfd->fid);
+        OFI_CHECK_ERROR_MSG(ret, "Target atomics MR close failed (%s)\n", fi_strerror(errno));
+    }
 #endif
 
 #if ENABLE_TARGET_CNTR
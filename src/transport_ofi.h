@@ -40,6 +40,7 @@
 #define ENABLE_TARGET_CNTR 0
 #endif
 
+extern struct fid_domain*               shmem_transport_ofi_domainfd;
 #if ENABLE_TARGET_CNTR
 extern struct fid_cntr*                 shmem_transport_ofi_target_cntrfd;
 #endif
@@ -49,20 +50,35 @@ extern struct fid_cq*                   shmem_transport_ofi_target_cq;
 #ifndef ENABLE_MR_SCALABLE
 extern uint64_t*                        shmem_transport_ofi_target_heap_keys;
 extern uint64_t*                        shmem_transport_ofi_target_data_keys;
+extern uint64_t*                        shmem_transport_ofi_target_atomics_keys;
 #ifdef ENABLE_REMOTE_VIRTUAL_ADDRESSING
 extern int                              shmem_transport_ofi_use_absolute_address;
 #else
 extern uint8_t**                        shmem_transport_ofi_target_heap_addrs;
 extern uint8_t**                        shmem_transport_ofi_target_data_addrs;
+extern uint8_t**                        shmem_transport_ofi_target_atomics_addrs;
 #endif /* ENABLE_REMOTE_VIRTUAL_ADDRESSING */
 #endif /* ENABLE_MR_SCALABLE */
+#if !defined(ENABLE_MR_SCALABLE) || !defined(ENABLE_REMOTE_VIRTUAL_ADDRESSING)
+extern int                              shmem_transport_ofi_atomics_mr;
+
+#define SHMEM_TRANSPORT_OFI_IN_ATOMICS_MR(addr)                                 \
+    (shmem_transport_ofi_atomics_mr &&                                          \
+     (void*) (addr) >= shmem_internal_heap_atomics_base &&                      \
+     (uint8_t*) (addr) < (uint8_t*) shmem_internal_heap_atomics_base +          \
+                         shmem_internal_heap_atomics_length)
+#endif
 extern uint64_t                         shmem_transport_ofi_max_poll;
 extern long                             shmem_transport_ofi_put_poll_limit;
 extern long                             shmem_transport_ofi_get_poll_limit;
 extern size_t                           shmem_transport_ofi_max_buffered_send;
 extern size_t                           shmem_transport_ofi_max_msg_size;
+#ifdef ENABLE_MR_RMA_EVENT
+extern int                              shmem_transport_ofi_mr_rma_event;
+#endif
 extern size_t                           shmem_transport_ofi_bounce_buffer_size;
 extern long                             shmem_transport_ofi_max_bounce_buffers;
+extern uint64_t                         shmem_transport_ofi_shr_pe_buckets;
 
 extern pthread_mutex_t                  shmem_transport_ofi_progress_lock;
 
@@ -126,7 +142,12 @@ void shmem_transport_ofi_get_mr(const void *addr, int dest_pe,
     *key = 0;
     *mr_addr = (uint8_t*) addr;
 #else
-    if ((void*) addr >= shmem_internal_data_base &&
+    if (SHMEM_TRANSPORT_OFI_IN_ATOMICS_MR(addr)) {
+
+        *key = 2;
+        *mr_addr = (uint8_t*) ((uint8_t *) addr - (uint8_t *) shmem_internal_heap_atomics_base);
+
+    } else if ((void*) addr >= shmem_internal_data_base &&
         (uint8_t*) addr < (uint8_t*) shmem_internal_data_base + shmem_internal_data_length) {
 
         *key = 0;
@@ -150,7 +171,20 @@ void shmem_transport_ofi_get_mr(const void *addr, int dest_pe,
 static inline
 void shmem_transport_ofi_get_mr(const void *addr, int dest_pe,
                                 uint8_t **mr_addr, uint64_t *key) {
-    if ((void*) addr >= shmem_internal_data_base &&
+    if (SHMEM_TRANSPORT_OFI_IN_ATOMICS_MR(addr)) {
+        *key = shmem_transport_ofi_target_atomics_keys[dest_pe];
+#ifdef ENABLE_REMOTE_VIRTUAL_ADDRESSING
+        if (shmem_transport_ofi_use_absolute_address)
+            *mr_addr = (uint8_t *) addr;
+        else
+            *mr_addr = (void *) ((uint8_t *) addr - (uint8_t *) shmem_internal_heap_atomics_base);
+#else
+        *mr_addr = shmem_transport_ofi_target_atomics_addrs[dest_pe] +
+            ((uint8_t *) addr - (uint8_t *) shmem_internal_heap_atomics_base);
+#endif
+    }
+
+    else if ((void*) addr >= shmem_internal_data_base &&
         (uint8_t*) addr < (uint8_t*) shmem_internal_data_base + shmem_internal_data_length) {
         *key = shmem_transport_ofi_target_data_keys[dest_pe];
 #ifdef ENABLE_REMOTE_VIRTUAL_ADDRESSING
@@ -265,13 +299,102 @@ struct shmem_transport_ctx_t {
     uint64_t                        completed_bb_cntr;
     shmem_free_list_t              *bounce_buffers;
     int                             stx_idx;
+    /* Next context bound to the same STX, protected by the OFI lock */
+    struct shmem_transport_ctx_t   *stx_next;
     struct shmem_internal_tid       tid;
     struct shmem_internal_team_t   *team;
+    /* Buckets of destination PEs with puts or non-fetching atomics issued
+     * since the last put quiet, and buckets ordered by a fence that has not
+     * yet been enforced.  Only used by single-issuer contexts. */
+    uint64_t                        dirty_pes;
+    uint64_t                        fenced_pes;
+    /* Accessed by the progress thread with its context list lock held */
+    struct shmem_transport_ctx_t   *progress_next;
+    uint64_t                        progress_cnt;
+    /* MR cache entries used by operations that have not yet been completed
+     * by a quiet.  Protected by the MR cache lock. */
+    struct shmem_transport_ofi_mr_hold_t *mr_holds;
+    /* Endpoints of the additional rails, indexed by rail (entry 0 is unused),
+     * or NULL with a single rail */
+    struct shmem_transport_ofi_rail_ctx_t *rails;
 };
 
 typedef struct shmem_transport_ctx_t shmem_transport_ctx_t;
 extern shmem_transport_ctx_t shmem_transport_ctx_default;
 
+/* Registration cache for private (non-symmetric) local buffers.  Large puts
+ * and gets pass the descriptor of a cached registration to the provider.  An
+ * operation using an entry holds it until the put or get counter of its
+ * context reaches the value recorded with shmem_transport_ofi_mr_cache_hold,
+ * so that evicted and invalidated entries are closed only once unused. */
+struct shmem_transport_ofi_mr_entry_t;
+typedef struct shmem_transport_ofi_mr_entry_t shmem_transport_ofi_mr_entry_t;
+
+extern size_t shmem_transport_ofi_mr_cache_threshold;
+
+int shmem_transport_ofi_mr_cache_init(void);
+void shmem_transport_ofi_mr_cache_fini(void);
+shmem_transport_ofi_mr_entry_t *shmem_transport_ofi_mr_cache_acquire(const void *buf, size_t len,
+                                                                     void **desc);
+void shmem_transport_ofi_mr_cache_hold(shmem_transport_ctx_t *ctx,
+                                       shmem_transport_ofi_mr_entry_t *entry,
+                                       int is_get, uint64_t cnt);
+void shmem_transport_ofi_mr_cache_release(shmem_transport_ctx_t *ctx, int is_get, uint64_t cnt);
+
+static inline
+shmem_transport_ofi_mr_entry_t *shmem_transport_ofi_mr_lookup(const void *buf, size_t len,
+                                                              void **desc)
+{
+    *desc = NULL;
+
+    if (len < shmem_transport_ofi_mr_cache_threshold)
+        return NULL;
+
+    /* Symmetric objects are registered for remote access only */
+    if (((uint8_t *) buf >= (uint8_t *) shmem_internal_heap_base &&
+         (uint8_t *) buf < (uint8_t *) shmem_internal_heap_base + shmem_internal_heap_length) ||
+        ((uint8_t *) buf >= (uint8_t *) shmem_internal_data_base &&
+         (uint8_t *) buf < (uint8_t *) shmem_internal_data_base + shmem_internal_data_length))
+        return NULL;
+
+    return shmem_transport_ofi_mr_cache_acquire(buf, len, desc);
+}
+
+/* Multi-rail support.  Additional rails are endpoint sets opened on further
+ * domains of the provider, typically one per NIC.  Transfers of at least
+ * twice the stripe size are split across the rails; smaller puts and gets are
+ * placed on a rail selected by the destination PE, so that operations to a
+ * given PE keep using the same rail.  Atomics and bounce buffered puts always
+ * use the primary rail.  The rail functions are only called when more than
+ * one rail is active. */
+extern int shmem_transport_ofi_nrails;
+
+int shmem_transport_ofi_rails_init(struct fi_info *fabrics, struct fi_info *primary);
+int shmem_transport_ofi_rails_startup(void);
+void shmem_transport_ofi_rails_fini(void);
+int shmem_transport_ofi_rail_ctx_init(shmem_transport_ctx_t *ctx);
+void shmem_transport_ofi_rail_ctx_fini(shmem_transport_ctx_t *ctx);
+int shmem_transport_ofi_rail_put_small(shmem_transport_ctx_t *ctx, void *target,
+                                       const void *source, size_t len, int pe);
+void shmem_transport_ofi_rail_put(shmem_transport_ctx_t *ctx, void **target,
+                                  const void **source, size_t *len, int pe);
+void shmem_transport_ofi_rail_get(shmem_transport_ctx_t *ctx, void **target,
+                                  const void **source, size_t *len, int pe);
+void shmem_transport_ofi_rail_put_quiet(shmem_transport_ctx_t *ctx);
+void shmem_transport_ofi_rail_get_wait(shmem_transport_ctx_t *ctx);
+void shmem_transport_ofi_rail_probe(void);
+uint64_t shmem_transport_ofi_rail_target_cntr_read(void);
+void shmem_transport_ofi_rail_target_cntr_wait(uint64_t ge_val, int timeout_ms);
+
+/* Release the MR cache entries held by operations that are complete once the
+ * given number of puts or gets has completed */
+static inline
+void shmem_transport_ofi_mr_complete(shmem_transport_ctx_t *ctx, int is_get, uint64_t cnt)
+{
+    if (__atomic_load_n(&ctx->mr_holds, __ATOMIC_RELAXED) != NULL)
+        shmem_transport_ofi_mr_cache_release(ctx, is_get, cnt);
+}
+
 extern struct fid_ep* shmem_transport_ofi_target_ep;
 
 #ifdef USE_CTX_LOCK
@@ -321,6 +444,8 @@ void shmem_transport_probe(void)
         int ret = fi_cq_read(shmem_transport_ofi_target_cq, &buf, 1);
         if (ret == 1)
             RAISE_WARN_STR("Unexpected event");
+        if (shmem_transport_ofi_nrails > 1)
+            shmem_transport_ofi_rail_probe();
 #  ifdef USE_THREAD_COMPLETION
         pthread_mutex_unlock(&shmem_transport_ofi_progress_lock);
     }
@@ -407,11 +532,38 @@ shmem_transport_ofi_bounce_buffer_t * create_bounce_buffer(shmem_transport_ctx_t
     return buff;
 }
 
+/* Completion counters are per context, so completions cannot be attributed to
+ * a destination.  Instead, contexts that are used by one thread at a time
+ * record the PE buckets they have written to.  A fence only marks the dirty
+ * buckets; the put quiet it requires is deferred until an operation targets
+ * one of them.  Shared contexts under SHMEM_THREAD_MULTIPLE fence eagerly. */
+#define SHMEM_TRANSPORT_OFI_PE_BUCKET(pe) ((uint64_t) 1 << ((unsigned) (pe) % 64))
+
+static inline
+int shmem_transport_ofi_ctx_lazy_fence(shmem_transport_ctx_t *ctx)
+{
+    return (ctx->options & (SHMEM_CTX_PRIVATE | SHMEM_CTX_SERIALIZED)) ||
+           shmem_internal_thread_level != SHMEM_THREAD_MULTIPLE;
+}
+
+static inline
+void shmem_transport_ofi_mark_pe(shmem_transport_ctx_t *ctx, int pe)
+{
+    if (shmem_transport_ofi_ctx_lazy_fence(ctx))
+        ctx->dirty_pes |= SHMEM_TRANSPORT_OFI_PE_BUCKET(pe);
+}
+
 static inline
 void shmem_transport_put_quiet(shmem_transport_ctx_t* ctx)
 {
     SHMEM_TRANSPORT_OFI_CTX_LOCK(ctx);
 
+    if (shmem_transport_ofi_ctx_lazy_fence(ctx)) {
+        /* Every operation issued so far is complete on return */
+        ctx->dirty_pes = 0;
+        ctx->fenced_pes = 0;
+    }
+
     /* Wait for bounce buffered operations to complete */
     if (ctx->bounce_buffers) {
         SHMEM_TRANSPORT_OFI_CTX_BB_LOCK(ctx);
@@ -423,6 +575,10 @@ void shmem_transport_put_quiet(shmem_transport_ctx_t* ctx)
         SHMEM_TRANSPORT_OFI_CTX_BB_UNLOCK(ctx);
     }
 
+    /* Wait for operations issued on the additional rails */
+    if (ctx->rails)
+        shmem_transport_ofi_rail_put_quiet(ctx);
+
     /* wait for put counter to meet outstanding count value */
 
     /* Note: the communication routines increment pending put counters before
@@ -448,6 +604,7 @@ void shmem_transport_put_quiet(shmem_transport_ctx_t* ctx)
         } else if (fail) {
             RAISE_ERROR_MSG("Operations completed in error (%" PRIu64 ")\n", fail);
         } else {
+            shmem_transport_ofi_mr_complete(ctx, 0, cnt);
             SHMEM_TRANSPORT_OFI_CTX_UNLOCK(ctx);
             return;
         }
@@ -462,6 +619,7 @@ void shmem_transport_put_quiet(shmem_transport_ctx_t* ctx)
     } while (cnt < cnt_new);
     shmem_internal_assert(cnt == cnt_new);
 
+    shmem_transport_ofi_mr_complete(ctx, 0, cnt);
     SHMEM_TRANSPORT_OFI_CTX_UNLOCK(ctx);
 }
 
@@ -476,13 +634,39 @@ int shmem_transport_quiet(shmem_transport_ctx_t* ctx)
 }
 
 
+/* Enforce a pending fence before issuing an operation to the given PE */
+static inline
+void shmem_transport_ofi_order_pe(shmem_transport_ctx_t *ctx, int pe)
+{
+    if (ctx->fenced_pes & SHMEM_TRANSPORT_OFI_PE_BUCKET(pe))
+        shmem_transport_put_quiet(ctx);
+}
+
+static inline
+int shmem_transport_quiet_pe(shmem_transport_ctx_t* ctx, int pe)
+{
+    if (!shmem_transport_ofi_ctx_lazy_fence(ctx) ||
+        (ctx->dirty_pes & SHMEM_TRANSPORT_OFI_PE_BUCKET(pe)))
+        shmem_transport_put_quiet(ctx);
+
+    shmem_transport_get_wait(ctx);
+
+    return 0;
+}
+
 static inline
 int shmem_transport_fence(shmem_transport_ctx_t* ctx)
 {
 #if WANT_TOTAL_DATA_ORDERING == 0
     /* Communication is unordered; must wait for puts and buffered (injected)
      * non-fetching atomics to be completed in order to ensure ordering. */
-    shmem_transport_put_quiet(ctx);
+    /* Operations to PEs reachable through the shared memory transport bypass
+     * the order check, so buckets holding such PEs are fenced eagerly. */
+    if (shmem_transport_ofi_ctx_lazy_fence(ctx) &&
+        !(ctx->dirty_pes & shmem_transport_ofi_shr_pe_buckets))
+        ctx->fenced_pes |= ctx->dirty_pes;
+    else
+        shmem_transport_put_quiet(ctx);
 #endif
     /* Complete fetching ops; needed to support nonblocking fetch-atomics */
     shmem_transport_get_wait(ctx);
@@ -552,8 +736,15 @@ void shmem_transport_put_scalar(shmem_transport_ctx_t* ctx, void *target, const
 
     shmem_internal_assert(len <= shmem_transport_ofi_max_buffered_send);
 
+    if (shmem_transport_ofi_nrails > 1 &&
+        shmem_transport_ofi_rail_put_small(ctx, target, source, len, pe))
+        return;
+
+    shmem_transport_ofi_order_pe(ctx, pe);
+
     SHMEM_TRANSPORT_OFI_CTX_LOCK(ctx);
     SHMEM_TRANSPORT_OFI_CNTR_INC(&ctx->pending_put_cntr);
+    shmem_transport_ofi_mark_pe(ctx, pe);
 
     do {
 
@@ -578,11 +769,22 @@ void shmem_transport_ofi_put_large(shmem_transport_ctx_t* ctx, void *target, con
     uint64_t key;
     uint8_t *addr;
 
+    /* Issue the parts of the transfer placed on the additional rails, leaving
+     * the part placed on the primary rail */
+    if (shmem_transport_ofi_nrails > 1) {
+        shmem_transport_ofi_rail_put(ctx, &target, &source, &len, pe);
+        if (len == 0) return;
+    }
+
     shmem_transport_ofi_get_mr(target, pe, &addr, &key);
 
     uint8_t *frag_source = (uint8_t *) source;
     uint64_t frag_target = (uint64_t) addr;
     size_t frag_len = len;
+    void *desc;
+    shmem_transport_ofi_mr_entry_t *mr_entry = shmem_transport_ofi_mr_lookup(source, len, &desc);
+
+    shmem_transport_ofi_order_pe(ctx, pe);
 
     /* operation generates counting events and must be completed by
      * quiet. */
@@ -593,10 +795,11 @@ void shmem_transport_ofi_put_large(shmem_transport_ctx_t* ctx, void *target, con
         polled = 0;
 
         SHMEM_TRANSPORT_OFI_CNTR_INC(&ctx->pending_put_cntr);
+        shmem_transport_ofi_mark_pe(ctx, pe);
 
         do {
             ret = fi_write(ctx->ep,
-                           frag_source, frag_len, NULL,
+                           frag_source, frag_len, desc,
                            GET_DEST(dst), frag_target,
                            key, NULL);
         } while (try_again(ctx, ret, &polled));
@@ -604,6 +807,10 @@ void shmem_transport_ofi_put_large(shmem_transport_ctx_t* ctx, void *target, con
         frag_source += frag_len;
         frag_target += frag_len;
     }
+
+    if (mr_entry)
+        shmem_transport_ofi_mr_cache_hold(ctx, mr_entry, 0,
+                                          SHMEM_TRANSPORT_OFI_CNTR_READ(&ctx->pending_put_cntr));
     SHMEM_TRANSPORT_OFI_CTX_UNLOCK(ctx);
 }
 
@@ -625,8 +832,11 @@ void shmem_transport_put_nb(shmem_transport_ctx_t* ctx, void *target, const void
 
     } else if (len <= shmem_transport_ofi_bounce_buffer_size && ctx->bounce_buffers) {
 
+        shmem_transport_ofi_order_pe(ctx, pe);
+
         SHMEM_TRANSPORT_OFI_CTX_LOCK(ctx);
         SHMEM_TRANSPORT_OFI_CNTR_INC(&ctx->pending_put_cntr);
+        shmem_transport_ofi_mark_pe(ctx, pe);
         shmem_transport_ofi_get_mr(target, pe, &addr, &key);
 
         shmem_transport_ofi_bounce_buffer_t *buff =
@@ -668,11 +878,14 @@ void shmem_transport_put_signal_nbi(shmem_transport_ctx_t* ctx, void *target, co
 
     shmem_transport_ofi_get_mr(target, pe, &addr, &key);
 
+    shmem_transport_ofi_order_pe(ctx, pe);
+
     if (len <= shmem_transport_ofi_max_buffered_send) {
         uint8_t *src_buf = (uint8_t *) source;
 
         SHMEM_TRANSPORT_OFI_CTX_LOCK(ctx);
         SHMEM_TRANSPORT_OFI_CNTR_INC(&ctx->pending_put_cntr);
+        shmem_transport_ofi_mark_pe(ctx, pe);
 
         const struct iovec msg_iov = {
                                        .iov_base = src_buf,
@@ -741,6 +954,7 @@ void shmem_transport_put_signal_nbi(shmem_transport_ctx_t* ctx, void *target, co
             msg.context = frag_source;
 
             SHMEM_TRANSPORT_OFI_CNTR_INC(&ctx->pending_put_cntr);
+            shmem_transport_ofi_mark_pe(ctx, pe);
 
             do {
                 ret = fi_writemsg(ctx->ep, &msg, FI_DELIVERY_COMPLETE);
@@ -767,8 +981,11 @@ void shmem_transport_put_signal_nbi(shmem_transport_ctx_t* ctx, void *target, co
     ret = 0;
     int atomic_op = (sig_op == SHMEM_SIGNAL_ADD) ? FI_SUM : FI_ATOMIC_WRITE;
 
+    shmem_transport_ofi_order_pe(ctx, pe);
+
     SHMEM_TRANSPORT_OFI_CTX_LOCK(ctx);
     SHMEM_TRANSPORT_OFI_CNTR_INC(&ctx->pending_put_cntr);
+    shmem_transport_ofi_mark_pe(ctx, pe);
 
     const struct fi_ioc msg_iov_signal = {
                                           .addr = (uint8_t *) &signal,
@@ -835,6 +1052,14 @@ void shmem_transport_get(shmem_transport_ctx_t* ctx, void *target, const void *s
     uint64_t key;
     uint8_t *addr;
 
+    if (shmem_transport_ofi_nrails > 1) {
+        shmem_transport_ofi_rail_get(ctx, &target, &source, &len, pe);
+        if (len == 0) return;
+    }
+
+    void *desc;
+    shmem_transport_ofi_mr_entry_t *mr_entry = shmem_transport_ofi_mr_lookup(target, len, &desc);
+
     shmem_transport_ofi_get_mr(source, pe, &addr, &key);
 
     SHMEM_TRANSPORT_OFI_CTX_LOCK(ctx);
@@ -845,7 +1070,7 @@ void shmem_transport_get(shmem_transport_ctx_t* ctx, void *target, const void *s
             ret = fi_read(ctx->ep,
                           target,
                           len,
-                          NULL,
+                          desc,
                           GET_DEST(dst),
                           (uint64_t) addr,
                           key,
@@ -866,7 +1091,7 @@ void shmem_transport_get(shmem_transport_ctx_t* ctx, void *target, const void *s
 
             do {
                 ret = fi_read(ctx->ep,
-                              frag_target, frag_len, NULL,
+                              frag_target, frag_len, desc,
                               GET_DEST(dst), frag_source,
                               key, NULL);
             } while (try_again(ctx, ret, &polled));
@@ -875,6 +1100,10 @@ void shmem_transport_get(shmem_transport_ctx_t* ctx, void *target, const void *s
             frag_target += frag_len;
         }
     }
+
+    if (mr_entry)
+        shmem_transport_ofi_mr_cache_hold(ctx, mr_entry, 1,
+                                          SHMEM_TRANSPORT_OFI_CNTR_READ(&ctx->pending_get_cntr));
     SHMEM_TRANSPORT_OFI_CTX_UNLOCK(ctx);
 }
 
@@ -895,6 +1124,9 @@ void shmem_transport_get_wait(shmem_transport_ctx_t* ctx)
 
     SHMEM_TRANSPORT_OFI_CTX_LOCK(ctx);
 
+    if (ctx->rails)
+        shmem_transport_ofi_rail_get_wait(ctx);
+
     while (poll_count < shmem_transport_ofi_get_poll_limit ||
            shmem_transport_ofi_get_poll_limit < 0) {
         success = fi_cntr_read(ctx->get_cntr);
@@ -910,6 +1142,7 @@ void shmem_transport_get_wait(shmem_transport_ctx_t* ctx)
         } else if (fail) {
             RAISE_ERROR_MSG("Operations completed in error (%" PRIu64 ")\n", fail);
         } else {
+            shmem_transport_ofi_mr_complete(ctx, 1, cnt);
             SHMEM_TRANSPORT_OFI_CTX_UNLOCK(ctx);
             return;
         }
@@ -924,6 +1157,7 @@ void shmem_transport_get_wait(shmem_transport_ctx_t* ctx)
     } while (cnt < cnt_new);
     shmem_internal_assert(cnt == cnt_new);
 
+    shmem_transport_ofi_mr_complete(ctx, 1, cnt);
     SHMEM_TRANSPORT_OFI_CTX_UNLOCK(ctx);
 }
 
@@ -943,6 +1177,8 @@ void shmem_transport_cswap(shmem_transport_ctx_t* ctx, void *target, const void
     shmem_internal_assert(len <= sizeof(double _Complex));
     shmem_internal_assert(SHMEM_Dtsize[SHMEM_TRANSPORT_DTYPE(datatype)] == len);
 
+    shmem_transport_ofi_order_pe(ctx, pe);
+
     SHMEM_TRANSPORT_OFI_CTX_LOCK(ctx);
     SHMEM_TRANSPORT_OFI_CNTR_INC(&ctx->pending_get_cntr);
 
@@ -998,6 +1234,8 @@ void shmem_transport_cswap_nbi(shmem_transport_ctx_t* ctx, void *target, const
                                  .data          = 0
                                };
 
+    shmem_transport_ofi_order_pe(ctx, pe);
+
     SHMEM_TRANSPORT_OFI_CTX_LOCK(ctx);
     SHMEM_TRANSPORT_OFI_CNTR_INC(&ctx->pending_get_cntr);
 
@@ -1032,6 +1270,8 @@ void shmem_transport_mswap(shmem_transport_ctx_t* ctx, void *target, const void
     shmem_internal_assert(len <= sizeof(double _Complex));
     shmem_internal_assert(SHMEM_Dtsize[SHMEM_TRANSPORT_DTYPE(datatype)] == len);
 
+    shmem_transport_ofi_order_pe(ctx, pe);
+
     SHMEM_TRANSPORT_OFI_CTX_LOCK(ctx);
     SHMEM_TRANSPORT_OFI_CNTR_INC(&ctx->pending_get_cntr);
 
@@ -1069,8 +1309,11 @@ void shmem_transport_atomic(shmem_transport_ctx_t* ctx, void *target, const void
 
     shmem_internal_assert(SHMEM_Dtsize[SHMEM_TRANSPORT_DTYPE(datatype)] == len);
 
+    shmem_transport_ofi_order_pe(ctx, pe);
+
     SHMEM_TRANSPORT_OFI_CTX_LOCK(ctx);
     SHMEM_TRANSPORT_OFI_CNTR_INC(&ctx->pending_put_cntr);
+    shmem_transport_ofi_mark_pe(ctx, pe);
 
     do {
         ret = fi_inject_atomic(ctx->ep,
@@ -1102,6 +1345,8 @@ void shmem_transport_atomicv(shmem_transport_ctx_t* ctx, void *target, const voi
 
     shmem_internal_assert(SHMEM_Dtsize[dt] * len == full_len);
 
+    shmem_transport_ofi_order_pe(ctx, pe);
+
     SHMEM_TRANSPORT_OFI_CTX_LOCK(ctx);
     ret = fi_atomicvalid(ctx->ep, dt, op,
                          &max_atomic_size);
@@ -1121,6 +1366,7 @@ void shmem_transport_atomicv(shmem_transport_ctx_t* ctx, void *target, const voi
         polled = 0;
 
         SHMEM_TRANSPORT_OFI_CNTR_INC(&ctx->pending_put_cntr);
+        shmem_transport_ofi_mark_pe(ctx, pe);
 
         do {
             ret = fi_inject_atomic(ctx->ep,
@@ -1142,6 +1388,7 @@ void shmem_transport_atomicv(shmem_transport_ctx_t* ctx, void *target, const voi
 
         polled = 0;
         SHMEM_TRANSPORT_OFI_CNTR_INC(&ctx->pending_put_cntr);
+        shmem_transport_ofi_mark_pe(ctx, pe);
 
         const struct fi_ioc        msg_iov = { .addr = buff->data, .count = len };
         const struct fi_rma_ioc    rma_iov = { .addr = (uint64_t) addr, .count = len, .key = key };
@@ -1170,6 +1417,7 @@ void shmem_transport_atomicv(shmem_transport_ctx_t* ctx, void *target, const voi
                                    (max_atomic_size/SHMEM_Dtsize[dt]));
             polled = 0;
             SHMEM_TRANSPORT_OFI_CNTR_INC(&ctx->pending_put_cntr);
+            shmem_transport_ofi_mark_pe(ctx, pe);
             do {
                 ret = fi_atomic(ctx->ep,
                                 (void *)((char *)source +
@@ -1208,6 +1456,8 @@ void shmem_transport_fetch_atomic(shmem_transport_ctx_t* ctx, void *target,
     shmem_internal_assert(len <= sizeof(double _Complex));
     shmem_internal_assert(SHMEM_Dtsize[SHMEM_TRANSPORT_DTYPE(datatype)] == len);
 
+    shmem_transport_ofi_order_pe(ctx, pe);
+
     SHMEM_TRANSPORT_OFI_CTX_LOCK(ctx);
     SHMEM_TRANSPORT_OFI_CNTR_INC(&ctx->pending_get_cntr);
 
@@ -1263,6 +1513,8 @@ void shmem_transport_fetch_atomic_nbi(shmem_transport_ctx_t* ctx, void *target,
                                  .data          = 0
                                };
 
+    shmem_transport_ofi_order_pe(ctx, pe);
+
     SHMEM_TRANSPORT_OFI_CTX_LOCK(ctx);
     SHMEM_TRANSPORT_OFI_CNTR_INC(&ctx->pending_get_cntr);
 
@@ -1333,6 +1585,11 @@ int shmem_transport_atomic_supported(shm_internal_op_t op,
 #else
     size_t size = 0;
 
+    /* Providers have no half-precision atomics; these types are only reduced
+     * in software */
+    if (datatype == SHM_INTERNAL_FLOAT16 || datatype == SHM_INTERNAL_BFLOAT16)
+        return 0;
+
     /* NOTE-MT: It's not clear from the OFI documentation whether this mutex is
      * actually required by FI_THREAD_COMPLETION. */
 
@@ -1397,10 +1654,14 @@ static inline
 uint64_t shmem_transport_received_cntr_get(void)
 {
 #ifndef ENABLE_HARD_POLLING
-    shmem_internal_assert(shmem_internal_thread_level == SHMEM_THREAD_SINGLE);
-    /* NOTE-MT: This is only reachable in single-threaded runs, otherwise
-     * we would need a mutex to support FI_THREAD_COMPLETION builds. */
-    return fi_cntr_read(shmem_transport_ofi_target_cntrfd);
+    /* NOTE-MT: Blocking waits allow only one thread at a time to access the
+     * target counter, which FI_THREAD_COMPLETION builds require. */
+    uint64_t cnt = fi_cntr_read(shmem_transport_ofi_target_cntrfd);
+
+    if (shmem_transport_ofi_nrails > 1)
+        cnt += shmem_transport_ofi_rail_target_cntr_read();
+
+    return cnt;
 #else
     RAISE_ERROR_STR("OFI transport configured for hard polling");
     return 0;
@@ -1408,15 +1669,20 @@ uint64_t shmem_transport_received_cntr_get(void)
 }
 
 static inline
-void shmem_transport_received_cntr_wait(uint64_t ge_val)
+void shmem_transport_received_cntr_wait(uint64_t ge_val, int timeout_ms)
 {
 #ifndef ENABLE_HARD_POLLING
-    shmem_internal_assert(shmem_internal_thread_level == SHMEM_THREAD_SINGLE);
-    /* NOTE-MT: This is only reachable in single-threaded runs, otherwise
-     * we would need a mutex to support FI_THREAD_COMPLETION builds. */
-    int ret = fi_cntr_wait(shmem_transport_ofi_target_cntrfd, ge_val, -1);
+    /* NOTE-MT: See shmem_transport_received_cntr_get */
+    if (shmem_transport_ofi_nrails > 1) {
+        shmem_transport_ofi_rail_target_cntr_wait(ge_val, timeout_ms);
+        return;
+    }
+
+    int ret = fi_cntr_wait(shmem_transport_ofi_target_cntrfd, ge_val,
+                           timeout_ms < 0 ? -1 : timeout_ms);
 
-    OFI_CHECK_ERROR(ret);
+    if (ret != -FI_ETIMEDOUT)
+        OFI_CHECK_ERROR(ret);
 #else
     RAISE_ERROR_STR("OFI transport configured for hard polling");
 #endif
@@ -0,0 +1,607 @@
+/* -*- C -*-
+ *
+ * Copyright (c) 2017 Intel Corporation. All rights reserved.
+ * This software is available to you under the BSD license.
+ *
+ * This file is part of the Sandia OpenSHMEM software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+ *
+ */
+
+/* Registration cache for private (non-symmetric) local buffers.
+ *
+ * Entries cover page-aligned address ranges and are kept in an array sorted
+ * by base address, along with the running maximum of the entry end addresses.
+ * A lookup bisects to the last entry starting at or below the buffer and
+ * walks backward while the running maximum still covers the buffer.  Entries
+ * may overlap; they are not merged.  When the cache is full, the least
+ * recently used entry that is not held by an operation is evicted.
+ *
+ * The cached ranges are registered with a userfaultfd that reports unmap
+ * (including brk shrinking the heap), remove (madvise), and remap events.  A
+ * monitor thread invalidates the entries overlapping these ranges.  The
+ * kernel blocks the thread changing the mapping until the event is read, and
+ * events are read with the cache lock held, so a stale entry is never found
+ * after munmap returns.  For the same reason, no memory is allocated or
+ * released while the lock is held.
+ *
+ * Ranges are registered in write-protect mode without protecting any page,
+ * so page faults are not trapped.  Kernels without write-protect support
+ * only offer missing mode, where the first touch of each page faults to the
+ * monitor.  The monitor then stops tracking the page, which means its unmap
+ * would no longer be reported, so the entries covering it are invalidated. */
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <unistd.h>
+
+#define SHMEM_INTERNAL_INCLUDE
+#include "shmem.h"
+#include "shmem_internal.h"
+#include "transport_ofi.h"
+
+#if defined(ENABLE_THREADS) && defined(HAVE_LINUX_USERFAULTFD_H)
+#include <pthread.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/userfaultfd.h>
+
+#ifdef __NR_userfaultfd
+#define ENABLE_MR_CACHE 1
+#endif
+#endif
+
+size_t shmem_transport_ofi_mr_cache_threshold = SIZE_MAX;
+
+#ifdef ENABLE_MR_CACHE
+
+/* Requested keys of cache registrations, above the keys of the symmetric
+ * heap and data segments */
+#define MR_CACHE_KEY_BASE 16
+
+struct shmem_transport_ofi_mr_entry_t {
+    uintptr_t                               base;
+    uintptr_t                               end;
+    struct fid_mr                          *mr;
+    void                                   *desc;
+    long                                    refcnt;   /* Holds, plus one while cached */
+    uint64_t                                last_use;
+    struct shmem_transport_ofi_mr_entry_t  *next;     /* Close list */
+};
+
+struct shmem_transport_ofi_mr_hold_t {
+    shmem_transport_ofi_mr_entry_t         *entry;
+    uint64_t                                cnt;
+    int                                     is_get;
+    struct shmem_transport_ofi_mr_hold_t   *next;
+};
+typedef struct shmem_transport_ofi_mr_hold_t shmem_transport_ofi_mr_hold_t;
+
+static pthread_mutex_t mr_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static shmem_transport_ofi_mr_entry_t **mr_cache_entries = NULL;
+static uintptr_t *mr_cache_max_end = NULL;
+static size_t mr_cache_nentries = 0;
+static size_t mr_cache_size = 0;
+static uint64_t mr_cache_clock = 0;
+static uint64_t mr_cache_gen = 0;       /* Number of address space changes */
+static uint64_t mr_cache_key = MR_CACHE_KEY_BASE;
+static uintptr_t mr_cache_page_size;
+static int mr_cache_uffd = -1;
+static uint64_t mr_cache_reg_mode = UFFDIO_REGISTER_MODE_MISSING;
+static int mr_cache_pipe[2] = { -1, -1 };
+static pthread_t mr_cache_thread;
+
+static uint64_t mr_cache_hits = 0;
+static uint64_t mr_cache_misses = 0;
+static uint64_t mr_cache_evictions = 0;
+static uint64_t mr_cache_invalidations = 0;
+
+
+/* Number of entries whose base is at or below addr */
+static size_t mr_cache_upper_bound(uintptr_t addr)
+{
+    size_t lo = 0, hi = mr_cache_nentries;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (mr_cache_entries[mid]->base <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+static void mr_cache_update_max_end(size_t i)
+{
+    for ( ; i < mr_cache_nentries; i++) {
+        uintptr_t end = mr_cache_entries[i]->end;
+
+        if (i > 0 && mr_cache_max_end[i-1] > end)
+            end = mr_cache_max_end[i-1];
+        mr_cache_max_end[i] = end;
+    }
+}
+
+static void mr_cache_insert(shmem_transport_ofi_mr_entry_t *entry)
+{
+    size_t i = mr_cache_upper_bound(entry->base);
+
+    memmove(&mr_cache_entries[i+1], &mr_cache_entries[i],
+            (mr_cache_nentries - i) * sizeof(shmem_transport_ofi_mr_entry_t *));
+    mr_cache_entries[i] = entry;
+    mr_cache_nentries++;
+    entry->refcnt++;
+
+    mr_cache_update_max_end(i);
+}
+
+/* Remove entry i from the cache, adding it to the close list if it is not
+ * held by any operation */
+static void mr_cache_remove(size_t i, shmem_transport_ofi_mr_entry_t **close_list)
+{
+    shmem_transport_ofi_mr_entry_t *entry = mr_cache_entries[i];
+
+    memmove(&mr_cache_entries[i], &mr_cache_entries[i+1],
+            (mr_cache_nentries - i - 1) * sizeof(shmem_transport_ofi_mr_entry_t *));
+    mr_cache_nentries--;
+
+    mr_cache_update_max_end(i);
+
+    if (--entry->refcnt == 0) {
+        entry->next = *close_list;
+        *close_list = entry;
+    }
+}
+
+static shmem_transport_ofi_mr_entry_t *mr_cache_find(uintptr_t start, uintptr_t end)
+{
+    size_t i = mr_cache_upper_bound(start);
+
+    while (i > 0 && mr_cache_max_end[i-1] >= end) {
+        i--;
+        if (mr_cache_entries[i]->end >= end)
+            return mr_cache_entries[i];
+    }
+
+    return NULL;
+}
+
+static int mr_cache_evict(shmem_transport_ofi_mr_entry_t **close_list)
+{
+    size_t i, victim = SIZE_MAX;
+
+    for (i = 0; i < mr_cache_nentries; i++) {
+        if (mr_cache_entries[i]->refcnt == 1 &&
+            (victim == SIZE_MAX || mr_cache_entries[i]->last_use <
+                                   mr_cache_entries[victim]->last_use))
+            victim = i;
+    }
+
+    if (victim == SIZE_MAX)
+        return 0;
+
+    mr_cache_remove(victim, close_list);
+    mr_cache_evictions++;
+
+    return 1;
+}
+
+static void mr_cache_invalidate(uintptr_t start, uintptr_t end,
+                                shmem_transport_ofi_mr_entry_t **close_list)
+{
+    size_t i;
+
+    if (end <= start)
+        return;
+
+    i = mr_cache_upper_bound(end - 1);
+
+    while (i > 0 && mr_cache_max_end[i-1] > start) {
+        i--;
+        if (mr_cache_entries[i]->end > start) {
+            mr_cache_remove(i, close_list);
+            mr_cache_invalidations++;
+        }
+    }
+
+    mr_cache_gen++;
+}
+
+static void mr_cache_close(shmem_transport_ofi_mr_entry_t *close_list)
+{
+    while (close_list != NULL) {
+        shmem_transport_ofi_mr_entry_t *next = close_list->next;
+        int ret = fi_close(&close_list->mr->fid);
+
+        OFI_CHECK_ERROR_MSG(ret, "MR cache entry close failed (%s)\n", fi_strerror(errno));
+        free(close_list);
+        close_list = next;
+    }
+}
+
+static void mr_cache_process_events(void)
+{
+    struct uffd_msg msg;
+    shmem_transport_ofi_mr_entry_t *close_list = NULL;
+
+    pthread_mutex_lock(&mr_cache_lock);
+
+    while (read(mr_cache_uffd, &msg, sizeof(msg)) == sizeof(msg)) {
+        switch (msg.event) {
+            case UFFD_EVENT_PAGEFAULT:
+                {
+                    /* Only the address space is tracked; stop tracking the
+                     * page, drop the entries whose unmap would go unreported,
+                     * and let the kernel resolve the fault */
+                    struct uffdio_range range;
+
+                    range.start = msg.arg.pagefault.address & ~(mr_cache_page_size - 1);
+                    range.len   = mr_cache_page_size;
+                    mr_cache_invalidate(range.start, range.start + range.len, &close_list);
+                    ioctl(mr_cache_uffd, UFFDIO_UNREGISTER, &range);
+                    ioctl(mr_cache_uffd, UFFDIO_WAKE, &range);
+                }
+                break;
+            case UFFD_EVENT_UNMAP:
+            case UFFD_EVENT_REMOVE:
+                mr_cache_invalidate(msg.arg.remove.start, msg.arg.remove.end, &close_list);
+                break;
+            case UFFD_EVENT_REMAP:
+                mr_cache_invalidate(msg.arg.remap.from, msg.arg.remap.from + msg.arg.remap.len,
+                                    &close_list);
+                break;
+            default:
+                break;
+        }
+    }
+
+    pthread_mutex_unlock(&mr_cache_lock);
+
+    mr_cache_close(close_list);
+}
+
+static void * mr_cache_monitor_func(void *arg)
+{
+    struct pollfd fds[2];
+
+    fds[0].fd     = mr_cache_uffd;
+    fds[0].events = POLLIN;
+    fds[1].fd     = mr_cache_pipe[0];
+    fds[1].events = POLLIN;
+
+    for (;;) {
+        int ret = poll(fds, 2, -1);
+
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            RAISE_WARN_MSG("MR cache monitor poll failed (%s)\n", strerror(errno));
+            break;
+        }
+
+        if (fds[1].revents)
+            break;
+
+        if (fds[0].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+            RAISE_WARN_STR("MR cache monitor lost its userfaultfd");
+            break;
+        }
+
+        if (fds[0].revents & POLLIN)
+            mr_cache_process_events();
+    }
+
+    return NULL;
+}
+
+
+/* The API handshake is done once per userfaultfd, so the supported features
+ * are queried on a separate descriptor */
+static int mr_cache_wp_supported(void)
+{
+    struct uffdio_api api;
+    int fd, ret;
+
+    fd = syscall(__NR_userfaultfd, O_CLOEXEC | O_NONBLOCK);
+    if (fd < 0)
+        return 0;
+
+    memset(&api, 0, sizeof(api));
+    api.api = UFFD_API;
+
+    ret = ioctl(fd, UFFDIO_API, &api) == 0 &&
+          (api.features & UFFD_FEATURE_PAGEFAULT_FLAG_WP);
+
+    close(fd);
+    return ret;
+}
+
+
+int shmem_transport_ofi_mr_cache_init(void)
+{
+    struct uffdio_api api;
+    long size = shmem_internal_params.OFI_MR_CACHE_SIZE;
+    int ret;
+
+    if (size <= 0)
+        return 0;
+
+    mr_cache_page_size = (uintptr_t) sysconf(_SC_PAGESIZE);
+
+    mr_cache_uffd = syscall(__NR_userfaultfd, O_CLOEXEC | O_NONBLOCK);
+    if (mr_cache_uffd < 0) {
+        RAISE_WARN_MSG("Disabling the MR cache, userfaultfd is unavailable (%s)\n",
+                       strerror(errno));
+        return 0;
+    }
+
+    memset(&api, 0, sizeof(api));
+    api.api      = UFFD_API;
+    api.features = UFFD_FEATURE_EVENT_UNMAP | UFFD_FEATURE_EVENT_REMOVE |
+                   UFFD_FEATURE_EVENT_REMAP;
+    if (mr_cache_wp_supported()) {
+        api.features     |= UFFD_FEATURE_PAGEFAULT_FLAG_WP;
+        mr_cache_reg_mode = UFFDIO_REGISTER_MODE_WP;
+    } else {
+        DEBUG_STR("MR cache cannot use write-protect mode, first touches will fault");
+    }
+
+    if (ioctl(mr_cache_uffd, UFFDIO_API, &api)) {
+        RAISE_WARN_MSG("Disabling the MR cache, userfaultfd does not report unmap events (%s)\n",
+                       strerror(errno));
+        close(mr_cache_uffd);
+        mr_cache_uffd = -1;
+        return 0;
+    }
+
+    /* The entry table is allocated up front, since memory must not be
+     * allocated while the cache lock is held */
+    mr_cache_entries = malloc(size * sizeof(shmem_transport_ofi_mr_entry_t *));
+    mr_cache_max_end = malloc(size * sizeof(uintptr_t));
+    if (mr_cache_entries == NULL || mr_cache_max_end == NULL)
+        RAISE_ERROR_STR("Out of memory when allocating the MR cache");
+
+    if (pipe(mr_cache_pipe)) {
+        RAISE_WARN_MSG("Disabling the MR cache, monitor pipe creation failed (%s)\n",
+                       strerror(errno));
+        close(mr_cache_uffd);
+        mr_cache_uffd = -1;
+        return 0;
+    }
+
+    ret = pthread_create(&mr_cache_thread, NULL, &mr_cache_monitor_func, NULL);
+    if (ret) {
+        RAISE_WARN_MSG("Disabling the MR cache, monitor thread creation failed (%d)\n", ret);
+        close(mr_cache_pipe[0]);
+        close(mr_cache_pipe[1]);
+        close(mr_cache_uffd);
+        mr_cache_uffd = -1;
+        return 0;
+    }
+
+    mr_cache_size = (size_t) size;
+    shmem_transport_ofi_mr_cache_threshold = shmem_internal_params.OFI_MR_CACHE_THRESHOLD;
+
+    DEBUG_MSG("MR cache enabled, size = %zu, threshold = %zu\n",
+              mr_cache_size, shmem_transport_ofi_mr_cache_threshold);
+
+    return 0;
+}
+
+
+void shmem_transport_ofi_mr_cache_fini(void)
+{
+    shmem_transport_ofi_mr_entry_t *close_list = NULL;
+    ssize_t ret;
+
+    if (mr_cache_size == 0)
+        return;
+
+    shmem_transport_ofi_mr_cache_threshold = SIZE_MAX;
+
+    do {
+        ret = write(mr_cache_pipe[1], "", 1);
+    } while (ret < 0 && errno == EINTR);
+    pthread_join(mr_cache_thread, NULL);
+
+    pthread_mutex_lock(&mr_cache_lock);
+    while (mr_cache_nentries > 0)
+        mr_cache_remove(mr_cache_nentries - 1, &close_list);
+    pthread_mutex_unlock(&mr_cache_lock);
+
+    mr_cache_close(close_list);
+
+    DEBUG_MSG("MR cache: %" PRIu64 " hits, %" PRIu64 " misses, %" PRIu64
+              " evictions, %" PRIu64 " invalidations\n",
+              mr_cache_hits, mr_cache_misses, mr_cache_evictions,
+              mr_cache_invalidations);
+
+    free(mr_cache_entries);
+    free(mr_cache_max_end);
+    close(mr_cache_pipe[0]);
+    close(mr_cache_pipe[1]);
+    close(mr_cache_uffd);
+    mr_cache_size = 0;
+}
+
+
+shmem_transport_ofi_mr_entry_t *shmem_transport_ofi_mr_cache_acquire(const void *buf, size_t len,
+                                                                     void **desc)
+{
+    uintptr_t start = (uintptr_t) buf & ~(mr_cache_page_size - 1);
+    uintptr_t end = ((uintptr_t) buf + len + mr_cache_page_size - 1) & ~(mr_cache_page_size - 1);
+    shmem_transport_ofi_mr_entry_t *entry, *close_list = NULL;
+    struct uffdio_register reg;
+    uint64_t gen;
+    int ret;
+
+    pthread_mutex_lock(&mr_cache_lock);
+
+    entry = mr_cache_find(start, end);
+    if (entry != NULL) {
+        entry->refcnt++;
+        entry->last_use = ++mr_cache_clock;
+        mr_cache_hits++;
+        pthread_mutex_unlock(&mr_cache_lock);
+
+        *desc = entry->desc;
+        return entry;
+    }
+
+    mr_cache_misses++;
+    gen = mr_cache_gen;
+    pthread_mutex_unlock(&mr_cache_lock);
+
+    entry = malloc(sizeof(shmem_transport_ofi_mr_entry_t));
+    if (entry == NULL)
+        return NULL;
+
+    /* Track the range before registering it.  Memory that is unmapped after
+     * this point advances the generation count, and the entry is then used
+     * for this operation only. */
+    memset(&reg, 0, sizeof(reg));
+    reg.range.start = start;
+    reg.range.len   = end - start;
+    reg.mode        = mr_cache_reg_mode;
+
+    if (ioctl(mr_cache_uffd, UFFDIO_REGISTER, &reg)) {
+        DEBUG_MSG("MR cache cannot track [%p, %p) (%s)\n", (void *) start, (void *) end,
+                  strerror(errno));
+        free(entry);
+        return NULL;
+    }
+
+    ret = fi_mr_reg(shmem_transport_ofi_domainfd, (void *) start, end - start,
+                    FI_READ | FI_WRITE, 0,
+                    __atomic_fetch_add(&mr_cache_key, 1, __ATOMIC_RELAXED),
+                    0, &entry->mr, NULL);
+    if (ret) {
+        DEBUG_MSG("MR cache registration of [%p, %p) failed (%s)\n", (void *) start,
+                  (void *) end, fi_strerror(-ret));
+        free(entry);
+        return NULL;
+    }
+
+    entry->base   = start;
+    entry->end    = end;
+    entry->desc   = fi_mr_desc(entry->mr);
+    entry->refcnt = 1;
+    entry->next   = NULL;
+
+    pthread_mutex_lock(&mr_cache_lock);
+
+    entry->last_use = ++mr_cache_clock;
+
+    if (gen == mr_cache_gen &&
+        (mr_cache_nentries < mr_cache_size || mr_cache_evict(&close_list)))
+        mr_cache_insert(entry);
+
+    pthread_mutex_unlock(&mr_cache_lock);
+
+    mr_cache_close(close_list);
+
+    *desc = entry->desc;
+    return entry;
+}
+
+
+void shmem_transport_ofi_mr_cache_hold(shmem_transport_ctx_t *ctx,
+                                       shmem_transport_ofi_mr_entry_t *entry,
+                                       int is_get, uint64_t cnt)
+{
+    shmem_transport_ofi_mr_hold_t *hold = malloc(sizeof(shmem_transport_ofi_mr_hold_t));
+
+    if (hold == NULL)
+        RAISE_ERROR_STR("Out of memory when allocating MR cache hold");
+
+    hold->entry  = entry;
+    hold->cnt    = cnt;
+    hold->is_get = is_get;
+
+    pthread_mutex_lock(&mr_cache_lock);
+    hold->next = ctx->mr_holds;
+    __atomic_store_n(&ctx->mr_holds, hold, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&mr_cache_lock);
+}
+
+
+void shmem_transport_ofi_mr_cache_release(shmem_transport_ctx_t *ctx, int is_get, uint64_t cnt)
+{
+    shmem_transport_ofi_mr_hold_t **prev, *hold, *done = NULL;
+    shmem_transport_ofi_mr_entry_t *close_list = NULL;
+
+    pthread_mutex_lock(&mr_cache_lock);
+
+    prev = &ctx->mr_holds;
+    while ((hold = *prev) != NULL) {
+        if (hold->is_get == is_get && hold->cnt <= cnt) {
+            __atomic_store_n(prev, hold->next, __ATOMIC_RELAXED);
+
+            if (--hold->entry->refcnt == 0) {
+                hold->entry->next = close_list;
+                close_list = hold->entry;
+            }
+
+            hold->next = done;
+            done = hold;
+        } else {
+            prev = &hold->next;
+        }
+    }
+
+    pthread_mutex_unlock(&mr_cache_lock);
+
+    while (done != NULL) {
+        hold = done->next;
+        free(done);
+        done = hold;
+    }
+
+    mr_cache_close(close_list);
+}
+
+#else /* !ENABLE_MR_CACHE */
+
+int shmem_transport_ofi_mr_cache_init(void)
+{
+    if (shmem_internal_params.OFI_MR_CACHE_SIZE > 0)
+        RAISE_WARN_STR("Ignoring SHMEM_OFI_MR_CACHE_SIZE, userfaultfd or threading support is unavailable");
+
+    return 0;
+}
+
+void shmem_transport_ofi_mr_cache_fini(void)
+{
+    return;
+}
+
+shmem_transport_ofi_mr_entry_t *shmem_transport_ofi_mr_cache_acquire(const void *buf, size_t len,
+                                                                     void **desc)
+{
+    *desc = NULL;
+    return NULL;
+}
+
+void shmem_transport_ofi_mr_cache_hold(shmem_transport_ctx_t *ctx,
+                                       shmem_transport_ofi_mr_entry_t *entry,
+                                       int is_get, uint64_t cnt)
+{
+    return;
+}
+
+void shmem_transport_ofi_mr_cache_release(shmem_transport_ctx_t *ctx, int is_get, uint64_t cnt)
+{
+    return;
+}
+
+#endif /* ENABLE_MR_CACHE */
@@ -0,0 +1,936 @@
+/* -*- C -*-
+ *
+ * Copyright (c) 2017 Intel Corporation. All rights reserved.
+ * This software is available to you under the BSD license.
+ *
+ * This file is part of the Sandia OpenSHMEM software package. For license
+ * information, see the LICENSE file in the top level directory of the
+ * distribution.
+ *
+ */
+
+/* Multi-rail support for the OFI transport.
+ *
+ * The primary rail is the fabric, domain, and endpoints set up in
+ * transport_ofi.c.  Each additional rail opens another domain of the same
+ * provider with its own address vector, target endpoint, and registrations
+ * of the symmetric heap and data segment, and each context opens an endpoint
+ * and completion counters on every rail.  Remote addresses are the same on
+ * all rails, since the rails share the memory registration mode of the
+ * primary rail; only the keys differ.
+ *
+ * Operations on the additional rails are tracked by per-rail pending
+ * counters in the context, and the put quiet and get wait of the context
+ * wait for all rails. */
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <sys/param.h>
+
+#define SHMEM_INTERNAL_INCLUDE
+#include "shmem.h"
+#include "shmem_internal.h"
+#include "transport_ofi.h"
+#include "runtime.h"
+
+/* Interval at which a blocking wait on the received operations counter
+ * rechecks the target counters of the additional rails */
+#define RAIL_TARGET_WAIT_MS 1
+
+struct shmem_transport_ofi_rail_t {
+    struct fi_info     *info;
+    struct fi_info     *tx_info;        /* Attributes of context endpoints */
+    struct fid_fabric  *fabric;
+    struct fid_domain  *domain;
+    struct fid_av      *av;
+    struct fid_ep      *target_ep;
+    struct fid_cq      *target_cq;
+#if ENABLE_TARGET_CNTR
+    struct fid_cntr    *target_cntr;
+#endif
+#if defined(ENABLE_MR_SCALABLE) && defined(ENABLE_REMOTE_VIRTUAL_ADDRESSING)
+    struct fid_mr      *mr;
+#else
+    struct fid_mr      *heap_mr;
+    struct fid_mr      *data_mr;
+#endif
+#ifndef ENABLE_MR_SCALABLE
+    uint64_t           *heap_keys;
+    uint64_t           *data_keys;
+#endif
+#ifdef USE_AV_MAP
+    fi_addr_t          *addr_table;
+#endif
+    size_t              addrlen;
+    size_t              max_msg_size;
+    uint64_t            bytes;          /* Bytes issued by destroyed contexts */
+};
+typedef struct shmem_transport_ofi_rail_t shmem_transport_ofi_rail_t;
+
+struct shmem_transport_ofi_rail_ctx_t {
+    struct fid_ep                  *ep;
+    struct fid_cntr                *put_cntr;
+    struct fid_cntr                *get_cntr;
+    struct fid_cq                  *cq;
+#ifdef USE_CTX_LOCK
+    uint64_t                        pending_put_cntr;
+    uint64_t                        pending_get_cntr;
+#else
+    shmem_internal_cntr_t           pending_put_cntr;
+    shmem_internal_cntr_t           pending_get_cntr;
+#endif
+    uint64_t                        bytes;
+};
+typedef struct shmem_transport_ofi_rail_ctx_t shmem_transport_ofi_rail_ctx_t;
+
+/* Bytes issued on each rail are only counted for the SHMEM_DEBUG report at
+ * finalize.  Counts are kept in the context (entry 0 holds the primary rail)
+ * and added to the rail when the context is destroyed. */
+#define RAIL_COUNT_BYTES(ctx, idx, len)                                 \
+    do {                                                                \
+        if (shmem_internal_params.DEBUG)                                \
+            __atomic_fetch_add(&(ctx)->rails[(idx)].bytes, (len),       \
+                               __ATOMIC_RELAXED);                       \
+    } while (0)
+
+#ifdef USE_AV_MAP
+#define RAIL_DEST(rail, pe) (shmem_transport_ofi_rails[(rail)].addr_table[(pe)])
+#else
+#define RAIL_DEST(rail, pe) ((fi_addr_t)(pe))
+#endif
+
+int shmem_transport_ofi_nrails = 1;
+
+static shmem_transport_ofi_rail_t *shmem_transport_ofi_rails = NULL;
+static int shmem_transport_ofi_rails_found = 1;
+static size_t shmem_transport_ofi_rail_stripe_size;
+
+
+static void rail_close_fid(struct fid *fid, const char *name)
+{
+    int ret = fi_close(fid);
+
+    if (ret)
+        RAISE_WARN_MSG("Rail %s close failed (%s)\n", name, fi_strerror(-ret));
+}
+
+static void rail_close(shmem_transport_ofi_rail_t *rail)
+{
+    if (rail->target_ep) rail_close_fid(&rail->target_ep->fid, "target endpoint");
+    if (rail->target_cq) rail_close_fid(&rail->target_cq->fid, "target CQ");
+#if defined(ENABLE_MR_SCALABLE) && defined(ENABLE_REMOTE_VIRTUAL_ADDRESSING)
+    if (rail->mr) rail_close_fid(&rail->mr->fid, "MR");
+#else
+    if (rail->heap_mr) rail_close_fid(&rail->heap_mr->fid, "heap MR");
+    if (rail->data_mr) rail_close_fid(&rail->data_mr->fid, "data MR");
+#endif
+#if ENABLE_TARGET_CNTR
+    if (rail->target_cntr) rail_close_fid(&rail->target_cntr->fid, "target CNTR");
+#endif
+    if (rail->av) rail_close_fid(&rail->av->fid, "AV");
+    if (rail->domain) rail_close_fid(&rail->domain->fid, "domain");
+    if (rail->fabric) rail_close_fid(&rail->fabric->fid, "fabric");
+    if (rail->info) fi_freeinfo(rail->info);
+    if (rail->tx_info) fi_freeinfo(rail->tx_info);
+#ifndef ENABLE_MR_SCALABLE
+    free(rail->heap_keys);
+    free(rail->data_keys);
+#endif
+#ifdef USE_AV_MAP
+    free(rail->addr_table);
+#endif
+
+    memset(rail, 0, sizeof(shmem_transport_ofi_rail_t));
+}
+
+/* A domain can serve as an additional rail if it belongs to the provider of
+ * the primary rail, uses the same memory registration mode, and is not
+ * already in use */
+static int rail_is_candidate(struct fi_info *cur, struct fi_info *primary, int nfound)
+{
+    int i;
+
+    if (strcmp(cur->fabric_attr->prov_name, primary->fabric_attr->prov_name) != 0)
+        return 0;
+
+    if (cur->domain_attr->mr_mode != primary->domain_attr->mr_mode)
+        return 0;
+
+    if (cur->tx_attr->inject_size < shmem_transport_ofi_max_buffered_send ||
+        cur->ep_attr->max_msg_size == 0)
+        return 0;
+
+    if (strcmp(cur->domain_attr->name, primary->domain_attr->name) == 0)
+        return 0;
+
+    for (i = 1; i < nfound; i++)
+        if (strcmp(cur->domain_attr->name, shmem_transport_ofi_rails[i].info->domain_attr->name) == 0)
+            return 0;
+
+    return 1;
+}
+
+/* Open the domain and target resources of a rail, as done for the primary
+ * rail by allocate_fabric_resources and shmem_transport_ofi_target_ep_init */
+static int rail_open(shmem_transport_ofi_rail_t *rail, struct fi_info *cur)
+{
+    struct fi_av_attr av_attr = {0};
+    struct fi_cq_attr cq_attr = {0};
+    struct fi_info *info;
+    uint64_t flags = 0;
+    int ret;
+
+    rail->info = info = fi_dupinfo(cur);
+    if (info == NULL)
+        return -FI_ENOMEM;
+
+#if defined(ENABLE_MR_SCALABLE) && defined(ENABLE_REMOTE_VIRTUAL_ADDRESSING)
+    info->domain_attr->mr_key_size = 0;
+#else
+    if (info->domain_attr->mr_mode & FI_MR_PROV_KEY)
+        info->domain_attr->mr_key_size = 1;
+    else
+        info->domain_attr->mr_key_size = 0;
+#endif
+
+    rail->max_msg_size = info->ep_attr->max_msg_size;
+
+    ret = fi_fabric(info->fabric_attr, &rail->fabric, NULL);
+    if (ret) return ret;
+
+    ret = fi_domain(rail->fabric, info, &rail->domain, NULL);
+    if (ret) return ret;
+
+#ifdef USE_AV_MAP
+    av_attr.type = FI_AV_MAP;
+    rail->addr_table = malloc(shmem_internal_num_pes * sizeof(fi_addr_t));
+    if (rail->addr_table == NULL)
+        return -FI_ENOMEM;
+#else
+    av_attr.type = FI_AV_TABLE;
+#endif
+
+    ret = fi_av_open(rail->domain, &av_attr, &rail->av, NULL);
+    if (ret) return ret;
+
+    info->ep_attr->tx_ctx_cnt = 0;
+    info->caps = FI_RMA | FI_REMOTE_READ | FI_REMOTE_WRITE;
+#if ENABLE_TARGET_CNTR
+    info->caps |= FI_RMA_EVENT;
+#endif
+    info->tx_attr->op_flags = 0;
+    info->mode = 0;
+    info->tx_attr->mode = 0;
+    info->rx_attr->mode = 0;
+
+    ret = fi_endpoint(rail->domain, info, &rail->target_ep, NULL);
+    if (ret) return ret;
+
+    /* Context endpoints are opened with these attributes, so that creating
+     * a context does not modify the shared rail state */
+    rail->tx_info = fi_dupinfo(info);
+    if (rail->tx_info == NULL)
+        return -FI_ENOMEM;
+
+    rail->tx_info->ep_attr->tx_ctx_cnt = 0;
+    rail->tx_info->caps = FI_RMA | FI_WRITE | FI_READ;
+    rail->tx_info->tx_attr->op_flags = FI_DELIVERY_COMPLETE;
+
+    ret = fi_ep_bind(rail->target_ep, &rail->av->fid, 0);
+    if (ret) return ret;
+
+#if ENABLE_TARGET_CNTR
+    {
+        struct fi_cntr_attr cntr_attr = {0};
+
+        cntr_attr.events   = FI_CNTR_EVENTS_COMP;
+        cntr_attr.wait_obj = FI_WAIT_UNSPEC;
+
+        ret = fi_cntr_open(rail->domain, &cntr_attr, &rail->target_cntr, NULL);
+        if (ret) return ret;
+
+#ifdef ENABLE_MR_RMA_EVENT
+        if (shmem_transport_ofi_mr_rma_event)
+            flags |= FI_RMA_EVENT;
+#endif
+    }
+#endif
+
+#if defined(ENABLE_MR_SCALABLE) && defined(ENABLE_REMOTE_VIRTUAL_ADDRESSING)
+    ret = fi_mr_reg(rail->domain, 0, UINT64_MAX, FI_REMOTE_READ | FI_REMOTE_WRITE,
+                    0, 0ULL, flags, &rail->mr, NULL);
+    if (ret) return ret;
+
+#if ENABLE_TARGET_CNTR
+    ret = fi_mr_bind(rail->mr, &rail->target_cntr->fid, FI_REMOTE_WRITE);
+    if (ret) return ret;
+
+#ifdef ENABLE_MR_RMA_EVENT
+    if (shmem_transport_ofi_mr_rma_event) {
+        ret = fi_mr_enable(rail->mr);
+        if (ret) return ret;
+    }
+#endif
+#endif
+
+#else
+    /* Same keys as the primary rail */
+    ret = fi_mr_reg(rail->domain, shmem_internal_heap_base, shmem_internal_heap_length,
+                    FI_REMOTE_READ | FI_REMOTE_WRITE, 0, 1ULL, flags, &rail->heap_mr, NULL);
+    if (ret) return ret;
+
+    ret = fi_mr_reg(rail->domain, shmem_internal_data_base, shmem_internal_data_length,
+                    FI_REMOTE_READ | FI_REMOTE_WRITE, 0, 0ULL, flags, &rail->data_mr, NULL);
+    if (ret) return ret;
+
+#if ENABLE_TARGET_CNTR
+    ret = fi_mr_bind(rail->heap_mr, &rail->target_cntr->fid, FI_REMOTE_WRITE);
+    if (ret) return ret;
+
+    ret = fi_mr_bind(rail->data_mr, &rail->target_cntr->fid, FI_REMOTE_WRITE);
+    if (ret) return ret;
+
+#ifdef ENABLE_MR_RMA_EVENT
+    if (shmem_transport_ofi_mr_rma_event) {
+        ret = fi_mr_enable(rail->heap_mr);
+        if (ret) return ret;
+
+        ret = fi_mr_enable(rail->data_mr);
+        if (ret) return ret;
+    }
+#endif
+#endif
+#endif
+
+    ret = fi_cq_open(rail->domain, &cq_attr, &rail->target_cq, NULL);
+    if (ret) return ret;
+
+    ret = fi_ep_bind(rail->target_ep, &rail->target_cq->fid, FI_RECV);
+    if (ret) return ret;
+
+    return fi_enable(rail->target_ep);
+}
+
+static int rail_publish(int idx)
+{
+    shmem_transport_ofi_rail_t *rail = &shmem_transport_ofi_rails[idx];
+    char   name[32];
+    char   epname[128];
+    size_t epnamelen = sizeof(epname);
+    int    ret;
+
+    ret = fi_getname(&rail->target_ep->fid, epname, &epnamelen);
+    if (ret != 0 || epnamelen > sizeof(epname)) {
+        RAISE_WARN_STR("fi_getname failed on rail target endpoint");
+        return 1;
+    }
+    rail->addrlen = epnamelen;
+
+    snprintf(name, sizeof(name), "fi_rail%d_epname", idx);
+    ret = shmem_runtime_put(name, epname, epnamelen);
+    OFI_CHECK_RETURN_STR(ret, "shmem_runtime_put of rail epname failed");
+
+#ifndef ENABLE_MR_SCALABLE
+    {
+        uint64_t heap_key, data_key;
+
+        if (rail->info->domain_attr->mr_mode & FI_MR_PROV_KEY) {
+            heap_key = fi_mr_key(rail->heap_mr);
+            data_key = fi_mr_key(rail->data_mr);
+        } else {
+            heap_key = 1ULL;
+            data_key = 0ULL;
+        }
+
+        snprintf(name, sizeof(name), "fi_rail%d_heap_key", idx);
+        ret = shmem_runtime_put(name, &heap_key, sizeof(uint64_t));
+        OFI_CHECK_RETURN_STR(ret, "Put of rail heap key to runtime KVS failed");
+
+        snprintf(name, sizeof(name), "fi_rail%d_data_key", idx);
+        ret = shmem_runtime_put(name, &data_key, sizeof(uint64_t));
+        OFI_CHECK_RETURN_STR(ret, "Put of rail data segment key to runtime KVS failed");
+    }
+#endif
+
+    return 0;
+}
+
+static int rail_populate(int idx)
+{
+    shmem_transport_ofi_rail_t *rail = &shmem_transport_ofi_rails[idx];
+    char  name[32];
+    char *alladdrs;
+    int   i, ret;
+
+    alladdrs = malloc(shmem_internal_num_pes * rail->addrlen);
+    if (alladdrs == NULL) {
+        RAISE_WARN_STR("Out of memory allocating rail addresses");
+        return 1;
+    }
+
+    snprintf(name, sizeof(name), "fi_rail%d_epname", idx);
+    for (i = 0; i < shmem_internal_num_pes; i++) {
+        ret = shmem_runtime_get(i, name, alladdrs + i * rail->addrlen, rail->addrlen);
+        if (ret != 0)
+            RAISE_ERROR_MSG("Runtime get of '%s' failed\n", name);
+    }
+
+#ifdef USE_AV_MAP
+    ret = fi_av_insert(rail->av, alladdrs, shmem_internal_num_pes, rail->addr_table, 0, NULL);
+#else
+    ret = fi_av_insert(rail->av, alladdrs, shmem_internal_num_pes, NULL, 0, NULL);
+#endif
+    free(alladdrs);
+
+    if (ret != shmem_internal_num_pes) {
+        RAISE_WARN_STR("Rail av insert failed");
+        return 1;
+    }
+
+#ifndef ENABLE_MR_SCALABLE
+    rail->heap_keys = malloc(sizeof(uint64_t) * shmem_internal_num_pes);
+    rail->data_keys = malloc(sizeof(uint64_t) * shmem_internal_num_pes);
+    if (rail->heap_keys == NULL || rail->data_keys == NULL) {
+        RAISE_WARN_STR("Out of memory allocating rail keytables");
+        return 1;
+    }
+
+    for (i = 0; i < shmem_internal_num_pes; i++) {
+        snprintf(name, sizeof(name), "fi_rail%d_heap_key", idx);
+        ret = shmem_runtime_get(i, name, &rail->heap_keys[i], sizeof(uint64_t));
+        OFI_CHECK_RETURN_STR(ret, "Get of rail heap key from runtime KVS failed");
+
+        snprintf(name, sizeof(name), "fi_rail%d_data_key", idx);
+        ret = shmem_runtime_get(i, name, &rail->data_keys[i], sizeof(uint64_t));
+        OFI_CHECK_RETURN_STR(ret, "Get of rail data segment key from runtime KVS failed");
+    }
+#endif
+
+    return 0;
+}
+
+
+int shmem_transport_ofi_rails_init(struct fi_info *fabrics, struct fi_info *primary)
+{
+    long want = shmem_internal_params.OFI_RAILS;
+    struct fi_info *cur;
+    int ret;
+
+#if WANT_TOTAL_DATA_ORDERING != 0
+    if (want > 1) {
+        RAISE_WARN_STR("Ignoring SHMEM_OFI_RAILS, total data ordering requires a single rail");
+        want = 1;
+    }
+#endif
+
+    if (want < 1) want = 1;
+
+    shmem_transport_ofi_rails = calloc(want, sizeof(shmem_transport_ofi_rail_t));
+    if (shmem_transport_ofi_rails == NULL)
+        RAISE_ERROR_STR("Out of memory when allocating OFI rails");
+
+    shmem_transport_ofi_rails[0].max_msg_size = shmem_transport_ofi_max_msg_size;
+    shmem_transport_ofi_rails_found = 1;
+
+    for (cur = fabrics; cur != NULL && shmem_transport_ofi_rails_found < want; cur = cur->next) {
+        shmem_transport_ofi_rail_t *rail = &shmem_transport_ofi_rails[shmem_transport_ofi_rails_found];
+
+        if (!rail_is_candidate(cur, primary, shmem_transport_ofi_rails_found))
+            continue;
+
+        ret = rail_open(rail, cur);
+        if (ret) {
+            RAISE_WARN_MSG("Cannot use OFI domain %s as a rail (%s)\n",
+                           cur->domain_attr->name, fi_strerror(-ret));
+            rail_close(rail);
+            continue;
+        }
+
+        ret = rail_publish(shmem_transport_ofi_rails_found);
+        if (ret) return ret;
+
+        shmem_transport_ofi_rails_found++;
+    }
+
+    if (shmem_transport_ofi_rails_found < want)
+        RAISE_WARN_MSG("Found %d of %ld requested OFI rails\n",
+                       shmem_transport_ofi_rails_found, want);
+
+    ret = shmem_runtime_put("fi_nrails", &shmem_transport_ofi_rails_found, sizeof(int));
+    OFI_CHECK_RETURN_STR(ret, "shmem_runtime_put fi_nrails failed");
+
+    return 0;
+}
+
+
+int shmem_transport_ofi_rails_startup(void)
+{
+    int nrails = shmem_transport_ofi_rails_found;
+    int i, ret;
+
+    if (nrails <= 1)
+        return 0;
+
+    /* Every PE must use the same rails */
+    for (i = 0; i < shmem_internal_num_pes && nrails > 1; i++) {
+        int peer_nrails;
+
+        ret = shmem_runtime_get(i, "fi_nrails", &peer_nrails, sizeof(int));
+        OFI_CHECK_RETURN_STR(ret, "Runtime get of 'fi_nrails' failed");
+
+        nrails = MIN(nrails, peer_nrails);
+    }
+
+    for (i = nrails; i < shmem_transport_ofi_rails_found; i++)
+        rail_close(&shmem_transport_ofi_rails[i]);
+    shmem_transport_ofi_rails_found = nrails;
+
+    for (i = 1; i < nrails; i++) {
+        ret = rail_populate(i);
+        if (ret) return ret;
+    }
+
+    shmem_transport_ofi_rail_stripe_size = shmem_internal_params.OFI_RAIL_STRIPE_SIZE;
+    if (shmem_transport_ofi_rail_stripe_size == 0)
+        shmem_transport_ofi_rail_stripe_size = 1;
+
+    shmem_transport_ofi_nrails = nrails;
+
+    DEBUG_MSG("Using %d OFI rails, stripe size %zu\n", nrails,
+              shmem_transport_ofi_rail_stripe_size);
+
+    return 0;
+}
+
+
+void shmem_transport_ofi_rails_fini(void)
+{
+    int i;
+
+    if (shmem_transport_ofi_rails == NULL)
+        return;
+
+    for (i = 0; i < shmem_transport_ofi_rails_found; i++) {
+        if (shmem_transport_ofi_nrails > 1)
+            DEBUG_MSG("Rail %d (%s): %" PRIu64 " bytes\n", i,
+                      i == 0 ? "primary" : shmem_transport_ofi_rails[i].info->domain_attr->name,
+                      shmem_transport_ofi_rails[i].bytes);
+        if (i > 0)
+            rail_close(&shmem_transport_ofi_rails[i]);
+    }
+
+    free(shmem_transport_ofi_rails);
+    shmem_transport_ofi_rails = NULL;
+    shmem_transport_ofi_nrails = 1;
+}
+
+
+int shmem_transport_ofi_rail_ctx_init(shmem_transport_ctx_t *ctx)
+{
+    struct fi_cntr_attr cntr_attr = {0};
+    struct fi_cq_attr cq_attr = {0};
+    int i, ret;
+
+    if (shmem_transport_ofi_nrails <= 1)
+        return 0;
+
+    ctx->rails = calloc(shmem_transport_ofi_nrails, sizeof(shmem_transport_ofi_rail_ctx_t));
+    if (ctx->rails == NULL)
+        RAISE_ERROR_STR("Out of memory when allocating OFI rail endpoints");
+
+    cntr_attr.events   = FI_CNTR_EVENTS_COMP;
+    cntr_attr.wait_obj = FI_WAIT_UNSPEC;
+    cq_attr.format     = FI_CQ_FORMAT_CONTEXT;
+
+    for (i = 1; i < shmem_transport_ofi_nrails; i++) {
+        shmem_transport_ofi_rail_t *rail = &shmem_transport_ofi_rails[i];
+        shmem_transport_ofi_rail_ctx_t *rctx = &ctx->rails[i];
+
+#ifndef USE_CTX_LOCK
+        shmem_internal_cntr_write(&rctx->pending_put_cntr, 0);
+        shmem_internal_cntr_write(&rctx->pending_get_cntr, 0);
+#endif
+
+        ret = fi_cntr_open(rail->domain, &cntr_attr, &rctx->put_cntr, NULL);
+        OFI_CHECK_RETURN_MSG(ret, "Rail put_cntr creation failed (%s)\n", fi_strerror(-ret));
+
+        ret = fi_cntr_open(rail->domain, &cntr_attr, &rctx->get_cntr, NULL);
+        OFI_CHECK_RETURN_MSG(ret, "Rail get_cntr creation failed (%s)\n", fi_strerror(-ret));
+
+        ret = fi_cq_open(rail->domain, &cq_attr, &rctx->cq, NULL);
+        OFI_CHECK_RETURN_MSG(ret, "Rail cq_open failed (%s)\n", fi_strerror(-ret));
+
+        ret = fi_endpoint(rail->domain, rail->tx_info, &rctx->ep, NULL);
+        OFI_CHECK_RETURN_MSG(ret, "Rail ep creation failed (%s)\n", fi_strerror(-ret));
+
+        ret = fi_ep_bind(rctx->ep, &rctx->put_cntr->fid, FI_WRITE);
+        OFI_CHECK_RETURN_STR(ret, "fi_ep_bind put CNTR to rail endpoint failed");
+
+        ret = fi_ep_bind(rctx->ep, &rctx->get_cntr->fid, FI_READ);
+        OFI_CHECK_RETURN_STR(ret, "fi_ep_bind get CNTR to rail endpoint failed");
+
+        ret = fi_ep_bind(rctx->ep, &rctx->cq->fid,
+                         FI_SELECTIVE_COMPLETION | FI_TRANSMIT | FI_RECV);
+        OFI_CHECK_RETURN_STR(ret, "fi_ep_bind CQ to rail endpoint failed");
+
+        ret = fi_ep_bind(rctx->ep, &rail->av->fid, 0);
+        OFI_CHECK_RETURN_STR(ret, "fi_ep_bind AV to rail endpoint failed");
+
+        ret = fi_enable(rctx->ep);
+        OFI_CHECK_RETURN_STR(ret, "fi_enable on rail endpoint failed");
+    }
+
+    return 0;
+}
+
+
+void shmem_transport_ofi_rail_ctx_fini(shmem_transport_ctx_t *ctx)
+{
+    int i;
+
+    if (ctx->rails == NULL)
+        return;
+
+    for (i = 0; i < shmem_transport_ofi_nrails; i++)
+        __atomic_fetch_add(&shmem_transport_ofi_rails[i].bytes, ctx->rails[i].bytes,
+                           __ATOMIC_RELAXED);
+
+    for (i = 1; i < shmem_transport_ofi_nrails; i++) {
+        shmem_transport_ofi_rail_ctx_t *rctx = &ctx->rails[i];
+
+        if (rctx->ep) rail_close_fid(&rctx->ep->fid, "context endpoint");
+        if (rctx->put_cntr) rail_close_fid(&rctx->put_cntr->fid, "context put CNTR");
+        if (rctx->get_cntr) rail_close_fid(&rctx->get_cntr->fid, "context get CNTR");
+        if (rctx->cq) rail_close_fid(&rctx->cq->fid, "context CQ");
+    }
+
+    free(ctx->rails);
+    ctx->rails = NULL;
+}
+
+
+static inline
+int rail_try_again(shmem_transport_ofi_rail_ctx_t *rctx, int ret, uint64_t *polled)
+{
+    if (ret == 0)
+        return 0;
+
+    if (ret == -FI_EAGAIN) {
+        struct fi_cq_err_entry e = {0};
+        ssize_t err = fi_cq_readerr(rctx->cq, (void *) &e, 0);
+
+        if (err == 1)
+            RAISE_ERROR_MSG("Error in rail operation: %s\n",
+                            fi_cq_strerror(rctx->cq, e.prov_errno, e.err_data, NULL, 0));
+
+        shmem_transport_probe();
+
+        (*polled)++;
+        if ((*polled) <= shmem_transport_ofi_max_poll)
+            return 1;
+
+        RAISE_ERROR_MSG("Operation retry limit exceeded (%" PRIu64 ")\n",
+                        shmem_transport_ofi_max_poll);
+    }
+
+    RAISE_ERROR_MSG("Rail operation failed (%s)\n", fi_strerror(-ret));
+    return 0;
+}
+
+/* Symmetric addresses that can be accessed through the additional rails */
+static inline
+int rail_is_eligible(const void *addr)
+{
+#if !defined(ENABLE_MR_SCALABLE) || !defined(ENABLE_REMOTE_VIRTUAL_ADDRESSING)
+    /* The atomics partition is only registered on the primary rail */
+    if (SHMEM_TRANSPORT_OFI_IN_ATOMICS_MR(addr))
+        return 0;
+#endif
+    return 1;
+}
+
+static inline
+void rail_get_mr(int idx, const void *addr, int pe, uint8_t **mr_addr, uint64_t *key)
+{
+    shmem_transport_ofi_get_mr(addr, pe, mr_addr, key);
+
+#ifndef ENABLE_MR_SCALABLE
+    if ((void *) addr >= shmem_internal_data_base &&
+        (uint8_t *) addr < (uint8_t *) shmem_internal_data_base + shmem_internal_data_length)
+        *key = shmem_transport_ofi_rails[idx].data_keys[pe];
+    else
+        *key = shmem_transport_ofi_rails[idx].heap_keys[pe];
+#endif
+}
+
+static void rail_write(shmem_transport_ctx_t *ctx, int idx, uint8_t *target,
+                       const uint8_t *source, size_t len, int pe)
+{
+    shmem_transport_ofi_rail_ctx_t *rctx = &ctx->rails[idx];
+    size_t max_msg_size = shmem_transport_ofi_rails[idx].max_msg_size;
+    uint64_t key;
+    uint8_t *addr;
+    int ret;
+
+    rail_get_mr(idx, target, pe, &addr, &key);
+
+    SHMEM_TRANSPORT_OFI_CTX_LOCK(ctx);
+    while (len > 0) {
+        size_t frag_len = MIN(len, max_msg_size);
+        uint64_t polled = 0;
+
+        SHMEM_TRANSPORT_OFI_CNTR_INC(&rctx->pending_put_cntr);
+        shmem_transport_ofi_mark_pe(ctx, pe);
+
+        do {
+            ret = fi_write(rctx->ep, source, frag_len, NULL, RAIL_DEST(idx, pe),
+                           (uint64_t) addr, key, NULL);
+        } while (rail_try_again(rctx, ret, &polled));
+
+        source += frag_len;
+        addr   += frag_len;
+        len    -= frag_len;
+    }
+    SHMEM_TRANSPORT_OFI_CTX_UNLOCK(ctx);
+}
+
+static void rail_read(shmem_transport_ctx_t *ctx, int idx, uint8_t *target,
+                      const uint8_t *source, size_t len, int pe)
+{
+    shmem_transport_ofi_rail_ctx_t *rctx = &ctx->rails[idx];
+    size_t max_msg_size = shmem_transport_ofi_rails[idx].max_msg_size;
+    uint64_t key;
+    uint8_t *addr;
+    int ret;
+
+    rail_get_mr(idx, source, pe, &addr, &key);
+
+    SHMEM_TRANSPORT_OFI_CTX_LOCK(ctx);
+    while (len > 0) {
+        size_t frag_len = MIN(len, max_msg_size);
+        uint64_t polled = 0;
+
+        SHMEM_TRANSPORT_OFI_CNTR_INC(&rctx->pending_get_cntr);
+
+        do {
+            ret = fi_read(rctx->ep, target, frag_len, NULL, RAIL_DEST(idx, pe),
+                          (uint64_t) addr, key, NULL);
+        } while (rail_try_again(rctx, ret, &polled));
+
+        target += frag_len;
+        addr   += frag_len;
+        len    -= frag_len;
+    }
+    SHMEM_TRANSPORT_OFI_CTX_UNLOCK(ctx);
+}
+
+/* Split a transfer into parts of at least the stripe size, at most one per
+ * rail.  Returns the number of parts and sets the length of each part. */
+static inline
+size_t rail_split(size_t len, size_t *part_len)
+{
+    size_t nparts = len / shmem_transport_ofi_rail_stripe_size;
+
+    if (nparts < 1) nparts = 1;
+    if (nparts > (size_t) shmem_transport_ofi_nrails) nparts = shmem_transport_ofi_nrails;
+
+    /* Keep the part boundaries cache line aligned */
+    *part_len = (((len + nparts - 1) / nparts) + 63) & ~((size_t) 63);
+    if (*part_len == 0) *part_len = 64;
+
+    return (len + *part_len - 1) / *part_len;
+}
+
+/* Issue the parts of a transfer that are placed on the additional rails, and
+ * narrow the transfer to the part placed on the primary rail, which may be
+ * empty.  Part i is placed on rail (pe + i) % nrails. */
+static void rail_transfer(shmem_transport_ctx_t *ctx, void **target, const void **source,
+                          size_t *len, int pe, int is_get)
+{
+    const void *remote = is_get ? *source : *target;
+    size_t nparts, part_len, i;
+    size_t primary_off = 0, primary_len = 0;
+
+    if (!rail_is_eligible(remote)) {
+        RAIL_COUNT_BYTES(ctx, 0, *len);
+        return;
+    }
+
+    nparts = rail_split(*len, &part_len);
+
+    if (!is_get)
+        shmem_transport_ofi_order_pe(ctx, pe);
+
+    for (i = 0; i < nparts; i++) {
+        int idx = (int) ((pe + i) % shmem_transport_ofi_nrails);
+        size_t off = i * part_len;
+        size_t plen = MIN(part_len, *len - off);
+
+        RAIL_COUNT_BYTES(ctx, idx, plen);
+
+        if (idx == 0) {
+            primary_off = off;
+            primary_len = plen;
+        } else if (is_get) {
+            rail_read(ctx, idx, (uint8_t *) *target + off, (const uint8_t *) *source + off,
+                      plen, pe);
+        } else {
+            rail_write(ctx, idx, (uint8_t *) *target + off, (const uint8_t *) *source + off,
+                       plen, pe);
+        }
+    }
+
+    *target = (uint8_t *) *target + primary_off;
+    *source = (const uint8_t *) *source + primary_off;
+    *len    = primary_len;
+}
+
+void shmem_transport_ofi_rail_put(shmem_transport_ctx_t *ctx, void **target,
+                                  const void **source, size_t *len, int pe)
+{
+    rail_transfer(ctx, target, source, len, pe, 0);
+}
+
+void shmem_transport_ofi_rail_get(shmem_transport_ctx_t *ctx, void **target,
+                                  const void **source, size_t *len, int pe)
+{
+    rail_transfer(ctx, target, source, len, pe, 1);
+}
+
+int shmem_transport_ofi_rail_put_small(shmem_transport_ctx_t *ctx, void *target,
+                                       const void *source, size_t len, int pe)
+{
+    int idx = pe % shmem_transport_ofi_nrails;
+    shmem_transport_ofi_rail_ctx_t *rctx;
+    uint64_t polled = 0;
+    uint64_t key;
+    uint8_t *addr;
+    int ret;
+
+    if (!rail_is_eligible(target))
+        idx = 0;
+
+    RAIL_COUNT_BYTES(ctx, idx, len);
+
+    if (idx == 0)
+        return 0;
+
+    rctx = &ctx->rails[idx];
+    rail_get_mr(idx, target, pe, &addr, &key);
+
+    shmem_transport_ofi_order_pe(ctx, pe);
+
+    SHMEM_TRANSPORT_OFI_CTX_LOCK(ctx);
+    SHMEM_TRANSPORT_OFI_CNTR_INC(&rctx->pending_put_cntr);
+    shmem_transport_ofi_mark_pe(ctx, pe);
+
+    do {
+        ret = fi_inject_write(rctx->ep, source, len, RAIL_DEST(idx, pe),
+                              (uint64_t) addr, key);
+    } while (rail_try_again(rctx, ret, &polled));
+    SHMEM_TRANSPORT_OFI_CTX_UNLOCK(ctx);
+
+    return 1;
+}
+
+
+/* Wait for the operations issued on one rail.  Called with the context lock
+ * held; the lock is released while polling. */
+static void rail_cntr_wait(shmem_transport_ctx_t *ctx, shmem_transport_ofi_rail_ctx_t *rctx,
+                           int is_get)
+{
+    struct fid_cntr *cntr = is_get ? rctx->get_cntr : rctx->put_cntr;
+
+    for (;;) {
+        uint64_t success = fi_cntr_read(cntr);
+        uint64_t fail = fi_cntr_readerr(cntr);
+        uint64_t cnt = is_get ? SHMEM_TRANSPORT_OFI_CNTR_READ(&rctx->pending_get_cntr) :
+                                SHMEM_TRANSPORT_OFI_CNTR_READ(&rctx->pending_put_cntr);
+
+        if (fail)
+            RAISE_ERROR_MSG("Operations completed in error (%" PRIu64 ")\n", fail);
+
+        if (success >= cnt)
+            return;
+
+        shmem_transport_probe();
+
+        SHMEM_TRANSPORT_OFI_CTX_UNLOCK(ctx);
+        SPINLOCK_BODY();
+        SHMEM_TRANSPORT_OFI_CTX_LOCK(ctx);
+    }
+}
+
+void shmem_transport_ofi_rail_put_quiet(shmem_transport_ctx_t *ctx)
+{
+    int i;
+
+    for (i = 1; i < shmem_transport_ofi_nrails; i++)
+        rail_cntr_wait(ctx, &ctx->rails[i], 0);
+}
+
+void shmem_transport_ofi_rail_get_wait(shmem_transport_ctx_t *ctx)
+{
+    int i;
+
+    for (i = 1; i < shmem_transport_ofi_nrails; i++)
+        rail_cntr_wait(ctx, &ctx->rails[i], 1);
+}
+
+
+void shmem_transport_ofi_rail_probe(void)
+{
+    int i;
+
+    for (i = 1; i < shmem_transport_ofi_nrails; i++) {
+        struct fi_cq_entry buf;
+
+        if (fi_cq_read(shmem_transport_ofi_rails[i].target_cq, &buf, 1) == 1)
+            RAISE_WARN_STR("Unexpected event");
+    }
+}
+
+uint64_t shmem_transport_ofi_rail_target_cntr_read(void)
+{
+    uint64_t cnt = 0;
+#if ENABLE_TARGET_CNTR
+    int i;
+
+    for (i = 1; i < shmem_transport_ofi_nrails; i++)
+        cnt += fi_cntr_read(shmem_transport_ofi_rails[i].target_cntr);
+#endif
+
+    return cnt;
+}
+
+void shmem_transport_ofi_rail_target_cntr_wait(uint64_t ge_val, int timeout_ms)
+{
+#if ENABLE_TARGET_CNTR
+    for (;;) {
+        uint64_t cnt = fi_cntr_read(shmem_transport_ofi_target_cntrfd);
+        int ret;
+
+        if (cnt + shmem_transport_ofi_rail_target_cntr_read() >= ge_val)
+            return;
+
+        /* Sleep on the primary rail, waking up periodically to check the
+         * other rails */
+        ret = fi_cntr_wait(shmem_transport_ofi_target_cntrfd, cnt + 1,
+                           (timeout_ms >= 0 && timeout_ms < RAIL_TARGET_WAIT_MS) ?
+                           timeout_ms : RAIL_TARGET_WAIT_MS);
+        if (ret != -FI_ETIMEDOUT)
+            OFI_CHECK_ERROR(ret);
+
+        if (timeout_ms >= 0)
+            return;
+    }
+#else
+    RAISE_ERROR_STR("OFI transport configured without target counters");
+#endif
+}
@@ -70,7 +70,9 @@ int shmem_transport_dtype_table[] = {
     PTL_DOUBLE,               /* SHM_INTERNAL_DOUBLE         */
     PTL_LONG_DOUBLE,          /* SHM_INTERNAL_LONG_DOUBLE    */
     PTL_FLOAT_COMPLEX,        /* SHM_INTERNAL_FLOAT_COMPLEX  */
-    PTL_DOUBLE_COMPLEX        /* SHM_INTERNAL_DOUBLE_COMPLEX */
+    PTL_DOUBLE_COMPLEX,       /* SHM_INTERNAL_DOUBLE_COMPLEX */
+    PTL_UINT16_T,             /* SHM_INTERNAL_FLOAT16 (software reductions only)  */
+    PTL_UINT16_T              /* SHM_INTERNAL_BFLOAT16 (software reductions only) */
 };
 
 #undef SHM_INTERNAL_INT8
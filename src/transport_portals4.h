@@ -293,6 +293,16 @@ shmem_transport_quiet(shmem_transport_ctx_t* ctx)
 }
 
 
+/* Completion events are counted per context, so quieting one PE drains all of
+ * the context's operations */
+static inline
+int
+shmem_transport_quiet_pe(shmem_transport_ctx_t* ctx, int pe)
+{
+    return shmem_transport_quiet(ctx);
+}
+
+
 static inline
 int
 shmem_transport_fence(shmem_transport_ctx_t* ctx)
@@ -1096,7 +1106,8 @@ int shmem_transport_atomic_supported(ptl_op_t op, ptl_datatype_t datatype)
     /* FIXME: Force shared memory atomics build to use software reductions */
     return 0;
 #else
-    return 1;
+    /* Half-precision types are only reduced in software */
+    return !(datatype == SHM_INTERNAL_FLOAT16 || datatype == SHM_INTERNAL_BFLOAT16);
 #endif
 }
 
@@ -1318,14 +1329,23 @@ uint64_t shmem_transport_received_cntr_get(void)
 
 
 static inline
-void shmem_transport_received_cntr_wait(uint64_t ge_val)
+void shmem_transport_received_cntr_wait(uint64_t ge_val, int timeout_ms)
 {
 #ifndef ENABLE_HARD_POLLING
     int ret;
     ptl_ct_event_t ct;
 
-    ret = PtlCTWait(shmem_transport_portals4_target_ct_h,
-                    ge_val, &ct);
+    if (timeout_ms < 0) {
+        ret = PtlCTWait(shmem_transport_portals4_target_ct_h,
+                        ge_val, &ct);
+    } else {
+        ptl_size_t threshold = ge_val;
+        unsigned int which;
+
+        ret = PtlCTPoll(&shmem_transport_portals4_target_ct_h, &threshold, 1,
+                        timeout_ms, &ct, &which);
+        if (PTL_CT_NONE_REACHED == ret) return;
+    }
 
     if (PTL_OK != ret) {
         RAISE_ERROR(ret);
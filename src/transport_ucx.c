@@ -82,16 +82,134 @@ static void shmem_transport_ucx_cb_init(void *request) {
 static pthread_t shmem_transport_ucx_progress_thread;
 static int shmem_transport_ucx_progress_thread_enabled = 1;
 
+/* Contexts with their own worker, serviced by the progress thread */
+static shmem_transport_ctx_t *shmem_transport_ucx_ctx_workers = NULL;
+static pthread_mutex_t shmem_transport_ucx_ctx_workers_lock = PTHREAD_MUTEX_INITIALIZER;
+static ucs_thread_mode_t shmem_transport_ucx_thread_mode;
+
 static void * shmem_transport_ucx_progress_thread_func(void *arg)
 {
     while (__atomic_load_n(&shmem_transport_ucx_progress_thread_enabled, __ATOMIC_ACQUIRE)) {
+        shmem_transport_ctx_t *ctx;
+
         shmem_transport_probe();
+
+        pthread_mutex_lock(&shmem_transport_ucx_ctx_workers_lock);
+        for (ctx = shmem_transport_ucx_ctx_workers; ctx != NULL; ctx = ctx->next)
+            ucp_worker_progress(ctx->worker);
+        pthread_mutex_unlock(&shmem_transport_ucx_ctx_workers_lock);
+
         usleep(shmem_internal_params.PROGRESS_INTERVAL);
     }
 
     return NULL;
 }
 
+int shmem_transport_ucx_ctx_worker_create(shmem_transport_ctx_t *ctx)
+{
+    ucs_status_t status;
+    ucp_worker_params_t worker_params;
+    ucp_worker_attr_t worker_attr;
+    ucp_worker_h worker;
+
+    worker_params.field_mask  = UCP_WORKER_PARAM_FIELD_THREAD_MODE;
+
+    /* The owning thread is the only user of the worker, unless the progress
+     * thread also drives it */
+    if (shmem_internal_params.PROGRESS_INTERVAL > 0)
+        worker_params.thread_mode = shmem_transport_ucx_thread_mode;
+    else
+        worker_params.thread_mode = UCS_THREAD_MODE_SINGLE;
+
+    status = ucp_worker_create(shmem_transport_ucp_ctx, &worker_params, &worker);
+    if (status != UCS_OK) return 1;
+
+    worker_attr.field_mask = UCP_WORKER_ATTR_FIELD_THREAD_MODE;
+    status = ucp_worker_query(worker, &worker_attr);
+    if (status != UCS_OK || worker_attr.thread_mode < worker_params.thread_mode) {
+        ucp_worker_destroy(worker);
+        return 1;
+    }
+
+    ctx->conns = calloc(shmem_internal_num_pes, sizeof(shmem_transport_ucx_conn_t));
+    if (ctx->conns == NULL) {
+        ucp_worker_destroy(worker);
+        return 1;
+    }
+
+    ctx->worker = worker;
+
+    if (shmem_internal_params.PROGRESS_INTERVAL > 0) {
+        pthread_mutex_lock(&shmem_transport_ucx_ctx_workers_lock);
+        ctx->next = shmem_transport_ucx_ctx_workers;
+        shmem_transport_ucx_ctx_workers = ctx;
+        pthread_mutex_unlock(&shmem_transport_ucx_ctx_workers_lock);
+    }
+
+    return 0;
+}
+
+void shmem_transport_ucx_ctx_worker_destroy(shmem_transport_ctx_t *ctx)
+{
+    ucs_status_t status;
+    int i;
+
+    if (shmem_internal_params.PROGRESS_INTERVAL > 0) {
+        shmem_transport_ctx_t **p;
+
+        pthread_mutex_lock(&shmem_transport_ucx_ctx_workers_lock);
+        for (p = &shmem_transport_ucx_ctx_workers; *p != NULL; p = &(*p)->next) {
+            if (*p == ctx) {
+                *p = ctx->next;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&shmem_transport_ucx_ctx_workers_lock);
+    }
+
+    status = ucp_worker_flush(ctx->worker);
+    UCX_CHECK_STATUS(status);
+
+    for (i = 0; i < shmem_internal_num_pes; i++) {
+        if (ctx->conns[i].ep == NULL) continue;
+
+        ucp_rkey_destroy(ctx->conns[i].data_rkey);
+        ucp_rkey_destroy(ctx->conns[i].heap_rkey);
+        ucs_status_ptr_t pstatus = ucp_ep_close_nb(ctx->conns[i].ep,
+                                                   UCP_EP_CLOSE_MODE_FLUSH);
+        shmem_transport_ucx_complete_op(ctx, pstatus);
+    }
+
+    free(ctx->conns);
+    ctx->conns = NULL;
+
+    ucp_worker_destroy(ctx->worker);
+    ctx->worker = shmem_transport_ucp_worker;
+}
+
+static void shmem_transport_ucx_conn_init(ucp_worker_h worker, shmem_transport_ucx_conn_t *conn, int pe)
+{
+    ucs_status_t status;
+    ucp_ep_params_t params;
+
+    params.field_mask = UCP_EP_PARAM_FIELD_REMOTE_ADDRESS;
+    params.address    = shmem_transport_peers[pe].addr;
+
+    status = ucp_ep_create(worker, &params, &conn->ep);
+    UCX_CHECK_STATUS(status);
+
+    status = ucp_ep_rkey_unpack(conn->ep, shmem_transport_peers[pe].data_rkey_buf, &conn->data_rkey);
+    UCX_CHECK_STATUS(status);
+
+    status = ucp_ep_rkey_unpack(conn->ep, shmem_transport_peers[pe].heap_rkey_buf, &conn->heap_rkey);
+    UCX_CHECK_STATUS(status);
+}
+
+void shmem_transport_ucx_connect(shmem_transport_ctx_t *ctx, int pe)
+{
+    shmem_transport_ucx_conn_init(ctx->worker, &ctx->conns[pe], pe);
+}
+
 int shmem_transport_init(void)
 {
     ucs_status_t status;
@@ -134,6 +252,8 @@ int shmem_transport_init(void)
     if (shmem_internal_params.PROGRESS_INTERVAL > 0)
         worker_params.thread_mode = UCS_THREAD_MODE_MULTI;
 
+    shmem_transport_ucx_thread_mode = worker_params.thread_mode;
+
     status = ucp_worker_create(shmem_transport_ucp_ctx, &worker_params,
                                &shmem_transport_ucp_worker);
     UCX_CHECK_STATUS(status);
@@ -262,6 +382,9 @@ int shmem_transport_init(void)
     /* Configure the default context */
     shmem_transport_ctx_default.options = 0;
     shmem_transport_ctx_default.team    = &shmem_internal_team_world;
+    shmem_transport_ctx_default.worker  = shmem_transport_ucp_worker;
+    shmem_transport_ctx_default.conns   = NULL;
+    shmem_transport_ctx_default.next    = NULL;
 
     return 0;
 }
@@ -275,8 +398,6 @@ int shmem_transport_startup(void)
 
     /* Build connection table to each peer */
     for (i = 0; i < shmem_internal_num_pes; i++) {
-        ucs_status_t status;
-        ucp_ep_params_t params;
         size_t rkey_len;
         void *rkey;
         uint8_t *addr_bytes;
@@ -303,21 +424,15 @@ int shmem_transport_startup(void)
             }
         }
 
-        params.field_mask = UCP_EP_PARAM_FIELD_REMOTE_ADDRESS;
-        params.address    = shmem_transport_peers[i].addr;
-
-        status = ucp_ep_create(shmem_transport_ucp_worker, &params, &shmem_transport_peers[i].ep);
-        UCX_CHECK_STATUS(status);
-
+        /* Packed rkeys are kept so that contexts with their own worker can
+         * unpack them when they connect */
         ret = shmem_runtime_get(i, "data_rkey_len", &rkey_len, sizeof(size_t));
         if (ret) RAISE_ERROR_MSG("Runtime get of UCX data rkey length failed (PE %d, ret %d)\n", i, ret);
         rkey = malloc(rkey_len);
         if (rkey == NULL) RAISE_ERROR_MSG("Out of memory, allocating rkey buffer (len = %zu)\n", rkey_len);
         ret = shmem_runtime_get(i, "data_rkey", rkey, rkey_len);
         if (ret) RAISE_ERROR_MSG("Runtime get of UCX data rkey failed (PE %d, ret %d)\n", i, ret);
-        status = ucp_ep_rkey_unpack(shmem_transport_peers[i].ep, rkey, &shmem_transport_peers[i].data_rkey);
-        UCX_CHECK_STATUS(status);
-        free(rkey);
+        shmem_transport_peers[i].data_rkey_buf = rkey;
 
         ret = shmem_runtime_get(i, "heap_rkey_len", &rkey_len, sizeof(size_t));
         if (ret) RAISE_ERROR_MSG("Runtime get of UCX heap rkey length failed (PE %d, ret %d)\n", i, ret);
@@ -325,9 +440,10 @@ int shmem_transport_startup(void)
         if (rkey == NULL) RAISE_ERROR_MSG("Out of memory, allocating rkey buffer (len = %zu)\n", rkey_len);
         ret = shmem_runtime_get(i, "heap_rkey", rkey, rkey_len);
         if (ret) RAISE_ERROR_MSG("Runtime get of UCX heap rkey failed (PE %d, ret %d)\n", i, ret);
-        status = ucp_ep_rkey_unpack(shmem_transport_peers[i].ep, rkey, &shmem_transport_peers[i].heap_rkey);
-        UCX_CHECK_STATUS(status);
-        free(rkey);
+        shmem_transport_peers[i].heap_rkey_buf = rkey;
+
+        shmem_transport_ucx_conn_init(shmem_transport_ucp_worker,
+                                      &shmem_transport_peers[i].conn, i);
 
 #ifndef ENABLE_REMOTE_VIRTUAL_ADDRESSING
         ret = shmem_runtime_get(i, "data_base", &shmem_transport_peers[i].data_base, sizeof(void*));
@@ -361,12 +477,14 @@ int shmem_transport_fini(void)
 
     /* Clean up peers table */
     for (i = 0; i < shmem_internal_num_pes; i++) {
-        ucp_rkey_destroy(shmem_transport_peers[i].data_rkey);
-        ucp_rkey_destroy(shmem_transport_peers[i].heap_rkey);
-        ucs_status_ptr_t pstatus = ucp_ep_close_nb(shmem_transport_peers[i].ep,
+        ucp_rkey_destroy(shmem_transport_peers[i].conn.data_rkey);
+        ucp_rkey_destroy(shmem_transport_peers[i].conn.heap_rkey);
+        ucs_status_ptr_t pstatus = ucp_ep_close_nb(shmem_transport_peers[i].conn.ep,
                                                    UCP_EP_CLOSE_MODE_FLUSH);
-        shmem_transport_ucx_complete_op(pstatus);
+        shmem_transport_ucx_complete_op(&shmem_transport_ctx_default, pstatus);
         free(shmem_transport_peers[i].addr);
+        free(shmem_transport_peers[i].data_rkey_buf);
+        free(shmem_transport_peers[i].heap_rkey_buf);
     }
 
     free(shmem_transport_peers);
@@ -41,20 +41,31 @@ extern ucp_atomic_fetch_op_t shmem_transport_ucx_fetch_op[];
 typedef enum shm_internal_op_t shm_internal_op_t;
 typedef int shmem_transport_ct_t;
 
+/* Endpoint and remote keys used to reach a peer from a given worker */
+typedef struct {
+    ucp_ep_h       ep;
+    ucp_rkey_h     data_rkey, heap_rkey;
+} shmem_transport_ucx_conn_t;
+
 struct shmem_transport_ctx_t {
     long options;
     struct shmem_internal_team_t *team;
+    ucp_worker_h worker;
+    /* Per-peer connections for contexts with their own worker, created on
+     * first use.  NULL when the context uses the shared worker. */
+    shmem_transport_ucx_conn_t *conns;
+    struct shmem_transport_ctx_t *next;
 };
 typedef struct shmem_transport_ctx_t shmem_transport_ctx_t;
 
 typedef struct {
     size_t         addr_len;
     ucp_address_t *addr;
-    ucp_ep_h       ep;
+    shmem_transport_ucx_conn_t conn;
 #ifndef ENABLE_REMOTE_VIRTUAL_ADDRESSING
     uint8_t       *data_base, *heap_base;
 #endif
-    ucp_rkey_h     data_rkey, heap_rkey;
+    void          *data_rkey_buf, *heap_rkey_buf;
 } shmem_transport_peer_t;
 
 extern shmem_transport_peer_t *shmem_transport_peers;
@@ -72,6 +83,10 @@ int shmem_transport_init(void);
 int shmem_transport_startup(void);
 int shmem_transport_fini(void);
 
+int shmem_transport_ucx_ctx_worker_create(shmem_transport_ctx_t *ctx);
+void shmem_transport_ucx_ctx_worker_destroy(shmem_transport_ctx_t *ctx);
+void shmem_transport_ucx_connect(shmem_transport_ctx_t *ctx, int pe);
+
 #define UCX_CHECK_STATUS(status)                                                        \
     do {                                                                                \
         if (status != UCS_OK) {                                                         \
@@ -94,18 +109,43 @@ shmem_transport_probe(void)
 }
 
 static inline
-ucs_status_t shmem_transport_ucx_complete_op(ucs_status_ptr_t req) {
+void
+shmem_transport_ucx_progress(shmem_transport_ctx_t *ctx)
+{
+    ucp_worker_progress(ctx->worker);
+
+    /* Targets are reached through the shared worker, so keep it moving while
+     * the application waits on a private worker */
+    if (ctx->worker != shmem_transport_ucp_worker)
+        shmem_transport_probe();
+}
+
+static inline
+shmem_transport_ucx_conn_t *
+shmem_transport_ucx_get_conn(shmem_transport_ctx_t *ctx, int pe)
+{
+    if (ctx->conns == NULL)
+        return &shmem_transport_peers[pe].conn;
+
+    if (ctx->conns[pe].ep == NULL)
+        shmem_transport_ucx_connect(ctx, pe);
+
+    return &ctx->conns[pe];
+}
+
+static inline
+ucs_status_t shmem_transport_ucx_complete_op(shmem_transport_ctx_t *ctx, ucs_status_ptr_t req) {
     if (req == NULL) {
         /* All calls to complete_op must generate progress to avoid deadlock
          * in application-level polling loops */
-        shmem_transport_probe();
+        shmem_transport_ucx_progress(ctx);
         return UCS_OK;
     } else if (UCS_PTR_IS_ERR(req)) {
         return UCS_PTR_STATUS(req);
     } else {
         ucs_status_t status;
         do {
-            shmem_transport_probe();
+            shmem_transport_ucx_progress(ctx);
             status = ucp_request_check_status(req);
         } while (status == UCS_INPROGRESS);
         ucp_request_release(req);
@@ -148,12 +188,12 @@ ucs_status_t shmem_transport_ucx_post_cb_op(ucs_status_ptr_t req, void *completi
 }
 
 static inline
-void shmem_transport_ucx_get_mr(const void *addr, int dest_pe,
+void shmem_transport_ucx_get_mr(shmem_transport_ucx_conn_t *conn, const void *addr, int dest_pe,
                                 uint8_t **remote_addr, ucp_rkey_h *rkey) {
     if ((void*) addr >= shmem_internal_data_base &&
         (uint8_t*) addr < (uint8_t*) shmem_internal_data_base + shmem_internal_data_length) {
 
-        *rkey = shmem_transport_peers[dest_pe].data_rkey;
+        *rkey = conn->data_rkey;
 #ifdef ENABLE_REMOTE_VIRTUAL_ADDRESSING
         *remote_addr = (uint8_t *) addr;
 #else
@@ -163,7 +203,7 @@ void shmem_transport_ucx_get_mr(const void *addr, int dest_pe,
     } else if ((void*) addr >= shmem_internal_heap_base &&
                (uint8_t*) addr < (uint8_t*) shmem_internal_heap_base + shmem_internal_heap_length) {
 
-        *rkey = shmem_transport_peers[dest_pe].heap_rkey;
+        *rkey = conn->heap_rkey;
 #ifdef ENABLE_REMOTE_VIRTUAL_ADDRESSING
         *remote_addr = (uint8_t *) addr;
 #else
@@ -179,11 +219,6 @@ static inline
 int
 shmem_transport_ctx_create(struct shmem_internal_team_t *team, long options, shmem_transport_ctx_t **ctx)
 {
-    /* FIXME: Contexts are not optimized yet. We could create a separate set of
-     * EPs for each context (or team), and/or we could use completion callbacks
-     * to implement completion counters at the SOS level to enable separate
-     * completion tracking per context. */
-
     if (team == NULL)
         RAISE_ERROR_STR("Context creation occured on a NULL team");
 
@@ -192,8 +227,19 @@ shmem_transport_ctx_create(struct shmem_internal_team_t *team, long options, shm
     if (*ctx == NULL)
         return 1;
 
-    (*ctx)->team = team;
-    (*ctx)->options = 0;
+    (*ctx)->team    = team;
+    (*ctx)->options = options;
+    (*ctx)->worker  = shmem_transport_ucp_worker;
+    (*ctx)->conns   = NULL;
+    (*ctx)->next    = NULL;
+
+    /* Private contexts are used by a single thread, so they can have their
+     * own worker without serializing against other threads.  Shareable
+     * contexts stay on the shared worker. */
+    if ((options & SHMEM_CTX_PRIVATE) && shmem_internal_params.UCX_CTX_WORKERS) {
+        if (shmem_transport_ucx_ctx_worker_create(*ctx))
+            DEBUG_STR("Unable to create a UCX worker for private context, using shared worker");
+    }
 
     return 0;
 }
@@ -206,8 +252,11 @@ shmem_transport_ctx_destroy(shmem_transport_ctx_t *ctx)
         return;
     else if (ctx == (shmem_transport_ctx_t *) SHMEM_CTX_DEFAULT)
         RAISE_ERROR_STR("Cannot destroy SHMEM_CTX_DEFAULT");
-    else
+    else {
+        if (ctx->conns != NULL)
+            shmem_transport_ucx_ctx_worker_destroy(ctx);
         free(ctx);
+    }
 
     return;
 }
@@ -218,7 +267,29 @@ shmem_transport_quiet(shmem_transport_ctx_t* ctx)
 {
     ucs_status_t status;
 
-    status = ucp_worker_flush(shmem_transport_ucp_worker);
+    status = ucp_worker_flush(ctx->worker);
+    UCX_CHECK_STATUS(status);
+
+    return 0;
+}
+
+/* Flush only the endpoint used to reach the given PE */
+static inline
+int
+shmem_transport_quiet_pe(shmem_transport_ctx_t* ctx, int pe)
+{
+    ucs_status_t status;
+
+    /* No operations were issued to PEs this context has not connected to */
+    if (ctx->conns != NULL && ctx->conns[pe].ep == NULL) {
+        shmem_transport_ucx_progress(ctx);
+        return 0;
+    }
+
+    shmem_transport_ucx_conn_t *conn = shmem_transport_ucx_get_conn(ctx, pe);
+
+    ucs_status_ptr_t pstatus = ucp_ep_flush_nb(conn->ep, 0, &shmem_transport_ucx_cb_nop);
+    status = shmem_transport_ucx_complete_op(ctx, pstatus);
     UCX_CHECK_STATUS(status);
 
     return 0;
@@ -233,9 +304,9 @@ shmem_transport_fence(shmem_transport_ctx_t* ctx)
 #if defined(USE_CMA) || (defined(USE_XPMEM) && !defined(USE_SHR_ATOMICS))
     /* Put/get use shared memory and atomics use UCX. Flush to resolve a race
      * across transports. */
-    status = ucp_worker_flush(shmem_transport_ucp_worker);
+    status = ucp_worker_flush(ctx->worker);
 #else
-    status = ucp_worker_fence(shmem_transport_ucp_worker);
+    status = ucp_worker_fence(ctx->worker);
 #endif
     UCX_CHECK_STATUS(status);
 
@@ -250,9 +321,11 @@ shmem_transport_put_scalar(shmem_transport_ctx_t* ctx, void *target, const void
     ucp_rkey_h rkey;
     uint8_t *remote_addr;
 
-    shmem_transport_ucx_get_mr(target, pe, &remote_addr, &rkey);
+    shmem_transport_ucx_conn_t *conn = shmem_transport_ucx_get_conn(ctx, pe);
 
-    status = ucp_put_nbi(shmem_transport_peers[pe].ep, source, len, (uint64_t) remote_addr, rkey);
+    shmem_transport_ucx_get_mr(conn, target, pe, &remote_addr, &rkey);
+
+    status = ucp_put_nbi(conn->ep, source, len, (uint64_t) remote_addr, rkey);
     UCX_CHECK_STATUS_INPROGRESS(status);
 
     /* SOS expects scalar puts to complete locally. Use ucp_put_nbi in the hope
@@ -272,9 +345,11 @@ shmem_transport_put_nb(shmem_transport_ctx_t* ctx, void *target, const void *sou
     ucp_rkey_h rkey;
     uint8_t *remote_addr;
 
-    shmem_transport_ucx_get_mr(target, pe, &remote_addr, &rkey);
+    shmem_transport_ucx_conn_t *conn = shmem_transport_ucx_get_conn(ctx, pe);
+
+    shmem_transport_ucx_get_mr(conn, target, pe, &remote_addr, &rkey);
 
-    ucs_status_ptr_t pstatus = ucp_put_nb(shmem_transport_peers[pe].ep, source,
+    ucs_status_ptr_t pstatus = ucp_put_nb(conn->ep, source,
                                           len, (uint64_t) remote_addr, rkey,
                                           &shmem_transport_ucx_cb_complete);
     status = shmem_transport_ucx_post_cb_op(pstatus, completion);
@@ -286,7 +361,7 @@ void
 shmem_transport_put_wait(shmem_transport_ctx_t* ctx, long *completion)
 {
     while (__atomic_load_n(completion, __ATOMIC_ACQUIRE) > 0)
-        shmem_transport_probe();
+        shmem_transport_ucx_progress(ctx);
 }
 
 static inline
@@ -298,9 +373,11 @@ shmem_transport_put_nbi(shmem_transport_ctx_t* ctx, void *target, const void *so
     ucp_rkey_h rkey;
     uint8_t *remote_addr;
 
-    shmem_transport_ucx_get_mr(target, pe, &remote_addr, &rkey);
+    shmem_transport_ucx_conn_t *conn = shmem_transport_ucx_get_conn(ctx, pe);
 
-    status = ucp_put_nbi(shmem_transport_peers[pe].ep, source, len, (uint64_t) remote_addr, rkey);
+    shmem_transport_ucx_get_mr(conn, target, pe, &remote_addr, &rkey);
+
+    status = ucp_put_nbi(conn->ep, source, len, (uint64_t) remote_addr, rkey);
     UCX_CHECK_STATUS_INPROGRESS(status);
 }
 
@@ -312,12 +389,14 @@ shmem_transport_get(shmem_transport_ctx_t* ctx, void *target, const void *source
     ucp_rkey_h rkey;
     uint8_t *remote_addr;
 
-    shmem_transport_ucx_get_mr(source, pe, &remote_addr, &rkey);
+    shmem_transport_ucx_conn_t *conn = shmem_transport_ucx_get_conn(ctx, pe);
+
+    shmem_transport_ucx_get_mr(conn, source, pe, &remote_addr, &rkey);
 
-    pstatus = ucp_get_nb(shmem_transport_peers[pe].ep, target, len,
+    pstatus = ucp_get_nb(conn->ep, target, len,
                          (uint64_t) remote_addr, rkey, &shmem_transport_ucx_cb_nop);
 
-    ucs_status_t status = shmem_transport_ucx_complete_op(pstatus);
+    ucs_status_t status = shmem_transport_ucx_complete_op(ctx, pstatus);
     UCX_CHECK_STATUS(status);
 }
 
@@ -339,7 +418,9 @@ shmem_transport_swap(shmem_transport_ctx_t* ctx, void *target, const void *sourc
     ucs_status_ptr_t pstatus;
     uint64_t value;
 
-    shmem_transport_ucx_get_mr(target, pe, &remote_addr, &rkey);
+    shmem_transport_ucx_conn_t *conn = shmem_transport_ucx_get_conn(ctx, pe);
+
+    shmem_transport_ucx_get_mr(conn, target, pe, &remote_addr, &rkey);
 
     switch (len) {
         case 1:
@@ -358,11 +439,11 @@ shmem_transport_swap(shmem_transport_ctx_t* ctx, void *target, const void *sourc
             RAISE_ERROR_MSG("Unsupported datatype len=%zu\n", len);
     }
 
-    pstatus = ucp_atomic_fetch_nb(shmem_transport_peers[pe].ep, UCP_ATOMIC_FETCH_OP_SWAP, value,
+    pstatus = ucp_atomic_fetch_nb(conn->ep, UCP_ATOMIC_FETCH_OP_SWAP, value,
                                   dest, len, (uint64_t) remote_addr, rkey,
                                   &shmem_transport_ucx_cb_nop);
 
-    ucs_status_t status = shmem_transport_ucx_complete_op(pstatus);
+    ucs_status_t status = shmem_transport_ucx_complete_op(ctx, pstatus);
     UCX_CHECK_STATUS(status);
 }
 
@@ -376,7 +457,9 @@ shmem_transport_swap_nbi(shmem_transport_ctx_t* ctx, void *target, const void *s
     ucs_status_ptr_t pstatus;
     uint64_t value;
 
-    shmem_transport_ucx_get_mr(target, pe, &remote_addr, &rkey);
+    shmem_transport_ucx_conn_t *conn = shmem_transport_ucx_get_conn(ctx, pe);
+
+    shmem_transport_ucx_get_mr(conn, target, pe, &remote_addr, &rkey);
 
     switch (len) {
         case 1:
@@ -395,12 +478,12 @@ shmem_transport_swap_nbi(shmem_transport_ctx_t* ctx, void *target, const void *s
             RAISE_ERROR_MSG("Unsupported datatype len=%zu\n", len);
     }
 
-    pstatus = ucp_atomic_fetch_nb(shmem_transport_peers[pe].ep, UCP_ATOMIC_FETCH_OP_SWAP, value,
+    pstatus = ucp_atomic_fetch_nb(conn->ep, UCP_ATOMIC_FETCH_OP_SWAP, value,
                                   dest, len, (uint64_t) remote_addr, rkey,
                                   &shmem_transport_ucx_cb_nop);
 
     /* Manual progress to avoid deadlock for application-level polling */
-    shmem_transport_probe();
+    shmem_transport_ucx_progress(ctx);
 
     ucs_status_t status = shmem_transport_ucx_release_op(pstatus);
     UCX_CHECK_STATUS_INPROGRESS(status);
@@ -417,7 +500,9 @@ shmem_transport_cswap(shmem_transport_ctx_t* ctx, void *target, const void *sour
     ucs_status_ptr_t pstatus;
     uint64_t value;
 
-    shmem_transport_ucx_get_mr(target, pe, &remote_addr, &rkey);
+    shmem_transport_ucx_conn_t *conn = shmem_transport_ucx_get_conn(ctx, pe);
+
+    shmem_transport_ucx_get_mr(conn, target, pe, &remote_addr, &rkey);
 
     memcpy(dest, source, len);
 
@@ -438,11 +523,11 @@ shmem_transport_cswap(shmem_transport_ctx_t* ctx, void *target, const void *sour
             RAISE_ERROR_MSG("Unsupported datatype len=%zu\n", len);
     }
 
-    pstatus = ucp_atomic_fetch_nb(shmem_transport_peers[pe].ep, UCP_ATOMIC_FETCH_OP_CSWAP,
+    pstatus = ucp_atomic_fetch_nb(conn->ep, UCP_ATOMIC_FETCH_OP_CSWAP,
                                   value, dest, len, (uint64_t) remote_addr, rkey,
                                   &shmem_transport_ucx_cb_nop);
 
-    ucs_status_t status = shmem_transport_ucx_complete_op(pstatus);
+    ucs_status_t status = shmem_transport_ucx_complete_op(ctx, pstatus);
     UCX_CHECK_STATUS(status);
 }
 
@@ -457,7 +542,9 @@ shmem_transport_cswap_nbi(shmem_transport_ctx_t* ctx, void *target, const void *
     ucs_status_ptr_t pstatus;
     uint64_t value;
 
-    shmem_transport_ucx_get_mr(target, pe, &remote_addr, &rkey);
+    shmem_transport_ucx_conn_t *conn = shmem_transport_ucx_get_conn(ctx, pe);
+
+    shmem_transport_ucx_get_mr(conn, target, pe, &remote_addr, &rkey);
 
     memcpy(dest, source, len);
 
@@ -478,12 +565,12 @@ shmem_transport_cswap_nbi(shmem_transport_ctx_t* ctx, void *target, const void *
             RAISE_ERROR_MSG("Unsupported datatype len=%zu\n", len);
     }
 
-    pstatus = ucp_atomic_fetch_nb(shmem_transport_peers[pe].ep, UCP_ATOMIC_FETCH_OP_CSWAP,
+    pstatus = ucp_atomic_fetch_nb(conn->ep, UCP_ATOMIC_FETCH_OP_CSWAP,
                                   value, dest, len, (uint64_t) remote_addr, rkey,
                                   &shmem_transport_ucx_cb_nop);
 
     /* Manual progress to avoid deadlock for application-level polling */
-    shmem_transport_probe();
+    shmem_transport_ucx_progress(ctx);
 
     ucs_status_t status = shmem_transport_ucx_release_op(pstatus);
     UCX_CHECK_STATUS_INPROGRESS(status);
@@ -499,7 +586,9 @@ shmem_transport_atomic(shmem_transport_ctx_t* ctx, void *target, const void *sou
     ucs_status_t status;
     uint64_t value;
 
-    shmem_transport_ucx_get_mr(target, pe, &remote_addr, &rkey);
+    shmem_transport_ucx_conn_t *conn = shmem_transport_ucx_get_conn(ctx, pe);
+
+    shmem_transport_ucx_get_mr(conn, target, pe, &remote_addr, &rkey);
 
     shmem_internal_assert(op <= SHMEM_TRANSPORT_UCX_OP_LAST);
 
@@ -520,7 +609,7 @@ shmem_transport_atomic(shmem_transport_ctx_t* ctx, void *target, const void *sou
             RAISE_ERROR_MSG("Unsupported datatype len=%zu\n", len);
     }
 
-    status = ucp_atomic_post(shmem_transport_peers[pe].ep, shmem_transport_ucx_post_op[op],
+    status = ucp_atomic_post(conn->ep, shmem_transport_ucx_post_op[op],
                              value, len, (uint64_t) remote_addr, rkey);
     UCX_CHECK_STATUS_INPROGRESS(status);
 }
@@ -545,7 +634,9 @@ shmem_transport_fetch_atomic(shmem_transport_ctx_t* ctx, void *target, const voi
     ucs_status_ptr_t pstatus;
     uint64_t value;
 
-    shmem_transport_ucx_get_mr(target, pe, &remote_addr, &rkey);
+    shmem_transport_ucx_conn_t *conn = shmem_transport_ucx_get_conn(ctx, pe);
+
+    shmem_transport_ucx_get_mr(conn, target, pe, &remote_addr, &rkey);
 
     shmem_internal_assert(op <= SHMEM_TRANSPORT_UCX_OP_LAST);
 
@@ -566,12 +657,12 @@ shmem_transport_fetch_atomic(shmem_transport_ctx_t* ctx, void *target, const voi
             RAISE_ERROR_MSG("Unsupported datatype len=%zu\n", len);
     }
 
-    pstatus = ucp_atomic_fetch_nb(shmem_transport_peers[pe].ep,
+    pstatus = ucp_atomic_fetch_nb(conn->ep,
                                   shmem_transport_ucx_fetch_op[op], value,
                                   dest, len, (uint64_t) remote_addr, rkey,
                                   &shmem_transport_ucx_cb_nop);
 
-    ucs_status_t status = shmem_transport_ucx_complete_op(pstatus);
+    ucs_status_t status = shmem_transport_ucx_complete_op(ctx, pstatus);
     UCX_CHECK_STATUS(status);
 }
 
@@ -585,7 +676,9 @@ shmem_transport_fetch_atomic_nbi(shmem_transport_ctx_t* ctx, void *target, const
     ucs_status_ptr_t pstatus;
     uint64_t value;
 
-    shmem_transport_ucx_get_mr(target, pe, &remote_addr, &rkey);
+    shmem_transport_ucx_conn_t *conn = shmem_transport_ucx_get_conn(ctx, pe);
+
+    shmem_transport_ucx_get_mr(conn, target, pe, &remote_addr, &rkey);
 
     shmem_internal_assert(op <= SHMEM_TRANSPORT_UCX_OP_LAST);
 
@@ -606,13 +699,13 @@ shmem_transport_fetch_atomic_nbi(shmem_transport_ctx_t* ctx, void *target, const
             RAISE_ERROR_MSG("Unsupported datatype len=%zu\n", len);
     }
 
-    pstatus = ucp_atomic_fetch_nb(shmem_transport_peers[pe].ep,
+    pstatus = ucp_atomic_fetch_nb(conn->ep,
                                   shmem_transport_ucx_fetch_op[op], value,
                                   dest, len, (uint64_t) remote_addr, rkey,
                                   &shmem_transport_ucx_cb_nop);
 
     /* Manual progress to avoid deadlock for application-level polling */
-    shmem_transport_probe();
+    shmem_transport_ucx_progress(ctx);
 
     ucs_status_t status = shmem_transport_ucx_release_op(pstatus);
     UCX_CHECK_STATUS_INPROGRESS(status);
@@ -627,13 +720,15 @@ shmem_transport_atomic_fetch(shmem_transport_ctx_t* ctx, void *target, const voi
     ucp_rkey_h rkey;
     ucs_status_ptr_t pstatus;
 
-    shmem_transport_ucx_get_mr(source, pe, &remote_addr, &rkey);
+    shmem_transport_ucx_conn_t *conn = shmem_transport_ucx_get_conn(ctx, pe);
+
+    shmem_transport_ucx_get_mr(conn, source, pe, &remote_addr, &rkey);
 
-    pstatus = ucp_atomic_fetch_nb(shmem_transport_peers[pe].ep, UCP_ATOMIC_FETCH_OP_FADD, 0,
+    pstatus = ucp_atomic_fetch_nb(conn->ep, UCP_ATOMIC_FETCH_OP_FADD, 0,
                                   target, len, (uint64_t) remote_addr, rkey,
                                   &shmem_transport_ucx_cb_nop);
 
-    ucs_status_t status = shmem_transport_ucx_complete_op(pstatus);
+    ucs_status_t status = shmem_transport_ucx_complete_op(ctx, pstatus);
     UCX_CHECK_STATUS(status);
 }
 
@@ -652,7 +747,9 @@ shmem_transport_atomic_set(shmem_transport_ctx_t* ctx, void *target, const void
      * completion before returning. */
     static uint64_t dest;
 
-    shmem_transport_ucx_get_mr(target, pe, &remote_addr, &rkey);
+    shmem_transport_ucx_conn_t *conn = shmem_transport_ucx_get_conn(ctx, pe);
+
+    shmem_transport_ucx_get_mr(conn, target, pe, &remote_addr, &rkey);
 
     switch (len) {
         case 1:
@@ -671,7 +768,7 @@ shmem_transport_atomic_set(shmem_transport_ctx_t* ctx, void *target, const void
             RAISE_ERROR_MSG("Unsupported datatype len=%zu\n", len);
     }
 
-    pstatus = ucp_atomic_fetch_nb(shmem_transport_peers[pe].ep, UCP_ATOMIC_FETCH_OP_SWAP, value,
+    pstatus = ucp_atomic_fetch_nb(conn->ep, UCP_ATOMIC_FETCH_OP_SWAP, value,
                                   &dest, len, (uint64_t) remote_addr, rkey,
                                   &shmem_transport_ucx_cb_nop);
 
@@ -689,7 +786,9 @@ shmem_transport_mswap(shmem_transport_ctx_t* ctx, void *target, const void *sour
     ucp_rkey_h rkey;
     int done = 0;
 
-    shmem_transport_ucx_get_mr(target, pe, &remote_addr, &rkey);
+    shmem_transport_ucx_conn_t *conn = shmem_transport_ucx_get_conn(ctx, pe);
+
+    shmem_transport_ucx_get_mr(conn, target, pe, &remote_addr, &rkey);
 
     if (len != 4)
         RAISE_ERROR_STR("Unsupported datatype");
@@ -706,7 +805,7 @@ shmem_transport_mswap(shmem_transport_ctx_t* ctx, void *target, const void *sour
         if (*(uint32_t *)dest == v) done = 1;
 
         /* Manual progress to avoid deadlock for application-level polling */
-        shmem_transport_probe();
+        shmem_transport_ucx_progress(ctx);
     }
 }
 
@@ -808,9 +907,11 @@ uint64_t shmem_transport_received_cntr_get(void)
  * equal to the given value.
  *
  * @param ge_val Function returns when received messages >= ge_val
+ * @param timeout_ms Function may return after this many milliseconds,
+ *                   waits indefinitely when negative
  */
 static inline
-void shmem_transport_received_cntr_wait(uint64_t ge_val)
+void shmem_transport_received_cntr_wait(uint64_t ge_val, int timeout_ms)
 {
     RAISE_ERROR_STR("Transport does not support received counter");
 }
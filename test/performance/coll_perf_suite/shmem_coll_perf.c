@@ -0,0 +1,508 @@
+/*
+ *  Copyright (c) 2018 Intel Corporation. All rights reserved.
+ *  This software is available to you under the BSD license below:
+ *
+ *      Redistribution and use in source and binary forms, with or
+ *      without modification, are permitted provided that the following
+ *      conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Collective latency and bandwidth.  For each selected collective, team
+ * shape, and message size, every member of the team times each call of the
+ * collective, with a team sync between calls.  The minimum, average, and
+ * maximum over the team members of the per-PE average latency are reported,
+ * along with the algorithmic bandwidth (bytes delivered to each PE divided by
+ * the average latency).  Collective algorithms are selected through the
+ * library's environment variables, which are echoed in the output so that
+ * results of several runs can be compared; see shmem_coll_tune.py.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <float.h>
+#include <unistd.h>
+#include <time.h>
+#include <shmem.h>
+
+enum coll_op {
+    OP_BARRIER = 0,
+    OP_BCAST,
+    OP_REDUCE,
+    OP_FCOLLECT,
+    OP_COLLECT,
+    OP_ALLTOALL,
+    OP_ALLTOALLS,
+    NUM_OPS
+};
+
+static const struct {
+    const char *name;
+    const char *alg_env;        /* Environment variable selecting the algorithm */
+    int         sized;          /* Swept over message sizes */
+} coll_ops[NUM_OPS] = {
+    { "barrier",   "SHMEM_BARRIER_ALGORITHM",  0 },
+    { "bcast",     "SHMEM_BCAST_ALGORITHM",    1 },
+    { "reduce",    "SHMEM_REDUCE_ALGORITHM",   1 },
+    { "fcollect",  "SHMEM_FCOLLECT_ALGORITHM", 1 },
+    { "collect",   "SHMEM_COLLECT_ALGORITHM",  1 },
+    { "alltoall",  NULL,                       1 },
+    { "alltoalls", NULL,                       1 },
+};
+
+enum team_shape {
+    SHAPE_WORLD = 0,
+    SHAPE_SHARED,
+    SHAPE_STRIDED,
+    SHAPE_SPLIT2D,
+    SHAPE_POW2,
+    NUM_SHAPES
+};
+
+static const char *shape_names[NUM_SHAPES] = {
+    "world", "shared", "strided", "split2d", "pow2"
+};
+
+enum out_format { FMT_TEXT, FMT_CSV, FMT_JSON };
+
+/* Stride of the alltoalls destination and source arrays */
+#define ALLTOALLS_STRIDE 2
+
+static int ops_enabled[NUM_OPS];
+static int shapes_enabled[NUM_SHAPES];
+static size_t min_size = 8;
+static size_t max_size = 65536;
+static int niters = 100;
+static int nwarmup = 10;
+static enum out_format format = FMT_TEXT;
+static FILE *out;
+static int nrecords = 0;
+
+static int me, npes;
+static char *src_buf, *dest_buf;
+
+static double lat_in, lat_min, lat_max, lat_sum;
+static double lat_in_min, lat_in_max;
+static int member_in, member_cnt;
+
+static double
+wtime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1.0e9;
+}
+
+static const char *
+env_or(const char *name, const char *dflt)
+{
+    const char *val = name ? getenv(name) : NULL;
+    return val ? val : dflt;
+}
+
+static void
+do_op(enum coll_op op, shmem_team_t team, size_t size)
+{
+    switch (op) {
+        case OP_BARRIER:
+            shmem_team_sync(team);
+            break;
+        case OP_BCAST:
+            shmem_broadcastmem(team, dest_buf, src_buf, size, 0);
+            break;
+        case OP_REDUCE:
+            shmem_double_sum_reduce(team, (double *) dest_buf, (double *) src_buf,
+                                    size / sizeof(double));
+            break;
+        case OP_FCOLLECT:
+            shmem_fcollectmem(team, dest_buf, src_buf, size);
+            break;
+        case OP_COLLECT:
+            shmem_collectmem(team, dest_buf, src_buf, size);
+            break;
+        case OP_ALLTOALL:
+            shmem_alltoallmem(team, dest_buf, src_buf, size);
+            break;
+        case OP_ALLTOALLS:
+            shmem_alltoallsmem(team, dest_buf, src_buf, ALLTOALLS_STRIDE,
+                               ALLTOALLS_STRIDE, size);
+            break;
+        default:
+            break;
+    }
+}
+
+/* Bytes delivered to each PE by one call */
+static size_t
+op_bytes(enum coll_op op, size_t size, int team_npes)
+{
+    switch (op) {
+        case OP_BARRIER:
+            return 0;
+        case OP_BCAST:
+        case OP_REDUCE:
+            return size;
+        default:
+            return size * team_npes;
+    }
+}
+
+static void
+print_header(void)
+{
+    if (me != 0) return;
+
+    switch (format) {
+        case FMT_CSV:
+            fprintf(out, "collective,algorithm,radix,team,team_size,npes,bytes,"
+                    "iterations,lat_min_us,lat_avg_us,lat_max_us,algbw_MBps\n");
+            break;
+        case FMT_JSON:
+            fprintf(out, "[\n");
+            break;
+        default:
+            fprintf(out, "# %-10s %-8s %-6s %-10s %6s %10s %12s %12s %12s %12s\n",
+                    "coll", "alg", "radix", "team", "npes", "bytes", "min(us)",
+                    "avg(us)", "max(us)", "algbw(MB/s)");
+    }
+}
+
+static void
+print_footer(void)
+{
+    if (me != 0) return;
+
+    if (format == FMT_JSON)
+        fprintf(out, "\n]\n");
+}
+
+static void
+print_record(enum coll_op op, const char *team_name, int team_npes, size_t size,
+             double min, double avg, double max)
+{
+    const char *alg = coll_ops[op].alg_env ? env_or(coll_ops[op].alg_env, "auto") : "n/a";
+    const char *radix = env_or("SHMEM_COLL_RADIX", "default");
+    size_t bytes = op_bytes(op, size, team_npes);
+    double bw = (bytes > 0 && avg > 0) ? bytes / avg : 0.0;
+
+    if (me != 0) return;
+
+    switch (format) {
+        case FMT_CSV:
+            fprintf(out, "%s,%s,%s,%s,%d,%d,%zu,%d,%.3f,%.3f,%.3f,%.3f\n",
+                    coll_ops[op].name, alg, radix, team_name, team_npes, npes,
+                    size, niters, min, avg, max, bw);
+            break;
+        case FMT_JSON:
+            fprintf(out, "%s  {\"collective\": \"%s\", \"algorithm\": \"%s\", "
+                    "\"radix\": \"%s\", \"team\": \"%s\", \"team_size\": %d, "
+                    "\"npes\": %d, \"bytes\": %zu, \"iterations\": %d, "
+                    "\"lat_min_us\": %.3f, \"lat_avg_us\": %.3f, "
+                    "\"lat_max_us\": %.3f, \"algbw_MBps\": %.3f}",
+                    nrecords > 0 ? ",\n" : "", coll_ops[op].name, alg, radix,
+                    team_name, team_npes, npes, size, niters, min, avg, max, bw);
+            break;
+        default:
+            fprintf(out, "  %-10s %-8s %-6s %-10s %6d %10zu %12.3f %12.3f %12.3f %12.3f\n",
+                    coll_ops[op].name, alg, radix, team_name, team_npes, size,
+                    min, avg, max, bw);
+    }
+
+    fflush(out);
+    nrecords++;
+}
+
+/* Time one collective and message size on a team.  Called by all PEs; PEs
+ * that are not members of the team pass SHMEM_TEAM_INVALID.  Teams of the
+ * same shape (e.g. the rows of a 2D split) run concurrently. */
+static void
+bench_op(enum coll_op op, shmem_team_t team, const char *team_name, size_t size)
+{
+    int team_npes = 0;
+    int i;
+
+    shmem_barrier_all();
+
+    if (team != SHMEM_TEAM_INVALID) {
+        double total = 0.0;
+
+        team_npes = shmem_team_n_pes(team);
+
+        for (i = 0; i < nwarmup + niters; i++) {
+            double start;
+
+            shmem_team_sync(team);
+            start = wtime();
+            do_op(op, team, size);
+            if (i >= nwarmup)
+                total += wtime() - start;
+        }
+
+        lat_in     = total / niters * 1.0e6;
+        lat_in_min = lat_in;
+        lat_in_max = lat_in;
+        member_in  = 1;
+    } else {
+        lat_in     = 0.0;
+        lat_in_min = DBL_MAX;
+        lat_in_max = 0.0;
+        member_in  = 0;
+    }
+
+    shmem_barrier_all();
+
+    shmem_double_min_reduce(SHMEM_TEAM_WORLD, &lat_min, &lat_in_min, 1);
+    shmem_double_max_reduce(SHMEM_TEAM_WORLD, &lat_max, &lat_in_max, 1);
+    shmem_double_sum_reduce(SHMEM_TEAM_WORLD, &lat_sum, &lat_in, 1);
+    shmem_int_sum_reduce(SHMEM_TEAM_WORLD, &member_cnt, &member_in, 1);
+
+    /* PE 0 is a member of the first team of every shape */
+    print_record(op, team_name, team_npes, size, lat_min, lat_sum / member_cnt, lat_max);
+}
+
+static void
+bench_team(shmem_team_t team, const char *team_name)
+{
+    int op;
+    size_t size;
+
+    for (op = 0; op < NUM_OPS; op++) {
+        if (!ops_enabled[op]) continue;
+
+        if (!coll_ops[op].sized) {
+            bench_op(op, team, team_name, 0);
+            continue;
+        }
+
+        for (size = min_size; size <= max_size; size *= 2) {
+            /* Reductions operate on whole doubles */
+            if (op == OP_REDUCE && size < sizeof(double))
+                continue;
+            bench_op(op, team, team_name, size);
+        }
+    }
+}
+
+static void
+bench_shape(enum team_shape shape)
+{
+    shmem_team_t team = SHMEM_TEAM_INVALID, team_y = SHMEM_TEAM_INVALID;
+    char name[32];
+    int xrange, k;
+
+    switch (shape) {
+        case SHAPE_WORLD:
+            bench_team(SHMEM_TEAM_WORLD, "world");
+            break;
+
+        case SHAPE_SHARED:
+            bench_team(SHMEM_TEAM_SHARED, "shared");
+            break;
+
+        case SHAPE_STRIDED:
+            /* Every other PE */
+            if (npes < 2) break;
+            shmem_team_split_strided(SHMEM_TEAM_WORLD, 0, 2, (npes + 1) / 2, NULL, 0, &team);
+            bench_team(team, "strided");
+            if (team != SHMEM_TEAM_INVALID) shmem_team_destroy(team);
+            break;
+
+        case SHAPE_SPLIT2D:
+            /* Closest to square grid, rows are the x-axis teams */
+            for (xrange = 1; (xrange + 1) * (xrange + 1) <= npes; xrange++)
+                ;
+            shmem_team_split_2d(SHMEM_TEAM_WORLD, xrange, NULL, 0, &team, NULL, 0, &team_y);
+            bench_team(team, "split2d-x");
+            bench_team(team_y, "split2d-y");
+            if (team != SHMEM_TEAM_INVALID) shmem_team_destroy(team);
+            if (team_y != SHMEM_TEAM_INVALID) shmem_team_destroy(team_y);
+            break;
+
+        case SHAPE_POW2:
+            /* Teams of the first 2, 4, 8, ... PEs, used to find PE count
+             * crossovers */
+            for (k = 2; k <= npes; k *= 2) {
+                shmem_team_split_strided(SHMEM_TEAM_WORLD, 0, 1, k, NULL, 0, &team);
+                snprintf(name, sizeof(name), "pow2-%d", k);
+                bench_team(team, name);
+                if (team != SHMEM_TEAM_INVALID) shmem_team_destroy(team);
+                team = SHMEM_TEAM_INVALID;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+static int
+parse_list(char *arg, const char **names, int nnames, int *enabled)
+{
+    char *tok, *save = NULL;
+    int i;
+
+    memset(enabled, 0, nnames * sizeof(int));
+
+    for (tok = strtok_r(arg, ",", &save); tok != NULL; tok = strtok_r(NULL, ",", &save)) {
+        if (strcmp(tok, "all") == 0) {
+            for (i = 0; i < nnames; i++) enabled[i] = 1;
+            continue;
+        }
+
+        for (i = 0; i < nnames; i++) {
+            if (strcmp(tok, names[i]) == 0) {
+                enabled[i] = 1;
+                break;
+            }
+        }
+
+        if (i == nnames) {
+            if (me == 0) fprintf(stderr, "Unknown name '%s'\n", tok);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static void
+usage(void)
+{
+    if (me == 0) {
+        printf("Usage: shmem_coll_perf [options]\n"
+               "  -c LIST  collectives: barrier,bcast,reduce,fcollect,collect,\n"
+               "           alltoall,alltoalls or all (default: all)\n"
+               "  -t LIST  team shapes: world,shared,strided,split2d,pow2 or all\n"
+               "           (default: world)\n"
+               "  -s SIZE  smallest message size in bytes (default: %zu)\n"
+               "  -e SIZE  largest message size in bytes (default: %zu)\n"
+               "  -n NUM   timed iterations (default: %d)\n"
+               "  -w NUM   warmup iterations (default: %d)\n"
+               "  -f FMT   output format: text, csv, json (default: text)\n"
+               "  -o FILE  write results to FILE instead of stdout\n"
+               "  -h       print this help\n",
+               min_size, max_size, niters, nwarmup);
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    const char *op_names[NUM_OPS];
+    const char *out_path = NULL;
+    size_t buf_size;
+    int ch, i, ret = 0;
+
+    shmem_init();
+
+    me = shmem_my_pe();
+    npes = shmem_n_pes();
+
+    for (i = 0; i < NUM_OPS; i++) {
+        op_names[i] = coll_ops[i].name;
+        ops_enabled[i] = 1;
+    }
+    shapes_enabled[SHAPE_WORLD] = 1;
+
+    while ((ch = getopt(argc, argv, "c:t:s:e:n:w:f:o:h")) != -1) {
+        switch (ch) {
+            case 'c':
+                ret = parse_list(optarg, op_names, NUM_OPS, ops_enabled);
+                break;
+            case 't':
+                ret = parse_list(optarg, shape_names, NUM_SHAPES, shapes_enabled);
+                break;
+            case 's':
+                min_size = strtoul(optarg, NULL, 0);
+                break;
+            case 'e':
+                max_size = strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                niters = atoi(optarg);
+                break;
+            case 'w':
+                nwarmup = atoi(optarg);
+                break;
+            case 'f':
+                if (strcmp(optarg, "text") == 0) format = FMT_TEXT;
+                else if (strcmp(optarg, "csv") == 0) format = FMT_CSV;
+                else if (strcmp(optarg, "json") == 0) format = FMT_JSON;
+                else ret = 1;
+                break;
+            case 'o':
+                out_path = optarg;
+                break;
+            case 'h':
+            default:
+                ret = 1;
+                break;
+        }
+    }
+
+    if (ret != 0 || min_size == 0 || min_size > max_size || niters <= 0 || nwarmup < 0) {
+        usage();
+        shmem_finalize();
+        return ret != 0 ? 1 : 0;
+    }
+
+    out = stdout;
+    if (me == 0 && out_path != NULL) {
+        out = fopen(out_path, "w");
+        if (out == NULL) {
+            fprintf(stderr, "Unable to open '%s'\n", out_path);
+            shmem_global_exit(1);
+        }
+    }
+
+    /* Large enough for the strided alltoall over all PEs */
+    buf_size = max_size * npes * ALLTOALLS_STRIDE;
+    src_buf = shmem_malloc(buf_size);
+    dest_buf = shmem_malloc(buf_size);
+
+    if (src_buf == NULL || dest_buf == NULL) {
+        if (me == 0)
+            fprintf(stderr, "Unable to allocate %zu byte buffers, reduce -e\n", buf_size);
+        shmem_global_exit(1);
+    }
+
+    memset(src_buf, me & 0xff, buf_size);
+    memset(dest_buf, 0, buf_size);
+
+    print_header();
+
+    for (i = 0; i < NUM_SHAPES; i++)
+        if (shapes_enabled[i])
+            bench_shape(i);
+
+    print_footer();
+
+    if (me == 0 && out != stdout)
+        fclose(out);
+
+    shmem_free(dest_buf);
+    shmem_free(src_buf);
+
+    shmem_finalize();
+
+    return 0;
+}
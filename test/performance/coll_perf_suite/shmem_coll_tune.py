@@ -0,0 +1,231 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2018 Intel Corporation. All rights reserved.
+# This software is available to you under the BSD license.
+#
+# This file is part of the Sandia OpenSHMEM software package. For license
+# information, see the LICENSE file in the top level directory of the
+# distribution.
+
+"""Derive collective tuning parameters for a machine.
+
+Runs shmem_coll_perf under each algorithm and radix setting of interest,
+using the given launcher, and prints the SHMEM_* environment settings that
+minimized latency:
+
+  SHMEM_COLL_CROSSOVER       smallest team size at which tree barrier and
+                             broadcast beat the linear algorithms
+  SHMEM_COLL_SIZE_CROSSOVER  smallest message size at which the ring
+                             reduction beats recursive doubling
+  SHMEM_COLL_RADIX           tree radix with the lowest barrier and broadcast
+                             latency
+  SHMEM_FCOLLECT_ALGORITHM   fastest fcollect algorithm over the message
+                             size range
+
+The fcollect latency of each algorithm at each message size is printed as
+comments, showing where each algorithm wins.  With --table, the settings
+are also written as a collective tuning table that the library loads
+through SHMEM_COLL_TUNING_FILE, with an fcollect rule for each message size
+range won by a different algorithm.
+
+The launcher must propagate the environment to the PEs (e.g. Hydra does
+by default; with Open MPI add the variables with --env-flag=-x).
+
+Example:
+  shmem_coll_tune.py --launcher "oshrun -n 64" --table coll.tune ./shmem_coll_perf
+"""
+
+import argparse
+import csv
+import io
+import os
+import shlex
+import subprocess
+import sys
+
+
+def run_bench(args, colls, shape, env, smin=None, smax=None):
+    cmd = shlex.split(args.launcher)
+    for name, val in env.items():
+        if args.env_flag:
+            cmd += [args.env_flag, name]
+    cmd += [args.bench, "-f", "csv", "-c", ",".join(colls), "-t", shape,
+            "-n", str(args.iters), "-w", str(args.warmup),
+            "-s", str(smin or args.min_size), "-e", str(smax or args.max_size)]
+
+    run_env = dict(os.environ)
+    run_env.update(env)
+
+    if args.verbose:
+        print("# " + " ".join("%s=%s" % kv for kv in env.items()) + " " +
+              " ".join(cmd), file=sys.stderr)
+
+    proc = subprocess.run(cmd, env=run_env, stdout=subprocess.PIPE,
+                          universal_newlines=True)
+    if proc.returncode != 0:
+        print("# run failed (%d): %s" % (proc.returncode, " ".join(cmd)),
+              file=sys.stderr)
+        return []
+
+    # Skip launcher noise before the CSV header
+    text = proc.stdout
+    start = text.find("collective,")
+    if start < 0:
+        return []
+
+    rows = []
+    for row in csv.DictReader(io.StringIO(text[start:])):
+        try:
+            row["team_size"] = int(row["team_size"])
+            row["bytes"] = int(row["bytes"])
+            row["lat_avg_us"] = float(row["lat_avg_us"])
+        except (KeyError, ValueError):
+            continue
+        rows.append(row)
+    return rows
+
+
+def index(rows, key):
+    return {(r["collective"], r[key]): r["lat_avg_us"] for r in rows}
+
+
+def tune_coll_crossover(args):
+    """Team size crossover between linear and tree barrier/broadcast."""
+    colls = ["barrier", "bcast"]
+    lat = {}
+    for alg in ("linear", "tree"):
+        env = {"SHMEM_BARRIER_ALGORITHM": alg, "SHMEM_BCAST_ALGORITHM": alg}
+        lat[alg] = index(run_bench(args, colls, "pow2", env, 8, 8), "team_size")
+
+    sizes = sorted({k[1] for k in lat["linear"]} & {k[1] for k in lat["tree"]})
+    for size in sizes:
+        lin = sum(lat["linear"].get((c, size), 0.0) for c in colls)
+        tree = sum(lat["tree"].get((c, size), 0.0) for c in colls)
+        if tree < lin:
+            return size
+    return None if not sizes else sizes[-1] * 2
+
+
+def tune_size_crossover(args):
+    """Message size crossover between recursive doubling and ring reduce."""
+    lat = {}
+    for alg in ("recdbl", "ring"):
+        env = {"SHMEM_REDUCE_ALGORITHM": alg}
+        lat[alg] = index(run_bench(args, ["reduce"], "world", env), "bytes")
+
+    sizes = sorted({k[1] for k in lat["recdbl"]} & {k[1] for k in lat["ring"]})
+    for size in sizes:
+        if lat["ring"][("reduce", size)] < lat["recdbl"][("reduce", size)]:
+            return size
+    return None if not sizes else sizes[-1] * 2
+
+
+def tune_radix(args):
+    """Tree radix with the lowest barrier plus small broadcast latency."""
+    best = None
+    env = {"SHMEM_BARRIER_ALGORITHM": "tree", "SHMEM_BCAST_ALGORITHM": "tree"}
+    for radix in args.radices:
+        env["SHMEM_COLL_RADIX"] = str(radix)
+        rows = run_bench(args, ["barrier", "bcast"], "world", env, 8, 8)
+        if not rows:
+            continue
+        total = sum(r["lat_avg_us"] for r in rows)
+        if best is None or total < best[1]:
+            best = (radix, total)
+    return best[0] if best else None
+
+
+def tune_fcollect(args, algs):
+    """Latency of each fcollect algorithm at each message size.  Prints the
+    comparison and returns the fastest algorithm over the size range and the
+    (smallest size, algorithm) of each range of sizes won by one algorithm."""
+    lat = {}
+    for alg in algs:
+        rows = run_bench(args, ["fcollect"], "world",
+                         {"SHMEM_FCOLLECT_ALGORITHM": alg})
+        if rows:
+            lat[alg] = {r["bytes"]: r["lat_avg_us"] for r in rows}
+    if not lat:
+        return None, []
+
+    algs = [a for a in algs if a in lat]
+    sizes = sorted(set.intersection(*(set(lat[a]) for a in algs)))
+
+    print("# fcollect latency (us)")
+    print("# %10s" % "bytes" + "".join("%10s" % a for a in algs) + "  fastest")
+    ranges = []
+    for size in sizes:
+        best = min(algs, key=lambda a: lat[a][size])
+        print("# %10d" % size + "".join("%10.2f" % lat[a][size] for a in algs) +
+              "  " + best)
+        if not ranges or ranges[-1][1] != best:
+            ranges.append((size, best))
+
+    overall = min(algs, key=lambda a: sum(lat[a][s] for s in sizes))
+    return ("SHMEM_FCOLLECT_ALGORITHM", overall), ranges
+
+
+def write_table(path, settings, fcollect_ranges, npes_hint):
+    """Write the settings in the SHMEM_COLL_TUNING_FILE format."""
+    directives = {"SHMEM_COLL_CROSSOVER": "crossover",
+                  "SHMEM_COLL_SIZE_CROSSOVER": "size_crossover",
+                  "SHMEM_COLL_RADIX": "radix"}
+    with open(path, "w") as f:
+        f.write("# Collective tuning table written by shmem_coll_tune.py (%s)\n"
+                % npes_hint)
+        f.write("# <collective> <min PEs> <min bytes> <algorithm>\n")
+        for name, val in settings:
+            if name in directives:
+                f.write("%s %s\n" % (directives[name], val))
+        for i, (size, alg) in enumerate(fcollect_ranges):
+            f.write("fcollect 1 %d %s\n" % (0 if i == 0 else size, alg))
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("bench", help="path to shmem_coll_perf")
+    parser.add_argument("--launcher", default="oshrun -n 2",
+                        help="command used to launch the benchmark")
+    parser.add_argument("--env-flag", default=None,
+                        help="launcher flag that exports one variable (e.g. -x)")
+    parser.add_argument("--min-size", type=int, default=8)
+    parser.add_argument("--max-size", type=int, default=1 << 20)
+    parser.add_argument("--iters", type=int, default=100)
+    parser.add_argument("--warmup", type=int, default=10)
+    parser.add_argument("--radices", type=int, nargs="+", default=[2, 4, 8, 16])
+    parser.add_argument("--table", default=None,
+                        help="also write the settings as a tuning table file")
+    parser.add_argument("-v", "--verbose", action="store_true")
+    args = parser.parse_args()
+
+    settings = []
+
+    val = tune_coll_crossover(args)
+    if val is not None:
+        settings.append(("SHMEM_COLL_CROSSOVER", val))
+
+    val = tune_size_crossover(args)
+    if val is not None:
+        settings.append(("SHMEM_COLL_SIZE_CROSSOVER", val))
+
+    val = tune_radix(args)
+    if val is not None:
+        settings.append(("SHMEM_COLL_RADIX", val))
+
+    val, fcollect_ranges = tune_fcollect(
+        args, ["linear", "ring", "recdbl", "bruck", "neighbor"])
+    if val is not None:
+        settings.append(val)
+
+    for name, val in settings:
+        print("export %s=%s" % (name, val))
+
+    if args.table and settings:
+        write_table(args.table, settings, fcollect_ranges, args.launcher)
+
+    return 0 if settings else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
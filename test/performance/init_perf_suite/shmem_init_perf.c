@@ -0,0 +1,164 @@
+/*
+ *  Copyright (c) 2018 Intel Corporation. All rights reserved.
+ *  This software is available to you under the BSD license below:
+ *
+ *      Redistribution and use in source and binary forms, with or
+ *      without modification, are permitted provided that the following
+ *      conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Startup cost at the current PE count.  Each PE times shmem_init, the first
+ * barrier after it, and a first put to every other PE, which includes any
+ * connection or address setup the transport defers to first use.  The
+ * minimum, average, and maximum over the PEs are reported.  Per-phase times
+ * within shmem_init are reported by the library when SHMEM_INIT_TIMING is
+ * set; shmem_init_scaling.py runs this program over a range of PE counts and
+ * tabulates both.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <shmem.h>
+
+enum metric {
+    M_INIT = 0,
+    M_BARRIER,
+    M_CONTACT,
+    NUM_METRICS
+};
+
+static const char *metric_names[NUM_METRICS] = { "init", "first_barrier", "first_contact" };
+
+/* Max reduction over {t, -t}, which yields the max and min, then a sum */
+static double times[3 * NUM_METRICS];
+static double results[3 * NUM_METRICS];
+static long contact_buf;
+
+static double
+wtime(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1.0e9;
+}
+
+static void
+usage(void)
+{
+    printf("Usage: shmem_init_perf [-f text|csv] [-H]\n"
+           "  -f : output format                          DEFAULT: text\n"
+           "  -H : omit the header line\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    double t, init_time;
+    int me, npes, i, ch, csv = 0, header = 1, ret = 0;
+
+    t = wtime();
+    shmem_init();
+    init_time = wtime() - t;
+
+    me = shmem_my_pe();
+    npes = shmem_n_pes();
+
+    while ((ch = getopt(argc, argv, "f:Hh")) != -1) {
+        switch (ch) {
+            case 'f':
+                if (strcmp(optarg, "text") == 0) csv = 0;
+                else if (strcmp(optarg, "csv") == 0) csv = 1;
+                else ret = 1;
+                break;
+            case 'H':
+                header = 0;
+                break;
+            case 'h':
+            default:
+                ret = 1;
+                break;
+        }
+    }
+
+    if (ret != 0) {
+        if (me == 0) usage();
+        shmem_finalize();
+        return 1;
+    }
+
+    times[M_INIT] = init_time;
+
+    t = wtime();
+    shmem_barrier_all();
+    times[M_BARRIER] = wtime() - t;
+
+    /* Touch every other PE once, starting with the next one to spread the
+     * traffic */
+    t = wtime();
+    for (i = 1; i < npes; i++)
+        shmem_long_p(&contact_buf, me, (me + i) % npes);
+    shmem_quiet();
+    times[M_CONTACT] = wtime() - t;
+
+    for (i = 0; i < NUM_METRICS; i++) {
+        times[NUM_METRICS + i] = -times[i];
+        times[2 * NUM_METRICS + i] = times[i];
+    }
+
+    shmem_barrier_all();
+    shmem_double_max_reduce(SHMEM_TEAM_WORLD, results, times, 2 * NUM_METRICS);
+    shmem_double_sum_reduce(SHMEM_TEAM_WORLD, results + 2 * NUM_METRICS,
+                            times + 2 * NUM_METRICS, NUM_METRICS);
+
+    if (me == 0) {
+        if (csv) {
+            if (header) {
+                printf("npes");
+                for (i = 0; i < NUM_METRICS; i++)
+                    printf(",%s_min_s,%s_avg_s,%s_max_s", metric_names[i],
+                           metric_names[i], metric_names[i]);
+                printf("\n");
+            }
+            printf("%d", npes);
+            for (i = 0; i < NUM_METRICS; i++)
+                printf(",%.6f,%.6f,%.6f", -results[NUM_METRICS + i],
+                       results[2 * NUM_METRICS + i] / npes, results[i]);
+            printf("\n");
+        } else {
+            if (header)
+                printf("%-16s %8s %12s %12s %12s\n", "# metric", "npes",
+                       "min (s)", "avg (s)", "max (s)");
+            for (i = 0; i < NUM_METRICS; i++)
+                printf("%-16s %8d %12.6f %12.6f %12.6f\n", metric_names[i], npes,
+                       -results[NUM_METRICS + i], results[2 * NUM_METRICS + i] / npes,
+                       results[i]);
+        }
+        fflush(stdout);
+    }
+
+    shmem_finalize();
+
+    return 0;
+}
@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2018 Intel Corporation. All rights reserved.
+# This software is available to you under the BSD license.
+#
+# This file is part of the Sandia OpenSHMEM software package. For license
+# information, see the LICENSE file in the top level directory of the
+# distribution.
+
+"""Tabulate OpenSHMEM startup cost against the number of PEs.
+
+Runs shmem_init_perf with SHMEM_INIT_TIMING=1 at each PE count, using the
+given launcher, and prints the maximum over the PEs of each initialization
+phase reported by the library, followed by the shmem_init, first barrier
+and first contact times measured by the benchmark.
+
+The launcher command must contain {n}, which is replaced by the PE count,
+and must propagate the environment to the PEs.  A library configured with
+--enable-pmi-simple can be launched on a single node with Hydra:
+
+  shmem_init_scaling.py --launcher "mpiexec.hydra -n {n}" ./shmem_init_perf
+"""
+
+import argparse
+import os
+import shlex
+import subprocess
+import sys
+
+PHASE_HEADER = "Initialization phase times"
+
+
+def run(args, npes):
+    cmd = shlex.split(args.launcher.replace("{n}", str(npes)))
+    if args.env_flag:
+        cmd += [args.env_flag, "SHMEM_INIT_TIMING"]
+    cmd += [args.bench, "-f", "csv"]
+
+    env = dict(os.environ)
+    env["SHMEM_INIT_TIMING"] = "1"
+
+    if args.verbose:
+        print("# " + " ".join(cmd), file=sys.stderr)
+
+    proc = subprocess.run(cmd, env=env, stdout=subprocess.PIPE,
+                          universal_newlines=True)
+    if proc.returncode != 0:
+        print("# run failed (%d): %s" % (proc.returncode, " ".join(cmd)),
+              file=sys.stderr)
+        return None
+
+    phases = {}
+    metrics = {}
+    lines = proc.stdout.splitlines()
+    in_phases = False
+    for i, line in enumerate(lines):
+        if line.startswith(PHASE_HEADER):
+            in_phases = True
+            continue
+        if in_phases:
+            fields = line.rsplit(None, 3)
+            if len(fields) != 4:
+                in_phases = False
+                continue
+            try:
+                phases[fields[0].strip()] = float(fields[3])
+            except ValueError:
+                pass    # Column header
+        elif line.startswith("npes,") and i + 1 < len(lines):
+            names = line.split(",")
+            values = lines[i + 1].split(",")
+            metrics = {k: float(v) for k, v in zip(names[1:], values[1:])
+                       if k.endswith("_max_s")}
+
+    return phases, metrics
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("bench", help="path to shmem_init_perf")
+    parser.add_argument("--launcher", default="mpiexec.hydra -n {n}",
+                        help="launch command, {n} is replaced by the PE count")
+    parser.add_argument("--env-flag", default=None,
+                        help="launcher flag that exports one variable (e.g. -x)")
+    parser.add_argument("--npes", default="1,2,4,8,16,32,64",
+                        help="comma separated PE counts")
+    parser.add_argument("-f", "--format", choices=["text", "csv"], default="text")
+    parser.add_argument("-v", "--verbose", action="store_true")
+    args = parser.parse_args()
+
+    if "{n}" not in args.launcher:
+        parser.error("the launcher must contain {n}")
+    try:
+        npes_list = [int(n) for n in args.npes.split(",")]
+    except ValueError:
+        parser.error("invalid PE count list: %s" % args.npes)
+
+    results = []
+    columns = []
+    for npes in npes_list:
+        res = run(args, npes)
+        if res is None:
+            continue
+        results.append((npes, res))
+        for name in list(res[0]) + list(res[1]):
+            if name not in columns:
+                columns.append(name)
+
+    if not results:
+        return 1
+
+    if args.format == "csv":
+        print(",".join(["npes"] + [c.replace(" ", "_") for c in columns]))
+        for npes, (phases, metrics) in results:
+            vals = [phases.get(c, metrics.get(c)) for c in columns]
+            print(",".join([str(npes)] + ["" if v is None else "%.6f" % v
+                                          for v in vals]))
+    else:
+        width = max(len(c) for c in columns) + 2
+        print("# maximum over PEs, in seconds")
+        print("%-*s" % (width, "phase") +
+              "".join("%12d" % npes for npes, _ in results))
+        for c in columns:
+            row = "%-*s" % (width, c)
+            for _, (phases, metrics) in results:
+                v = phases.get(c, metrics.get(c))
+                row += "%12s" % ("-" if v is None else "%.6f" % v)
+            print(row)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,344 @@
+/*
+ *  Copyright (c) 2018 Intel Corporation. All rights reserved.
+ *  This software is available to you under the BSD license below:
+ *
+ *      Redistribution and use in source and binary forms, with or
+ *      without modification, are permitted provided that the following
+ *      conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Atomic hot-spot contention.  A set of contending PEs issues blocking 64-bit
+ * atomics at words on PE 0, sweeping the number of contenders, the layout of
+ * the target words, and the operation:
+ *
+ *   layouts    : single (all contenders hit one word), line (contenders
+ *                share one cache line, one word each), spread (one cache
+ *                line per contender)
+ *   operations : fadd (fetch-add), cswap (compare-and-swap increment, using
+ *                the value returned by the previous attempt), swap, and
+ *                fxor (fetch-xor)
+ *
+ * Contenders are drawn from the PEs on PE 0's node (-l on), the other nodes
+ * (-l off), or all PEs (-l any, the default).  For each point the aggregate
+ * throughput is reported with the average latency, the worst median and 99th
+ * percentile over the contenders, and the maximum latency.  For cswap, the
+ * fraction of attempts that succeeded is reported as well.
+ *
+ * Whether on-node atomics are performed with processor atomics is a build
+ * setting (--enable-shr-atomics); compare builds with and without it to see
+ * its effect.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <shmem.h>
+
+#define WORDS_PER_LINE 8        /* 64 byte cache lines */
+
+enum amo_op {
+    OP_FADD = 0,
+    OP_CSWAP,
+    OP_SWAP,
+    OP_FXOR,
+    NUM_AMO_OPS
+};
+
+static const char *op_names[NUM_AMO_OPS] = { "fadd", "cswap", "swap", "fxor" };
+
+enum word_layout {
+    LAYOUT_SINGLE = 0,
+    LAYOUT_LINE,
+    LAYOUT_SPREAD,
+    NUM_LAYOUTS
+};
+
+static const char *layout_names[NUM_LAYOUTS] = { "single", "line", "spread" };
+
+enum locality {
+    LOC_ANY = 0,
+    LOC_ON,
+    LOC_OFF,
+    NUM_LOCALITIES
+};
+
+static const char *locality_names[NUM_LOCALITIES] = { "any", "on", "off" };
+
+static int niters = 1000;
+static int nwarmup = 100;
+
+static uint64_t *words;
+static double *lat;
+
+/* Max reduction over {time, p50, p99, max latency}, then a sum reduction over
+ * {ops, latency sum, successes} */
+static double max_in[4], max_out[4];
+static double sum_in[3], sum_out[3];
+
+static double
+wtime(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1.0e9;
+}
+
+static int
+cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+/* Returns 1 if the operation took effect, which only a cswap can fail to do */
+static inline int
+do_op(int op, uint64_t *word, uint64_t *cond)
+{
+    uint64_t old;
+
+    switch (op) {
+        case OP_FADD:
+            shmem_uint64_atomic_fetch_add(word, 1, 0);
+            return 1;
+        case OP_CSWAP:
+            old = shmem_uint64_atomic_compare_swap(word, *cond, *cond + 1, 0);
+            if (old == *cond) {
+                *cond = old + 1;
+                return 1;
+            }
+            *cond = old;
+            return 0;
+        case OP_SWAP:
+            shmem_uint64_atomic_swap(word, *cond, 0);
+            return 1;
+        default:
+            shmem_uint64_atomic_fetch_xor(word, *cond, 0);
+            return 1;
+    }
+}
+
+static void
+run(int op, int layout, int rank, int ncontend, int locality)
+{
+    uint64_t *word = words;
+    uint64_t cond = 0;
+    double start, t, total_time = 0;
+    long successes = 0;
+    int i;
+
+    if (layout == LAYOUT_LINE)
+        word = words + rank % WORDS_PER_LINE;
+    else if (layout == LAYOUT_SPREAD)
+        word = words + rank * WORDS_PER_LINE;
+
+    if (shmem_my_pe() == 0)
+        memset(words, 0, shmem_n_pes() * WORDS_PER_LINE * sizeof(uint64_t));
+
+    memset(max_in, 0, sizeof(max_in));
+    memset(sum_in, 0, sizeof(sum_in));
+
+    shmem_barrier_all();
+
+    if (rank >= 0 && rank < ncontend) {
+        for (i = 0; i < nwarmup; i++)
+            do_op(op, word, &cond);
+
+        start = wtime();
+        for (i = 0; i < niters; i++) {
+            t = wtime();
+            successes += do_op(op, word, &cond);
+            lat[i] = wtime() - t;
+        }
+        total_time = wtime() - start;
+
+        for (i = 0; i < niters; i++)
+            sum_in[1] += lat[i];
+
+        qsort(lat, niters, sizeof(double), cmp_double);
+
+        max_in[0] = total_time;
+        max_in[1] = lat[niters / 2];
+        max_in[2] = lat[(int) (niters * 0.99)];
+        max_in[3] = lat[niters - 1];
+        sum_in[0] = niters;
+        sum_in[2] = successes;
+    }
+
+    shmem_barrier_all();
+    shmem_double_max_reduce(SHMEM_TEAM_WORLD, max_out, max_in, 4);
+    shmem_double_sum_reduce(SHMEM_TEAM_WORLD, sum_out, sum_in, 3);
+
+    if (shmem_my_pe() == 0) {
+        printf("%-6s %-7s %-5s %6d %12.3f %10.2f %10.2f %10.2f %10.2f %8.3f\n",
+               op_names[op], layout_names[layout], locality_names[locality], ncontend,
+               sum_out[0] / max_out[0] / 1.0e6, sum_out[1] / sum_out[0] * 1.0e6,
+               max_out[1] * 1.0e6, max_out[2] * 1.0e6, max_out[3] * 1.0e6,
+               sum_out[2] / sum_out[0]);
+        fflush(stdout);
+    }
+}
+
+static int
+parse_list(char *arg, const char **names, int n, int *enabled)
+{
+    char *tok, *save = NULL;
+    int i;
+
+    for (i = 0; i < n; i++)
+        enabled[i] = (0 == strcmp(arg, "all"));
+    if (0 == strcmp(arg, "all"))
+        return 0;
+
+    for (tok = strtok_r(arg, ",", &save); tok != NULL; tok = strtok_r(NULL, ",", &save)) {
+        for (i = 0; i < n; i++)
+            if (0 == strcmp(tok, names[i])) break;
+        if (i == n) return 1;
+        enabled[i] = 1;
+    }
+
+    return 0;
+}
+
+static void
+usage(void)
+{
+    printf("Usage: atomic_contention [-n iterations] [-w warmup] [-c max contenders]\n"
+           "       [-o fadd,cswap,swap,fxor|all] [-L single,line,spread|all]\n"
+           "       [-l any|on|off] [-H]\n");
+}
+
+static int on_node;             /* Whether this PE shares a node with PE 0 */
+
+int
+main(int argc, char *argv[])
+{
+    int ops[NUM_AMO_OPS], layouts[NUM_LAYOUTS];
+    int locality = LOC_ANY;
+    int *on_node_all, *eligible;
+    int me, npes, i, j, c, ch, rank, neligible = 0, max_contend = 0;
+    int header = 1, ret = 0;
+
+    shmem_init();
+    me = shmem_my_pe();
+    npes = shmem_n_pes();
+
+    for (i = 0; i < NUM_AMO_OPS; i++) ops[i] = 1;
+    for (i = 0; i < NUM_LAYOUTS; i++) layouts[i] = 1;
+
+    while ((ch = getopt(argc, argv, "n:w:c:o:L:l:Hh")) != -1) {
+        switch (ch) {
+        case 'n':
+            niters = atoi(optarg);
+            break;
+        case 'w':
+            nwarmup = atoi(optarg);
+            break;
+        case 'c':
+            max_contend = atoi(optarg);
+            break;
+        case 'o':
+            ret = parse_list(optarg, op_names, NUM_AMO_OPS, ops);
+            break;
+        case 'L':
+            ret = parse_list(optarg, layout_names, NUM_LAYOUTS, layouts);
+            break;
+        case 'l':
+            for (locality = 0; locality < NUM_LOCALITIES; locality++)
+                if (strcmp(optarg, locality_names[locality]) == 0) break;
+            if (locality == NUM_LOCALITIES) ret = 1;
+            break;
+        case 'H':
+            header = 0;
+            break;
+        default:
+            ret = 1;
+            break;
+        }
+    }
+
+    if (ret != 0 || niters < 1 || nwarmup < 0 || max_contend < 0) {
+        if (me == 0) usage();
+        shmem_finalize();
+        return 1;
+    }
+
+    words = shmem_calloc(npes * WORDS_PER_LINE, sizeof(uint64_t));
+    on_node_all = shmem_calloc(npes, sizeof(int));
+    lat = malloc(niters * sizeof(double));
+    eligible = malloc(npes * sizeof(int));
+
+    if (words == NULL || on_node_all == NULL || lat == NULL || eligible == NULL) {
+        fprintf(stderr, "%d: Unable to allocate buffers\n", me);
+        shmem_global_exit(1);
+    }
+
+    on_node = shmem_team_translate_pe(SHMEM_TEAM_WORLD, 0, SHMEM_TEAM_SHARED) >= 0;
+    shmem_int_fcollect(SHMEM_TEAM_WORLD, on_node_all, &on_node, 1);
+
+    /* Remote contenders first; PE 0 contends on its own words last */
+    for (i = 1; i < npes; i++) {
+        if (locality == LOC_ANY ||
+            (locality == LOC_ON && on_node_all[i]) ||
+            (locality == LOC_OFF && !on_node_all[i]))
+            eligible[neligible++] = i;
+    }
+    if (locality == LOC_ANY)
+        eligible[neligible++] = 0;
+
+    if (max_contend == 0 || max_contend > neligible)
+        max_contend = neligible;
+
+    rank = -1;
+    for (i = 0; i < neligible; i++)
+        if (eligible[i] == me) rank = i;
+
+    if (me == 0) {
+        if (max_contend == 0)
+            printf("No contending PEs with locality '%s'\n", locality_names[locality]);
+        else if (header)
+            printf("%-6s %-7s %-5s %6s %12s %10s %10s %10s %10s %8s\n", "# op", "layout",
+                   "local", "PEs", "Mops/s", "avg (us)", "p50 (us)", "p99 (us)",
+                   "max (us)", "success");
+    }
+
+    for (i = 0; i < NUM_AMO_OPS; i++) {
+        if (!ops[i]) continue;
+        for (j = 0; j < NUM_LAYOUTS; j++) {
+            if (!layouts[j]) continue;
+            for (c = 1; c <= max_contend; c = (c * 2 > max_contend && c < max_contend) ?
+                     max_contend : c * 2)
+                run(i, j, rank, c, locality);
+        }
+    }
+
+    free(eligible);
+    free(lat);
+    shmem_free(on_node_all);
+    shmem_free(words);
+
+    shmem_finalize();
+    return 0;
+}
@@ -0,0 +1,353 @@
+/*
+ *  Copyright (c) 2018 Intel Corporation. All rights reserved.
+ *  This software is available to you under the BSD license below:
+ *
+ *      Redistribution and use in source and binary forms, with or
+ *      without modification, are permitted provided that the following
+ *      conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Multithreaded message rate.  T threads per PE each issue windows of small
+ * puts or atomic adds to the next PE, followed by a quiet, through one of:
+ *
+ *   default    : SHMEM_CTX_DEFAULT, shared by all threads
+ *   shared     : one context created with no options, shared by all threads
+ *   private    : a SHMEM_CTX_PRIVATE context per thread
+ *   serialized : a SHMEM_CTX_SERIALIZED context per thread
+ *
+ * Private and serialized contexts skip the context lock; private contexts
+ * also get an exclusive STX when one is available.  The aggregate rate is
+ * reported with the slowest and fastest thread rates and Jain's fairness
+ * index over all threads of all PEs (1.0 when all threads progress at the
+ * same rate), so lock contention shows up as both a lower rate and a lower
+ * index.  Put sizes above the transport's inject size and up to
+ * SHMEM_BOUNCE_SIZE exercise the bounce buffer free list.
+ *
+ * The STX settings in effect are echoed in the header.  To sweep them, run
+ * the benchmark under each setting, e.g.:
+ *
+ *   for a in round-robin random numa load; do
+ *       SHMEM_OFI_STX_ALLOCATOR=$a oshrun -n 2 ./mt_msgrate -t 8
+ *   done
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <shmem.h>
+
+/* For systems without the PThread barrier API (e.g. MacOS) */
+#include "pthread_barrier.h"
+
+#define MAX_THREADS 64
+
+enum ctx_mode {
+    MODE_DEFAULT = 0,
+    MODE_SHARED,
+    MODE_PRIVATE,
+    MODE_SERIALIZED,
+    NUM_MODES
+};
+
+static const char *mode_names[NUM_MODES] = { "default", "shared", "private", "serialized" };
+
+enum msg_op {
+    OP_PUT = 0,
+    OP_AMO,
+    NUM_MSG_OPS
+};
+
+static const char *op_names[NUM_MSG_OPS] = { "put", "amo" };
+
+static const char *env_echo[] = {
+    "SHMEM_OFI_STX_MAX", "SHMEM_OFI_STX_THRESHOLD", "SHMEM_OFI_STX_ALLOCATOR",
+    "SHMEM_OFI_STX_AUTO", "SHMEM_BOUNCE_SIZE"
+};
+
+static int nthreads = 4;
+static int niters = 1000;
+static int window = 64;
+static size_t nbytes = 8;
+
+static int cur_mode, cur_op;
+static char *dest;
+static char *src;
+static long *amo_dest;
+static shmem_ctx_t shared_ctx;
+static double thread_time[MAX_THREADS];
+
+static pthread_barrier_t start_bar;
+
+static double
+wtime(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1.0e9;
+}
+
+static inline void
+issue_window(shmem_ctx_t ctx, char *my_dest, const char *my_src, long *my_amo, int peer)
+{
+    int j;
+
+    if (cur_op == OP_PUT) {
+        for (j = 0; j < window; j++)
+            shmem_ctx_putmem_nbi(ctx, my_dest, my_src, nbytes, peer);
+    } else {
+        for (j = 0; j < window; j++)
+            shmem_ctx_long_atomic_add(ctx, my_amo, 1, peer);
+    }
+    shmem_ctx_quiet(ctx);
+}
+
+static void *
+thread_main(void *arg)
+{
+    int tid = (int) (intptr_t) arg;
+    int me = shmem_my_pe();
+    int peer = (me + 1) % shmem_n_pes();
+    char *my_dest = dest + tid * nbytes;
+    char *my_src = src + tid * nbytes;
+    long *my_amo = amo_dest + tid;
+    shmem_ctx_t ctx;
+    double start;
+    int i;
+
+    switch (cur_mode) {
+        case MODE_DEFAULT:
+            ctx = SHMEM_CTX_DEFAULT;
+            break;
+        case MODE_SHARED:
+            ctx = shared_ctx;
+            break;
+        default:
+            if (shmem_ctx_create(cur_mode == MODE_PRIVATE ? SHMEM_CTX_PRIVATE :
+                                 SHMEM_CTX_SERIALIZED, &ctx)) {
+                fprintf(stderr, "%d: Thread %d unable to create %s context\n", me, tid,
+                        mode_names[cur_mode]);
+                shmem_global_exit(1);
+            }
+    }
+
+    /* Warm up connections before timing */
+    issue_window(ctx, my_dest, my_src, my_amo, peer);
+
+    pthread_barrier_wait(&start_bar);
+
+    start = wtime();
+    for (i = 0; i < niters; i++)
+        issue_window(ctx, my_dest, my_src, my_amo, peer);
+    thread_time[tid] = wtime() - start;
+
+    if (cur_mode == MODE_PRIVATE || cur_mode == MODE_SERIALIZED)
+        shmem_ctx_destroy(ctx);
+
+    return NULL;
+}
+
+/* Max reduction over {max time, max rate, -min rate}, then a sum reduction
+ * over {sum rate, sum rate^2} */
+static double stats_in[5], stats_out[5];
+
+static void
+run(int mode, int op, int npes, int me)
+{
+    pthread_t threads[MAX_THREADS];
+    double msgs = (double) niters * window;
+    double max_time = 0, max_rate = 0, min_rate = -1, sum = 0, sum_sq = 0;
+    int i;
+
+    cur_mode = mode;
+    cur_op = op;
+
+    pthread_barrier_init(&start_bar, NULL, nthreads);
+
+    shmem_barrier_all();
+
+    for (i = 0; i < nthreads; i++)
+        pthread_create(&threads[i], NULL, thread_main, (void *) (intptr_t) i);
+
+    for (i = 0; i < nthreads; i++)
+        pthread_join(threads[i], NULL);
+
+    pthread_barrier_destroy(&start_bar);
+
+    for (i = 0; i < nthreads; i++) {
+        double rate = msgs / thread_time[i];
+
+        if (thread_time[i] > max_time) max_time = thread_time[i];
+        if (rate > max_rate) max_rate = rate;
+        if (min_rate < 0 || rate < min_rate) min_rate = rate;
+        sum += rate;
+        sum_sq += rate * rate;
+    }
+
+    stats_in[0] = max_time;
+    stats_in[1] = max_rate;
+    stats_in[2] = -min_rate;
+    stats_in[3] = sum;
+    stats_in[4] = sum_sq;
+
+    shmem_barrier_all();
+    shmem_double_max_reduce(SHMEM_TEAM_WORLD, stats_out, stats_in, 3);
+    shmem_double_sum_reduce(SHMEM_TEAM_WORLD, stats_out + 3, stats_in + 3, 2);
+
+    if (me == 0) {
+        double total = msgs * nthreads * npes;
+        double jain = stats_out[3] * stats_out[3] / (nthreads * npes * stats_out[4]);
+
+        printf("%-10s %-4s %8d %8zu %8d %12.3f %12.3f %12.3f %8.3f\n",
+               mode_names[mode], op_names[op], nthreads, op == OP_PUT ? nbytes : sizeof(long),
+               window, total / stats_out[0] / 1.0e6, -stats_out[2] / 1.0e6,
+               stats_out[1] / 1.0e6, jain);
+        fflush(stdout);
+    }
+}
+
+static int
+parse_list(char *arg, const char **names, int n, int *enabled)
+{
+    char *tok, *save = NULL;
+    int i;
+
+    for (i = 0; i < n; i++)
+        enabled[i] = (0 == strcmp(arg, "all"));
+    if (0 == strcmp(arg, "all"))
+        return 0;
+
+    for (tok = strtok_r(arg, ",", &save); tok != NULL; tok = strtok_r(NULL, ",", &save)) {
+        for (i = 0; i < n; i++)
+            if (0 == strcmp(tok, names[i])) break;
+        if (i == n) return 1;
+        enabled[i] = 1;
+    }
+
+    return 0;
+}
+
+static void
+usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-t threads] [-n iterations] [-w window] [-s bytes]\n"
+            "       [-m default,shared,private,serialized|all] [-o put,amo|all] [-H]\n",
+            name);
+}
+
+int
+main(int argc, char *argv[])
+{
+    int modes[NUM_MODES], ops[NUM_MSG_OPS];
+    int provided, me, npes, i, j, ch, header = 1, ret = 0;
+
+    for (i = 0; i < NUM_MODES; i++) modes[i] = 1;
+    for (i = 0; i < NUM_MSG_OPS; i++) ops[i] = 1;
+
+    while ((ch = getopt(argc, argv, "t:n:w:s:m:o:Hh")) != -1) {
+        switch (ch) {
+        case 't':
+            nthreads = atoi(optarg);
+            break;
+        case 'n':
+            niters = atoi(optarg);
+            break;
+        case 'w':
+            window = atoi(optarg);
+            break;
+        case 's':
+            nbytes = (size_t) atol(optarg);
+            break;
+        case 'm':
+            ret = parse_list(optarg, mode_names, NUM_MODES, modes);
+            break;
+        case 'o':
+            ret = parse_list(optarg, op_names, NUM_MSG_OPS, ops);
+            break;
+        case 'H':
+            header = 0;
+            break;
+        default:
+            ret = 1;
+            break;
+        }
+    }
+
+    if (ret != 0 || nthreads < 1 || nthreads > MAX_THREADS || niters < 1 ||
+        window < 1 || nbytes < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    shmem_init_thread(SHMEM_THREAD_MULTIPLE, &provided);
+    me = shmem_my_pe();
+    npes = shmem_n_pes();
+
+    if (provided != SHMEM_THREAD_MULTIPLE) {
+        if (me == 0)
+            printf("Warning: SHMEM_THREAD_MULTIPLE not supported, skipping\n");
+        shmem_finalize();
+        return 0;
+    }
+
+    dest = shmem_malloc(nthreads * nbytes);
+    amo_dest = shmem_calloc(nthreads, sizeof(long));
+    src = malloc(nthreads * nbytes);
+
+    if (dest == NULL || amo_dest == NULL || src == NULL) {
+        fprintf(stderr, "%d: Unable to allocate buffers\n", me);
+        shmem_global_exit(1);
+    }
+
+    memset(src, me, nthreads * nbytes);
+
+    if (shmem_ctx_create(0, &shared_ctx))
+        shared_ctx = SHMEM_CTX_DEFAULT;
+
+    if (me == 0 && header) {
+        printf("#");
+        for (i = 0; i < (int) (sizeof(env_echo) / sizeof(env_echo[0])); i++) {
+            const char *val = getenv(env_echo[i]);
+            printf(" %s=%s", env_echo[i], val ? val : "(default)");
+        }
+        printf("\n%-10s %-4s %8s %8s %8s %12s %12s %12s %8s\n", "# mode", "op", "threads",
+               "bytes", "window", "Mmsg/s", "min thr", "max thr", "jain");
+    }
+
+    for (i = 0; i < NUM_MODES; i++)
+        for (j = 0; j < NUM_MSG_OPS; j++)
+            if (modes[i] && ops[j])
+                run(i, j, npes, me);
+
+    if (shared_ctx != SHMEM_CTX_DEFAULT)
+        shmem_ctx_destroy(shared_ctx);
+
+    shmem_free(amo_dest);
+    shmem_free(dest);
+    free(src);
+
+    shmem_finalize();
+    return 0;
+}
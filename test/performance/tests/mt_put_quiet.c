@@ -0,0 +1,212 @@
+/*
+ *  Copyright (c) 2018 Intel Corporation. All rights reserved.
+ *  This software is available to you under the BSD license below:
+ *
+ *      Redistribution and use in source and binary forms, with or
+ *      without modification, are permitted provided that the following
+ *      conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Multithreaded put/quiet rate.  Each thread issues a window of puts to the
+ * next PE and then quiets its context.  Threads either share one context
+ * (-m shared) or each use a private context (-m private).  Comparing the two
+ * modes, and private mode with SHMEM_UCX_CTX_WORKERS on and off, shows how
+ * quiet and progress scale with the number of threads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <shmem.h>
+
+/* For systems without the PThread barrier API (e.g. MacOS) */
+#include "pthread_barrier.h"
+
+#define MAX_THREADS 64
+
+static int nthreads = 4;
+static int niters = 10000;
+static int window = 16;
+static size_t nbytes = 8;
+static int use_private = 1;
+
+static char *dest;
+static char *src;
+static shmem_ctx_t shared_ctx;
+static double thread_time[MAX_THREADS];
+
+static pthread_barrier_t start_bar;
+
+static double
+wtime(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1.0e6;
+}
+
+static void *
+thread_main(void *arg)
+{
+    int tid = (int) (intptr_t) arg;
+    int me = shmem_my_pe();
+    int peer = (me + 1) % shmem_n_pes();
+    char *my_dest = dest + tid * nbytes;
+    char *my_src = src + tid * nbytes;
+    shmem_ctx_t ctx;
+    double start;
+    int i, j;
+
+    if (use_private) {
+        if (shmem_ctx_create(SHMEM_CTX_PRIVATE, &ctx)) {
+            fprintf(stderr, "%d: Thread %d unable to create private context\n", me, tid);
+            shmem_global_exit(1);
+        }
+    } else {
+        ctx = shared_ctx;
+    }
+
+    /* Warm up connections before timing */
+    shmem_ctx_putmem(ctx, my_dest, my_src, nbytes, peer);
+    shmem_ctx_quiet(ctx);
+
+    pthread_barrier_wait(&start_bar);
+
+    start = wtime();
+    for (i = 0; i < niters; i++) {
+        for (j = 0; j < window; j++)
+            shmem_ctx_putmem_nbi(ctx, my_dest, my_src, nbytes, peer);
+        shmem_ctx_quiet(ctx);
+    }
+    thread_time[tid] = wtime() - start;
+
+    if (use_private)
+        shmem_ctx_destroy(ctx);
+
+    return NULL;
+}
+
+static void
+usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-t threads] [-n iterations] [-w window] "
+            "[-s bytes] [-m shared|private]\n", name);
+}
+
+int
+main(int argc, char *argv[])
+{
+    pthread_t threads[MAX_THREADS];
+    int provided, me, npes, i, ch;
+    static double max_time, time_in;
+
+    while ((ch = getopt(argc, argv, "t:n:w:s:m:h")) != -1) {
+        switch (ch) {
+        case 't':
+            nthreads = atoi(optarg);
+            break;
+        case 'n':
+            niters = atoi(optarg);
+            break;
+        case 'w':
+            window = atoi(optarg);
+            break;
+        case 's':
+            nbytes = (size_t) atol(optarg);
+            break;
+        case 'm':
+            use_private = (0 == strcmp(optarg, "private"));
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (nthreads < 1 || nthreads > MAX_THREADS || niters < 1 ||
+        window < 1 || nbytes < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    shmem_init_thread(SHMEM_THREAD_MULTIPLE, &provided);
+    me = shmem_my_pe();
+    npes = shmem_n_pes();
+
+    if (provided != SHMEM_THREAD_MULTIPLE) {
+        if (me == 0)
+            printf("Warning: SHMEM_THREAD_MULTIPLE not supported, skipping\n");
+        shmem_finalize();
+        return 0;
+    }
+
+    dest = shmem_malloc(nthreads * nbytes);
+    src = malloc(nthreads * nbytes);
+
+    if (dest == NULL || src == NULL) {
+        fprintf(stderr, "%d: Unable to allocate buffers\n", me);
+        shmem_global_exit(1);
+    }
+
+    memset(src, me, nthreads * nbytes);
+
+    if (!use_private && shmem_ctx_create(0, &shared_ctx))
+        shared_ctx = SHMEM_CTX_DEFAULT;
+
+    pthread_barrier_init(&start_bar, NULL, nthreads);
+
+    shmem_barrier_all();
+
+    for (i = 0; i < nthreads; i++)
+        pthread_create(&threads[i], NULL, thread_main, (void *) (intptr_t) i);
+
+    for (i = 0; i < nthreads; i++)
+        pthread_join(threads[i], NULL);
+
+    time_in = 0;
+    for (i = 0; i < nthreads; i++)
+        if (thread_time[i] > time_in) time_in = thread_time[i];
+
+    shmem_double_max_reduce(SHMEM_TEAM_WORLD, &max_time, &time_in, 1);
+
+    if (me == 0) {
+        double msgs = (double) npes * nthreads * niters * window;
+        printf("%-8s %8s %10s %10s %14s %14s\n", "mode", "threads", "bytes",
+               "window", "msgs/s", "quiets/s");
+        printf("%-8s %8d %10zu %10d %14.2f %14.2f\n",
+               use_private ? "private" : "shared", nthreads, nbytes, window,
+               msgs / max_time, (double) npes * nthreads * niters / max_time);
+    }
+
+    if (!use_private && shared_ctx != SHMEM_CTX_DEFAULT)
+        shmem_ctx_destroy(shared_ctx);
+
+    pthread_barrier_destroy(&start_bar);
+    shmem_free(dest);
+    free(src);
+
+    shmem_finalize();
+    return 0;
+}
@@ -0,0 +1,98 @@
+/*
+ *  Copyright (c) 2018 Intel Corporation. All rights reserved.
+ *  This software is available to you under the BSD license below:
+ *
+ *      Redistribution and use in source and binary forms, with or
+ *      without modification, are permitted provided that the following
+ *      conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Each PE writes a buffer to the next PE from a private context, completes it
+ * with shmemx_ctx_quiet_pe, and then sets a flag.  A second round orders the
+ * data and the flag with a fence instead.  The target checks the buffer once
+ * it sees the flag.
+ */
+
+#include <stdio.h>
+#include <shmem.h>
+#include <shmemx.h>
+
+#define NELEMS 512
+#define NROUNDS 2
+
+static long data[NROUNDS][NELEMS];
+static long src[NELEMS];
+static int flag[NROUNDS];
+
+int main(void) {
+    int me, npes, i, r, errors = 0;
+    shmem_ctx_t ctx;
+
+    shmem_init();
+
+    me = shmem_my_pe();
+    npes = shmem_n_pes();
+
+    int target = (me + 1) % npes;
+    int source = (me + npes - 1) % npes;
+
+    if (shmem_ctx_create(SHMEM_CTX_PRIVATE, &ctx))
+        ctx = SHMEM_CTX_DEFAULT;
+
+    for (i = 0; i < NELEMS; i++)
+        src[i] = me * NELEMS + i;
+
+    shmem_barrier_all();
+
+    /* Completing a PE that was not written to is a no-op */
+    shmemx_ctx_quiet_pe(ctx, source);
+
+    shmem_ctx_long_put_nbi(ctx, data[0], src, NELEMS, target);
+    shmemx_ctx_quiet_pe(ctx, target);
+    shmem_ctx_int_p(ctx, &flag[0], 1, target);
+
+    shmem_ctx_long_put_nbi(ctx, data[1], src, NELEMS, target);
+    shmem_ctx_fence(ctx);
+    shmem_ctx_int_p(ctx, &flag[1], 1, target);
+
+    shmem_ctx_quiet(ctx);
+
+    for (r = 0; r < NROUNDS; r++) {
+        shmem_int_wait_until(&flag[r], SHMEM_CMP_EQ, 1);
+
+        for (i = 0; i < NELEMS; i++) {
+            if (data[r][i] != (long) source * NELEMS + i) {
+                printf("%d: round %d, data[%d] = %ld, expected %ld\n", me, r, i,
+                       data[r][i], (long) source * NELEMS + i);
+                errors++;
+                break;
+            }
+        }
+    }
+
+    if (ctx != SHMEM_CTX_DEFAULT)
+        shmem_ctx_destroy(ctx);
+
+    shmem_barrier_all();
+    shmem_finalize();
+
+    return errors != 0;
+}
@@ -0,0 +1,125 @@
+/*
+ *  Copyright (c) 2018 Intel Corporation. All rights reserved.
+ *  This software is available to you under the BSD license below:
+ *
+ *      Redistribution and use in source and binary forms, with or
+ *      without modification, are permitted provided that the following
+ *      conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Validate the float16 and bfloat16 team reductions.  The inputs are small
+ * integers, which both formats represent exactly, so the results can be
+ * compared bit for bit.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <shmem.h>
+#include <shmemx.h>
+
+#define N 1031
+
+/* Bit pattern of a small integer, |v| < 2048 */
+static uint16_t float16_bits(int v) {
+    uint16_t sign = v < 0 ? 0x8000 : 0;
+    unsigned int a = v < 0 ? -v : v;
+    int e = 0;
+
+    if (a == 0) return sign;
+    while ((a >> (e + 1)) != 0) e++;
+
+    return sign | (uint16_t) ((e + 15) << 10) | (uint16_t) ((a << (10 - e)) & 0x3ff);
+}
+
+static uint16_t bfloat16_bits(int v) {
+    float f = (float) v;
+    uint32_t x;
+
+    memcpy(&x, &f, sizeof(x));
+    return (uint16_t) (x >> 16);
+}
+
+static int value(int pe, int i, int op) {
+    /* Sums are of zeros and ones, so they stay exact for large jobs */
+    return op == 0 ? (pe + i) % 2 : (pe * 3 + i) % 16 - 8;
+}
+
+shmemx_float16_t  h_src[N], h_dst[N];
+shmemx_bfloat16_t b_src[N], b_dst[N];
+
+int main(int argc, char **argv) {
+    int me, npes, op, i, p, errors = 0;
+    const char *op_names[] = { "sum", "min", "max" };
+
+    shmem_init();
+    me = shmem_my_pe();
+    npes = shmem_n_pes();
+
+    for (op = 0; op < 3; op++) {
+        for (i = 0; i < N; i++) {
+            uint16_t h = float16_bits(value(me, i, op));
+            uint16_t b = bfloat16_bits(value(me, i, op));
+            memcpy(&h_src[i], &h, sizeof(h));
+            memcpy(&b_src[i], &b, sizeof(b));
+        }
+
+        if (op == 0) {
+            shmemx_float16_sum_reduce(SHMEM_TEAM_WORLD, h_dst, h_src, N);
+            shmemx_bfloat16_sum_reduce(SHMEM_TEAM_WORLD, b_dst, b_src, N);
+        } else if (op == 1) {
+            shmemx_float16_min_reduce(SHMEM_TEAM_WORLD, h_dst, h_src, N);
+            shmemx_bfloat16_min_reduce(SHMEM_TEAM_WORLD, b_dst, b_src, N);
+        } else {
+            shmemx_float16_max_reduce(SHMEM_TEAM_WORLD, h_dst, h_src, N);
+            shmemx_bfloat16_max_reduce(SHMEM_TEAM_WORLD, b_dst, b_src, N);
+        }
+
+        for (i = 0; i < N; i++) {
+            int expected = value(0, i, op);
+            uint16_t h, b;
+
+            for (p = 1; p < npes; p++) {
+                int v = value(p, i, op);
+                if (op == 0) expected += v;
+                else if (op == 1) expected = v < expected ? v : expected;
+                else expected = v > expected ? v : expected;
+            }
+
+            memcpy(&h, &h_dst[i], sizeof(h));
+            memcpy(&b, &b_dst[i], sizeof(b));
+
+            if (h != float16_bits(expected)) {
+                printf("%d: float16 %s [%d] = 0x%04x, expected 0x%04x\n", me,
+                       op_names[op], i, h, float16_bits(expected));
+                errors++;
+            }
+            if (b != bfloat16_bits(expected)) {
+                printf("%d: bfloat16 %s [%d] = 0x%04x, expected 0x%04x\n", me,
+                       op_names[op], i, b, bfloat16_bits(expected));
+                errors++;
+            }
+        }
+    }
+
+    shmem_finalize();
+    return errors != 0;
+}
@@ -0,0 +1,140 @@
+/*
+ *  Copyright (c) 2018 Intel Corporation. All rights reserved.
+ *  This software is available to you under the BSD license below:
+ *
+ *      Redistribution and use in source and binary forms, with or
+ *      without modification, are permitted provided that the following
+ *      conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Validate placement of hinted allocations in the symmetric heap partitions
+ * and the partition statistics query.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <shmem.h>
+#include <shmemx.h>
+
+#define NUM_COUNTERS 8
+#define CACHELINE 64
+
+int main(int argc, char **argv) {
+    int i, me, npes, errors = 0;
+    long *counters[NUM_COUNTERS];
+    shmemx_heap_stats_t before, after;
+    long *buf;
+
+    shmem_init();
+    me = shmem_my_pe();
+    npes = shmem_n_pes();
+
+    if (shmemx_heap_stats(SHMEMX_HEAP_ATOMICS, &before)) {
+        printf("%d: Error, atomics heap query failed\n", me);
+        shmem_global_exit(1);
+    }
+
+    for (i = 0; i < NUM_COUNTERS; i++) {
+        counters[i] = shmem_malloc_with_hints(sizeof(long), SHMEM_MALLOC_ATOMICS_REMOTE);
+        if (counters[i] == NULL) {
+            printf("%d: Error, allocation %d failed\n", me, i);
+            shmem_global_exit(1);
+        }
+        *counters[i] = 0;
+    }
+
+    shmemx_heap_stats(SHMEMX_HEAP_ATOMICS, &after);
+
+    /* Objects placed in the atomics partition must not share cache lines */
+    if (before.size > 0 && after.num_allocs == before.num_allocs + NUM_COUNTERS) {
+        for (i = 0; i < NUM_COUNTERS; i++) {
+            if ((uintptr_t) counters[i] % CACHELINE != 0) {
+                printf("%d: Error, counter %d (%p) is not cache line aligned\n",
+                       me, i, (void *) counters[i]);
+                ++errors;
+            }
+        }
+        if (after.in_use < before.in_use + NUM_COUNTERS * CACHELINE) {
+            printf("%d: Error, atomics heap in use %zu, expected at least %zu\n",
+                   me, after.in_use, before.in_use + NUM_COUNTERS * CACHELINE);
+            ++errors;
+        }
+    } else if (after.num_allocs + after.num_fallbacks !=
+               before.num_allocs + before.num_fallbacks + NUM_COUNTERS) {
+        printf("%d: Error, atomics heap recorded %"PRIu64" allocs and %"PRIu64
+               " fallbacks\n", me, after.num_allocs, after.num_fallbacks);
+        ++errors;
+    }
+
+    for (i = 0; i < NUM_COUNTERS; i++)
+        shmem_long_atomic_inc(counters[i], (me + 1) % npes);
+
+    shmem_barrier_all();
+
+    for (i = 0; i < NUM_COUNTERS; i++) {
+        if (*counters[i] != 1) {
+            printf("%d: Error, counter %d = %ld, expected 1\n", me, i, *counters[i]);
+            ++errors;
+        }
+    }
+
+    for (i = 0; i < NUM_COUNTERS; i++)
+        shmem_free(counters[i]);
+
+    shmemx_heap_stats(SHMEMX_HEAP_ATOMICS, &after);
+    if (after.in_use != before.in_use) {
+        printf("%d: Error, atomics heap in use %zu after free, expected %zu\n",
+               me, after.in_use, before.in_use);
+        ++errors;
+    }
+
+    /* Bulk allocations are served from the default heap when the bulk
+     * partition is disabled or exhausted */
+    shmemx_heap_stats(SHMEMX_HEAP_BULK, &before);
+    buf = shmem_malloc_with_hints(1024 * sizeof(long), SHMEMX_MALLOC_BULK);
+    shmemx_heap_stats(SHMEMX_HEAP_BULK, &after);
+
+    if (buf == NULL) {
+        printf("%d: Error, bulk allocation failed\n", me);
+        ++errors;
+    } else if (after.num_allocs + after.num_fallbacks !=
+               before.num_allocs + before.num_fallbacks + 1) {
+        printf("%d: Error, bulk heap recorded %"PRIu64" allocs and %"PRIu64
+               " fallbacks\n", me, after.num_allocs, after.num_fallbacks);
+        ++errors;
+    }
+
+    buf = shmem_realloc(buf, 2048 * sizeof(long));
+    if (buf == NULL) {
+        printf("%d: Error, bulk reallocation failed\n", me);
+        ++errors;
+    }
+    shmem_free(buf);
+
+    if (shmemx_heap_stats(-1, &after) == 0) {
+        printf("%d: Error, query of invalid heap succeeded\n", me);
+        ++errors;
+    }
+
+    shmem_finalize();
+    return errors != 0;
+}
@@ -0,0 +1,103 @@
+/*
+ *  Copyright (c) 2018 Intel Corporation. All rights reserved.
+ *  This software is available to you under the BSD license below:
+ *
+ *      Redistribution and use in source and binary forms, with or
+ *      without modification, are permitted provided that the following
+ *      conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Exercise the inline RMA and AMO fast paths.  Peers that are not directly
+ * mapped use the library routines.
+ */
+
+#define SHMEMX_INLINE_FASTPATH
+
+#include <stdio.h>
+#include <shmem.h>
+#include <shmemx.h>
+
+long data = -1;
+long counter = 0;
+int flag = 0;
+
+int main(void) {
+    int me, npes, peer, errors = 0;
+    long old;
+
+    shmem_init();
+
+    me = shmem_my_pe();
+    npes = shmem_n_pes();
+    peer = (me + 1) % npes;
+
+    shmem_long_p(&data, me, peer);
+    shmem_barrier_all();
+
+    if (data != (me + npes - 1) % npes) {
+        printf("%d: data = %ld, expected %d\n", me, data, (me + npes - 1) % npes);
+        errors++;
+    }
+
+    if (shmem_long_g(&data, peer) != me) {
+        printf("%d: shmem_long_g returned wrong value\n", me);
+        errors++;
+    }
+
+    shmem_barrier_all();
+
+    /* Every PE increments and adds to the counter on PE 0 */
+    shmem_long_atomic_inc(&counter, 0);
+    shmem_long_atomic_add(&counter, 2, 0);
+    old = shmem_long_atomic_fetch_inc(&counter, 0);
+    if (old < 0 || old >= 4 * npes) {
+        printf("%d: fetch_inc returned %ld\n", me, old);
+        errors++;
+    }
+    shmem_long_atomic_fetch_add(&counter, 1, 0);
+
+    shmem_barrier_all();
+
+    if (me == 0 && shmem_long_atomic_fetch(&counter, 0) != 5 * npes) {
+        printf("%d: counter = %ld, expected %d\n", me, counter, 5 * npes);
+        errors++;
+    }
+
+    /* Only one PE wins the compare and swap */
+    if (shmem_int_atomic_compare_swap(&flag, 0, me + 1, 0) == 0)
+        shmem_int_atomic_set(&flag, -(me + 1), 0);
+
+    shmem_barrier_all();
+
+    if (me == 0 && (flag >= 0 || flag < -npes)) {
+        printf("%d: flag = %d\n", me, flag);
+        errors++;
+    }
+
+    if (me == 0 && shmem_int_atomic_swap(&flag, 0, 0) >= 0) {
+        printf("%d: swap returned a nonnegative value\n", me);
+        errors++;
+    }
+
+    shmem_finalize();
+
+    return errors != 0;
+}
@@ -0,0 +1,103 @@
+/*
+ *  Copyright (c) 2018 Intel Corporation. All rights reserved.
+ *  This software is available to you under the BSD license below:
+ *
+ *      Redistribution and use in source and binary forms, with or
+ *      without modification, are permitted provided that the following
+ *      conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Allocate and free symmetric objects inside a deferred allocation epoch and
+ * validate remote accesses to them.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <shmem.h>
+#include <shmemx.h>
+
+#define NUM_OBJS 64
+#define OBJ_LEN  16
+
+int main(void) {
+    long *objs[NUM_OBJS];
+    static uintptr_t addrs[2];
+    int i, j, me, npes, peer, errors = 0;
+
+    shmem_init();
+
+    me = shmem_my_pe();
+    npes = shmem_n_pes();
+    peer = (me + 1) % npes;
+
+    shmemx_malloc_epoch_begin();
+
+    for (i = 0; i < NUM_OBJS; i++) {
+        objs[i] = shmem_calloc(OBJ_LEN, sizeof(long));
+        if (objs[i] == NULL) {
+            printf("%d: shmem_calloc failed at object %d\n", me, i);
+            shmem_global_exit(1);
+        }
+
+        /* The first access to the peer waits for its allocations */
+        for (j = 0; j < OBJ_LEN; j++)
+            shmem_long_p(&objs[i][j], me * NUM_OBJS + i, peer);
+    }
+
+    /* Freed objects must not be reused before the epoch ends */
+    for (i = 0; i < NUM_OBJS; i += 2)
+        shmem_free(objs[i]);
+
+    shmemx_malloc_epoch_end();
+
+    for (i = 1; i < NUM_OBJS; i += 2) {
+        for (j = 0; j < OBJ_LEN; j++) {
+            long expected = ((me + npes - 1) % npes) * NUM_OBJS + i;
+            if (objs[i][j] != expected) {
+                printf("%d: objs[%d][%d] = %ld, expected %ld\n", me, i, j,
+                       objs[i][j], expected);
+                errors++;
+            }
+        }
+    }
+
+    /* Allocations after the epoch must still be symmetric */
+    objs[0] = shmem_malloc(OBJ_LEN * sizeof(long));
+    addrs[0] = (uintptr_t) objs[0];
+    shmem_barrier_all();
+    shmem_getmem(&addrs[1], &addrs[0], sizeof(uintptr_t), peer);
+
+    if (addrs[0] != addrs[1]) {
+        printf("%d: asymmetric allocation %p, peer has %p\n", me,
+               (void *) addrs[0], (void *) addrs[1]);
+        errors++;
+    }
+
+    shmem_barrier_all();
+
+    shmem_free(objs[0]);
+    for (i = 1; i < NUM_OBJS; i += 2)
+        shmem_free(objs[i]);
+
+    shmem_finalize();
+
+    return errors != 0;
+}
@@ -0,0 +1,160 @@
+/*
+ *  Copyright (c) 2018 Intel Corporation. All rights reserved.
+ *  This software is available to you under the BSD license below:
+ *
+ *      Redistribution and use in source and binary forms, with or
+ *      without modification, are permitted provided that the following
+ *      conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Validate user-defined team reductions: a commutative argmax over
+ * (value, index) pairs, a saturating sum, and a non-commutative composition
+ * of affine maps, which checks that PEs are combined in order.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <shmem.h>
+#include <shmemx.h>
+
+#define N 1000
+#define MOD 1000003
+#define SAT_MAX 100
+
+typedef struct {
+    double value;
+    int    index;
+} argmax_t;
+
+/* x -> a * x + b (mod MOD) */
+typedef struct {
+    uint64_t a;
+    uint64_t b;
+} affine_t;
+
+static void argmax_op(const void *in, void *inout, size_t nelems) {
+    const argmax_t *x = (const argmax_t *) in;
+    argmax_t *y = (argmax_t *) inout;
+    size_t i;
+
+    for (i = 0; i < nelems; i++) {
+        if (x[i].value > y[i].value ||
+            (x[i].value == y[i].value && x[i].index < y[i].index))
+            y[i] = x[i];
+    }
+}
+
+static void sat_sum_op(const void *in, void *inout, size_t nelems) {
+    const int *x = (const int *) in;
+    int *y = (int *) inout;
+    size_t i;
+
+    for (i = 0; i < nelems; i++)
+        y[i] = x[i] + y[i] > SAT_MAX ? SAT_MAX : x[i] + y[i];
+}
+
+/* Apply in, then inout */
+static void affine_op(const void *in, void *inout, size_t nelems) {
+    const affine_t *f = (const affine_t *) in;
+    affine_t *g = (affine_t *) inout;
+    size_t i;
+
+    for (i = 0; i < nelems; i++) {
+        uint64_t a = g[i].a * f[i].a % MOD;
+        uint64_t b = (g[i].a * f[i].b + g[i].b) % MOD;
+        g[i].a = a;
+        g[i].b = b;
+    }
+}
+
+static double argmax_value(int pe, int i) {
+    return (double) ((pe * 7 + i * 13) % 31);
+}
+
+static affine_t affine_of(int pe, int i) {
+    affine_t f;
+    f.a = (uint64_t) (pe + 2) * (i + 1) % MOD;
+    f.b = (uint64_t) (pe * 31 + i) % MOD;
+    return f;
+}
+
+argmax_t am_src[N], am_dst[N];
+int      sat[N], sat_dst[N];
+affine_t af_src[N], af_dst[N];
+
+int main(int argc, char **argv) {
+    int me, npes, i, p, errors = 0;
+
+    shmem_init();
+    me = shmem_my_pe();
+    npes = shmem_n_pes();
+
+    for (i = 0; i < N; i++) {
+        am_src[i].value = argmax_value(me, i);
+        am_src[i].index = me;
+        sat[i] = (me + i) % 5;
+        af_src[i] = affine_of(me, i);
+    }
+
+    shmemx_team_reduce_user(SHMEM_TEAM_WORLD, am_dst, am_src, N, sizeof(argmax_t),
+                            argmax_op, 1);
+    /* In place */
+    shmemx_team_reduce_user(SHMEM_TEAM_WORLD, sat, sat, N, sizeof(int), sat_sum_op, 1);
+    shmemx_team_reduce_user(SHMEM_TEAM_WORLD, af_dst, af_src, N, sizeof(affine_t),
+                            affine_op, 0);
+
+    for (i = 0; i < N; i++) {
+        argmax_t am = { argmax_value(0, i), 0 };
+        affine_t af = affine_of(0, i);
+        int s = i % 5;
+
+        for (p = 1; p < npes; p++) {
+            argmax_t x = { argmax_value(p, i), p };
+            affine_t f = affine_of(p, i);
+            int v = (p + i) % 5;
+
+            if (x.value > am.value) am = x;
+            s = s + v > SAT_MAX ? SAT_MAX : s + v;
+            affine_op(&af, &f, 1);
+            af = f;
+        }
+
+        if (am_dst[i].value != am.value || am_dst[i].index != am.index) {
+            printf("%d: argmax[%d] = (%g, %d), expected (%g, %d)\n", me, i,
+                   am_dst[i].value, am_dst[i].index, am.value, am.index);
+            errors++;
+        }
+        if (sat[i] != s) {
+            printf("%d: saturating sum[%d] = %d, expected %d\n", me, i, sat[i], s);
+            errors++;
+        }
+        if (af_dst[i].a != af.a || af_dst[i].b != af.b) {
+            printf("%d: affine[%d] = (%llu, %llu), expected (%llu, %llu)\n", me, i,
+                   (unsigned long long) af_dst[i].a, (unsigned long long) af_dst[i].b,
+                   (unsigned long long) af.a, (unsigned long long) af.b);
+            errors++;
+        }
+    }
+
+    shmem_finalize();
+    return errors != 0;
+}
@@ -0,0 +1,217 @@
+/*
+ *  Copyright (c) 2018 Intel Corporation. All rights reserved.
+ *  This software is available to you under the BSD license below:
+ *
+ *      Redistribution and use in source and binary forms, with or
+ *      without modification, are permitted provided that the following
+ *      conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Split SHMEM_TEAM_WORLD by color and key, including a split whose members
+ * are in reverse PE order and therefore need an explicit member table.
+ * Validate PE numbering, translation, sync, RMA on a team context, and the
+ * broadcast, reduce, collect, fcollect, and alltoall collectives.
+ */
+
+#include <stdio.h>
+#include <shmem.h>
+#include <shmemx.h>
+
+static long flag;
+static long bcast_src, bcast_dest;
+static long reduce_src, reduce_dest;
+
+static int check_team(shmem_team_t team, int expect_size, int expect_pe, const char *name)
+{
+    int errors = 0;
+    int me = shmem_my_pe();
+
+    if (shmem_team_n_pes(team) != expect_size || shmem_team_my_pe(team) != expect_pe) {
+        printf("%d: %s has size %d and my_pe %d, expected %d and %d\n", me, name,
+               shmem_team_n_pes(team), shmem_team_my_pe(team), expect_size, expect_pe);
+        errors++;
+    }
+
+    if (shmem_team_translate_pe(team, shmem_team_my_pe(team), SHMEM_TEAM_WORLD) != me ||
+        shmem_team_translate_pe(SHMEM_TEAM_WORLD, me, team) != expect_pe) {
+        printf("%d: %s translates incorrectly\n", me, name);
+        errors++;
+    }
+
+    return errors;
+}
+
+/* Run each collective on the team, with values derived from the world PE
+ * numbers.  Team PE 0 is the broadcast root, and in the collect, team PE i
+ * contributes i + 1 elements. */
+static int check_collectives(shmem_team_t team, long *src, long *dest, const char *name)
+{
+    int errors = 0;
+    int me = shmem_my_pe();
+    int npes = shmem_n_pes();
+    int size = shmem_team_n_pes(team);
+    int my_pe = shmem_team_my_pe(team);
+    long expect_sum = 0;
+    int i, j, k;
+
+    for (i = 0; i < npes; i++)
+        src[i] = (long) me * npes + i;
+
+    bcast_src = me;
+    bcast_dest = -1;
+    shmem_long_broadcast(team, &bcast_dest, &bcast_src, 1, 0);
+    if (my_pe != 0 && bcast_dest != shmem_team_translate_pe(team, 0, SHMEM_TEAM_WORLD)) {
+        printf("%d: %s broadcast received %ld\n", me, name, bcast_dest);
+        errors++;
+    }
+
+    reduce_src = me;
+    shmem_long_sum_reduce(team, &reduce_dest, &reduce_src, 1);
+    for (i = 0; i < size; i++)
+        expect_sum += shmem_team_translate_pe(team, i, SHMEM_TEAM_WORLD);
+    if (reduce_dest != expect_sum) {
+        printf("%d: %s sum reduce gave %ld, expected %ld\n", me, name, reduce_dest, expect_sum);
+        errors++;
+    }
+
+    shmem_long_fcollect(team, dest, &src[0], 1);
+    for (i = 0; i < size; i++) {
+        if (dest[i] != (long) shmem_team_translate_pe(team, i, SHMEM_TEAM_WORLD) * npes) {
+            printf("%d: %s fcollect element %d is %ld\n", me, name, i, dest[i]);
+            errors++;
+        }
+    }
+
+    shmem_long_collect(team, dest, src, my_pe + 1);
+    for (i = 0, k = 0; i < size; i++) {
+        for (j = 0; j <= i; j++, k++) {
+            if (dest[k] != (long) shmem_team_translate_pe(team, i, SHMEM_TEAM_WORLD) * npes + j) {
+                printf("%d: %s collect element %d is %ld\n", me, name, k, dest[k]);
+                errors++;
+            }
+        }
+    }
+
+    /* Peers write dest as soon as they enter the alltoall */
+    shmem_team_sync(team);
+    shmem_long_alltoall(team, dest, src, 1);
+    for (i = 0; i < size; i++) {
+        if (dest[i] != (long) shmem_team_translate_pe(team, i, SHMEM_TEAM_WORLD) * npes + my_pe) {
+            printf("%d: %s alltoall element %d is %ld\n", me, name, i, dest[i]);
+            errors++;
+        }
+    }
+
+    return errors;
+}
+
+int main(void) {
+    int me, npes, i, errors = 0;
+    shmem_team_t rev_team, mod_team;
+    shmem_ctx_t ctx;
+    long *src, *dest;
+
+    shmem_init();
+
+    me = shmem_my_pe();
+    npes = shmem_n_pes();
+
+    src = shmem_malloc(npes * sizeof(long));
+    dest = shmem_malloc(npes * npes * sizeof(long));
+
+    /* Two teams, each ordered by decreasing world PE */
+    int color = me % 2;
+    int rev_size = (npes + 1 - color) / 2;
+    int rev_pe = rev_size - 1 - me / 2;
+
+    if (shmemx_team_split_color(SHMEM_TEAM_WORLD, color, -me, NULL, 0, &rev_team)) {
+        printf("%d: Reverse split failed\n", me);
+        shmem_global_exit(1);
+    }
+
+    errors += check_team(rev_team, rev_size, rev_pe, "reverse team");
+
+    for (i = 0; i < rev_size; i++) {
+        int pe = shmem_team_translate_pe(rev_team, i, SHMEM_TEAM_WORLD);
+        if (pe != color + 2 * (rev_size - 1 - i)) {
+            printf("%d: Reverse team PE %d is world PE %d\n", me, i, pe);
+            errors++;
+        }
+    }
+
+    /* Each PE sends its world PE number to the next team PE through a team context */
+    if (shmem_team_create_ctx(rev_team, 0, &ctx)) {
+        printf("%d: Unable to create team context\n", me);
+        shmem_global_exit(1);
+    }
+
+    shmem_ctx_long_p(ctx, &flag, me, (rev_pe + 1) % rev_size);
+    shmem_ctx_quiet(ctx);
+    shmem_team_sync(rev_team);
+
+    i = shmem_team_translate_pe(rev_team, (rev_pe + rev_size - 1) % rev_size, SHMEM_TEAM_WORLD);
+    if (flag != i) {
+        printf("%d: Received %ld, expected %d\n", me, flag, i);
+        errors++;
+    }
+
+    shmem_ctx_destroy(ctx);
+
+    errors += check_collectives(rev_team, src, dest, "reverse team");
+
+    /* PEs not divisible by three join no team */
+    if (shmemx_team_split_color(rev_team, (me % 3) ? SHMEMX_TEAM_COLOR_UNDEFINED : 0,
+                                me, NULL, 0, &mod_team)) {
+        printf("%d: Modulo split failed\n", me);
+        shmem_global_exit(1);
+    }
+
+    if (me % 3) {
+        if (mod_team != SHMEM_TEAM_INVALID) {
+            printf("%d: Expected no team from the modulo split\n", me);
+            errors++;
+        }
+    } else {
+        int mod_size = 0;
+        int mod_pe = 0;
+
+        for (i = color; i < npes; i += 2) {
+            if (i % 3 == 0) {
+                if (i < me) mod_pe++;
+                mod_size++;
+            }
+        }
+
+        errors += check_team(mod_team, mod_size, mod_pe, "modulo team");
+        errors += check_collectives(mod_team, src, dest, "modulo team");
+        shmem_team_sync(mod_team);
+        shmem_team_destroy(mod_team);
+    }
+
+    shmem_team_destroy(rev_team);
+
+    shmem_free(dest);
+    shmem_free(src);
+
+    shmem_finalize();
+
+    return errors != 0;
+}
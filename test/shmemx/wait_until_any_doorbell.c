@@ -0,0 +1,107 @@
+/*
+ *  Copyright (c) 2018 Intel Corporation. All rights reserved.
+ *  This software is available to you under the BSD license below:
+ *
+ *      Redistribution and use in source and binary forms, with or
+ *      without modification, are permitted provided that the following
+ *      conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Each PE sets a few flags in a large array on the next PE and rings the
+ * doorbell bit covering each flag.  The target waits for every flag with
+ * shmemx_int_wait_until_any_doorbell, masking the flags it has already seen.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <shmem.h>
+#include <shmemx.h>
+
+#define NELEMS 4096
+#define NWRITES 8
+
+static int flags[NELEMS];
+static uint64_t doorbell[SHMEMX_DOORBELL_NWORDS(NELEMS, sizeof(int))];
+static int status[NELEMS];
+
+int main(void) {
+    int me, npes, i, errors = 0;
+    int seen[NWRITES] = { 0 };
+
+    shmem_init();
+
+    me = shmem_my_pe();
+    npes = shmem_n_pes();
+
+    int target = (me + 1) % npes;
+    int source = (me + npes - 1) % npes;
+
+    shmem_barrier_all();
+
+    /* Flags are spread across different doorbell words and lines */
+    for (i = 0; i < NWRITES; i++) {
+        size_t idx = (size_t) (me + 1 + i * 509) % NELEMS;
+        shmem_int_p(&flags[idx], 1, target);
+        shmem_fence();
+        shmem_uint64_atomic_or(&doorbell[SHMEMX_DOORBELL_WORD(idx, sizeof(int))],
+                               SHMEMX_DOORBELL_BIT(idx, sizeof(int)), target);
+    }
+
+    for (i = 0; i < NWRITES; i++) {
+        size_t idx = shmemx_int_wait_until_any_doorbell(flags, NELEMS, status, SHMEM_CMP_EQ,
+                                                         1, doorbell);
+        int j, found = 0;
+
+        if (idx >= NELEMS) {
+            printf("%d: wait_until_any_doorbell returned %zu\n", me, idx);
+            shmem_global_exit(1);
+        }
+
+        for (j = 0; j < NWRITES; j++) {
+            if ((size_t) (source + 1 + j * 509) % NELEMS == idx && !seen[j]) {
+                seen[j] = 1;
+                found = 1;
+            }
+        }
+
+        if (!found) {
+            printf("%d: Unexpected flag %zu\n", me, idx);
+            errors++;
+        }
+
+        status[idx] = 1;
+    }
+
+    /* A NULL doorbell falls back to scanning the whole array */
+    for (i = 0; i < NELEMS; i++)
+        status[i] = (flags[i] == 0);
+
+    if (shmemx_int_wait_until_any_doorbell(flags, NELEMS, status, SHMEM_CMP_EQ, 1,
+                                           NULL) >= NELEMS) {
+        printf("%d: wait_until_any_doorbell without a doorbell failed\n", me);
+        errors++;
+    }
+
+    shmem_barrier_all();
+    shmem_finalize();
+
+    return errors != 0;
+}
@@ -0,0 +1,123 @@
+/*
+ *  Copyright (c) 2018 Intel Corporation. All rights reserved.
+ *  This software is available to you under the BSD license below:
+ *
+ *      Redistribution and use in source and binary forms, with or
+ *      without modification, are permitted provided that the following
+ *      conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Collect with the algorithm given by COLLECT_ALGORITHM, forced through
+ * SHMEM_COLLECT_ALGORITHM, on teams of every size from 1 to the number of
+ * PEs, so that odd, even, and non-power-of-two sizes are covered whatever
+ * the launch size.  Each PE contributes a different number of elements,
+ * and every third PE contributes none.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <shmem.h>
+
+#ifndef COLLECT_ALGORITHM
+#define COLLECT_ALGORITHM "ring"
+#endif
+
+static const size_t bases[] = { 1, 100, 5000 };
+#define MAX_BASE 5000
+
+static size_t contrib_len(int team_pe, size_t base)
+{
+    return (team_pe % 3 == 2) ? 0 : base + team_pe;
+}
+
+static long value(int world_pe, size_t i)
+{
+    return ((long) world_pe << 32) + (long) i;
+}
+
+int main(void)
+{
+    long *src, *dest;
+    int me, npes, size, b, errors = 0;
+
+    setenv("SHMEM_COLLECT_ALGORITHM", COLLECT_ALGORITHM, 0);
+
+    shmem_init();
+
+    me   = shmem_my_pe();
+    npes = shmem_n_pes();
+
+    src  = shmem_malloc((MAX_BASE + npes) * sizeof(long));
+    dest = shmem_malloc((size_t) npes * (MAX_BASE + npes) * sizeof(long));
+
+    if (src == NULL || dest == NULL) {
+        fprintf(stderr, "%d: Allocation failed\n", me);
+        shmem_global_exit(1);
+    }
+
+    for (size = 1; size <= npes; size++) {
+        shmem_team_t team;
+
+        shmem_team_split_strided(SHMEM_TEAM_WORLD, 0, 1, size, NULL, 0, &team);
+
+        if (team != SHMEM_TEAM_INVALID) {
+            int team_me = shmem_team_my_pe(team);
+
+            for (b = 0; b < (int) (sizeof(bases) / sizeof(bases[0])); b++) {
+                size_t len = contrib_len(team_me, bases[b]), off = 0, i;
+                int pe;
+
+                for (i = 0; i < len; i++)
+                    src[i] = value(me, i);
+
+                shmem_long_collect(team, dest, src, len);
+
+                for (pe = 0; pe < size; pe++) {
+                    size_t pe_len = contrib_len(pe, bases[b]);
+
+                    for (i = 0; i < pe_len; i++) {
+                        if (dest[off + i] != value(pe, i)) {
+                            printf("%d: %s team size %d base %zu: dest[%zu] = %lx, expected %lx\n",
+                                   me, COLLECT_ALGORITHM, size, bases[b], off + i,
+                                   dest[off + i], value(pe, i));
+                            errors++;
+                            break;
+                        }
+                    }
+                    off += pe_len;
+                }
+
+                shmem_team_sync(team);
+            }
+
+            shmem_team_destroy(team);
+        }
+
+        shmem_barrier_all();
+    }
+
+    shmem_free(dest);
+    shmem_free(src);
+
+    shmem_finalize();
+
+    return errors != 0;
+}
@@ -0,0 +1,113 @@
+/*
+ *  Copyright (c) 2018 Intel Corporation. All rights reserved.
+ *  This software is available to you under the BSD license below:
+ *
+ *      Redistribution and use in source and binary forms, with or
+ *      without modification, are permitted provided that the following
+ *      conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Fcollect with the algorithm given by FCOLLECT_ALGORITHM, forced through
+ * SHMEM_FCOLLECT_ALGORITHM, on teams of every size from 1 to the number of
+ * PEs, so that odd, even, and non-power-of-two sizes are covered whatever
+ * the launch size.  Lengths that are not a multiple of the cache line size
+ * are included.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <shmem.h>
+
+#ifndef FCOLLECT_ALGORITHM
+#define FCOLLECT_ALGORITHM "bruck"
+#endif
+
+static const size_t lens[] = { 1, 3, 100, 5001 };
+#define MAX_LEN 5001
+
+static long value(int world_pe, size_t i)
+{
+    return ((long) world_pe << 32) + (long) i;
+}
+
+int main(void)
+{
+    long *src, *dest;
+    int me, npes, size, l, errors = 0;
+
+    setenv("SHMEM_FCOLLECT_ALGORITHM", FCOLLECT_ALGORITHM, 0);
+
+    shmem_init();
+
+    me   = shmem_my_pe();
+    npes = shmem_n_pes();
+
+    src  = shmem_malloc(MAX_LEN * sizeof(long));
+    dest = shmem_malloc((size_t) npes * MAX_LEN * sizeof(long));
+
+    if (src == NULL || dest == NULL) {
+        fprintf(stderr, "%d: Allocation failed\n", me);
+        shmem_global_exit(1);
+    }
+
+    for (size = 1; size <= npes; size++) {
+        shmem_team_t team;
+
+        shmem_team_split_strided(SHMEM_TEAM_WORLD, 0, 1, size, NULL, 0, &team);
+
+        if (team != SHMEM_TEAM_INVALID) {
+            for (l = 0; l < (int) (sizeof(lens) / sizeof(lens[0])); l++) {
+                size_t len = lens[l], i;
+                int pe;
+
+                for (i = 0; i < len; i++)
+                    src[i] = value(me, i);
+
+                shmem_long_fcollect(team, dest, src, len);
+
+                for (pe = 0; pe < size; pe++) {
+                    for (i = 0; i < len; i++) {
+                        if (dest[pe * len + i] != value(pe, i)) {
+                            printf("%d: %s team size %d len %zu: dest[%zu] = %lx, expected %lx\n",
+                                   me, FCOLLECT_ALGORITHM, size, len, pe * len + i,
+                                   dest[pe * len + i], value(pe, i));
+                            errors++;
+                            break;
+                        }
+                    }
+                }
+
+                shmem_team_sync(team);
+            }
+
+            shmem_team_destroy(team);
+        }
+
+        shmem_barrier_all();
+    }
+
+    shmem_free(dest);
+    shmem_free(src);
+
+    shmem_finalize();
+
+    return errors != 0;
+}
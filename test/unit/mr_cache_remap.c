@@ -0,0 +1,120 @@
+/*
+ *  Copyright (c) 2018 Intel Corporation. All rights reserved.
+ *  This software is available to you under the BSD license below:
+ *
+ *      Redistribution and use in source and binary forms, with or
+ *      without modification, are permitted provided that the following
+ *      conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Large puts from and gets into a private buffer that is unmapped and then
+ * mapped again at the same address with new pages, with the OFI memory
+ * registration cache enabled.  A registration left over from the old pages
+ * would transfer stale data.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <shmem.h>
+
+#define LEN   (1024 * 1024)
+#define ITERS 8
+
+static long pattern(int pe, int iter, size_t i)
+{
+    return ((long) pe << 40) + ((long) iter << 24) + (long) i;
+}
+
+int main(void)
+{
+    long *target, *buf;
+    void *addr = NULL;
+    int me, npes, peer, iter, errors = 0;
+    size_t i, nelems = LEN / sizeof(long);
+
+    setenv("SHMEM_OFI_MR_CACHE_SIZE", "16", 0);
+    setenv("SHMEM_OFI_MR_CACHE_THRESHOLD", "4096", 0);
+
+    shmem_init();
+
+    me   = shmem_my_pe();
+    npes = shmem_n_pes();
+    peer = (me + 1) % npes;
+
+    target = shmem_malloc(LEN);
+    if (target == NULL) {
+        fprintf(stderr, "%d: shmem_malloc failed\n", me);
+        shmem_global_exit(1);
+    }
+
+    for (iter = 0; iter < ITERS; iter++) {
+        /* Map the buffer again at the address of the previous mapping */
+        buf = mmap(addr, LEN, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | (addr ? MAP_FIXED : 0), -1, 0);
+        if (buf == MAP_FAILED) {
+            perror("mmap");
+            shmem_global_exit(1);
+        }
+        addr = buf;
+
+        for (i = 0; i < nelems; i++)
+            buf[i] = pattern(me, iter, i);
+
+        shmem_putmem(target, buf, LEN, peer);
+        shmem_barrier_all();
+
+        for (i = 0; i < nelems; i++) {
+            if (target[i] != pattern((me + npes - 1) % npes, iter, i)) {
+                printf("%d: iter %d: put target[%zu] = %lx, expected %lx\n", me, iter, i,
+                       target[i], pattern((me + npes - 1) % npes, iter, i));
+                errors++;
+                break;
+            }
+        }
+
+        /* Read back what the next PE received, through the same buffer */
+        memset(buf, 0, LEN);
+        shmem_getmem(buf, target, LEN, peer);
+
+        for (i = 0; i < nelems; i++) {
+            if (buf[i] != pattern(me, iter, i)) {
+                printf("%d: iter %d: get buf[%zu] = %lx, expected %lx\n", me, iter, i,
+                       buf[i], pattern(me, iter, i));
+                errors++;
+                break;
+            }
+        }
+
+        shmem_barrier_all();
+
+        if (munmap(buf, LEN)) {
+            perror("munmap");
+            shmem_global_exit(1);
+        }
+    }
+
+    shmem_free(target);
+    shmem_finalize();
+
+    return errors != 0;
+}
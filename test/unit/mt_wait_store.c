@@ -0,0 +1,112 @@
+/*
+ *  Copyright (c) 2018 Intel Corporation. All rights reserved.
+ *  This software is available to you under the BSD license below:
+ *
+ *      Redistribution and use in source and binary forms, with or
+ *      without modification, are permitted provided that the following
+ *      conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Several threads block in wait_until on different variables, which are
+ * then changed one at a time, in reverse order, with plain stores from the
+ * main thread.  Each waiter must return once its own variable changes, even
+ * though the stores generate no network traffic.  A second round does the
+ * same with puts from the previous PE.
+ */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <shmem.h>
+
+#define NUM_THREADS 4
+
+static int store_var[NUM_THREADS];
+static int put_var[NUM_THREADS];
+static int done[NUM_THREADS];
+
+static void *waiter_fn(void *arg) {
+    int i = (int) (long) arg;
+
+    shmem_int_wait_until(&store_var[i], SHMEM_CMP_EQ, i + 1);
+    __atomic_store_n(&done[i], 1, __ATOMIC_RELEASE);
+
+    shmem_int_wait_until(&put_var[i], SHMEM_CMP_EQ, i + 1);
+    return NULL;
+}
+
+int main(void) {
+    pthread_t threads[NUM_THREADS];
+    int tl, ret, me, npes, i, j, errors = 0;
+
+    ret = shmem_init_thread(SHMEM_THREAD_MULTIPLE, &tl);
+
+    if (tl != SHMEM_THREAD_MULTIPLE || ret != 0) {
+        printf("Init failed (requested thread level %d, got %d, ret %d)\n",
+               SHMEM_THREAD_MULTIPLE, tl, ret);
+
+        if (ret == 0) {
+            shmem_global_exit(1);
+        } else {
+            return ret;
+        }
+    }
+
+    me = shmem_my_pe();
+    npes = shmem_n_pes();
+
+    for (i = 0; i < NUM_THREADS; i++) {
+        ret = pthread_create(&threads[i], NULL, waiter_fn, (void *) (long) i);
+        if (ret) {
+            printf("%d: pthread_create failed (%d)\n", me, ret);
+            shmem_global_exit(1);
+        }
+    }
+
+    /* Give the waiters time to block before each store.  Only the thread
+     * waiting on the stored variable may return. */
+    for (i = NUM_THREADS - 1; i >= 0; i--) {
+        sleep(1);
+        __atomic_store_n(&store_var[i], i + 1, __ATOMIC_RELEASE);
+
+        while (!__atomic_load_n(&done[i], __ATOMIC_ACQUIRE))
+            usleep(1000);
+
+        for (j = 0; j < i; j++) {
+            if (__atomic_load_n(&done[j], __ATOMIC_ACQUIRE)) {
+                printf("%d: Thread %d returned before its variable was stored\n", me, j);
+                errors++;
+            }
+        }
+    }
+
+    shmem_barrier_all();
+
+    for (i = NUM_THREADS - 1; i >= 0; i--)
+        shmem_int_p(&put_var[i], i + 1, (me + 1) % npes);
+
+    for (i = 0; i < NUM_THREADS; i++)
+        pthread_join(threads[i], NULL);
+
+    shmem_finalize();
+
+    return errors != 0;
+}
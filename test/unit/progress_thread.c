@@ -0,0 +1,121 @@
+/*
+ *  Copyright (c) 2018 Intel Corporation. All rights reserved.
+ *  This software is available to you under the BSD license below:
+ *
+ *      Redistribution and use in source and binary forms, with or
+ *      without modification, are permitted provided that the following
+ *      conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Communication with the OFI progress thread enabled.  Contexts are created
+ * and destroyed while the thread polls them, and PE 0 computes outside the
+ * library while the other PEs target it with puts and atomics.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <shmem.h>
+
+#define NUM_CTX 8
+#define LEN     4096
+#define ITERS   16
+
+long counter = 0;
+long data[LEN];
+
+static double wtime(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+int main(void)
+{
+    static long src[LEN];
+    shmem_ctx_t ctx[NUM_CTX];
+    int me, npes, iter, i, errors = 0;
+    volatile double x = 0;
+
+    setenv("SHMEM_OFI_PROGRESS_INTERVAL", "100", 0);
+
+    shmem_init();
+
+    me   = shmem_my_pe();
+    npes = shmem_n_pes();
+
+    for (iter = 0; iter < ITERS; iter++) {
+        for (i = 0; i < NUM_CTX; i++)
+            if (shmem_ctx_create(i % 2 ? SHMEM_CTX_PRIVATE : 0, &ctx[i]))
+                ctx[i] = SHMEM_CTX_DEFAULT;
+
+        for (i = 0; i < LEN; i++)
+            src[i] = (long) me * LEN + i + iter;
+
+        shmem_barrier_all();
+
+        if (me == 0) {
+            /* Compute without calling the library, so that only the progress
+             * thread can progress operations targeting this PE */
+            double start = wtime();
+
+            while (wtime() - start < 0.01)
+                x += 1.0;
+        }
+
+        shmem_ctx_long_put_nbi(ctx[iter % NUM_CTX], data, src, LEN, (me + 1) % npes);
+        for (i = 0; i < NUM_CTX; i++)
+            shmem_ctx_long_atomic_add(ctx[i], &counter, 1, 0);
+
+        for (i = 0; i < NUM_CTX; i++) {
+            shmem_ctx_quiet(ctx[i]);
+            if (ctx[i] != SHMEM_CTX_DEFAULT)
+                shmem_ctx_destroy(ctx[i]);
+        }
+
+        shmem_barrier_all();
+
+        for (i = 0; i < LEN; i++) {
+            long expected = (long) ((me + npes - 1) % npes) * LEN + i + iter;
+
+            if (data[i] != expected) {
+                printf("%d: iter %d: data[%d] = %ld, expected %ld\n",
+                       me, iter, i, data[i], expected);
+                errors++;
+                break;
+            }
+        }
+
+        shmem_barrier_all();
+    }
+
+    if (me == 0 && counter != (long) ITERS * NUM_CTX * npes) {
+        printf("%d: counter = %ld, expected %ld\n", me, counter,
+               (long) ITERS * NUM_CTX * npes);
+        errors++;
+    }
+
+    shmem_finalize();
+
+    return errors != 0;
+}
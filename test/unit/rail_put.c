@@ -0,0 +1,122 @@
+/*
+ *  Copyright (c) 2018 Intel Corporation. All rights reserved.
+ *  This software is available to you under the BSD license below:
+ *
+ *      Redistribution and use in source and binary forms, with or
+ *      without modification, are permitted provided that the following
+ *      conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Put and get transfers of sizes and alignments that are striped across
+ * several OFI rails, using a stripe size small enough that most transfers
+ * are split.  With transports or providers that have a single rail, the
+ * transfers take the regular path.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <shmem.h>
+
+#define MAX_LEN (256 * 1024 + 3)
+
+static const size_t lens[] = { 1, 63, 4096, 8191, 8192, 12345, 3 * 4096 + 64,
+                               65536, 65536 + 17, 256 * 1024 };
+static const size_t offs[] = { 0, 3, 64 };
+
+static unsigned char pattern(int pe, size_t i, size_t len)
+{
+    return (unsigned char) (pe * 131 + i * 7 + len);
+}
+
+int main(void)
+{
+    int me, npes, peer, errors = 0;
+    size_t l, o, i;
+    unsigned char *src, *dest, *local;
+
+    setenv("SHMEM_OFI_RAILS", "4", 0);
+    setenv("SHMEM_OFI_RAIL_STRIPE_SIZE", "4096", 0);
+
+    shmem_init();
+
+    me   = shmem_my_pe();
+    npes = shmem_n_pes();
+    peer = (me + 1) % npes;
+
+    src   = shmem_malloc(MAX_LEN + 64);
+    dest  = shmem_malloc(MAX_LEN + 64);
+    local = malloc(MAX_LEN + 64);
+
+    if (src == NULL || dest == NULL || local == NULL) {
+        fprintf(stderr, "%d: Allocation failed\n", me);
+        shmem_global_exit(1);
+    }
+
+    for (l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+        for (o = 0; o < sizeof(offs) / sizeof(offs[0]); o++) {
+            size_t len = lens[l], off = offs[o];
+
+            for (i = 0; i < len; i++)
+                src[off + i] = pattern(me, i, len);
+            memset(dest, 0, MAX_LEN + 64);
+            shmem_barrier_all();
+
+            /* Put to the next PE, then check the data received from the
+             * previous PE */
+            shmem_putmem(dest + off, src + off, len, peer);
+            shmem_barrier_all();
+
+            for (i = 0; i < len; i++) {
+                if (dest[off + i] != pattern((me + npes - 1) % npes, i, len)) {
+                    printf("%d: put len %zu off %zu: dest[%zu] = %d, expected %d\n",
+                           me, len, off, i, dest[off + i],
+                           pattern((me + npes - 1) % npes, i, len));
+                    errors++;
+                    break;
+                }
+            }
+
+            /* Get from the next PE into a private buffer */
+            memset(local, 0, MAX_LEN + 64);
+            shmem_getmem(local + off, src + off, len, peer);
+
+            for (i = 0; i < len; i++) {
+                if (local[off + i] != pattern(peer, i, len)) {
+                    printf("%d: get len %zu off %zu: local[%zu] = %d, expected %d\n",
+                           me, len, off, i, local[off + i], pattern(peer, i, len));
+                    errors++;
+                    break;
+                }
+            }
+
+            shmem_barrier_all();
+        }
+    }
+
+    free(local);
+    shmem_free(dest);
+    shmem_free(src);
+
+    shmem_finalize();
+
+    return errors != 0;
+}
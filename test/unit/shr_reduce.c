@@ -0,0 +1,154 @@
+/*
+ *  Copyright (c) 2018 Intel Corporation. All rights reserved.
+ *  This software is available to you under the BSD license below:
+ *
+ *      Redistribution and use in source and binary forms, with or
+ *      without modification, are permitted provided that the following
+ *      conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Reductions with SHMEM_REDUCE_ALGORITHM=shr, which uses the shared memory
+ * reduction when all PEs of the team can be reached through load/store and
+ * ring otherwise.  Counts that do not divide into cache lines, targets that
+ * start inside a cache line, in-place reductions, and a team of every other
+ * PE are covered.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <shmem.h>
+
+#define MAX_COUNT 5000
+#define MAX_OFF   7
+
+static const int counts[] = { 1, 3, 8, 15, 64, 127, 1000, MAX_COUNT };
+
+static int check_long(const long *v, int count, long expected_base, long scale,
+                      const char *what, int off)
+{
+    int i;
+
+    for (i = 0; i < count; i++) {
+        long expected = expected_base + scale * i;
+
+        if (v[i] != expected) {
+            printf("%d: %s count %d off %d: [%d] = %ld, expected %ld\n",
+                   shmem_my_pe(), what, count, off, i, v[i], expected);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int run(shmem_team_t team, long *lsrc, long *ldest, double *dsrc, double *ddest)
+{
+    int me = shmem_team_my_pe(team), npes = shmem_team_n_pes(team);
+    long sum_pes = (long) npes * (npes - 1) / 2;
+    int c, off, i, errors = 0;
+
+    for (c = 0; c < (int) (sizeof(counts) / sizeof(counts[0])); c++) {
+        for (off = 0; off <= MAX_OFF; off += MAX_OFF) {
+            int count = counts[c];
+
+            /* Sum of long, out of place, with source and target offset */
+            for (i = 0; i < count; i++)
+                lsrc[off + i] = me + (long) i * npes;
+
+            shmem_long_sum_reduce(team, ldest + off, lsrc + off, count);
+            errors += check_long(ldest + off, count, sum_pes, (long) npes * npes,
+                                 "long sum", off);
+
+            /* Max of long, in place */
+            for (i = 0; i < count; i++)
+                ldest[off + i] = (me == (i % npes)) ? 1000 + i : i;
+
+            shmem_team_sync(team);
+            shmem_long_max_reduce(team, ldest + off, ldest + off, count);
+            errors += check_long(ldest + off, count, 1000, 1, "long max in place", off);
+
+            /* Sum of double, out of place */
+            for (i = 0; i < count; i++)
+                dsrc[off + i] = 0.5 * (me + 1);
+
+            shmem_double_sum_reduce(team, ddest + off, dsrc + off, count);
+            for (i = 0; i < count; i++) {
+                if (ddest[off + i] != 0.25 * npes * (npes + 1)) {
+                    printf("%d: double sum count %d off %d: [%d] = %f, expected %f\n",
+                           shmem_my_pe(), count, off, i, ddest[off + i],
+                           0.25 * npes * (npes + 1));
+                    errors++;
+                    break;
+                }
+            }
+
+            shmem_team_sync(team);
+        }
+    }
+
+    return errors;
+}
+
+int main(void)
+{
+    shmem_team_t even_team;
+    long *lsrc, *ldest;
+    double *dsrc, *ddest;
+    int me, npes, errors = 0;
+
+    setenv("SHMEM_REDUCE_ALGORITHM", "shr", 0);
+
+    shmem_init();
+
+    me   = shmem_my_pe();
+    npes = shmem_n_pes();
+
+    lsrc  = shmem_malloc((MAX_COUNT + MAX_OFF) * sizeof(long));
+    ldest = shmem_malloc((MAX_COUNT + MAX_OFF) * sizeof(long));
+    dsrc  = shmem_malloc((MAX_COUNT + MAX_OFF) * sizeof(double));
+    ddest = shmem_malloc((MAX_COUNT + MAX_OFF) * sizeof(double));
+
+    if (lsrc == NULL || ldest == NULL || dsrc == NULL || ddest == NULL) {
+        fprintf(stderr, "%d: Allocation failed\n", me);
+        shmem_global_exit(1);
+    }
+
+    errors += run(SHMEM_TEAM_WORLD, lsrc, ldest, dsrc, ddest);
+
+    shmem_team_split_strided(SHMEM_TEAM_WORLD, 0, 2, (npes + 1) / 2, NULL, 0, &even_team);
+
+    if (even_team != SHMEM_TEAM_INVALID) {
+        errors += run(even_team, lsrc, ldest, dsrc, ddest);
+        shmem_team_destroy(even_team);
+    }
+
+    shmem_barrier_all();
+
+    shmem_free(ddest);
+    shmem_free(dsrc);
+    shmem_free(ldest);
+    shmem_free(lsrc);
+
+    shmem_finalize();
+
+    return errors != 0;
+}
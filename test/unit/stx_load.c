@@ -0,0 +1,121 @@
+/*
+ *  Copyright (c) 2018 Intel Corporation. All rights reserved.
+ *  This software is available to you under the BSD license below:
+ *
+ *      Redistribution and use in source and binary forms, with or
+ *      without modification, are permitted provided that the following
+ *      conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Contexts allocated with the load-aware STX allocator.  Contexts are
+ * created while others sharing the few available STXs have puts in flight,
+ * and some are destroyed and replaced, so that the allocator reads the
+ * counters of busy, idle, and retired contexts.  The data moved on every
+ * context is checked.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <shmem.h>
+
+#define NUM_CTX 16
+#define LEN     1024
+
+long data[NUM_CTX][LEN];
+
+static int check(int ctx_idx, int round, int src_pe)
+{
+    int i, errors = 0;
+
+    for (i = 0; i < LEN; i++) {
+        long expected = ((long) src_pe * NUM_CTX + ctx_idx) * LEN + i + round;
+
+        if (data[ctx_idx][i] != expected) {
+            printf("%d: round %d ctx %d: data[%d] = %ld, expected %ld\n",
+                   shmem_my_pe(), round, ctx_idx, i, data[ctx_idx][i], expected);
+            errors++;
+            break;
+        }
+    }
+
+    return errors;
+}
+
+int main(void)
+{
+    static long src[NUM_CTX][LEN];
+    shmem_ctx_t ctx[NUM_CTX];
+    int me, npes, peer, round, i, j, errors = 0;
+
+    setenv("SHMEM_OFI_STX_ALLOCATOR", "load", 0);
+    setenv("SHMEM_OFI_STX_MAX", "4", 0);
+
+    shmem_init();
+
+    me   = shmem_my_pe();
+    npes = shmem_n_pes();
+    peer = (me + 1) % npes;
+
+    for (round = 0; round < 2; round++) {
+        for (i = 0; i < NUM_CTX; i++)
+            for (j = 0; j < LEN; j++)
+                src[i][j] = ((long) me * NUM_CTX + i) * LEN + j + round;
+
+        /* In the second round, only the odd contexts are replaced */
+        for (i = 0; i < NUM_CTX; i++) {
+            if (round > 0 && i % 2 == 0)
+                continue;
+
+            if (shmem_ctx_create(0, &ctx[i])) {
+                printf("%d: Warning, could not create context %d\n", me, i);
+                ctx[i] = SHMEM_CTX_DEFAULT;
+            }
+
+            /* Leave the put outstanding while the next context is created */
+            shmem_ctx_long_put_nbi(ctx[i], data[i], src[i], LEN, peer);
+        }
+
+        for (i = 0; i < NUM_CTX; i++) {
+            if (round > 0 && i % 2 == 0)
+                shmem_ctx_long_put_nbi(ctx[i], data[i], src[i], LEN, peer);
+            shmem_ctx_quiet(ctx[i]);
+        }
+
+        shmem_barrier_all();
+
+        for (i = 0; i < NUM_CTX; i++)
+            errors += check(i, round, (me + npes - 1) % npes);
+
+        shmem_barrier_all();
+
+        for (i = 1; i < NUM_CTX; i += 2)
+            if (ctx[i] != SHMEM_CTX_DEFAULT)
+                shmem_ctx_destroy(ctx[i]);
+    }
+
+    for (i = 0; i < NUM_CTX; i += 2)
+        if (ctx[i] != SHMEM_CTX_DEFAULT)
+            shmem_ctx_destroy(ctx[i]);
+
+    shmem_finalize();
+
+    return errors != 0;
+}
@@ -0,0 +1,109 @@
+/*
+ *  Copyright (c) 2018 Intel Corporation. All rights reserved.
+ *  This software is available to you under the BSD license below:
+ *
+ *      Redistribution and use in source and binary forms, with or
+ *      without modification, are permitted provided that the following
+ *      conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Repeatedly split the on-node team into subteams with changing members,
+ * synchronize each an odd or even number of times, and destroy it.  Team indices
+ * are reused by teams with different members, so this checks that a new
+ * team does not inherit the shared memory barrier state of the old one.
+ * Each sync is checked by having every member publish the round to the
+ * first member of the team before the sync.
+ */
+
+#include <stdio.h>
+#include <shmem.h>
+
+#define ITERS  12
+#define ROUNDS 3
+
+int main(void)
+{
+    static long round_seen[1024];
+    int me, npes, iter, errors = 0;
+
+    shmem_init();
+
+    me   = shmem_team_my_pe(SHMEM_TEAM_SHARED);
+    npes = shmem_team_n_pes(SHMEM_TEAM_SHARED);
+
+    if (npes > 1024) {
+        if (me == 0)
+            printf("Skipping test, too many PEs on the node\n");
+        shmem_finalize();
+        return 0;
+    }
+
+    for (iter = 0; iter < ITERS; iter++) {
+        shmem_team_t team;
+        int start  = iter % 2;
+        int stride = (iter / 2) % 2 + 1;
+        int size   = (npes - start + stride - 1) / stride;
+
+        if (size < 1) {
+            start = 0;
+            size = npes;
+        }
+
+        shmem_team_split_strided(SHMEM_TEAM_SHARED, start, stride, size, NULL, 0, &team);
+
+        if (team != SHMEM_TEAM_INVALID) {
+            int team_me = shmem_team_my_pe(team), team_npes = shmem_team_n_pes(team);
+            int root = shmem_team_translate_pe(team, 0, SHMEM_TEAM_SHARED);
+            int round, i;
+
+            for (round = 1; round <= ROUNDS; round++) {
+                shmem_long_p(&round_seen[team_me], (long) iter * ROUNDS + round,
+                             shmem_team_translate_pe(SHMEM_TEAM_SHARED, root, SHMEM_TEAM_WORLD));
+                shmem_quiet();
+                shmem_team_sync(team);
+
+                if (team_me == 0) {
+                    for (i = 0; i < team_npes; i++) {
+                        if (round_seen[i] != (long) iter * ROUNDS + round) {
+                            printf("%d: iter %d round %d: member %d at %ld\n",
+                                   shmem_my_pe(), iter, round, i, round_seen[i]);
+                            errors++;
+                        }
+                    }
+                }
+
+                shmem_team_sync(team);
+            }
+
+            /* Leave every other team with its barrier in the opposite sense */
+            if (iter % 2)
+                shmem_team_sync(team);
+
+            shmem_team_destroy(team);
+        }
+
+        shmem_sync_all();
+    }
+
+    shmem_finalize();
+
+    return errors != 0;
+}